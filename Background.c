@@ -1,4 +1,5 @@
 ﻿#include "Background.h"
+#include "JobSystem.h"
 #include <math.h>
 #include <raymath.h>
 
@@ -17,6 +18,7 @@ Background InitBackground(int width, int height)
 
         .effectTexture = LoadRenderTexture(width, height),
         .finalTexture = LoadRenderTexture(width, height),
+        .distortedTexture = LoadRenderTexture(width, height),
 
         // Allocate memory for all possible quads (size of struct)
         .quadCache = (DistortedQuad*)MemAlloc(MAX_QUADS * sizeof(DistortedQuad)),
@@ -29,6 +31,7 @@ Background InitBackground(int width, int height)
     };
 
     UpdateStaticEffects(&background, width, height);
+    UpdateDistortionCache(&background, width, height);
     return background;
 }
 
@@ -106,7 +109,7 @@ void UpdateBackground(Background* background, float deltaTime, bool isTimewarpAc
     Color purpleColor = BACKGROUND_PURPLE;
 
     // Set background colour to a new colour!
-    background->phosphorColor = (Color)
+    Color newColor = (Color)
     {
         (unsigned char)Lerp(normalColor.r, purpleColor.r, background->colorTransition),
         (unsigned char)Lerp(normalColor.g, purpleColor.g, background->colorTransition),
@@ -114,7 +117,27 @@ void UpdateBackground(Background* background, float deltaTime, bool isTimewarpAc
         255
     };
 
-    background->staticEffectsNeedUpdate = true;
+    /* Static effects only need redrawing while the colour is actually moving.
+     * We redraw them here and not in DrawBackground, because DrawGame gets a copy of Game,
+     * so any "done, no need to update" flag set in there would just be thrown away! */
+    background->staticEffectsNeedUpdate = !ColorIsEqual(newColor, background->phosphorColor);
+    background->phosphorColor = newColor;
+
+    UpdateStaticEffects(background, background->staticEffects.texture.width, background->staticEffects.texture.height);
+
+    // Same reason: the quad cache lives here, and only changes with the curvature
+    if (background->screenCurvature != background->lastCurvature)
+    {
+        /* Curvature changed: recalculate distortion.
+         * In our current implementation, we never change our screen curvature. But I put this here:
+         * Because if in the future I wanted to make this a game-play mechanic, I am now able to!
+         * Example: Pulsing screen curvature?? Extreme curvature during a special powerup?? Boss??
+         */
+        background->distortionNeedsUpdate = true;
+        background->lastCurvature = background->screenCurvature;
+
+        UpdateDistortionCache(background, background->finalTexture.texture.width, background->finalTexture.texture.height);
+    }
 }
 
 /* I read about Barrel Distortion Effects and their mathematical formula equivalents.
@@ -150,12 +173,87 @@ Vector2 DistortPoint(Vector2 point, Vector2 center, float curveAmount, int width
     };
 }
 
-// Our main draw method! This is supposed to compose the final image after all effects!
-void DrawBackground(Background* background, int width, int height, Texture2D gameScreen)
+// Here we cache all of our quad properties, so drawing them later doesn't have to redo the math (saving CPU cycles)
+// What the distortion jobs share
+typedef struct DistortionJob
+{
+    Background* background;
+    Vector2 center;
+    int width;
+    int height;
+    int horizontalQuads;
+} DistortionJob;
+
+// Quad rows [first, last) of the cache
+static void DistortQuadRows(void* data, int first, int last)
+{
+    DistortionJob* job = data;
+    Background* background = job->background;
+
+    for(int y = first; y < last; y++)
+    {
+        float screenY = y * QUAD_SIZE; // Y Pos
+        int quadIndex = y * job->horizontalQuads;
+
+        for(int x = 0; x < job->horizontalQuads; x++)
+        {
+            float screenX = x * QUAD_SIZE; // X Pos
+
+            Vector2 p1 = DistortPoint((Vector2){screenX, screenY}, job->center,
+                              background->screenCurvature, job->width, job->height);
+            Vector2 p2 = DistortPoint((Vector2){screenX + QUAD_SIZE, screenY}, job->center,
+                                  background->screenCurvature, job->width, job->height);
+            Vector2 p3 = DistortPoint((Vector2){screenX, screenY + QUAD_SIZE}, job->center,
+                                  background->screenCurvature, job->width, job->height);
+
+            // We get a specific quad from our array, and define it!
+            background->quadCache[quadIndex].position = p1;
+            background->quadCache[quadIndex].width = p2.x - p1.x;
+            background->quadCache[quadIndex].height = p3.y - p1.y;
+            quadIndex++;
+        }
+    }
+}
+
+void UpdateDistortionCache(Background* background, int width, int height)
+{
+    if (!background->distortionNeedsUpdate)
+    {
+        return;
+    }
+
+    // These are our grid dimensions!
+    DistortionJob job =
+    {
+        .background = background,
+        .center = {width/2.0f, height/2.0f},
+        .width = width,
+        .height = height,
+        .horizontalQuads = (width + QUAD_SIZE - 1) / QUAD_SIZE
+    };
+    int verticalQuads = (height + QUAD_SIZE - 1) / QUAD_SIZE;
+
+    // Every row is independent, so the job workers split them up (a resize stalls a whole frame otherwise)
+    JobCounter counter = {0};
+    RunParallelFor("distortion cache", DistortQuadRows, &job, verticalQuads, DISTORTION_JOB_ROWS, &counter);
+    WaitForJobs(&counter);
+
+    background->distortionNeedsUpdate = false;
+}
+
+/* Our main draw method! This is supposed to compose the final image after all effects!
+ * sourceChanged = false means the game screen is the same as last frame (a cached menu for example),
+ * so we can skip re-drawing ~2000 distorted quads and reuse last frame's curved screen. */
+void DrawBackground(Background* background, int width, int height, Texture2D gameScreen, bool sourceChanged)
 {
-    // Update effects if needed ( we do this in Init too )
-    UpdateStaticEffects(background, width, height); // background->staticEffects
+    BeginBackgroundComposite(background, width, height, gameScreen, sourceChanged);
+    EndBackgroundComposite(background);
+}
 
+/* DrawBackground in two halves. In between, we're drawing into the final image, on top of the curved
+ * game screen but under the CRT effects. That's the last moment to add anything before present! */
+void BeginBackgroundComposite(Background* background, int width, int height, Texture2D gameScreen, bool sourceChanged)
+{
     // Drawing our dynamic animated effects!
     BeginTextureMode(background->effectTexture); // background->effectTexture
     {
@@ -173,125 +271,103 @@ void DrawBackground(Background* background, int width, int height, Texture2D gam
     }
     EndTextureMode();
 
-    // We now compose and apply the barrel distortion to the final image
-    BeginTextureMode(background->finalTexture); // background->finalTexture
+    // The barrel distortion of our game screen, only when there's something new to distort
+    if (sourceChanged)
     {
-        ClearBackground(BLACK);
-        Vector2 center = {width/2.0f, height/2.0f};
-
-        // In order to not flood our memory, here I'm trying to only update distortion if needed
-        if (background->screenCurvature != background->lastCurvature)
+        BeginTextureMode(background->distortedTexture); // background->distortedTexture
         {
-            /* Curvature changed: recalculate distortion.
-             * In our current implementation, we never change our screen curvature. But I put this here:
-             * Because if in the future I wanted to make this a game-play mechanic, I am now able to!
-             * Example: Pulsing screen curvature?? Extreme curvature during a special powerup?? Boss??
-             */
-            background->distortionNeedsUpdate = true;
-            background->lastCurvature = background->screenCurvature;
-        }
+            ClearBackground(BLACK);
 
-        // These are our grid dimensions!
-        int horizontalQuads = (width + QUAD_SIZE - 1) / QUAD_SIZE;
-        int verticalQuads = (height + QUAD_SIZE - 1) / QUAD_SIZE;
+            // These are our grid dimensions!
+            int horizontalQuads = (width + QUAD_SIZE - 1) / QUAD_SIZE;
+            int verticalQuads = (height + QUAD_SIZE - 1) / QUAD_SIZE;
 
-        // Here we draw our distorted game screen
-        if (background->distortionNeedsUpdate)
-        {
+            /* Just for clarity, this is the distortion of our game screen!
+             * This is also where we re-use our previously cached quads, to draw them withour recalculating.
+             */
             int quadIndex = 0;
 
             for(int y = 0; y < verticalQuads; y++)
             {
-                float screenY = y * QUAD_SIZE; // Y Pos
+                float screenY = y * QUAD_SIZE;
 
                 for(int x = 0; x < horizontalQuads; x++)
                 {
-                    float screenX = x * QUAD_SIZE; // X Pos
-
-                    // To optimize this code, we try to only calculate distortion for the visible area
-                    float distFromCenter = sqrtf
-                    (
-                        powf((screenX - center.x) / width, 2) +
-                        powf((screenY - center.y) / height, 2)
-                    );
-
-                    // Here, we use larger quads for the edges of the screen
-                    int currentQuadSize = distFromCenter > 0.7f ? QUAD_SIZE * 2 : QUAD_SIZE;
-
-                    Vector2 p1 = DistortPoint((Vector2){screenX, screenY}, center,
-                                      background->screenCurvature, width, height);
-                    Vector2 p2 = DistortPoint((Vector2){screenX + QUAD_SIZE, screenY}, center,
-                                          background->screenCurvature, width, height);
-                    Vector2 p3 = DistortPoint((Vector2){screenX, screenY + QUAD_SIZE}, center,
-                                          background->screenCurvature, width, height);
-
-                    /* Here, we cache all of our quad properties, to draw them later (saving CPU cycles)
-                     * We get a specific quad from our array, and define it!
-                     */
-                    background->quadCache[quadIndex].position = p1;
-                    background->quadCache[quadIndex].width = p2.x - p1.x;
-                    background->quadCache[quadIndex].height = p3.y - p1.y;
-                    quadIndex++;
+                    float screenX = x * QUAD_SIZE;
+
+                    DistortedQuad* quad = &background->quadCache[quadIndex++];
+
+                    // Skip if quad is outside screen
+                    if (quad->position.x + quad->width < 0 || quad->position.x > width ||
+                    quad->position.y + quad->height < 0 || quad->position.y > height)
+                    {
+                        continue;
+                    }
+
+                    // Draw the game screen with distortion!
+                    DrawTexturePro(gameScreen,
+                        // Original
+                        (Rectangle){screenX, screenY, QUAD_SIZE, QUAD_SIZE}, //
+                        // Destination rectangle: Our Distorted Quads
+                        (Rectangle){quad->position.x, quad->position.y, //
+                              quad->width, quad->height}, //
+                        (Vector2){0, 0}, 0, WHITE); //
                 }
             }
-            background->distortionNeedsUpdate = false;
         }
+        EndTextureMode();
+    }
 
-        /* Just for clarity, this is the distortion of our game screen!
-         * This is also where we re-use our previously cached quads, to draw them withour recalculating.
-         */
-        int quadIndex = 0;
-
-        for(int y = 0; y < verticalQuads; y++)
-        {
-            float screenY = y * QUAD_SIZE;
-
-            for(int x = 0; x < horizontalQuads; x++)
-            {
-                float screenX = x * QUAD_SIZE;
-
-                /* Here, we first make our array of distorted quad structs
-                 * Since our quads and their positions are pre-calculated, we only need their positions here!
-                 * Here, we get the memory adress of our quad, and we do this for every quad.
-                 * So, we allocate memory for all quads in our array, and then draw them
-                 */
-                DistortedQuad* quad = &background->quadCache[quadIndex++];
-
-                // Skip if quad is outside screen
-                if (quad->position.x + quad->width < 0 || quad->position.x > width ||
-                quad->position.y + quad->height < 0 || quad->position.y > height)
-                {
-                    continue;
-                }
+    // We now compose the final image
+    BeginTextureMode(background->finalTexture); // background->finalTexture
+    ClearBackground(BLACK);
 
-                // Draw the game screen with distortion!
-                DrawTexturePro(gameScreen,
-                    // Original
-                    (Rectangle){screenX, screenY, QUAD_SIZE, QUAD_SIZE}, //
-                    // Destination rectangle: Our Distorted Quads
-                    (Rectangle){quad->position.x, quad->position.y, //
-                          quad->width, quad->height}, //
-                    (Vector2){0, 0}, 0, WHITE); //
-            }
-        }
+    // Render textures are stored upside down, - to flip it back
+    DrawTextureRec(background->distortedTexture.texture,
+        (Rectangle){0, 0, width, -height}, (Vector2){0, 0}, WHITE);
+}
 
-        // Drawing our static effects!
-        DrawTexture(background->staticEffects.texture, 0, 0, WHITE);
+void EndBackgroundComposite(Background* background)
+{
+    // Drawing our static effects!
+    DrawTexture(background->staticEffects.texture, 0, 0, WHITE);
 
-        // Then, we must draw to overlay our dynamic effects
-        DrawTexture(background->effectTexture.texture, 0, 0, WHITE);
-    }
+    // Then, we must draw to overlay our dynamic effects
+    DrawTexture(background->effectTexture.texture, 0, 0, WHITE);
     EndTextureMode();
 
     // Draw the final result
     DrawTexture(background->finalTexture.texture, 0, 0, WHITE);
 }
 
+/* Draws a rectangle straight into the composite, bent like everything on the game screen.
+ * Only for small things, the edges stay straight between the four distorted corners. */
+void DrawDistortedRectangle(const Background* background, Rectangle rectangle, Color color)
+{
+    int width = background->finalTexture.texture.width;
+    int height = background->finalTexture.texture.height;
+    Vector2 center = {width/2.0f, height/2.0f};
+    float curvature = background->screenCurvature;
+
+    // The final texture ends up flipped on screen (see EndBackgroundComposite), so we flip too
+    rectangle.y = height - rectangle.y - rectangle.height;
+
+    Vector2 topLeft = DistortPoint((Vector2){rectangle.x, rectangle.y}, center, curvature, width, height);
+    Vector2 topRight = DistortPoint((Vector2){rectangle.x + rectangle.width, rectangle.y}, center, curvature, width, height);
+    Vector2 bottomLeft = DistortPoint((Vector2){rectangle.x, rectangle.y + rectangle.height}, center, curvature, width, height);
+    Vector2 bottomRight = DistortPoint((Vector2){rectangle.x + rectangle.width, rectangle.y + rectangle.height}, center, curvature, width, height);
+
+    // Counter-clockwise, or raylib culls them
+    DrawTriangle(topLeft, bottomLeft, bottomRight, color);
+    DrawTriangle(topLeft, bottomRight, topRight, color);
+}
+
 // Unloading cause otherwise bad (Free memory)
 void UnloadBackground(Background* background)
 {
     UnloadRenderTexture(background->effectTexture);
     UnloadRenderTexture(background->finalTexture);
+    UnloadRenderTexture(background->distortedTexture);
     UnloadRenderTexture(background->staticEffects);
     UnloadRenderTexture(background->uiTexture);
     MemFree(background->quadCache);
@@ -3,6 +3,7 @@
 #include <Player.h>
 #include <raymath.h>
 #include "VectorMath.h"
+#include "FixedMath.h"
 
 Ball InitBall(Vector2 position)
 {
@@ -43,11 +44,15 @@ void UpdateBall(Ball* ball, float deltaTime, int screenWidth, int screenHeight)
     ball->trail.positions[ball->trail.currentIndex] = ball->position;
     ball->trail.currentIndex = (ball->trail.currentIndex + 1) % TRAIL_LENGTH;
 
+#ifdef FIXED_POINT_PHYSICS
+    ball->position = FixedMoveBall(ball->position, ball->direction, ball->speed, deltaTime);
+#else
     // Movement vector: direction * speed * time
     Vector2 movement = MyVector2Scale(ball->direction, ball->speed * deltaTime);
 
     // Update position using vector addition
     ball->position = MyVector2Add(ball->position, movement);
+#endif
 
     // Bounce walls
     if (ball->position.x - ball->radius <= 0)
@@ -93,75 +98,93 @@ void AdjustBallDirection(Ball* ball)
         ball->direction.x = (ball->direction.x >= 0 ? MIN_HORIZONTAL_COMPONENT : -MIN_HORIZONTAL_COMPONENT);
     }
 
+#ifdef FIXED_POINT_PHYSICS
+    ball->direction = FixedNormalizeVector2(ball->direction);
+#else
     ball->direction = MyVector2Normalize(ball->direction);
+#endif
 }
 
 
-void DrawBall(Ball ball)
+/* The trail follows where the ball really went: its history ring, newest first, as one fading ribbon.
+ * The ring isn't cleared when a ball is lost, so anything further back than a tick could have carried it
+ * is from an old life and the ribbon ends there */
+int GetBallTrailRibbon(const Ball* ball, RibbonPoint points[BALL_TRAIL_RIBBON_POINTS])
 {
-    if (ball.active)
+    int count = 0;
+    float maxGap = ball->speed * SIM_DT * TRAIL_MAX_GAP_TICKS;
+    Vector2 previous = ball->position;
+
+    for (int i = 0; i <= TRAIL_LENGTH; i++)
     {
-        Vector2 prevPos = ball.position;
+        Vector2 position = i == 0 ? ball->position :
+            ball->trail.positions[(ball->trail.currentIndex - i + TRAIL_LENGTH) % TRAIL_LENGTH];
+
+        if (MyVector2Distance(position, previous) > maxGap)
+        {
+            break;
+        }
+
+        // 1 at the ball, 0 at the end of the trail
+        float alpha = 1.0f - (float)i / TRAIL_LENGTH;
 
-        // Here I'm trying to draw a gradually fading trail like multiple circles
-        for (int i = 0; i < TRAIL_LENGTH; i++)
+        Color trailColor = ball->currentColor;
+
+        if (ball->damageMultiplier > 1)
         {
-            // Calculate position along the trail
-            Vector2 trailPos = MyVector2Subtract(prevPos,
-                MyVector2Scale(ball.direction, i * TRAIL_SPACING));
-
-            float alpha = (float)(TRAIL_LENGTH - i) / TRAIL_LENGTH;
-
-            Color trailColor;
-
-            if (ball.damageMultiplier > 1)
-            {
-                trailColor = (Color){
-                    255,                          // R
-                    (unsigned char)(255 * alpha), // G - Fading orange
-                    0,                            // B
-                    (unsigned char)(alpha * 100)  // A
-                };
-            }
-            else
-            {
-                // Normal trail color based on ball's current color
-                trailColor = ball.currentColor;
-                trailColor.a = (unsigned char)(alpha * 100);
-            }
-
-            DrawCircleV(trailPos, ball.radius * (0.8f + (0.2f * alpha)), trailColor);
-            prevPos = trailPos;
+            trailColor = (Color){ 255, (unsigned char)(255 * alpha), 0, 0 }; // Fading orange
         }
 
-        DrawCircleV(ball.position, ball.radius, ball.currentColor);
+        trailColor.a = (unsigned char)(alpha * 100);
+
+        points[count++] = (RibbonPoint){ position, ball->radius * (0.8f + (0.2f * alpha)), trailColor };
+        previous = position;
+    }
+
+    return count;
+}
+
+void RecordBall(RenderCommandBuffer* commands, Ball ball)
+{
+    if (ball.active)
+    {
+        RibbonPoint points[BALL_TRAIL_RIBBON_POINTS];
+        int count = GetBallTrailRibbon(&ball, points);
+
+        PushRibbon(commands, RENDER_LAYER_BALL_TRAIL, points, count);
+        PushCircle(commands, RENDER_LAYER_BALL, ball.position, ball.radius, ball.currentColor);
     }
 }
 
 // I want to shoot the ball, and shoot it in the direction the player is moving! Slightly random when still.
-void ShootBall(Ball* ball, Vector2 startPosition, Vector2 direction, Player player)
+void ShootBall(Ball* ball, Vector2 startPosition, Vector2 direction, Player player, int steer, SimRandom* random)
 {
     if (!ball->active)
     {
         Vector2 offsetDirection = MyVector2Create(0, -1);
 
-        if (IsKeyDown(KEY_RIGHT))
+        // steer is what the player held at the exact moment of the launch
+        if (steer > 0)
         {
             offsetDirection = MyVector2Create(0.5f, -1.0f);
         }
-        else if (IsKeyDown(KEY_LEFT))
+        else if (steer < 0)
         {
             offsetDirection = MyVector2Create(-0.5f, -1.0f);
         }
         else
         {
-            float randomX = GetRandomValue(-35, 35) / 100.0f;
+            float randomX = SimRandomRange(random, -35, 35) / 100.0f;
             offsetDirection = MyVector2Create(randomX, -1.0f);
         }
 
         ball->speed = BALL_SPEED_MIN;
         ball->position = startPosition;
+#ifdef FIXED_POINT_PHYSICS
+        ball->direction = FixedNormalizeVector2(offsetDirection);
+#else
         ball->direction = MyVector2Normalize(offsetDirection);
+#endif
         ball->active = true;
     }
 }
\ No newline at end of file
@@ -7,6 +7,7 @@ Color GetBlockColor(int lives, bool isTimewarpActive)
     {
         switch(lives)
         {
+            case 9: case 8: case 7:
             case 6: return BLOCK_COLOR_1;
             case 5: return BLOCK_COLOR_2;
             case 4: return BLOCK_COLOR_3;
@@ -20,6 +21,7 @@ Color GetBlockColor(int lives, bool isTimewarpActive)
     {
         switch(lives)
         {
+            case 9: case 8: case 7:
             case 6: return BLOCK_COLOR_1_PURPLE;
             case 5: return BLOCK_COLOR_2_PURPLE;
             case 4: return BLOCK_COLOR_3_PURPLE;
@@ -31,6 +33,22 @@ Color GetBlockColor(int lives, bool isTimewarpActive)
     }
 }
 
+// The colour a block should have right now, packed levels can give blocks their own colour
+Color ShadeBlock(const Block* block, bool isTimewarpActive)
+{
+    if (block->type == BLOCK_SOLID)
+    {
+        return isTimewarpActive ? BLOCK_COLOR_SOLID_PURPLE : BLOCK_COLOR_SOLID;
+    }
+
+    if (block->tint.a != 0)
+    {
+        return isTimewarpActive ? ColorLerp(block->tint, BLOCK_COLOR_6_PURPLE, 0.5f) : block->tint;
+    }
+
+    return GetBlockColor(block->lives, isTimewarpActive);
+}
+
 // I want to initialise blocks with different lives, and colours that correspond to them!
 // I also want to make the rows determine the lives of the blocks in a descending order!
 Block InitBlock(int x, int y, int width, int height, int row)
@@ -40,6 +58,8 @@ Block InitBlock(int x, int y, int width, int height, int row)
     block.width = width;
     block.height = height;
     block.lives = MAX_BLOCK_ROWS - row;
+    block.type = BLOCK_NORMAL;
+    block.tint = BLANK;
     block.color = GetBlockColor(block.lives, false);
     block.active = true;
 
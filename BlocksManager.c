@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "Ball.h"
 #include "VectorMath.h"
+#include "FixedMath.h"
 
 void CalculateBlockDimensions(int screenWidth, int screenHeight, float *blockWidth, float *blockHeight, int columnCount)
 {
@@ -17,8 +18,8 @@ void CalculateBlockDimensions(int screenWidth, int screenHeight, float *blockWid
 // Helper function to reduce code duplication and calculus repetition =)
 void ClampBlockDimensions(int* rowCount, int* columnCount)
 {
-    *rowCount = Clamp(*rowCount, MIN_BLOCK_ROWS, MAX_BLOCK_ROWS);
-    *columnCount = Clamp(*columnCount, MIN_BLOCK_COLUMNS, MAX_BLOCK_COLUMNS);
+    *rowCount = Clamp(*rowCount, 1, BLOCK_GRID_ROWS);
+    *columnCount = Clamp(*columnCount, 1, BLOCK_GRID_COLUMNS);
 }
 
 // Another helper function to reduce calculus and code duplication!
@@ -28,11 +29,25 @@ void InitializeBlock(Block* block, float x, float y, float width, float height,
     block->width = width;
     block->height = height;
     block->lives = lives;
+    block->type = BLOCK_NORMAL;
+    block->tint = BLANK;
     block->color = GetBlockColor(lives, isTimewarpActive);
     block->active = true;
 }
 
-void InitBlocks(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS],
+static void ClearBlocks(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS])
+{
+    for (int row = 0; row < BLOCK_GRID_ROWS; row++)
+    {
+        for (int col = 0; col < BLOCK_GRID_COLUMNS; col++)
+        {
+            blocks[row][col] = (Block){0};  // Zero initialization
+            blocks[row][col].color = BLACK;
+        }
+    }
+}
+
+void InitBlocks(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS],
                 int screenWidth, int screenHeight, int rowCount, int columnCount, bool isTimewarpActive)
 {
     ClampBlockDimensions(&rowCount, &columnCount);
@@ -44,29 +59,62 @@ void InitBlocks(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS],
     float startY = screenHeight * BLOCK_TOP_OFFSET;
 
     // Initialize all blocks to inactive first
-    for (int row = 0; row < MAX_BLOCK_ROWS; row++)
+    ClearBlocks(blocks);
+
+    // Initialize active blocks
+    for (int row = 0; row < rowCount; row++)
     {
-        for (int col = 0; col < MAX_BLOCK_COLUMNS; col++)
+        for (int col = 0; col < columnCount; col++)
         {
-            blocks[row][col] = (Block){0};  // Zero initialization
-            blocks[row][col].color = BLACK;
+            float x = startX + col * (blockWidth + BLOCK_SPACING);
+            float y = startY + row * (blockHeight + BLOCK_SPACING);
+            InitializeBlock(&blocks[row][col], x, y, blockWidth, blockHeight,
+                          rowCount - row, isTimewarpActive);
         }
     }
+}
+
+/* Same layout as InitBlocks, but every block comes from a packed level.
+ * The cells are read straight out of the mapped pack file, no parsing and no copy in between. */
+void InitPackedBlocks(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS], int screenWidth, int screenHeight,
+                      const LevelCell* cells, int rowCount, int columnCount, const uint32_t* palette,
+                      bool isTimewarpActive)
+{
+    ClearBlocks(blocks);
+
+    float blockWidth, blockHeight;
+    CalculateBlockDimensions(screenWidth, screenHeight, &blockWidth, &blockHeight, columnCount);
+
+    float startX = screenWidth * BLOCK_SIDE_OFFSET;
+    float startY = screenHeight * BLOCK_TOP_OFFSET;
 
-    // Initialize active blocks
     for (int row = 0; row < rowCount; row++)
     {
         for (int col = 0; col < columnCount; col++)
         {
+            const LevelCell* cell = &cells[row * columnCount + col];
+
+            if (cell->lives == 0)
+            {
+                continue;
+            }
+
+            // The game doesn't run the full validator, so a bad cell just gets clamped to something sane
+            int lives = cell->lives > LEVEL_PACK_MAX_LIVES ? LEVEL_PACK_MAX_LIVES : cell->lives;
+
+            Block* block = &blocks[row][col];
             float x = startX + col * (blockWidth + BLOCK_SPACING);
             float y = startY + row * (blockHeight + BLOCK_SPACING);
-            InitializeBlock(&blocks[row][col], x, y, blockWidth, blockHeight,
-                          rowCount - row, isTimewarpActive);
+            InitializeBlock(block, x, y, blockWidth, blockHeight, lives, isTimewarpActive);
+
+            block->type = cell->type < LEVEL_CELL_TYPE_COUNT ? (BlockType)cell->type : BLOCK_NORMAL;
+            block->tint = cell->color != 0 ? GetColor(palette[cell->color & (LEVEL_PACK_PALETTE_SIZE - 1)]) : BLANK;
+            block->color = ShadeBlock(block, isTimewarpActive);
         }
     }
 }
 
-void DrawBlocks(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS], int rowCount, int columnCount)
+void RecordBlocks(RenderCommandBuffer* commands, Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS], int rowCount, int columnCount)
 {
     ClampBlockDimensions(&rowCount, &columnCount);
 
@@ -76,17 +124,28 @@ void DrawBlocks(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS], int rowCount, i
         {
             if (blocks[row][col].active)
             {
-                DrawBlock(&blocks[row][col]);
+                RecordBlock(commands, &blocks[row][col]);
             }
         }
     }
 }
 
-void DrawBlock(Block* block)
+void RecordBlock(RenderCommandBuffer* commands, const Block* block)
 {
-    DrawRectangle(block->position.x, block->position.y,
+    PushRectangle(commands, RENDER_LAYER_BLOCKS, block->position.x, block->position.y,
                  block->width, block->height, block->color);
 
+    // Solid blocks have no lives worth showing
+    if (block->type == BLOCK_SOLID)
+    {
+        return;
+    }
+
+    if (block->type == BLOCK_BONUS)
+    {
+        PushRectangleLines(commands, RENDER_LAYER_BLOCKS, block->position.x, block->position.y, block->width, block->height, WHITE);
+    }
+
     char lives[2];
     sprintf(lives, "%d", block->lives);
 
@@ -95,10 +154,31 @@ void DrawBlock(Block* block)
         block->position.y + block->height/2 - 10
     );
 
-    DrawText(lives, textPos.x, textPos.y, 20, BLACK);
+    PushText(commands, RENDER_LAYER_BLOCK_LABELS, lives, textPos.x, textPos.y, 20, BLACK);
 }
 
-bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive)
+// raylib's circle test, or the integer one in the fixed-point build
+static bool CheckBallCollisionRec(Vector2 center, float radius, Rectangle rect)
+{
+#ifdef FIXED_POINT_PHYSICS
+    return FixedCheckCollisionCircleRec(center, radius, rect);
+#else
+    return CheckCollisionCircleRec(center, radius, rect);
+#endif
+}
+
+// A little randomness on every block bounce, -0.05 to 0.05. Already on the fixed-point grid in that build
+static float BounceJitter(SimRandom* random)
+{
+#ifdef FIXED_POINT_PHYSICS
+    return FromFixedUnit(SimRandomRange(random, -5, 5) * FIXED_UNIT_ONE / 100);
+#else
+    return SimRandomRange(random, -5, 5) / 100.0f;
+#endif
+}
+
+// Whether CheckBlockCollision would do anything with a ball there. The fast-forward asks it ahead of time
+bool IsBallTouchingBlock(const Block* block, Vector2 position, float radius, bool isGhost)
 {
     if (!block->active)
     {
@@ -108,37 +188,30 @@ bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive)
     // To prevent the ball from going through gaps it shouldn't, we expand the blocsk radius
     Rectangle expandedBlock =
     {
-        block->position.x - ball->radius,
-        block->position.y - ball->radius,
-        block->width + (ball->radius * 2),
-        block->height + (ball->radius * 2)
+        block->position.x - radius,
+        block->position.y - radius,
+        block->width + (radius * 2),
+        block->height + (radius * 2)
     };
 
-    // Damage but don't collide!
-    if (ball->isGhost)
+    // Solid blocks can't be damaged, so the ghost just passes through
+    if (isGhost)
     {
-        if (CheckCollisionCircleRec(ball->position, ball->radius, expandedBlock))
-        {
-            block->lives--;
-
-            if (block->lives <= 0)
-            {
-                block->active = false;
-            }
-
-            return true;
-        }
-        return false;
+        return block->type != BLOCK_SOLID && CheckBallCollisionRec(position, radius, expandedBlock);
     }
 
+#ifdef FIXED_POINT_PHYSICS
+    // The same closest point test, in integers
+    return FixedCheckCollisionCircleRec(position, radius, expandedBlock);
+#else
     /* Here we find the closest point on our block, relevant to the balls center
      * This closest points, then determines where the ball collides with the block.
      */
     float closestX = fmaxf(expandedBlock.x,
-                          fminf(ball->position.x, expandedBlock.x + expandedBlock.width));
+                          fminf(position.x, expandedBlock.x + expandedBlock.width));
 
     float closestY = fmaxf(expandedBlock.y,
-                          fminf(ball->position.y, expandedBlock.y + expandedBlock.height));
+                          fminf(position.y, expandedBlock.y + expandedBlock.height));
 
     /* Here, we then calculate the distance between the closest point, and our ball's center
      * We do this to get the squared distance between the two points, which we then use to:
@@ -148,14 +221,42 @@ bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive)
      * distanceSquared = (closestX−ball.centerX)^2 + (closestY−ball.centerY)^2 (pythagoras)
      */
     Vector2 closestPoint = MyVector2Create(closestX, closestY);
-    Vector2 ballToClosest = MyVector2Subtract(closestPoint, ball->position);
+    Vector2 ballToClosest = MyVector2Subtract(closestPoint, position);
     float distanceSquared = MyVector2DotProduct(ballToClosest, ballToClosest);
 
     // Check if ball/block collision occurred (distance² ≤ radius²)
-    if (distanceSquared <= (ball->radius * ball->radius))
+    return distanceSquared <= (radius * radius);
+#endif
+}
+
+bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive, SimRandom* random)
+{
+    bool touching = IsBallTouchingBlock(block, ball->position, ball->radius, ball->isGhost);
+
+    // Damage but don't collide!
+    if (ball->isGhost)
+    {
+        if (touching)
+        {
+            block->lives--;
+
+            if (block->lives <= 0)
+            {
+                block->active = false;
+            }
+
+            return true;
+        }
+        return false;
+    }
+
+    if (touching)
     {
         // Reduce block life
-        block->lives -= ball->damageMultiplier;
+        if (block->type != BLOCK_SOLID)
+        {
+            block->lives -= ball->damageMultiplier;
+        }
 
         if (block->lives <= 0)
         {
@@ -163,9 +264,24 @@ bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive)
         }
         else
         {
-            block->color = GetBlockColor(block->lives, isTimewarpActive);
+            block->color = ShadeBlock(block, isTimewarpActive);
         }
 
+#ifdef FIXED_POINT_PHYSICS
+        // Depths in 1/4096 px, so which side wins never comes down to float rounding
+        Fixed ballX = ToFixed(ball->position.x);
+        Fixed ballY = ToFixed(ball->position.y);
+        Fixed radius = ToFixed(ball->radius);
+        Fixed blockX = ToFixed(block->position.x);
+        Fixed blockY = ToFixed(block->position.y);
+
+        Fixed leftDepth = ballX + radius - blockX;
+        Fixed rightDepth = blockX + block->width * (1 << FIXED_SHIFT) - (ballX - radius);
+        Fixed topDepth = ballY + radius - blockY;
+        Fixed bottomDepth = blockY + block->height * (1 << FIXED_SHIFT) - (ballY - radius);
+
+        Fixed minDepth = leftDepth;
+#else
         // Here, we make calculate the actual blocks width for precise reflection ( minus the ball radius )
         Rectangle actualBlock =
         {
@@ -182,6 +298,7 @@ bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive)
         float bottomDepth = actualBlock.y + actualBlock.height - (ball->position.y - ball->radius);
 
         float minDepth = leftDepth;
+#endif
         int collisionSide = 0; // 0: left, 1: right, 2: top, 3: bottom
 
         if (rightDepth < minDepth)
@@ -206,13 +323,13 @@ bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive)
             case 0: // Left
             case 1: // Right
                 ball->direction.x *= -1;
-                ball->direction.y += (GetRandomValue(-5, 5) / 100.0f);
+                ball->direction.y += BounceJitter(random);
             break;
 
             case 2: // Top
             case 3: // Bottom
                 ball->direction.y *= -1;
-                ball->direction.x += (GetRandomValue(-5, 5) / 100.0f);
+                ball->direction.x += BounceJitter(random);
             break;
         }
 
@@ -226,16 +343,16 @@ bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive)
     return false;
 }
 
-bool AreAllBlocksDestroyed(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS], int rowCount, int columnCount)
+bool AreAllBlocksDestroyed(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS], int rowCount, int columnCount)
 {
-    rowCount = Clamp(rowCount, MIN_BLOCK_ROWS, MAX_BLOCK_ROWS);
-    columnCount = Clamp(columnCount, MIN_BLOCK_COLUMNS, MAX_BLOCK_COLUMNS);
+    ClampBlockDimensions(&rowCount, &columnCount);
 
     for (int row = 0; row < rowCount; row++)
     {
         for (int col = 0; col < columnCount; col++)
         {
-            if (blocks[row][col].active)
+            // Solid blocks stay forever, they don't count
+            if (blocks[row][col].active && blocks[row][col].type != BLOCK_SOLID)
             {
                 return false;
             }
@@ -244,12 +361,11 @@ bool AreAllBlocksDestroyed(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS], int
     return true;
 }
 
-void UpdateBlockColors(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS],
+void UpdateBlockColors(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS],
                       int rowCount, int columnCount,
                       bool isTimewarpActive)
 {
-    rowCount = Clamp(rowCount, MIN_BLOCK_ROWS, MAX_BLOCK_ROWS);
-    columnCount = Clamp(columnCount, MIN_BLOCK_COLUMNS, MAX_BLOCK_COLUMNS);
+    ClampBlockDimensions(&rowCount, &columnCount);
 
     for (int row = 0; row < rowCount; row++)
     {
@@ -257,7 +373,7 @@ void UpdateBlockColors(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS],
         {
             if (blocks[row][col].active)
             {
-                blocks[row][col].color = GetBlockColor(blocks[row][col].lives, isTimewarpActive);
+                blocks[row][col].color = ShadeBlock(&blocks[row][col], isTimewarpActive);
             }
         }
     }
@@ -0,0 +1,181 @@
+﻿#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FastForward.h"
+#include "Game.h"
+#include "Level.h"
+#include "Snapshot.h"
+#include "Timing.h"
+
+/* Headless bot runs, to check the fast-forward against plain tick stepping and to time both.
+ *   BotRun [runs] [first seed] [minutes]
+ * Every run is played twice from the same seed: tick by tick through StepSimulation, then through
+ * FastForwardSimulation. Both have to end in exactly the same state, down to the last bit. */
+
+#define BOT_PLAN_TICKS 60           // The longest the bot holds one input before it looks again (0.25 s)
+#define BOT_DEFAULT_RUNS 5
+#define BOT_DEFAULT_SEED 1000
+#define BOT_DEFAULT_MINUTES 20      // Of play. A run still going by then is stopped there
+
+// What the bot does next, and for how long. A person holds keys too, they don't change their mind every tick
+typedef struct BotPlan
+{
+    SimInput input;
+    int ticks;
+} BotPlan;
+
+typedef struct BotResult
+{
+    int ticks;
+    int score;
+    int levels;
+    double seconds;
+    FastForwardStats stats;
+} BotResult;
+
+// Where the ball comes down to the paddle, off the side walls. Blocks in the way just mean a new plan later
+static float PredictLanding(const Game* game)
+{
+    const Ball* ball = &game->ball;
+    float low = ball->radius;
+    float width = game->screenWidth - ball->radius * 2;
+    float travel = (game->player.position.y - ball->radius - ball->position.y) / ball->direction.y;
+    float x = fmodf(ball->position.x + ball->direction.x * travel - low, width * 2);
+
+    // Every wall bounce mirrors it back
+    x = x < 0 ? x + width * 2 : x;
+    x = x > width ? width * 2 - x : x;
+
+    return low + x;
+}
+
+static BotPlan PlanBot(const Game* game, SimRandom* random)
+{
+    BotPlan plan = { .ticks = BOT_PLAN_TICKS };
+    const Player* player = &game->player;
+
+    if (!game->ball.active)
+    {
+        plan.input.launch = true;
+        plan.input.launchSteer = SimRandomRange(random, -1, 1);
+        plan.ticks = 1;
+        return plan;
+    }
+
+    // Catch it somewhere along the paddle, not always in the middle, or every bounce would look the same
+    float aim = game->ball.direction.y > 0 ? PredictLanding(game) : game->ball.position.x;
+    float offset = SimRandomRange(random, -30, 30) / 100.0f * player->width;
+    float dx = aim + offset - (player->position.x + player->width / 2.0f);
+    int ticks = (int)(fabsf(dx) / (player->speed * SIM_DT * game->timeScale));
+
+    if (ticks > 0)
+    {
+        plan.ticks = ticks < BOT_PLAN_TICKS ? ticks : BOT_PLAN_TICKS;
+        plan.input.moving = true;
+        plan.input.left = dx < 0;
+        plan.input.right = dx > 0;
+        plan.input.moveSeconds = dx < 0 ? -SIM_DT : SIM_DT;
+    }
+
+    return plan;
+}
+
+static BotResult PlayBotRun(Game* game, uint64_t seed, int maxTicks, bool fastForward)
+{
+    BotResult result = {0};
+    SimRandom random = SeedSimRandom(seed);
+
+    game->endless = true;
+    game->fixedLevelSeed = seed;
+    ResetGame(game);
+
+    double start = GetPreciseTime();
+
+    while (result.ticks < maxTicks && game->state != GAME_OVER && game->state != WIN)
+    {
+        if (game->state == LEVEL_COMPLETE)
+        {
+            LoadNextLevel(game);
+            result.levels++;
+        }
+
+        BotPlan plan = PlanBot(game, &random);
+        int ticks = plan.ticks < maxTicks - result.ticks ? plan.ticks : maxTicks - result.ticks;
+
+        if (fastForward)
+        {
+            result.ticks += FastForwardSimulation(game, &plan.input, ticks, &result.stats);
+            continue;
+        }
+
+        // What FastForwardSimulation has to come out the same as
+        for (int i = 0; i < ticks && game->state == PLAYING; i++)
+        {
+            StepSimulation(game, &plan.input, SIM_DT);
+            result.ticks++;
+        }
+    }
+
+    result.seconds = GetPreciseTime() - start;
+    result.score = game->player.score;
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = argc > 1 ? atoi(argv[1]) : BOT_DEFAULT_RUNS;
+    uint64_t firstSeed = argc > 2 ? strtoull(argv[2], NULL, 10) : BOT_DEFAULT_SEED;
+    int minutes = argc > 3 ? atoi(argv[3]) : BOT_DEFAULT_MINUTES;
+
+    if (runs <= 0 || minutes <= 0)
+    {
+        printf("Usage: %s [runs] [first seed] [minutes]\n", argv[0]);
+        return 1;
+    }
+
+    static GameSnapshot stepped;
+    static GameSnapshot forwarded;
+    Game game = InitHeadlessGame(1920, 1080);
+    int maxTicks = minutes * 60 * SIM_TICK_RATE;
+    int mismatches = 0;
+    double steppedSeconds = 0.0;
+    double forwardedSeconds = 0.0;
+
+    for (int run = 0; run < runs; run++)
+    {
+        uint64_t seed = firstSeed + run;
+
+        BotResult a = PlayBotRun(&game, seed, maxTicks, false);
+        memset(&stepped, 0, sizeof(stepped));
+        CaptureSnapshot(&game, &stepped);
+
+        BotResult b = PlayBotRun(&game, seed, maxTicks, true);
+        memset(&forwarded, 0, sizeof(forwarded));
+        CaptureSnapshot(&game, &forwarded);
+
+        // CompareSnapshots names the field, but the trails and colours it skips have to match too
+        const char* field = CompareSnapshots(&stepped, &forwarded);
+        bool same = a.ticks == b.ticks && field == NULL && memcmp(&stepped, &forwarded, sizeof(stepped)) == 0;
+
+        printf("Run %d (seed %llu): score %d, %d levels, %d ticks. Stepped %.1f ms, fast-forward %.1f ms (%.1fx), "
+               "%.1f%% of ticks skipped in %lld skips: %s%s\n",
+               run + 1, (unsigned long long)seed, a.score, a.levels, a.ticks, a.seconds * 1000.0, b.seconds * 1000.0,
+               b.seconds > 0.0 ? a.seconds / b.seconds : 0.0,
+               b.ticks > 0 ? 100.0 * b.stats.skippedTicks / b.ticks : 0.0, b.stats.skips,
+               same ? "SAME" : "DIFFERENT ", same ? "" : (field != NULL ? field : "somewhere"));
+
+        mismatches += same ? 0 : 1;
+        steppedSeconds += a.seconds;
+        forwardedSeconds += b.seconds;
+    }
+
+    printf("%d runs, %d different. Stepped %.1f ms, fast-forward %.1f ms: %.1fx\n", runs, mismatches,
+           steppedSeconds * 1000.0, forwardedSeconds * 1000.0,
+           forwardedSeconds > 0.0 ? steppedSeconds / forwardedSeconds : 0.0);
+
+    UnloadParticleSystem(&game.particles);
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,363 @@
+﻿#include "FastForward.h"
+#include <math.h>
+#include "VectorMath.h"
+#include "FixedMath.h"
+
+// Blocks the ball could reach before we look again, and the ticks it could be touching each one
+typedef struct NearBlock
+{
+    const Block* block;
+    int first;
+    int last;
+} NearBlock;
+
+/* The ticks (from 1 to most) a point moving `step` a tick is inside the box, by the slab method.
+ * Ticks are the time unit, so there are no seconds to round. False if it never gets there. */
+static bool GetTicksInBox(Vector2 start, Vector2 step, Rectangle box, int most, int* first, int* last)
+{
+    double enter = -INFINITY;
+    double leave = INFINITY;
+    double position[2] = { start.x, start.y };
+    double velocity[2] = { step.x, step.y };
+    double low[2] = { box.x, box.y };
+    double high[2] = { box.x + box.width, box.y + box.height };
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (velocity[axis] == 0.0)
+        {
+            // Never crosses this slab: outside it means never inside the box
+            if (position[axis] < low[axis] || position[axis] > high[axis])
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        double a = (low[axis] - position[axis]) / velocity[axis];
+        double b = (high[axis] - position[axis]) / velocity[axis];
+
+        enter = fmax(enter, fmin(a, b));
+        leave = fmin(leave, fmax(a, b));
+    }
+
+    if (enter > leave || leave < 1.0 || enter > most)
+    {
+        return false;
+    }
+
+    *first = enter < 1.0 ? 1 : (int)floor(enter);
+    *last = leave > most ? most : (int)ceil(leave);
+
+    return true;
+}
+
+// Ticks until a point moving `step` a tick gets to `limit`, which is ahead of it. Never: most
+static int TicksUntil(float position, float step, float limit, int most)
+{
+    if (step == 0.0f)
+    {
+        return most;
+    }
+
+    double ticks = ceil((double)(limit - position) / step);
+
+    return ticks < 0.0 ? 0 : (ticks < most ? (int)ticks : most);
+}
+
+// How far the ball moves each tick, exactly as UpdateBall will move it
+static Vector2 GetBallStep(const Ball* ball, float scaledTime)
+{
+#ifdef FIXED_POINT_PHYSICS
+    Vector2 next = FixedMoveBallTicks(ball->position, ball->direction, ball->speed, scaledTime, 1);
+    return MyVector2Subtract(next, ball->position);
+#else
+    return MyVector2Scale(ball->direction, ball->speed * scaledTime);
+#endif
+}
+
+/* Between impacts the ball flies in a straight line, so which blocks it can reach, and when, is worked out
+ * up front. Only until the next wall, the ceiling or the killzone: the ball can't get any further before
+ * something happens, so `most` comes back no later than that. The boxes are generous (FAST_FORWARD_MARGIN,
+ * the float build's path is a sum of float steps and not quite a line); inside one every tick gets the real test.
+ * Returns -1 when no block that counts is left, then StepSimulation has to end the level. */
+static int FindNearBlocks(const Game* game, int* most, NearBlock* near)
+{
+    const Ball* ball = &game->ball;
+    Vector2 step = GetBallStep(ball, SIM_DT * game->timeScale);
+    Vector2 start = ball->position;
+
+    float side = step.x > 0 ? game->screenWidth - ball->radius : ball->radius;
+    float end = step.y > 0 ? game->screenHeight + 1.0f : ball->radius;
+    int ticks = *most;
+
+    ticks = TicksUntil(start.x, step.x, side, ticks);
+    ticks = TicksUntil(start.y, step.y, end, ticks);
+    *most = ticks;
+
+    // Blocks are grown by the radius before the circle test, so the centre has to stay two radii away
+    float reach = ball->radius * 2 + FAST_FORWARD_MARGIN;
+    float left = fminf(start.x, start.x + step.x * ticks) - reach;
+    float right = fmaxf(start.x, start.x + step.x * ticks) + reach;
+    float top = fminf(start.y, start.y + step.y * ticks) - reach;
+    float bottom = fmaxf(start.y, start.y + step.y * ticks) + reach;
+    int count = 0;
+    bool anyLeft = false;
+
+    for (int row = 0; row < game->currentBlockRows; row++)
+    {
+        for (int col = 0; col < game->currentBlockColumns; col++)
+        {
+            const Block* block = &game->blocks[row][col];
+
+            if (!block->active)
+            {
+                continue;
+            }
+
+            anyLeft = anyLeft || block->type != BLOCK_SOLID;
+
+            // Nowhere near the whole path
+            if (block->position.x > right || block->position.x + block->width < left ||
+                block->position.y > bottom || block->position.y + block->height < top)
+            {
+                continue;
+            }
+
+            Rectangle box = { block->position.x - reach, block->position.y - reach,
+                              block->width + reach * 2, block->height + reach * 2 };
+
+            if (GetTicksInBox(start, step, box, ticks, &near[count].first, &near[count].last))
+            {
+                near[count++].block = block;
+            }
+        }
+    }
+
+    return anyLeft ? count : -1;
+}
+
+// Where this tick's input leaves the paddle. Only asked for when something is close to it
+static Rectangle GetPaddleAfterTick(const Game* game, const SimInput* input)
+{
+    Player player = game->player;
+    UpdatePlayerMovement(&player, input, game->timeScale, game->screenWidth);
+
+    return (Rectangle){ player.position.x, player.position.y, player.width, player.height };
+}
+
+/* Whether the ball at `position` on this tick makes anything happen: a wall or the ceiling (UpdateBall's own
+ * tests), a block, the paddle or the killzone. The same tests StepSimulation does, so no margins here */
+static bool IsBallQuiet(const Game* game, const SimInput* input, Vector2 position,
+                        const NearBlock* near, int nearCount, int tick)
+{
+    float radius = game->ball.radius;
+
+    if (position.x - radius <= 0 || position.x + radius >= game->screenWidth || position.y - radius <= 0)
+    {
+        return false;
+    }
+
+    if (position.y > game->screenHeight)
+    {
+        return false;
+    }
+
+    if (position.y + radius >= game->player.position.y &&
+        IsBallTouchingPaddle(position, radius, GetPaddleAfterTick(game, input)))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < nearCount; i++)
+    {
+        if (tick >= near[i].first && tick <= near[i].last &&
+            IsBallTouchingBlock(near[i].block, position, radius, game->ball.isGhost))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Nothing with a power-up happens on the next tick: falling ones miss the paddle and stay on screen, taken ones last
+static bool ArePowerUpsQuiet(const Game* game, const SimInput* input, const int* active, int activeCount,
+                             double simTime, float scaledTime)
+{
+    for (int i = 0; i < activeCount; i++)
+    {
+        const PowerUp* powerUp = &game->powerUps[active[i]];
+
+        if (powerUp->type >= POWERUP_COUNT)
+        {
+            return false;
+        }
+
+        if (powerUp->wasPickedUp)
+        {
+            if (powerUp->duration - (simTime - powerUp->startTime) <= 0)
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        PowerUp moved = *powerUp;
+        UpdatePowerUp(&moved, scaledTime);
+
+        if (moved.position.y > game->screenHeight)
+        {
+            return false;
+        }
+
+        if (moved.position.y + moved.radius >= game->player.position.y &&
+            CheckPowerUpCollision(&moved, GetPaddleAfterTick(game, input)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Up to `ticks` ticks where nothing happens, with only what changes on a quiet tick.
+ * Stops before the first tick where something would. Returns how many it did. */
+static int SkipQuietTicks(Game* game, const SimInput* input, int ticks)
+{
+    NearBlock near[BLOCK_GRID_ROWS * BLOCK_GRID_COLUMNS];
+    float scaledTime = SIM_DT * game->timeScale;
+    Ball* ball = &game->ball;
+    int nearCount = ball->active ? FindNearBlocks(game, &ticks, near) : 0;
+
+    if (nearCount < 0)
+    {
+        return 0;
+    }
+
+#ifdef FIXED_POINT_PHYSICS
+    Vector2 start = ball->position;
+#else
+    Vector2 movement = MyVector2Scale(ball->direction, ball->speed * scaledTime);
+#endif
+
+    // Nothing gets spawned or picked up on a quiet tick, so which power-ups are about stays put
+    int active[PU_MAX_COUNT];
+    int activeCount = 0;
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        if (game->powerUps[i].active)
+        {
+            active[activeCount++] = i;
+        }
+    }
+
+    int done = 0;
+
+    while (done < ticks && ArePowerUpsQuiet(game, input, active, activeCount, game->simTime + SIM_DT, scaledTime))
+    {
+#ifdef FIXED_POINT_PHYSICS
+        // Fixed-point steps are whole numbers, so any tick's position comes straight from the start
+        Vector2 next = FixedMoveBallTicks(start, ball->direction, ball->speed, scaledTime, done + 1);
+#else
+        // Float sums only come out the same added up one by one
+        Vector2 next = MyVector2Add(ball->position, movement);
+#endif
+
+        if (ball->active && !IsBallQuiet(game, input, next, near, nearCount, done + 1))
+        {
+            break;
+        }
+
+        // StepSimulation's bookkeeping, in the same order
+        game->simTime += SIM_DT;
+        game->spawnSystem.cooldownTimer -= scaledTime;
+        game->telemetry.ticks++;
+        game->telemetry.duration += SIM_DT;
+
+        if (game->lastScoreTimer > 0)
+        {
+            game->lastScoreTimer -= scaledTime;
+        }
+
+        UpdatePlayerMovement(&game->player, input, game->timeScale, game->screenWidth);
+
+        if (ball->active)
+        {
+            ball->trail.positions[ball->trail.currentIndex] = ball->position;
+            ball->trail.currentIndex = (ball->trail.currentIndex + 1) % TRAIL_LENGTH;
+            ball->position = next;
+        }
+
+        for (int i = 0; i < activeCount; i++)
+        {
+            if (!game->powerUps[active[i]].wasPickedUp)
+            {
+                UpdatePowerUp(&game->powerUps[active[i]], scaledTime);
+            }
+        }
+
+        done++;
+    }
+
+    if (!ball->active)
+    {
+        ball->position = MyVector2Create
+        (
+            game->player.position.x + game->player.width / 2,
+            game->player.position.y - ball->radius
+        );
+    }
+
+    // What UpdatePowerUps sets every tick, only the last one counts
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        PowerUp* powerUp = &game->powerUps[i];
+
+        if (powerUp->active && powerUp->wasPickedUp)
+        {
+            double elapsedTime = game->simTime - powerUp->startTime;
+            powerUp->remainingDuration = powerUp->duration - elapsedTime;
+        }
+    }
+
+    ball->currentColor = GetActivePowerUpColor(game->powerUps, PU_MAX_COUNT);
+
+    return done;
+}
+
+int FastForwardSimulation(Game* game, const SimInput* input, int ticks, FastForwardStats* stats)
+{
+    FastForwardStats unused;
+    stats = stats != NULL ? stats : &unused;
+
+    int done = 0;
+
+    while (done < ticks && game->state == PLAYING)
+    {
+        // A launch is an event of its own, and a couple of ticks aren't worth looking ahead for
+        bool launching = input->launch && !game->ball.active;
+        bool worthIt = !launching && ticks - done >= FAST_FORWARD_MIN_TICKS;
+        int skipped = worthIt ? SkipQuietTicks(game, input, ticks - done) : 0;
+
+        if (skipped > 0)
+        {
+            done += skipped;
+            stats->skippedTicks += skipped;
+            stats->skips++;
+        }
+
+        // Whatever stopped the skip happens on this tick, so it gets the real thing
+        if (done < ticks)
+        {
+            StepSimulation(game, input, SIM_DT);
+            done++;
+            stats->steppedTicks++;
+        }
+    }
+
+    return done;
+}
@@ -0,0 +1,193 @@
+﻿#include "FixedMath.h"
+#include <stdlib.h>
+
+/* sin(i/256 * 90 degrees) * 65536 for i = 0..256, plus the last one again so interpolation never reads past the end.
+ * Written out instead of filled in with sinf at startup, that would bring back exactly the problem we're avoiding.
+ * Linear interpolation between entries is off by less than one unit. */
+static const int32_t quarterSine[258] =
+{
+        0,   402,   804,  1206,  1608,  2010,  2412,  2814,  3216,  3617,  4019,  4420,
+     4821,  5222,  5623,  6023,  6424,  6824,  7224,  7623,  8022,  8421,  8820,  9218,
+     9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391, 12785, 13180, 13573, 13966,
+    14359, 14751, 15143, 15534, 15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+    19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699, 22078, 22457, 22834, 23210,
+    23586, 23961, 24335, 24708, 25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+    28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538, 30893, 31248, 31600, 31952,
+    32303, 32652, 33000, 33347, 33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+    36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716, 39040, 39362, 39683, 40002,
+    40320, 40636, 40951, 41264, 41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+    44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056, 46341, 46624, 46906, 47186,
+    47464, 47741, 48015, 48288, 48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+    50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398, 52639, 52878, 53114, 53349,
+    53581, 53812, 54040, 54267, 54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+    56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607, 57798, 57986, 58172, 58356,
+    58538, 58718, 58896, 59071, 59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+    60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568, 61705, 61839, 61971, 62101,
+    62228, 62353, 62476, 62596, 62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+    63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197, 64277, 64354, 64429, 64501,
+    64571, 64639, 64704, 64766, 64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+    65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436, 65457, 65476, 65492, 65505,
+    65516, 65525, 65531, 65535, 65536, 65536
+};
+
+// Rounded shift. GCC, Clang and MSVC all shift negative values arithmetically (and document it)
+static int64_t ShiftRound(int64_t value, int shift)
+{
+    return (value + ((int64_t)1 << (shift - 1))) >> shift;
+}
+
+// Floor of the square root, one bit at a time. Only bounces normalize, so this doesn't need to be clever
+static uint64_t SquareRoot64(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+Fixed ToFixed(float value)
+{
+    return (Fixed)(value * (float)(1 << FIXED_SHIFT));
+}
+
+float FromFixed(Fixed value)
+{
+    return (float)value * (1.0f / (1 << FIXED_SHIFT));
+}
+
+FixedUnit ToFixedUnit(float value)
+{
+    return (FixedUnit)(value * (float)FIXED_UNIT_ONE);
+}
+
+float FromFixedUnit(FixedUnit value)
+{
+    return (float)value * (1.0f / FIXED_UNIT_ONE);
+}
+
+FixedUnit FixedSin(int angle)
+{
+    uint32_t turn = (uint32_t)angle & (FIXED_ANGLE_TURN - 1);
+    uint32_t quadrant = turn >> 14;
+    uint32_t within = turn & 0x3FFF;
+
+    // The second and fourth quarters run the table backwards
+    if (quadrant & 1)
+    {
+        within = 0x4000 - within;
+    }
+
+    uint32_t index = within >> 6;
+    int32_t fraction = (int32_t)(within & 63);
+    int32_t value = quarterSine[index] + (((quarterSine[index + 1] - quarterSine[index]) * fraction) >> 6);
+
+    return quadrant >= 2 ? -value : value;
+}
+
+FixedUnit FixedCos(int angle)
+{
+    return FixedSin(angle + FIXED_ANGLE_TURN / 4);
+}
+
+void FixedNormalize(FixedUnit* x, FixedUnit* y)
+{
+    int64_t lengthSquared = (int64_t)*x * *x + (int64_t)*y * *y;
+
+    if (lengthSquared == 0)
+    {
+        return;
+    }
+
+    // Length with 24 fraction bits instead of 16, so the rounding of the root doesn't show in the result
+    int64_t length = (int64_t)SquareRoot64((uint64_t)lengthSquared << 16);
+
+    *x = (FixedUnit)((int64_t)*x * (1 << 24) / length);
+    *y = (FixedUnit)((int64_t)*y * (1 << 24) / length);
+}
+
+Vector2 FixedNormalizeVector2(Vector2 v)
+{
+    FixedUnit x = ToFixedUnit(v.x);
+    FixedUnit y = ToFixedUnit(v.y);
+
+    FixedNormalize(&x, &y);
+
+    return (Vector2){ FromFixedUnit(x), FromFixedUnit(y) };
+}
+
+Vector2 FixedMoveBall(Vector2 position, Vector2 direction, float speed, float seconds)
+{
+    return FixedMoveBallTicks(position, direction, speed, seconds, 1);
+}
+
+Vector2 FixedMoveBallTicks(Vector2 position, Vector2 direction, float speed, float seconds, int ticks)
+{
+    // A tick is about a million of these units, plenty to keep the step exact to 1/4096 px
+    int64_t time = (int64_t)(seconds * (float)(1 << 28));
+    int64_t step = ShiftRound((int64_t)ToFixed(speed) * time, 28);
+
+    // Every tick moves by the same whole number of units, so n ticks is just n of them
+    int64_t stepX = ShiftRound(ToFixedUnit(direction.x) * step, FIXED_UNIT_SHIFT);
+    int64_t stepY = ShiftRound(ToFixedUnit(direction.y) * step, FIXED_UNIT_SHIFT);
+
+    Fixed x = ToFixed(position.x) + (Fixed)(stepX * ticks);
+    Fixed y = ToFixed(position.y) + (Fixed)(stepY * ticks);
+
+    return (Vector2){ FromFixed(x), FromFixed(y) };
+}
+
+// -1 to 1 across the paddle becomes -maxAngle to maxAngle (binary angle units), then always upwards
+Vector2 FixedPaddleBounce(float ballX, float paddleX, int paddleWidth, int maxAngle)
+{
+    int halfWidth = paddleWidth / 2 > 0 ? paddleWidth / 2 : 1;
+    Fixed offset = ToFixed(ballX) - (ToFixed(paddleX) + halfWidth * (1 << FIXED_SHIFT));
+    int64_t hitPosition = (int64_t)offset * FIXED_UNIT_ONE / halfWidth >> FIXED_SHIFT;
+    int angle = (int)ShiftRound(hitPosition * maxAngle, FIXED_UNIT_SHIFT);
+
+    FixedUnit x = FixedSin(angle);
+    FixedUnit y = -abs(FixedCos(angle));
+
+    FixedNormalize(&x, &y);
+
+    return (Vector2){ FromFixedUnit(x), FromFixedUnit(y) };
+}
+
+// Closest point of the rectangle to the centre, then distance squared against radius squared. All exact
+bool FixedCheckCollisionCircleRec(Vector2 center, float radius, Rectangle rect)
+{
+    Fixed x = ToFixed(center.x);
+    Fixed y = ToFixed(center.y);
+    Fixed left = ToFixed(rect.x);
+    Fixed top = ToFixed(rect.y);
+    Fixed right = left + ToFixed(rect.width);
+    Fixed bottom = top + ToFixed(rect.height);
+
+    Fixed closestX = x < left ? left : (x > right ? right : x);
+    Fixed closestY = y < top ? top : (y > bottom ? bottom : y);
+
+    int64_t dx = closestX - x;
+    int64_t dy = closestY - y;
+    int64_t r = ToFixed(radius);
+
+    return dx * dx + dy * dy <= r * r;
+}
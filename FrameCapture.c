@@ -0,0 +1,756 @@
+﻿#include "FrameCapture.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Timing.h"
+
+/* raylib's rlgl doesn't wrap pack buffers or fences, so we fetch the few GL calls we need ourselves.
+ * GLFW is linked into raylib, and by now it has made the context current */
+typedef void (*GLProcedure)(void);
+GLProcedure glfwGetProcAddress(const char* name);
+
+#ifdef _WIN32
+    #define GL_CALL __stdcall
+#else
+    #define GL_CALL
+#endif
+
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_RGBA 0x1908
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#define GL_READ_FRAMEBUFFER_BINDING 0x8CAA
+#define GL_MAP_READ_BIT 0x0001
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x0001
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_CONDITION_SATISFIED 0x911C
+
+#define CAPTURE_SHUTDOWN_WAIT 1000000000ull // Nanoseconds we'll wait on one fence when we're quitting anyway
+
+static struct
+{
+    void (GL_CALL *GenBuffers)(int count, unsigned int* buffers);
+    void (GL_CALL *DeleteBuffers)(int count, const unsigned int* buffers);
+    void (GL_CALL *BindBuffer)(unsigned int target, unsigned int buffer);
+    void (GL_CALL *BufferData)(unsigned int target, ptrdiff_t size, const void* data, unsigned int usage);
+    void* (GL_CALL *MapBufferRange)(unsigned int target, ptrdiff_t offset, ptrdiff_t length, unsigned int access);
+    unsigned char (GL_CALL *UnmapBuffer)(unsigned int target);
+    void (GL_CALL *BindFramebuffer)(unsigned int target, unsigned int framebuffer);
+    void (GL_CALL *GetIntegerv)(unsigned int name, int* value);
+    void (GL_CALL *ReadPixels)(int x, int y, int width, int height, unsigned int format, unsigned int type, void* pixels);
+    void* (GL_CALL *FenceSync)(unsigned int condition, unsigned int flags);
+    unsigned int (GL_CALL *ClientWaitSync)(void* sync, unsigned int flags, uint64_t timeout);
+    void (GL_CALL *DeleteSync)(void* sync);
+} gl;
+
+typedef enum CaptureSlotState
+{
+    CAPTURE_SLOT_FREE,
+    CAPTURE_SLOT_READING,       // The GPU is copying into it, the fence says when it's done
+    CAPTURE_SLOT_ENCODING,      // Mapped, an encoder has it
+    CAPTURE_SLOT_ENCODED        // The encoder's done, the game thread unmaps it
+} CaptureSlotState;
+
+// What to make of one read back frame. A frame can be a screenshot and a video frame at once
+typedef struct CaptureJob
+{
+    bool screenshot;
+    char screenshotPath[64];
+    bool video;
+    int videoFrame;             // First video frame it's written as
+    int repeat;                 // How many video frames it stands in for
+    bool saved;                 // Filled in by the encoder: the screenshot made it to disk
+    double encodeMs;
+} CaptureJob;
+
+typedef struct CaptureSlot
+{
+    unsigned int buffer;
+    void* fence;
+    atomic_int state;
+    const unsigned char* pixels; // While mapped. Top row first, as it's shown (see CaptureFrame)
+    CaptureJob job;
+} CaptureSlot;
+
+/* One capture pipeline, a static singleton like the I/O worker.
+ * The ring and everything GL is the game thread's, the encoders only see slots it hands them */
+static struct
+{
+    bool available;
+    int width;
+    int height;
+
+    CaptureSlot slots[CAPTURE_RING_SIZE];
+    int nextSlot;               // The oldest slot too: the ring is used strictly in order
+
+    pthread_t encoders[CAPTURE_ENCODER_THREADS];
+    int encoderCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t written;     // A video frame went into the file, the next one can go
+    int queue[CAPTURE_RING_SIZE];
+    int queueHead;
+    int queueCount;
+    bool quit;
+
+    bool screenshotRequested;
+    int screenshots;            // Taken this session, numbers the files
+
+    // The current recording. After StopVideoCapture it stays open until its frames in flight are written
+    bool recording;
+    bool finishing;
+    CaptureFormat format;
+    char path[64];              // The Y4M, or the PNG sequence's prefix
+    FILE* video;
+    bool videoFailed;
+    double startTime;
+    int videoFramesIssued;      // Video frames handed out so far, the next capture starts at this one
+    int videoFramesWritten;     // Y4M frames in the file, guarded by the mutex
+    int videoInFlight;          // Captures of this recording not yet back in the ring
+    int framesCaptured;
+    int framesDropped;
+    int framesRepeated;
+    bool ringWasFull;           // Since the last video capture: the frames it stands in for were dropped, not slow
+
+    double gameThreadMs;
+    double encodeMs;            // Guarded by the mutex
+
+    char message[128];          // Shown by DrawCaptureStatus for a few seconds
+    double messageTime;
+} capture;
+
+static bool LoadCaptureFunctions(void)
+{
+    gl.GenBuffers = (void*)glfwGetProcAddress("glGenBuffers");
+    gl.DeleteBuffers = (void*)glfwGetProcAddress("glDeleteBuffers");
+    gl.BindBuffer = (void*)glfwGetProcAddress("glBindBuffer");
+    gl.BufferData = (void*)glfwGetProcAddress("glBufferData");
+    gl.MapBufferRange = (void*)glfwGetProcAddress("glMapBufferRange");
+    gl.UnmapBuffer = (void*)glfwGetProcAddress("glUnmapBuffer");
+    gl.BindFramebuffer = (void*)glfwGetProcAddress("glBindFramebuffer");
+    gl.GetIntegerv = (void*)glfwGetProcAddress("glGetIntegerv");
+    gl.ReadPixels = (void*)glfwGetProcAddress("glReadPixels");
+    gl.FenceSync = (void*)glfwGetProcAddress("glFenceSync");
+    gl.ClientWaitSync = (void*)glfwGetProcAddress("glClientWaitSync");
+    gl.DeleteSync = (void*)glfwGetProcAddress("glDeleteSync");
+
+    return gl.GenBuffers && gl.DeleteBuffers && gl.BindBuffer && gl.BufferData && gl.MapBufferRange &&
+           gl.UnmapBuffer && gl.BindFramebuffer && gl.GetIntegerv && gl.ReadPixels && gl.FenceSync &&
+           gl.ClientWaitSync && gl.DeleteSync;
+}
+
+static void SetCaptureMessage(const char* message)
+{
+    snprintf(capture.message, sizeof(capture.message), "%s", message);
+    capture.messageTime = GetPreciseTime();
+    printf("%s\n", message);
+}
+
+static void TimestampName(char* buffer, size_t size, const char* prefix)
+{
+    time_t now = time(NULL);
+    struct tm* local = localtime(&now);
+    char stamp[32];
+
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", local);
+    snprintf(buffer, size, "%s_%s", prefix, stamp);
+}
+
+// Encoder side
+
+// Drops the alpha too: the composite's alpha is whatever blending left behind, not something to save
+static bool WriteCapturePng(const char* path, const unsigned char* pixels, int width, int height, unsigned char* scratch)
+{
+    int count = width * height;
+
+    for (int i = 0; i < count; i++)
+    {
+        scratch[i * 3 + 0] = pixels[i * 4 + 0];
+        scratch[i * 3 + 1] = pixels[i * 4 + 1];
+        scratch[i * 3 + 2] = pixels[i * 4 + 2];
+    }
+
+    Image image = { .data = scratch, .width = width, .height = height, .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8 };
+    return ExportImage(image, path);
+}
+
+/* Full range BT.601, what Y4M's C420jpeg means. Chroma is the average of each 2x2 block.
+ * Fixed point with 8 fractional bits, chroma offset by 128 << 8 so nothing goes negative before the shift */
+static void ConvertToYuv420(const unsigned char* pixels, int width, int height, unsigned char* yuv)
+{
+    unsigned char* planeY = yuv;
+    unsigned char* planeU = yuv + width * height;
+    unsigned char* planeV = planeU + (width / 2) * (height / 2);
+
+    for (int y = 0; y < height; y += 2)
+    {
+        const unsigned char* row0 = pixels + (size_t)y * width * 4;
+        const unsigned char* row1 = row0 + (size_t)width * 4;
+        unsigned char* luma0 = planeY + (size_t)y * width;
+        unsigned char* luma1 = luma0 + width;
+        unsigned char* u = planeU + (size_t)(y / 2) * (width / 2);
+        unsigned char* v = planeV + (size_t)(y / 2) * (width / 2);
+
+        for (int x = 0; x < width; x += 2, row0 += 8, row1 += 8)
+        {
+            luma0[x] = (unsigned char)((77 * row0[0] + 150 * row0[1] + 29 * row0[2] + 128) >> 8);
+            luma0[x + 1] = (unsigned char)((77 * row0[4] + 150 * row0[5] + 29 * row0[6] + 128) >> 8);
+            luma1[x] = (unsigned char)((77 * row1[0] + 150 * row1[1] + 29 * row1[2] + 128) >> 8);
+            luma1[x + 1] = (unsigned char)((77 * row1[4] + 150 * row1[5] + 29 * row1[6] + 128) >> 8);
+
+            // Sums of four, so two more bits to shift off
+            int r = row0[0] + row0[4] + row1[0] + row1[4];
+            int g = row0[1] + row0[5] + row1[1] + row1[5];
+            int b = row0[2] + row0[6] + row1[2] + row1[6];
+            int cb = (-43 * r - 85 * g + 128 * b + (4 * 128 << 8) + 512) >> 10;
+            int cr = (128 * r - 107 * g - 21 * b + (4 * 128 << 8) + 512) >> 10;
+
+            u[x / 2] = (unsigned char)(cb > 255 ? 255 : cb);
+            v[x / 2] = (unsigned char)(cr > 255 ? 255 : cr);
+        }
+    }
+}
+
+// Y4M frames have to go in order, so an encoder that gets ahead waits for its turn
+static void WriteVideoFrame(const CaptureJob* job, const unsigned char* yuv, size_t frameSize)
+{
+    pthread_mutex_lock(&capture.mutex);
+
+    while (capture.videoFramesWritten != job->videoFrame)
+    {
+        pthread_cond_wait(&capture.written, &capture.mutex);
+    }
+
+    pthread_mutex_unlock(&capture.mutex);
+
+    // Only we write now, the others are waiting on `written`
+    for (int i = 0; i < job->repeat && yuv != NULL && !capture.videoFailed; i++)
+    {
+        if (fputs("FRAME\n", capture.video) == EOF || fwrite(yuv, 1, frameSize, capture.video) != frameSize)
+        {
+            printf("Couldn't write to %s, the rest of the recording is lost\n", capture.path);
+            capture.videoFailed = true;
+        }
+    }
+
+    pthread_mutex_lock(&capture.mutex);
+    capture.videoFramesWritten += job->repeat;
+    pthread_cond_broadcast(&capture.written);
+    pthread_mutex_unlock(&capture.mutex);
+}
+
+static void EncodeSlot(CaptureSlot* slot, unsigned char* scratch)
+{
+    CaptureJob* job = &slot->job;
+    double start = GetPreciseTime();
+
+    // Lost before it got here (see CollectCaptureSlots). Its place in the video goes by empty
+    if (slot->pixels == NULL)
+    {
+        if (job->video && capture.format == CAPTURE_Y4M)
+        {
+            WriteVideoFrame(job, NULL, 0);
+        }
+
+        return;
+    }
+
+    if (job->screenshot)
+    {
+        job->saved = WriteCapturePng(job->screenshotPath, slot->pixels, capture.width, capture.height, scratch);
+    }
+
+    if (job->video && capture.format == CAPTURE_Y4M)
+    {
+        ConvertToYuv420(slot->pixels, capture.width, capture.height, scratch);
+        WriteVideoFrame(job, scratch, (size_t)capture.width * capture.height * 3 / 2);
+    }
+    else if (job->video)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), "%s_%05d.png", capture.path, job->videoFrame);
+        WriteCapturePng(path, slot->pixels, capture.width, capture.height, scratch);
+    }
+
+    job->encodeMs = (GetPreciseTime() - start) * 1000.0;
+}
+
+static void* CaptureEncoderThread(void* argument)
+{
+    // RGB for PNGs, or a 4:2:0 frame, whichever is bigger
+    unsigned char* scratch = argument;
+
+    while (true)
+    {
+        pthread_mutex_lock(&capture.mutex);
+
+        while (capture.queueCount == 0 && !capture.quit)
+        {
+            pthread_cond_wait(&capture.wake, &capture.mutex);
+        }
+
+        if (capture.queueCount == 0)
+        {
+            pthread_mutex_unlock(&capture.mutex);
+            break;
+        }
+
+        CaptureSlot* slot = &capture.slots[capture.queue[capture.queueHead]];
+        capture.queueHead = (capture.queueHead + 1) % CAPTURE_RING_SIZE;
+        capture.queueCount--;
+        pthread_mutex_unlock(&capture.mutex);
+
+        EncodeSlot(slot, scratch);
+
+        if (slot->pixels != NULL)
+        {
+            pthread_mutex_lock(&capture.mutex);
+            capture.encodeMs += (slot->job.encodeMs - capture.encodeMs) * 0.1;
+            pthread_mutex_unlock(&capture.mutex);
+        }
+
+        atomic_store_explicit(&slot->state, CAPTURE_SLOT_ENCODED, memory_order_release);
+    }
+
+    free(scratch);
+    return NULL;
+}
+
+// Game thread side
+
+bool InitFrameCapture(int width, int height)
+{
+    if (capture.available)
+    {
+        return true;
+    }
+
+    if (!LoadCaptureFunctions())
+    {
+        printf("No pixel pack buffers or fences in this GL context, screenshots and recording are off\n");
+        return false;
+    }
+
+    capture.width = width;
+    capture.height = height;
+
+    ptrdiff_t frameSize = (ptrdiff_t)width * height * 4;
+
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        CaptureSlot* slot = &capture.slots[i];
+
+        gl.GenBuffers(1, &slot->buffer);
+        gl.BindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+        gl.BufferData(GL_PIXEL_PACK_BUFFER, frameSize, NULL, GL_STREAM_READ);
+        atomic_init(&slot->state, CAPTURE_SLOT_FREE);
+    }
+
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pthread_mutex_init(&capture.mutex, NULL);
+    pthread_cond_init(&capture.wake, NULL);
+    pthread_cond_init(&capture.written, NULL);
+    capture.quit = false;
+
+    for (int i = 0; i < CAPTURE_ENCODER_THREADS; i++)
+    {
+        unsigned char* scratch = malloc((size_t)width * height * 3);
+
+        if (scratch == NULL || pthread_create(&capture.encoders[capture.encoderCount], NULL, CaptureEncoderThread, scratch) != 0)
+        {
+            free(scratch);
+            break;
+        }
+
+        capture.encoderCount++;
+    }
+
+    if (capture.encoderCount == 0)
+    {
+        printf("Failed to start any capture encoders\n");
+
+        for (int i = 0; i < CAPTURE_RING_SIZE; i++)
+        {
+            gl.DeleteBuffers(1, &capture.slots[i].buffer);
+        }
+
+        pthread_cond_destroy(&capture.written);
+        pthread_cond_destroy(&capture.wake);
+        pthread_mutex_destroy(&capture.mutex);
+        return false;
+    }
+
+    capture.available = true;
+    return true;
+}
+
+static void FinishRecording(void)
+{
+    if (capture.video != NULL)
+    {
+        fclose(capture.video);
+        capture.video = NULL;
+    }
+
+    SetCaptureMessage(TextFormat("Saved %s%s: %d frames, %d dropped, %d repeated", capture.path,
+                                 capture.format == CAPTURE_Y4M ? ".y4m" : "_*.png", capture.framesCaptured,
+                                 capture.framesDropped, capture.framesRepeated));
+    capture.finishing = false;
+}
+
+/* Walks the ring oldest first. Buffers the encoders are done with go back to the ring; buffers the GPU has
+ * finished copying into get mapped and go to the encoders, in order, so video frames reach them in order */
+static void CollectCaptureSlots(bool wait)
+{
+    bool gpuBehind = false;
+
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        CaptureSlot* slot = &capture.slots[(capture.nextSlot + i) % CAPTURE_RING_SIZE];
+        int state = atomic_load_explicit(&slot->state, memory_order_acquire);
+
+        if (state == CAPTURE_SLOT_ENCODED)
+        {
+            if (slot->pixels != NULL)
+            {
+                gl.BindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+                gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                slot->pixels = NULL;
+            }
+
+            if (slot->job.screenshot)
+            {
+                SetCaptureMessage(TextFormat(slot->job.saved ? "Saved %s" : "Couldn't save %s", slot->job.screenshotPath));
+            }
+
+            capture.videoInFlight -= slot->job.video;
+            atomic_store_explicit(&slot->state, CAPTURE_SLOT_FREE, memory_order_relaxed);
+        }
+        else if (state == CAPTURE_SLOT_READING && !gpuBehind)
+        {
+            unsigned int result = gl.ClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? CAPTURE_SHUTDOWN_WAIT : 0);
+
+            // Later ones can't be done either, and they have to wait their turn anyway
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            {
+                gpuBehind = true;
+                continue;
+            }
+
+            gl.DeleteSync(slot->fence);
+            slot->fence = NULL;
+
+            gl.BindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+            slot->pixels = gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (ptrdiff_t)capture.width * capture.height * 4, GL_MAP_READ_BIT);
+
+            // Not much to do about it, the frame is lost. It still goes to the encoders, so the video's order moves on
+            if (slot->pixels == NULL)
+            {
+                printf("Couldn't map a capture buffer\n");
+                capture.framesDropped += slot->job.video ? slot->job.repeat : 0;
+            }
+
+            atomic_store_explicit(&slot->state, CAPTURE_SLOT_ENCODING, memory_order_relaxed);
+
+            pthread_mutex_lock(&capture.mutex);
+            capture.queue[(capture.queueHead + capture.queueCount) % CAPTURE_RING_SIZE] = (int)(slot - capture.slots);
+            capture.queueCount++;
+            pthread_cond_signal(&capture.wake);
+            pthread_mutex_unlock(&capture.mutex);
+        }
+    }
+
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (capture.finishing && capture.videoInFlight == 0)
+    {
+        FinishRecording();
+    }
+}
+
+// The copy only gets queued here, the GPU does it later and the fence tells us when
+static void StartReadback(CaptureSlot* slot, RenderTexture2D source)
+{
+    int previous = 0;
+    gl.GetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+
+    gl.BindFramebuffer(GL_READ_FRAMEBUFFER, source.id);
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    gl.ReadPixels(0, 0, capture.width, capture.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    gl.BindFramebuffer(GL_READ_FRAMEBUFFER, (unsigned int)previous);
+
+    slot->fence = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    atomic_store_explicit(&slot->state, CAPTURE_SLOT_READING, memory_order_relaxed);
+}
+
+void CaptureFrame(RenderTexture2D source)
+{
+    if (!capture.available)
+    {
+        return;
+    }
+
+    double start = GetPreciseTime();
+
+    CollectCaptureSlots(false);
+
+    /* Video frames that should exist by now. Everything since the last capture goes on this one:
+     * one more when we're keeping up, several after a slow frame or a drop */
+    int videoDue = capture.recording ? (int)((start - capture.startTime) * CAPTURE_VIDEO_FPS) + 1 : 0;
+    bool video = videoDue > capture.videoFramesIssued;
+
+    if ((video || capture.screenshotRequested) && source.texture.width == capture.width && source.texture.height == capture.height)
+    {
+        CaptureSlot* slot = &capture.slots[capture.nextSlot];
+
+        if (atomic_load_explicit(&slot->state, memory_order_acquire) != CAPTURE_SLOT_FREE)
+        {
+            // Screenshots just wait for the next frame, and so does video: it only loses frames if this lasts
+            capture.ringWasFull |= video;
+        }
+        else
+        {
+            CaptureJob* job = &slot->job;
+            *job = (CaptureJob){0};
+
+            if (capture.screenshotRequested)
+            {
+                char name[48];
+                TimestampName(name, sizeof(name), "screenshot");
+
+                job->screenshot = true;
+                snprintf(job->screenshotPath, sizeof(job->screenshotPath), "%s_%d.png", name, capture.screenshots++);
+                capture.screenshotRequested = false;
+            }
+
+            if (video)
+            {
+                // Video frames that passed without a capture of their own. A Y4M gets this one again in their place
+                int missed = videoDue - capture.videoFramesIssued - 1;
+
+                job->video = true;
+                job->videoFrame = capture.videoFramesIssued;
+                job->repeat = capture.format == CAPTURE_Y4M ? missed + 1 : 1;
+
+                capture.framesDropped += capture.ringWasFull ? missed : 0;
+                capture.framesRepeated += capture.ringWasFull ? 0 : missed;
+                capture.ringWasFull = false;
+                capture.videoFramesIssued = videoDue;
+                capture.framesCaptured++;
+                capture.videoInFlight++;
+            }
+
+            /* glReadPixels reads bottom row first, but the composite is stored upside down (it's drawn to the
+             * screen unflipped, see EndBackgroundComposite), so this comes out top row first as it's shown */
+            StartReadback(slot, source);
+            capture.nextSlot = (capture.nextSlot + 1) % CAPTURE_RING_SIZE;
+        }
+    }
+
+    double elapsedMs = (GetPreciseTime() - start) * 1000.0;
+    capture.gameThreadMs += (elapsedMs - capture.gameThreadMs) * 0.01;
+}
+
+void RequestScreenshot(void)
+{
+    capture.screenshotRequested = capture.available;
+}
+
+bool StartVideoCapture(CaptureFormat format)
+{
+    if (!capture.available || capture.recording)
+    {
+        return false;
+    }
+
+    // The last one's still going into its file
+    if (capture.finishing)
+    {
+        SetCaptureMessage("Still finishing the last recording");
+        return false;
+    }
+
+    TimestampName(capture.path, sizeof(capture.path), "capture");
+
+    if (format == CAPTURE_Y4M)
+    {
+        /* Straight to the file from the encoders, not through the I/O worker: ~180 MB/s of video would hold up
+         * every run save queued behind it. It's written by one encoder at a time (see WriteVideoFrame) */
+        char path[80];
+        snprintf(path, sizeof(path), "%s.y4m", capture.path);
+        capture.video = fopen(path, "wb");
+
+        if (capture.video == NULL)
+        {
+            SetCaptureMessage(TextFormat("Couldn't create %s", path));
+            return false;
+        }
+
+        fprintf(capture.video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", capture.width, capture.height, CAPTURE_VIDEO_FPS);
+    }
+
+    capture.format = format;
+    capture.recording = true;
+    capture.videoFailed = false;
+    capture.startTime = GetPreciseTime();
+    capture.videoFramesIssued = 0;
+    capture.videoFramesWritten = 0;
+    capture.framesCaptured = 0;
+    capture.framesDropped = 0;
+    capture.framesRepeated = 0;
+    capture.ringWasFull = false;
+
+    printf("Recording to %s%s\n", capture.path, format == CAPTURE_Y4M ? ".y4m" : "_*.png");
+    return true;
+}
+
+void StopVideoCapture(void)
+{
+    if (!capture.recording)
+    {
+        return;
+    }
+
+    capture.recording = false;
+    capture.finishing = true;
+
+    // Nothing in flight: done right away. Otherwise CollectCaptureSlots finishes it
+    if (capture.videoInFlight == 0)
+    {
+        FinishRecording();
+    }
+}
+
+bool IsCapturingVideo(void)
+{
+    return capture.recording;
+}
+
+void ShutdownFrameCapture(void)
+{
+    if (!capture.available)
+    {
+        return;
+    }
+
+    StopVideoCapture();
+
+    // We're quitting, so now we do wait: for the GPU, then for the encoders
+    while (true)
+    {
+        CollectCaptureSlots(true);
+
+        int busy = 0;
+
+        for (int i = 0; i < CAPTURE_RING_SIZE; i++)
+        {
+            busy += atomic_load(&capture.slots[i].state) != CAPTURE_SLOT_FREE;
+        }
+
+        if (busy == 0)
+        {
+            break;
+        }
+
+        SleepSeconds(0.001);
+    }
+
+    pthread_mutex_lock(&capture.mutex);
+    capture.quit = true;
+    pthread_cond_broadcast(&capture.wake);
+    pthread_mutex_unlock(&capture.mutex);
+
+    for (int i = 0; i < capture.encoderCount; i++)
+    {
+        pthread_join(capture.encoders[i], NULL);
+    }
+
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        gl.DeleteBuffers(1, &capture.slots[i].buffer);
+    }
+
+    pthread_cond_destroy(&capture.written);
+    pthread_cond_destroy(&capture.wake);
+    pthread_mutex_destroy(&capture.mutex);
+
+    capture.encoderCount = 0;
+    capture.available = false;
+}
+
+CaptureStats GetCaptureStats(void)
+{
+    CaptureStats stats = {0};
+
+    stats.available = capture.available;
+    stats.recording = capture.recording;
+    stats.format = capture.format;
+    stats.recordingSeconds = capture.recording ? GetPreciseTime() - capture.startTime : 0.0;
+    stats.framesCaptured = capture.framesCaptured;
+    stats.framesDropped = capture.framesDropped;
+    stats.framesRepeated = capture.framesRepeated;
+    stats.screenshots = capture.screenshots;
+    stats.gameThreadMs = capture.gameThreadMs;
+
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        stats.framesInFlight += atomic_load(&capture.slots[i].state) != CAPTURE_SLOT_FREE;
+    }
+
+    if (capture.available)
+    {
+        pthread_mutex_lock(&capture.mutex);
+        stats.encodeMs = capture.encodeMs;
+        pthread_mutex_unlock(&capture.mutex);
+    }
+
+    return stats;
+}
+
+void DrawCaptureStatus(int x, int y)
+{
+    const int fontSize = 20;
+    CaptureStats stats = GetCaptureStats();
+    bool showMessage = GetPreciseTime() - capture.messageTime < CAPTURE_STATUS_SECONDS && capture.message[0] != '\0';
+
+    if (!stats.recording && !showMessage)
+    {
+        return;
+    }
+
+    int rows = stats.recording ? 3 : 1;
+    DrawRectangle(x - 10, y - 10, 560, rows * (fontSize + 6) + 14, ColorAlpha(BLACK, 0.7f));
+
+    if (!stats.recording)
+    {
+        DrawText(capture.message, x, y, fontSize, WHITE);
+        return;
+    }
+
+    int seconds = (int)stats.recordingSeconds;
+
+    // Blinks, like a camcorder
+    if (seconds % 2 == 0)
+    {
+        DrawCircle(x + 8, y + fontSize / 2, 8, RED);
+    }
+
+    DrawText(TextFormat("REC %s  %d:%02d", stats.format == CAPTURE_Y4M ? "Y4M" : "PNG", seconds / 60, seconds % 60),
+             x + 24, y, fontSize, WHITE);
+
+    DrawText(TextFormat("%d frames, %d dropped, %d repeated", stats.framesCaptured, stats.framesDropped, stats.framesRepeated),
+             x, y + (fontSize + 6), fontSize, stats.framesDropped > 0 ? YELLOW : GREEN);
+
+    DrawText(TextFormat("Game thread %.2f ms  Encode %.1f ms  Ring %d/%d", stats.gameThreadMs, stats.encodeMs,
+                        stats.framesInFlight, CAPTURE_RING_SIZE),
+             x, y + (fontSize + 6) * 2, fontSize, GRAY);
+}
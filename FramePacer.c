@@ -0,0 +1,351 @@
+﻿#include "FramePacer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "Timing.h"
+
+/* raylib is built with GLFW inside, but raylib.h has no "wait for input, with a timeout".
+ * GLFW does, so we declare it ourselves. Events it picks up land in raylib's input state
+ * through raylib's own callbacks, so IsKeyPressed etc. still see them next frame. */
+void glfwWaitEventsTimeout(double timeout);
+
+// One pacer per process, so like the I/O worker its state lives here
+static struct
+{
+    bool initialized;
+    PacingPolicy policy;
+
+    double refreshRate;
+    int divisor;
+    double deadline;        // When the next frame should start
+    double frameStart;
+    double lastPresent;
+
+    // Sleep-then-spin: we learn how late the OS wakes us up, and busy-wait that much at the end
+    double sleepOvershoot;
+    double spinMargin;
+
+    // Rolling window of present-to-present times
+    float frameTimes[PACER_STATS_WINDOW];
+    bool missed[PACER_STATS_WINDOW];
+    int head;
+    int count;
+
+    // Governor, see UpdateGovernor
+    int governorFrames;
+    int governorMisses;
+    double governorWorstWork;
+
+    // Whole session, printed on shutdown
+    long long totalFrames;
+    long long totalMissed;
+    long long eventWakeups;
+    double totalTime;
+} pacer;
+
+static void RefreshDisplayRate(void)
+{
+    int rate = GetMonitorRefreshRate(GetCurrentMonitor());
+    pacer.refreshRate = rate > 0 ? rate : PACER_FALLBACK_REFRESH;
+}
+
+void InitFramePacer(void)
+{
+    // We do our own waiting, so raylib's EndDrawing shouldn't
+    SetTargetFPS(0);
+    BeginHighResolutionTimer();
+
+    memset(&pacer, 0, sizeof(pacer));
+    pacer.initialized = true;
+    pacer.policy = PACING_EVENT_DRIVEN;
+    pacer.divisor = 1;
+    pacer.spinMargin = PACER_SPIN_MAX;
+    pacer.frameStart = GetPreciseTime();
+    pacer.lastPresent = pacer.frameStart;
+    pacer.deadline = pacer.frameStart;
+
+    RefreshDisplayRate();
+}
+
+void SetPacingPolicy(PacingPolicy policy)
+{
+    if (policy == pacer.policy)
+    {
+        return;
+    }
+
+    // Fresh start: the old policy's deadlines and governor history mean nothing now
+    pacer.policy = policy;
+    pacer.divisor = 1;
+    pacer.governorFrames = 0;
+    pacer.governorMisses = 0;
+    pacer.governorWorstWork = 0.0;
+    pacer.deadline = GetPreciseTime();
+
+    RefreshDisplayRate(); // The window might have moved to another monitor
+}
+
+static double GetTargetInterval(void)
+{
+    double interval = 0.0;
+
+    switch (pacer.policy)
+    {
+        case PACING_UNCAPPED:
+            interval = 0.0;
+        break;
+
+        case PACING_DISPLAY_LOCKED:
+            interval = pacer.divisor / pacer.refreshRate;
+        break;
+
+        case PACING_EVENT_DRIVEN:
+            interval = 1.0 / PACER_MENU_TICK_RATE;
+        break;
+    }
+
+    // In the background nobody needs more than a trickle of frames, not even benchmarks
+    if (!IsWindowFocused() || IsWindowMinimized())
+    {
+        interval = fmax(interval, 1.0 / PACER_UNFOCUSED_RATE);
+    }
+
+    return interval;
+}
+
+static void WaitUntil(double deadline)
+{
+    double remaining = deadline - GetPreciseTime();
+
+    // Sleep the bulk of it, the OS scheduler isn't precise enough for the last bit
+    while (remaining > pacer.spinMargin)
+    {
+        double request = remaining - pacer.spinMargin;
+        double before = GetPreciseTime();
+
+        SleepSeconds(request);
+
+        double overshoot = fmax((GetPreciseTime() - before) - request, 0.0);
+        pacer.sleepOvershoot = pacer.sleepOvershoot * 0.9 + overshoot * 0.1;
+        pacer.spinMargin = fmin(fmax(pacer.sleepOvershoot * 1.5 + PACER_SPIN_MIN, PACER_SPIN_MIN), PACER_SPIN_MAX);
+
+        remaining = deadline - GetPreciseTime();
+    }
+
+    // ...and spin the rest
+    while (GetPreciseTime() < deadline)
+    {
+        SpinPause();
+    }
+}
+
+/* Menus: block until input arrives or the animation tick is due.
+ * When input wakes us early we still don't draw faster than the display can show. */
+static void WaitForEvents(double deadline)
+{
+    double remaining = deadline - GetPreciseTime();
+
+    if (remaining <= 0.0)
+    {
+        return;
+    }
+
+    glfwWaitEventsTimeout(remaining);
+
+    double soonest = pacer.frameStart + 1.0 / pacer.refreshRate;
+
+    if (GetPreciseTime() < deadline)
+    {
+        pacer.eventWakeups++;
+        WaitUntil(soonest < deadline ? soonest : deadline);
+    }
+}
+
+/* If we keep missing refresh deadlines, a steady 72 FPS looks way better than a stuttery 100-144.
+ * So the governor drops to every 2nd (3rd, 4th) refresh, and climbs back once there's headroom. */
+static void UpdateGovernor(double workTime, bool missed)
+{
+    if (pacer.policy != PACING_DISPLAY_LOCKED)
+    {
+        return;
+    }
+
+    pacer.governorFrames++;
+    pacer.governorMisses += missed ? 1 : 0;
+    pacer.governorWorstWork = fmax(pacer.governorWorstWork, workTime);
+
+    if (pacer.governorFrames < PACER_GOVERNOR_WINDOW)
+    {
+        return;
+    }
+
+    double refreshInterval = 1.0 / pacer.refreshRate;
+    double fasterInterval = (pacer.divisor - 1) * refreshInterval;
+
+    if (pacer.governorMisses > PACER_GOVERNOR_WINDOW / 10 && pacer.divisor < PACER_MAX_DIVISOR)
+    {
+        pacer.divisor++;
+    }
+    else if (pacer.divisor > 1 && pacer.governorWorstWork < fasterInterval * 0.7)
+    {
+        pacer.divisor--;
+    }
+
+    pacer.governorFrames = 0;
+    pacer.governorMisses = 0;
+    pacer.governorWorstWork = 0.0;
+}
+
+void PaceFrame(void)
+{
+    if (!pacer.initialized)
+    {
+        return;
+    }
+
+    // Right after EndDrawing, so this is (roughly) when the frame was presented
+    double present = GetPreciseTime();
+    double workTime = present - pacer.frameStart;
+    double interval = GetTargetInterval();
+    bool missed = false;
+
+    if (interval > 0.0)
+    {
+        pacer.deadline += interval;
+
+        if (present > pacer.deadline)
+        {
+            missed = pacer.policy == PACING_DISPLAY_LOCKED;
+
+            // Late: start counting again from now, instead of catching up with a burst of short frames
+            pacer.deadline = present;
+        }
+        else if (pacer.policy == PACING_EVENT_DRIVEN)
+        {
+            WaitForEvents(pacer.deadline);
+        }
+        else
+        {
+            WaitUntil(pacer.deadline);
+        }
+    }
+    else
+    {
+        pacer.deadline = present;
+    }
+
+    UpdateGovernor(workTime, missed);
+
+    // Stats are present to present, that's the cadence the player actually sees
+    double frameTime = present - pacer.lastPresent;
+    pacer.lastPresent = present;
+
+    pacer.frameTimes[pacer.head] = (float)frameTime;
+    pacer.missed[pacer.head] = missed;
+    pacer.head = (pacer.head + 1) % PACER_STATS_WINDOW;
+    pacer.count += pacer.count < PACER_STATS_WINDOW ? 1 : 0;
+
+    pacer.totalFrames++;
+    pacer.totalMissed += missed ? 1 : 0;
+    pacer.totalTime += frameTime;
+
+    pacer.frameStart = GetPreciseTime();
+}
+
+static int CompareFloats(const void* a, const void* b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+
+    return (x > y) - (x < y);
+}
+
+FrameStats GetFrameStats(void)
+{
+    FrameStats stats =
+    {
+        .frameCount = pacer.count,
+        .policy = pacer.policy,
+        .refreshRate = pacer.refreshRate,
+        .targetMs = pacer.initialized ? GetTargetInterval() * 1000.0 : 0.0,
+        .divisor = pacer.divisor,
+        .spinMarginMs = pacer.spinMargin * 1000.0,
+        .focused = IsWindowFocused()
+    };
+
+    if (pacer.count == 0)
+    {
+        return stats;
+    }
+
+    float sorted[PACER_STATS_WINDOW];
+    double sum = 0.0;
+
+    for (int i = 0; i < pacer.count; i++)
+    {
+        sorted[i] = pacer.frameTimes[i];
+        sum += pacer.frameTimes[i];
+        stats.missedDeadlines += pacer.missed[i] ? 1 : 0;
+    }
+
+    double mean = sum / pacer.count;
+    double variance = 0.0;
+
+    for (int i = 0; i < pacer.count; i++)
+    {
+        variance += (sorted[i] - mean) * (sorted[i] - mean);
+    }
+
+    qsort(sorted, pacer.count, sizeof(float), CompareFloats);
+
+    stats.meanMs = mean * 1000.0;
+    stats.deviationMs = sqrt(variance / pacer.count) * 1000.0;
+    stats.p99Ms = sorted[(pacer.count * 99) / 100] * 1000.0;
+    stats.worstMs = sorted[pacer.count - 1] * 1000.0;
+
+    return stats;
+}
+
+void DrawFrameStats(int x, int y)
+{
+    static const char* policyNames[] = { "uncapped", "display locked", "event driven" };
+    const int fontSize = 20;
+
+    FrameStats stats = GetFrameStats();
+
+    DrawRectangle(x - 10, y - 10, 560, 4 * (fontSize + 6) + 14, ColorAlpha(BLACK, 0.7f));
+
+    DrawText(TextFormat("%.0f FPS  (%s, target %.2f ms, %.0f Hz / %d)",
+                        stats.meanMs > 0.0 ? 1000.0 / stats.meanMs : 0.0, policyNames[stats.policy],
+                        stats.targetMs, stats.refreshRate, stats.divisor),
+             x, y, fontSize, WHITE);
+
+    DrawText(TextFormat("Frame %.2f ms  +/- %.2f  p99 %.2f  worst %.2f",
+                        stats.meanMs, stats.deviationMs, stats.p99Ms, stats.worstMs),
+             x, y + (fontSize + 6), fontSize, stats.deviationMs < 1.0 ? GREEN : YELLOW);
+
+    DrawText(TextFormat("Missed %d / %d  Spin %.2f ms%s",
+                        stats.missedDeadlines, stats.frameCount, stats.spinMarginMs, stats.focused ? "" : "  (unfocused)"),
+             x, y + (fontSize + 6) * 2, fontSize, stats.missedDeadlines > 0 ? RED : WHITE);
+
+    DrawText("F2 benchmark  F3 hide", x, y + (fontSize + 6) * 3, fontSize, GRAY);
+}
+
+void ShutdownFramePacer(void)
+{
+    if (!pacer.initialized)
+    {
+        return;
+    }
+
+    if (pacer.totalFrames > 0)
+    {
+        printf("Frame pacing: %lld frames, average %.2f ms, %lld missed deadlines, %lld input wakeups\n",
+               pacer.totalFrames, pacer.totalTime * 1000.0 / pacer.totalFrames, pacer.totalMissed, pacer.eventWakeups);
+    }
+
+    EndHighResolutionTimer();
+    pacer.initialized = false;
+}
@@ -8,14 +8,27 @@
 #include <time.h>
 
 #include "Level.h"
-
-Game InitGame(int width, int height)
+#include "IOWorker.h"
+#include "FramePacer.h"
+#include "LateInput.h"
+#include "Timing.h"
+#include "InputThread.h"
+#include "Snapshot.h"
+#include "History.h"
+#include "Replay.h"
+#include "FixedMath.h"
+#include "JobSystem.h"
+#include "FrameCapture.h"
+
+_Static_assert(TELEMETRY_POWERUP_TYPES == POWERUP_COUNT, "Telemetry needs one column per power-up type");
+
+// Everything the simulation needs, and nothing that needs a window or the disk (replay tools, tests)
+Game InitHeadlessGame(int width, int height)
 {
     Game game = {
         .screenWidth = width,
         .screenHeight = height,
-        .background = InitBackground(width, height),
-        .gameTexture = LoadRenderTexture(width, height),
+        .headless = true,
 
         .state = MAIN_MENU,
         .selectedOption = MENU_PLAY, // default
@@ -30,27 +43,25 @@ Game InitGame(int width, int height)
         .powerUpCount = 0,
         .spawnSystem = InitPowerUpSpawnSystem(),
         .isTimewarpActive = false,
+        .particles = InitParticleSystem(MAX_PARTICLES),
         .timeScale = 1.0f,
         .normalTimeScale = 1.0f,
 
-        .leaderboard = InitLeaderboard(),
         .uiUpdateTimer = 0.0f,
         .UI_UPDATE_INTERVAL = 1.0f/30.0f, // We want to render UI at 30 fps!
 
         .inMenu = true,
+        .lateLatchEnabled = true,
         .shouldClose = false,
         .currentLevel = 1,
-        .maxLevels = 5,
+        .maxLevels = GetLevelCount(),
         .currentBlockRows = MIN_BLOCK_ROWS,
         .currentBlockColumns = MIN_BLOCK_COLUMNS,
         .player.score = 0,
     };
 
-    game.gameTexture = LoadRenderTexture(width, height);
-    game.background = InitBackground(width, height);
-
     // Initialise blocks before player/etc
-    InitBlocks(game.blocks, width, height, game.currentBlockRows, game.currentBlockColumns, game.isTimewarpActive);
+    BuildLevelBlocks(&game, game.currentLevel);
 
     // Player, Ball, Blocks
     game.player = InitPlayer(width, height);
@@ -69,12 +80,35 @@ Game InitGame(int width, int height)
         game.powerUps[i].active = false;
     }
 
-    // Set random seed for powerup spawning
-    srand(time(NULL));
+    // Until the first ResetGame picks a proper run seed (the tutorial starts playing straight from here)
+    game.random = SeedSimRandom((uint64_t)time(NULL));
 
     return game;
 }
 
+Game InitGame(int width, int height)
+{
+    Game game = InitHeadlessGame(width, height);
+
+    game.headless = false;
+    game.background = InitBackground(width, height);
+    game.gameTexture = LoadRenderTexture(width, height);
+    game.screenCache = InitScreenCache(width, height);
+    game.leaderboard = InitLeaderboard();
+
+    return game;
+}
+
+// HandleCollisions' paddle test on its own. The fast-forward asks it ahead of time
+bool IsBallTouchingPaddle(Vector2 position, float radius, Rectangle paddle)
+{
+#ifdef FIXED_POINT_PHYSICS
+    return FixedCheckCollisionCircleRec(position, radius, paddle);
+#else
+    return CheckCollisionCircleRec(position, radius, paddle);
+#endif
+}
+
 void HandleCollisions (Game* game)
 {
     Rectangle playerRect =
@@ -86,7 +120,15 @@ void HandleCollisions (Game* game)
     };
 
     // Bounce ball on collision with the player, depending on its angle
-    if (CheckCollisionCircleRec(game->ball.position, game->ball.radius, playerRect))
+#ifdef FIXED_POINT_PHYSICS
+    if (IsBallTouchingPaddle(game->ball.position, game->ball.radius, playerRect))
+    {
+        // Same bounce in integers: the angle in binary units, sine and cosine from a table
+        game->ball.direction = FixedPaddleBounce(game->ball.position.x, game->player.position.x,
+                                                 game->player.width, FIXED_ANGLE_TURN / 8);
+    }
+#else
+    if (IsBallTouchingPaddle(game->ball.position, game->ball.radius, playerRect))
     {
         // -1 to 1!
         float paddleCenter = game->player.position.x + game->player.width/2;
@@ -105,14 +147,37 @@ void HandleCollisions (Game* game)
 
         game->ball.direction = MyVector2Normalize(newDirection);
     }
+#endif
 
     // Give score to the player on ball/block collision and combo!
     for (int row = 0; row < game->currentBlockRows; row++)
     {
         for (int col = 0; col < game->currentBlockColumns; col++)
         {
-            if (CheckBlockCollision(&game->blocks[row][col], &game->ball, game->isTimewarpActive))
+            if (CheckBlockCollision(&game->blocks[row][col], &game->ball, game->isTimewarpActive, &game->random))
             {
+                Block* block = &game->blocks[row][col];
+                Rectangle blockRect = { block->position.x, block->position.y, block->width, block->height };
+
+                // Solid blocks only bounce the ball, no score or combo for hitting a wall
+                if (block->type == BLOCK_SOLID)
+                {
+                    SpawnParticleBurst(&game->particles, blockRect, game->ball.currentColor, PARTICLE_HIT_COUNT / 2);
+                    return; // Still only one block per frame
+                }
+
+                game->telemetry.blocksHit++;
+
+                // Shards! A small spray on hits, and the whole block shatters when it's destroyed
+                if (block->active)
+                {
+                    SpawnParticleBurst(&game->particles, blockRect, game->ball.currentColor, PARTICLE_HIT_COUNT);
+                }
+                else
+                {
+                    SpawnParticleBurst(&game->particles, blockRect, block->color, PARTICLE_DESTROY_COUNT);
+                }
+
                 game->combo++;
                 game->maxCombo = fmax(game->combo, game->maxCombo);
 
@@ -123,7 +188,10 @@ void HandleCollisions (Game* game)
                 game->lastScoreGained = finalScore;
                 game->lastScoreTimer = SCORE_POPUP_DURATION;
 
-                if (CheckPowerUpSpawn(&game->spawnSystem, game->combo, game->player.score, GetFrameTime()))
+                // Bonus blocks always drop one, the rest roll the dice
+                bool bonusDrop = !block->active && block->type == BLOCK_BONUS;
+
+                if (bonusDrop || CheckPowerUpSpawn(&game->spawnSystem, game->combo, game->player.score, SIM_DT, &game->random))
                 {
                     Vector2 spawnPosition = MyVector2Create
                     (
@@ -131,8 +199,8 @@ void HandleCollisions (Game* game)
                         game->blocks[row][col].position.y + game->blocks[row][col].height / 2
                     );
 
-                    // Lazy so using rand() to randomly select a power-up!
-                    PowerUpType type = rand() % POWERUP_COUNT;
+                    // Seeded, so a snapshot or a replay picks the same power-up again
+                    PowerUpType type = (PowerUpType)SimRandomRange(&game->random, 0, POWERUP_COUNT - 1);
 
                     for (int i = 0; i < 10; i++)
                     {
@@ -162,6 +230,7 @@ void HandleCollisions (Game* game)
                                 break;
 
                                 case POWERUP_LIFE:
+                                case POWERUP_REWIND:
                                     duration = PU_DEFAULT_DURATION;
                                 break;
 
@@ -172,6 +241,7 @@ void HandleCollisions (Game* game)
 
                             game->powerUps[i] = CreatePowerUp(spawnPosition, type, duration);
                             game->powerUpCount++;
+                            game->telemetry.powerUpsSpawned[type]++;
 
                             break;
                         }
@@ -183,10 +253,401 @@ void HandleCollisions (Game* game)
     }
 }
 
+// Game over and win screens
+static void DrawEndScreen(Game game)
+{
+    const char* restartText = (game.state == GAME_OVER) ? "Press R to Restart  |  L to Retry Level" : "Press R to Restart";
+    const char* menuText = "Press Q for Menu";
+
+    const char* titleText = (game.state == WIN) ? "YOU WIN!" : "GAME OVER";
+    Color titleColor = (game.state == WIN) ? PLAYER_COLOR : PU_DAMAGE_COLOR;
+
+    char finalScoreText[64];
+    sprintf(finalScoreText, "Final Score: %d", game.player.score);
+    char maxComboText[64];
+    sprintf(maxComboText, "Max Combo: %d", game.maxCombo);
+
+    int titleWidth = MeasureText(titleText, TITLE_FONT_SIZE);
+    int scoreWidth = MeasureText(finalScoreText, OPTIONS_FONT_SIZE);
+    int comboWidth = MeasureText(maxComboText, OPTIONS_FONT_SIZE);
+    int restartWidth = MeasureText(restartText, OPTIONS_FONT_SIZE);
+    int menuWidth = MeasureText(menuText, OPTIONS_FONT_SIZE);
+
+    int baseY = game.screenHeight/2 - BASE_Y_OFFSET;
+
+    DrawText(titleText,
+        game.screenWidth/2 - titleWidth/2,
+        baseY,
+        TITLE_FONT_SIZE,
+        titleColor);
+
+    DrawText(finalScoreText,
+        game.screenWidth/2 - scoreWidth/2,
+        baseY + TITLE_SPACING,
+        OPTIONS_FONT_SIZE,
+        WHITE);
+
+    DrawText(maxComboText,
+        game.screenWidth/2 - comboWidth/2,
+        baseY + TITLE_SPACING + NORMAL_SPACING,
+        OPTIONS_FONT_SIZE,
+        PLAYER_COLOR);
+
+    // Where this run landed among every run ever played
+    if (game.leaderboard.lastRank > 0)
+    {
+        char rankText[64];
+        sprintf(rankText, "Your rank is #%d of %d", game.leaderboard.lastRank, game.leaderboard.lastTotal);
+
+        DrawText(rankText,
+            game.screenWidth/2 - MeasureText(rankText, OPTIONS_FONT_SIZE)/2,
+            baseY + TITLE_SPACING + NORMAL_SPACING * 2,
+            OPTIONS_FONT_SIZE,
+            GOLD);
+    }
+
+    DrawText(restartText,
+        game.screenWidth/2 - restartWidth/2,
+        baseY + TITLE_SPACING + NORMAL_SPACING * 3,
+        OPTIONS_FONT_SIZE,
+        BALL_COLOR);
+
+    DrawText(menuText,
+        game.screenWidth/2 - menuWidth/2,
+        baseY + TITLE_SPACING + NORMAL_SPACING * 4,
+        OPTIONS_FONT_SIZE,
+        PU_SPEED_COLOR);
+}
+
+// Every screen except gameplay is static text, so it's drawn into the screen cache instead
+static void DrawStaticScreen(Game game)
+{
+    switch(game.state)
+    {
+        case MAIN_MENU:
+        case TUTORIAL:
+        case LEADERBOARD:
+            DrawMainMenu(game);
+        break;
+
+        case LEVEL_COMPLETE:
+            DrawLevelComplete(game);
+        break;
+
+        case GAME_OVER:
+        case WIN:
+            DrawEndScreen(game);
+        break;
+
+        case PLAYING:
+        break;
+    }
+}
+
+// Everything a static screen shows goes into its key, so when any of it changes the cache redraws itself
+static unsigned int GetStaticScreenKey(const Game* game)
+{
+    unsigned int key = HashScreenKey(0, game->state);
+
+    switch(game->state)
+    {
+        case MAIN_MENU:
+            key = HashScreenKey(key, game->selectedOption);
+        break;
+
+        case LEADERBOARD:
+            key = HashScreenKey(key, (int)game->leaderboard.revision);
+        break;
+
+        case LEVEL_COMPLETE:
+        case GAME_OVER:
+        case WIN:
+            key = HashScreenKey(key, game->currentLevel);
+            key = HashScreenKey(key, game->player.score);
+            key = HashScreenKey(key, game->lastScoreGained);
+            key = HashScreenKey(key, game->maxCombo);
+            key = HashScreenKey(key, game->leaderboard.lastRank);
+            key = HashScreenKey(key, game->leaderboard.lastTotal);
+        break;
+
+        default:
+        break;
+    }
+
+    return key;
+}
+
+static void UpdateScreenCache(Game* game)
+{
+    /* Gameplay draws straight over what the composite last distorted, so the first static frame after it
+     * has to come out as rebuilt even if its key matches the screen we cached before the run */
+    if (game->state == PLAYING)
+    {
+        InvalidateScreenCache(&game->screenCache);
+        game->screenCache.rebuilt = false;
+        return;
+    }
+
+    if (BeginScreenCache(&game->screenCache, GetStaticScreenKey(game)))
+    {
+        DrawStaticScreen(*game);
+        EndScreenCache(&game->screenCache);
+    }
+}
+
+// A run just ended, either way: rank it and keep its telemetry
+static void FinishRun(Game* game)
+{
+    // Replaying or testing a run, it already counted when it was played
+    if (game->headless)
+    {
+        return;
+    }
+
+    FinishReplayRecording(game);
+    AddLeaderboardEntry(&game->leaderboard, game->player.score, game->maxCombo);
+
+    IORequest request = { .type = IO_APPEND_TELEMETRY };
+    request.telemetry = BuildTelemetryRow(&game->telemetry, game->player.score, game->maxCombo, game->currentLevel);
+    SubmitIORequest(request);
+}
+
+/* One fixed tick of the game, SIM_DT long. Nothing in here reads raylib's input or clock,
+ * everything it needs comes in through SimInput and deltaTime. */
+void StepSimulation(Game* game, const SimInput* input, float deltaTime)
+{
+    float scaledTime = deltaTime * game->timeScale;
+
+    game->simTime += deltaTime;
+    game->spawnSystem.cooldownTimer -= scaledTime; // power ups
+    game->telemetry.ticks++;
+    game->telemetry.duration += deltaTime; // Timewarp doesn't count
+
+    if (game->lastScoreTimer > 0)
+    {
+        game->lastScoreTimer -= scaledTime;
+    }
+
+    // Update player movement and trail
+    UpdatePlayerMovement(&game->player, input, game->timeScale, game->screenWidth);
+
+    // Ball shooting
+    if (input->launch && !game->ball.active)
+    {
+        Vector2 startPosition = MyVector2Create(
+            game->player.position.x + game->player.width / 2,
+            game->player.position.y - game->ball.radius
+        );
+
+        Vector2 initialDirection = MyVector2Create(0, -1);
+        ShootBall(&game->ball, startPosition, initialDirection, game->player, input->launchSteer, &game->random);
+    }
+
+    // Update ball and handle screen collisions!
+    // I want to make sure my ball can bounce on screen edges, but also create a "killZone" at the bottom!
+    if (game->ball.active)
+    {
+        UpdateBall(&game->ball, scaledTime, game->screenWidth, game->screenHeight);
+        HandleCollisions(game);
+
+        // Here I handle our Killzone!
+        if (game->ball.position.y > game->screenHeight)
+        {
+            game->player.lives--;
+            RecordTelemetryDeath(&game->telemetry);
+            game->ball.active = false;
+            game->combo = 0;  // Reset combo
+
+            if (game->player.lives <= 0)
+            {
+                FinishRun(game);
+                game->state = GAME_OVER;
+            }
+        }
+    }
+    else // Ball is not active
+    {
+        // Update ball position to follow player when not launched
+        game->ball.position = MyVector2Create
+        (
+            game->player.position.x + game->player.width / 2,
+            game->player.position.y - game->ball.radius
+        );
+    }
+
+    // Check win condition
+    if (AreAllBlocksDestroyed(game->blocks, game->currentBlockRows, game->currentBlockColumns))
+    {
+        if (!game->endless && game->currentLevel == game->maxLevels)
+        {
+            FinishRun(game);
+            game->state = WIN;
+        }
+        else
+        {
+            game->state = LEVEL_COMPLETE;
+        }
+    }
+
+    UpdatePowerUps(game, deltaTime);
+    HandlePowerUpCollisions(game);
+}
+
+/* Holding rewind scrubs back through the history instead of simulating, PU_REWIND_SPEED ticks per tick.
+ * Letting go carries on from wherever it got to. Returns true for the ticks it took over.
+ * A rewind costs one charge of the state it lands on, and it never reaches back past the pickup of
+ * that charge or past the last rewind. So a cut always has exactly one charge fewer than the state
+ * a replay verifier simulated up to it, which is all it can check (see IsHonestCut) */
+static bool StepRewind(Game* game, const SimInput* input)
+{
+    if (!input->rewind)
+    {
+        if (game->rewindTicks > 0)
+        {
+            /* The future we scrubbed over is gone, and so is the past before it. Even this tick is,
+             * landing on it again would fold the next cut into this one */
+            CutReplayRecording(game, game->rewindTicks);
+            ClearHistory();
+            game->rewindTicks = 0;
+        }
+
+        return false;
+    }
+
+    if (game->rewindTicks == 0 && (game->rewindCharges == 0 || GetHistoryLength() < 2))
+    {
+        return false;
+    }
+
+    int limit = (int)(PU_REWIND_SECONDS * SIM_TICK_RATE);
+    int oldest = GetHistoryLength() - 1;
+    int target = game->rewindTicks + PU_REWIND_SPEED;
+
+    target = target < limit ? target : limit;
+    target = target < oldest ? target : oldest;
+
+    // At the limit, or right after the charge was picked up, we just hold still until it's let go
+    static GameSnapshot snapshot;
+
+    for (; target > game->rewindTicks; target--)
+    {
+        if (ReconstructHistory(target, &snapshot) && snapshot.rewindCharges > 0)
+        {
+            ApplySnapshot(game, &snapshot);
+            game->rewindCharges = snapshot.rewindCharges - 1;
+            game->rewindTicks = target;
+            break;
+        }
+    }
+
+    return true;
+}
+
+/* Runs every whole tick that fits between the last one and now.
+ * Render frames and simulation ticks are fully decoupled: at 60 FPS that's 4 ticks a frame,
+ * at 1000 FPS most frames run none. */
+static void RunSimulationTicks(Game* game)
+{
+    InputQueue* queue = GetInputQueue();
+    double now = GetPreciseTime();
+
+    // (Re)entering gameplay: start the tick clock from now, older input belongs to whatever screen we were on
+    if (!game->input.clockRunning)
+    {
+        DiscardInput(&game->input, queue, now);
+        game->input.clock = now;
+        game->input.clockRunning = true;
+    }
+
+    int ticks = 0;
+
+    while (game->input.clock + SIM_DT <= now && game->state == PLAYING)
+    {
+        // A long hitch: drop the time instead of freezing up trying to simulate all of it
+        if (ticks == SIM_MAX_TICKS_PER_FRAME)
+        {
+            DiscardInput(&game->input, queue, now);
+            game->input.clock = now;
+            break;
+        }
+
+        SimInput input = BuildTickInput(&game->input, queue, game->input.clock, game->input.clock + SIM_DT);
+
+        if (!StepRewind(game, &input))
+        {
+            RecordReplayTick(game, &input);
+            StepSimulation(game, &input, SIM_DT);
+            RecordHistory(game);
+        }
+
+        game->input.clock += SIM_DT;
+        ticks++;
+    }
+
+    // The paddle is where the last tick left it, late latching extrapolates from that moment
+    game->inputSampleTime = game->input.clock;
+}
+
+// This frame's jobs, filled in by UpdateGame and finished before it returns
+static JobGraph frameGraph;
+
 void UpdateGame(Game* game)
 {
+    // Hand finished disk work (loads, saves) back to whoever asked for it
+    PollIOCompletions(game);
+
+    if (IsKeyPressed(KEY_F2))
+    {
+        game->benchmarkMode = !game->benchmarkMode;
+    }
+
+    if (IsKeyPressed(KEY_F3))
+    {
+        game->showFrameStats = !game->showFrameStats;
+    }
+
+    if (IsKeyPressed(KEY_F4))
+    {
+        game->showInputLatency = !game->showInputLatency;
+    }
+
+    if (IsKeyPressed(KEY_F5))
+    {
+        game->lateLatchEnabled = !game->lateLatchEnabled;
+    }
+
+    // F6 screenshot, F7 video, F8 PNG sequence. Read back a few frames later, see FrameCapture.h
+    if (IsKeyPressed(KEY_F6))
+    {
+        RequestScreenshot();
+    }
+
+    if (IsKeyPressed(KEY_F7) || IsKeyPressed(KEY_F8))
+    {
+        if (IsCapturingVideo())
+        {
+            StopVideoCapture();
+        }
+        else
+        {
+            StartVideoCapture(IsKeyPressed(KEY_F7) ? CAPTURE_Y4M : CAPTURE_PNG_SEQUENCE);
+        }
+    }
+
+    // Without an input thread, we turn raylib's per-frame key state into events ourselves
+    if (!IsInputThreadRunning())
+    {
+        PollFrameInput(&game->input, GetInputQueue());
+    }
+
+    // Not simulating: keep the queue drained, and restart the tick clock when gameplay resumes
+    if (game->state != PLAYING || game->inMenu)
+    {
+        DiscardInput(&game->input, GetInputQueue(), GetPreciseTime());
+        game->input.clockRunning = false;
+    }
+
     float deltaTime = GetFrameTime() * game->timeScale;
-    game->spawnSystem.cooldownTimer -= deltaTime; // power ups
 
     UpdateBackground(&game->background, deltaTime, game->isTimewarpActive);
     UpdatePlayerColor(&game->player, game->isTimewarpActive);
@@ -207,11 +668,8 @@ void UpdateGame(Game* game)
     }
     else
     {
-        BeginTextureMode(game->background.uiTexture);
-        {
-            ClearBackground(BLANK);
-        }
-        EndTextureMode();
+        // The UI layer isn't drawn outside gameplay, but redraw it on the very first frame back
+        game->uiUpdateTimer = game->UI_UPDATE_INTERVAL;
     }
 
     switch(game->state)
@@ -226,70 +684,7 @@ void UpdateGame(Game* game)
         {
             if (!game->inMenu)
             {
-                if (game->lastScoreTimer > 0)
-                {
-                    game->lastScoreTimer -= deltaTime;
-                }
-
-                // Update player movement and trail
-                UpdatePlayerMovement(&game->player, deltaTime, game->screenWidth);
-
-                // Ball shooting
-                if (IsKeyPressed(KEY_SPACE) && !game->ball.active)
-                {
-                    Vector2 startPosition = MyVector2Create(
-                        game->player.position.x + game->player.width / 2,
-                        game->player.position.y - game->ball.radius
-                    );
-
-                    Vector2 initialDirection = MyVector2Create(0, -1);
-                    ShootBall(&game->ball, startPosition, initialDirection, game->player);
-                }
-
-                // Update ball and handle screen collisions!
-                // I want to make sure my ball can bounce on screen edges, but also create a "killZone" at the bottom!
-                if (game->ball.active)
-                {
-                    UpdateBall(&game->ball, deltaTime, game->screenWidth, game->screenHeight);
-                    HandleCollisions(game);
-
-                    // Here I handle our Killzone!
-                    if (game->ball.position.y > game->screenHeight)
-                    {
-                        game->player.lives--;
-                        game->ball.active = false;
-                        game->combo = 0;  // Reset combo
-
-                        if (game->player.lives <= 0)
-                        {
-                            AddLeaderboardEntry(&game->leaderboard, game->player.score, game->maxCombo);
-                            game->state = GAME_OVER;
-                        }
-                    }
-                }
-                else // Ball is not active
-                {
-                    // Update ball position to follow player when not launched
-                    game->ball.position = MyVector2Create
-                    (
-                        game->player.position.x + game->player.width / 2,
-                        game->player.position.y - game->ball.radius
-                    );
-                }
-
-                // Check win condition
-                if (AreAllBlocksDestroyed(game->blocks, game->currentBlockRows, game->currentBlockColumns))
-                {
-                    if (game->currentLevel == game->maxLevels)
-                    {
-                        AddLeaderboardEntry(&game->leaderboard, game->player.score, game->maxCombo);
-                        game->state = WIN;
-                    }
-                    else
-                    {
-                        game->state = LEVEL_COMPLETE;
-                    }
-                }
+                RunSimulationTicks(game);
 
                 // Debug power-up info
                 for (int i = 0; i < PU_MAX_COUNT; i++)
@@ -303,10 +698,10 @@ void UpdateGame(Game* game)
                                powerUp->active, powerUp->wasPickedUp);
                     }
                 }
-
-                UpdatePowerUps(game);
-                HandlePowerUpCollisions(game);
             }
+
+            // On the job workers, while we get on with the rest of the frame
+            AddParticleJobs(&frameGraph, &game->particles, deltaTime);
         } break;
 
         case LEVEL_COMPLETE:
@@ -322,12 +717,28 @@ void UpdateGame(Game* game)
             {
                 ResetGame(game);
             }
+            else if (IsKeyPressed(KEY_L) && game->state == GAME_OVER)
+            {
+                // Straight back to the start of this level, nothing gets rebuilt
+                if (RetryLevel(game))
+                {
+                    BeginReplayRecording(game);
+                }
+            }
             else if (IsKeyPressed(KEY_Q))
             {
                 TransitionToMenu(game);
             }
         break;
     }
+
+    StartJobGraph(&frameGraph);
+
+    // After the switch, so a screen we just switched to gets cached before it's drawn. GL, so it's ours
+    UpdateScreenCache(game);
+
+    // Everything the frame's jobs touch has to be done before DrawGame reads it
+    WaitForJobGraph(&frameGraph);
 }
 
 /* Just for clearer seperation of concers, I've moved the UI drawing to a seperate function
@@ -399,95 +810,120 @@ void DrawUI(Game* game)
                 FONT_SIZE,
                 BALL_COLOR);
 
+            if (game->rewindTicks > 0)
+            {
+                const char* rewindText = "<< REWIND";
+                DrawText(rewindText,
+                    game->screenWidth/2 - MeasureText(rewindText, TITLE_FONT_SIZE)/2,
+                    game->screenHeight/2 - TITLE_FONT_SIZE/2,
+                    TITLE_FONT_SIZE,
+                    PU_REWIND_COLOR);
+            }
+
+            if (game->rewindCharges > 0)
+            {
+                char rewindText[32];
+                sprintf(rewindText, "Rewind x%d [BACKSPACE]", game->rewindCharges);
+                DrawText(rewindText,
+                    game->screenWidth/2 - MeasureText(rewindText, FONT_SIZE)/2,
+                    game->screenHeight - PADDING_TOP * 1.5,
+                    FONT_SIZE,
+                    PU_REWIND_COLOR);
+            }
+
             DrawPowerUpTimers(*game);
         }
         EndTextureMode();
     }
 }
 
-void DrawGame(Game game)
+/* Late latch: re-read the paddle keys right before the final composite, and draw the paddle where
+ * they'd have moved it by now. Only the drawing moves, player.position stays the simulation's. */
+static void DrawLatchedPaddle(const Game* game)
 {
-    BeginTextureMode(game.gameTexture); // Render all of this into our game.gameTexture
+    float x = game->player.position.x;
+
+    if (game->lateLatchEnabled && !game->inMenu)
     {
-        ClearBackground(BLACK);
+        bool simulatedLeft = game->input.held[INPUT_KEY_LEFT];
+        bool simulatedRight = game->input.held[INPUT_KEY_RIGHT];
+        bool simulatedDash = game->input.held[INPUT_KEY_DASH];
+
+        PaddleKeys keys = SamplePaddleKeys();
 
-        switch(game.state)
+        if (!keys.valid)
         {
-            case PLAYING:
-                DrawPlayerWithTrail(&game.player);
-                DrawBlocks(game.blocks, game.currentBlockRows, game.currentBlockColumns);
-                DrawBall(game.ball);
-                DrawPowerUps(&game);
-            break;
+            // No mid-frame key reads here, so we can only extrapolate with what the simulation saw
+            keys = (PaddleKeys){ .left = simulatedLeft, .right = simulatedRight, .dash = simulatedDash };
+        }
 
-            case MAIN_MENU:
-            case TUTORIAL:
-            case LEADERBOARD:
-                DrawMainMenu(game);
-            break;
+        // Same rules as UpdatePlayerMovement: right wins over left
+        float direction = keys.right ? 1.0f : (keys.left ? -1.0f : 0.0f);
+        float speed = game->player.speed * (keys.dash ? PLAYER_SPEED_BOOST : 1.0f);
+        float elapsed = fminf((float)(GetPreciseTime() - game->inputSampleTime), LATE_LATCH_MAX_LEAD) * game->timeScale;
 
-            case LEVEL_COMPLETE:
-            {
-                DrawLevelComplete(game);
-            }
-            break;
+        x = Clamp(x + direction * speed * elapsed, 0, game->screenWidth - game->player.width);
 
-            case GAME_OVER:
-            case WIN:
-            {
-                const char* restartText = "Press R to Restart";
-                const char* menuText = "Press Q for Menu";
+        MarkLateLatch(keys.left != simulatedLeft || keys.right != simulatedRight || keys.dash != simulatedDash);
+    }
 
-                const char* titleText = (game.state == WIN) ? "YOU WIN!" : "GAME OVER";
-                Color titleColor = (game.state == WIN) ? PLAYER_COLOR : PU_DAMAGE_COLOR;
+    DrawDistortedRectangle(&game->background,
+        (Rectangle){ x, game->player.position.y, game->player.width, game->player.height },
+        game->player.color);
+}
 
-                char finalScoreText[64];
-                sprintf(finalScoreText, "Final Score: %d", game.player.score);
-                char maxComboText[64];
-                sprintf(maxComboText, "Max Combo: %d", game.maxCombo);
+static void DrawInputLatency(const Game* game, int x, int y)
+{
+    const int fontSize = 20;
+    InputLatencyStats stats = GetInputLatencyStats();
 
-                int titleWidth = MeasureText(titleText, TITLE_FONT_SIZE);
-                int scoreWidth = MeasureText(finalScoreText, OPTIONS_FONT_SIZE);
-                int comboWidth = MeasureText(maxComboText, OPTIONS_FONT_SIZE);
-                int restartWidth = MeasureText(restartText, OPTIONS_FONT_SIZE);
-                int menuWidth = MeasureText(menuText, OPTIONS_FONT_SIZE);
+    DrawRectangle(x - 10, y - 10, 560, 3 * (fontSize + 6) + 14, ColorAlpha(BLACK, 0.7f));
 
-                int baseY = game.screenHeight/2 - BASE_Y_OFFSET;
+    DrawText(TextFormat("Input to present: %.2f ms (worst %.2f)", stats.simulatedMs, stats.worstSimulatedMs),
+             x, y, fontSize, WHITE);
 
-                DrawText(titleText,
-                    game.screenWidth/2 - titleWidth/2,
-                    baseY,
-                    TITLE_FONT_SIZE,
-                    titleColor);
-
-                DrawText(finalScoreText,
-                    game.screenWidth/2 - scoreWidth/2,
-                    baseY + TITLE_SPACING,
-                    OPTIONS_FONT_SIZE,
-                    WHITE);
-
-                DrawText(maxComboText,
-                    game.screenWidth/2 - comboWidth/2,
-                    baseY + TITLE_SPACING + NORMAL_SPACING,
-                    OPTIONS_FONT_SIZE,
-                    PLAYER_COLOR);
-
-                DrawText(restartText,
-                    game.screenWidth/2 - restartWidth/2,
-                    baseY + TITLE_SPACING + NORMAL_SPACING * 2,
-                    OPTIONS_FONT_SIZE,
-                    BALL_COLOR);
-
-                DrawText(menuText,
-                    game.screenWidth/2 - menuWidth/2,
-                    baseY + TITLE_SPACING + NORMAL_SPACING * 3,
-                    OPTIONS_FONT_SIZE,
-                    PU_SPEED_COLOR);
-            }
-            break;
+    DrawText(TextFormat("Late latched: %.2f ms (worst %.2f)%s", stats.latchedMs, stats.worstLatchedMs,
+                        game->lateLatchEnabled ? "" : "  OFF"),
+             x, y + (fontSize + 6), fontSize, game->lateLatchEnabled ? GREEN : GRAY);
+
+    DrawText(TextFormat("Corrected %d / %d frames  F5 toggle", stats.corrections, stats.samples),
+             x, y + (fontSize + 6) * 2, fontSize, GRAY);
+}
+
+// The game screen's draw commands, rebuilt every PLAYING frame
+static RenderCommandBuffer frameCommands;
+
+// The particles already batch themselves, they just need to happen at the right layer
+static void DrawParticlesCommand(const void* data)
+{
+    DrawParticles(data);
+}
+
+void DrawGame(Game game)
+{
+    Texture2D gameScreen = game.screenCache.texture.texture;
+    bool gameScreenChanged = game.screenCache.rebuilt;
+
+    if (game.state == PLAYING)
+    {
+        BeginTextureMode(game.gameTexture); // Render all of this into our game.gameTexture
+        {
+            ClearBackground(BLACK);
+
+            // Recorded first, then replayed sorted by layer and texture, see RenderCommands.h
+            ClearRenderCommands(&frameCommands);
+            RecordPlayerTrail(&frameCommands, &game.player); // The paddle itself comes later, see DrawLatchedPaddle
+            RecordBlocks(&frameCommands, game.blocks, game.currentBlockRows, game.currentBlockColumns);
+            PushCustom(&frameCommands, RENDER_LAYER_PARTICLES, DrawParticlesCommand, &game.particles);
+            RecordBall(&frameCommands, game.ball);
+            RecordPowerUps(&frameCommands, &game);
+            SubmitRenderCommands(&frameCommands);
         }
+        EndTextureMode();
+
+        gameScreen = game.gameTexture.texture;
+        gameScreenChanged = true;
     }
-    EndTextureMode();
 
     BeginDrawing();
     {
@@ -499,6 +935,7 @@ void DrawGame(Game game)
          *    a. Static Effects → background.staticEffects
          *    b. Dynamic Effects → background.effectTexture
          *    c. Distortion & Composition → background.finalTexture
+         *    d. Late-latched paddle, drawn straight into the composition
          *    ↓
          * 3. UI Elements → background.uiTexture (DrawUI) =)
          *    ↓
@@ -506,19 +943,49 @@ void DrawGame(Game game)
          *    - Background (with game elements and effects)
          *    - UI layer on top */
 
-        // Then, we draw the game.gameTexture that we rendered in BeginTextureMode above^^
-        DrawBackground(&game.background, game.screenWidth, game.screenHeight,
-                      game.gameTexture.texture);
+        // Then, we draw the game screen: game.gameTexture from above^^, or the cached static screen
+        BeginBackgroundComposite(&game.background, game.screenWidth, game.screenHeight,
+                      gameScreen, gameScreenChanged);
+        {
+            if (game.state == PLAYING)
+            {
+                DrawLatchedPaddle(&game);
+            }
+        }
+        EndBackgroundComposite(&game.background);
 
         // UI
-        DrawTexturePro(game.background.uiTexture.texture,
-              (Rectangle){ 0, 0,
-                         game.background.uiTexture.texture.width,
-                         -game.background.uiTexture.texture.height }, // - to flip vertically
-              (Rectangle){ 0, 0,
-                         game.screenWidth,
-                         game.screenHeight },
-              (Vector2){ 0, 0 }, 0, WHITE);
+        if (game.state == PLAYING)
+        {
+            DrawTexturePro(game.background.uiTexture.texture,
+                  (Rectangle){ 0, 0,
+                             game.background.uiTexture.texture.width,
+                             -game.background.uiTexture.texture.height }, // - to flip vertically
+                  (Rectangle){ 0, 0,
+                             game.screenWidth,
+                             game.screenHeight },
+                  (Vector2){ 0, 0 }, 0, WHITE);
+        }
+        else if (game.state == MAIN_MENU)
+        {
+            DrawMenuArrows(game);
+        }
+
+        if (game.showFrameStats)
+        {
+            DrawFrameStats(PADDING_SIDE, PADDING_TOP + FONT_SIZE * 2);
+            DrawHistoryStats(PADDING_SIDE, PADDING_TOP + FONT_SIZE * 13);
+            DrawRenderStats(&frameCommands, PADDING_SIDE, PADDING_TOP + FONT_SIZE * 17);
+            DrawJobStats(PADDING_SIDE, PADDING_TOP + FONT_SIZE * 19);
+        }
+
+        if (game.showInputLatency)
+        {
+            DrawInputLatency(&game, PADDING_SIDE, PADDING_TOP + FONT_SIZE * 8);
+        }
+
+        // On the screen only, the capture reads the composite before the UI goes on
+        DrawCaptureStatus(game.screenWidth - PADDING_SIDE - 540, PADDING_TOP + FONT_SIZE * 2);
 
         // DrawTexturePro(
         //     texture,          // The texture to draw
@@ -530,6 +997,9 @@ void DrawGame(Game game)
         // );
     }
     EndDrawing();
+
+    // For the F4 measurement: this frame is out, how old was the input it showed?
+    MarkPresent();
 }
 
 void TransitionToMenu(Game* game)
@@ -541,6 +1011,7 @@ void TransitionToMenu(Game* game)
     game->maxCombo = 0;
     game->currentLevel = 1;
     game->currentBlockRows = MIN_BLOCK_ROWS;
+    game->endless = false; // The tutorial's ENTER starts a normal run
 
     ResetGame(game);
 
@@ -555,6 +1026,15 @@ void TransitionToMenu(Game* game)
     EndTextureMode();
 }
 
+// A fresh seed for every endless run, unless one was given with --seed
+static uint64_t NewLevelSeed(void)
+{
+    uint64_t seed = (uint64_t)time(NULL) << 32;
+    seed ^= (uint64_t)(GetPreciseTime() * 1000000.0);
+
+    return seed != 0 ? seed : 1;
+}
+
 // Reinitialise everything on reset 'R' !
 void ResetGame(Game* game)
 {
@@ -576,15 +1056,24 @@ void ResetGame(Game* game)
     game->combo = 0;
     game->maxCombo = 0;
     game->currentLevel = 1;
-    game->currentBlockRows = MIN_BLOCK_ROWS;
-    game->currentBlockColumns = MIN_BLOCK_COLUMNS;
+    game->levelSeed = game->fixedLevelSeed != 0 ? game->fixedLevelSeed : NewLevelSeed();
+    game->random = SeedSimRandom(game->levelSeed ^ 0x5EED5EED5EED5EEDull); // Not the same stream as the levels
+    ClearParticles(&game->particles);
+    ResetRunTelemetry(&game->telemetry);
+    game->simTime = 0.0;
+    game->rewindCharges = 0;
+    game->rewindTicks = 0;
     game->ball.speed = BALL_SPEED_MIN;
     game->player.width = game->player.baseWidth;
     game->player.score = 0;
 
-    InitBlocks(game->blocks, game->screenWidth, game->screenHeight,
-           game->currentBlockRows, game->currentBlockColumns,
-           game->isTimewarpActive);
+    BuildLevelBlocks(game, game->currentLevel);
 
     game->state = PLAYING;
+    MarkLevelStart(game);
+
+    if (!game->headless)
+    {
+        BeginReplayRecording(game);
+    }
 }
\ No newline at end of file
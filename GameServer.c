@@ -0,0 +1,1416 @@
+﻿#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Game.h"
+#include "Level.h"
+#include "Spectator.h"
+#include "Timing.h"
+
+/* Authoritative game server: hosts any number of independent rooms, each its own headless Game.
+ *   GameServer serve [--port n] [--threads n]
+ *   GameServer load [--host h] [--port n] [--rooms n] [--watchers n] [--seconds s] [--threads n]
+ * A client connects and joins a room by number. The first one in plays, anyone after that watches.
+ * Every room lives on one worker thread for good (room number modulo the workers), so a room's game is
+ * only ever touched by that thread and nothing in the tick needs a lock. Each worker waits on its own
+ * epoll set and ticks all its rooms ROOM_TICK_RATE times a second, every tick ROOM_SIM_STEPS of StepSimulation
+ * with whatever the player last held. The state goes out every ROOM_STATE_INTERVAL ticks in the spectator
+ * stream's format (Spectator.h), deltas and all, so a Spectate-style client can read it as it is.
+ *
+ * Every message both ways is a little-endian uint16 length, a type byte and the rest, like the spectator stream.
+ * `load` is the other end: bots over loopback, one connection per room (plus watchers), that play from the
+ * state they're sent and time how long their input takes to come back acknowledged. epoll, so Linux only. */
+
+#define SERVER_DEFAULT_PORT 7790
+#define SERVER_MAX_CONNECTIONS 65536
+#define SERVER_MAX_EVENTS 256
+#define SERVER_STATS_SECONDS 10
+#define ROOM_TICK_RATE 60
+#define ROOM_SIM_STEPS (SIM_TICK_RATE / ROOM_TICK_RATE)
+#define ROOM_STATE_INTERVAL 2           // Ticks between state messages, 30 a second
+#define ROOM_MAX_MEMBERS 4              // The player and three watchers
+#define ROOM_MAX_CATCH_UP 6             // Ticks a worker runs back to back after a hitch before it drops the time
+#define CONNECTION_IN_BUFFER 256        // Clients only ever send a few bytes at a time
+#define CONNECTION_OUT_BUFFER 16384     // Unsent bytes. A client this far behind is dropped
+#define LOAD_LATENCY_WINDOW 65536
+
+_Static_assert(SIM_TICK_RATE % ROOM_TICK_RATE == 0, "A room tick has to be whole simulation steps");
+
+// After the spectator stream's own SPECTATOR_SNAPSHOT and SPECTATOR_DELTA
+typedef enum GameMessageType
+{
+    GAME_JOIN = 16,         // Client: uint32 room, uint64 level seed (only used by whoever opens the room)
+    GAME_INPUT = 17,        // Client: uint32 sequence, uint8 buttons held
+    GAME_WELCOME = 18,      // Server: uint32 room, uint8 playing, uint16 tick rate, uint16 state interval
+    GAME_INPUT_ACK = 19     // Server: uint32 sequence, uint32 tick. Sent just before the state that includes it
+} GameMessageType;
+
+#define GAME_JOIN_SIZE 13
+#define GAME_INPUT_SIZE 6
+
+typedef enum GameButtons
+{
+    GAME_BUTTON_LEFT = 1,
+    GAME_BUTTON_RIGHT = 2,
+    GAME_BUTTON_DASH = 4,
+    GAME_BUTTON_LAUNCH = 8,
+    GAME_BUTTON_RESTART = 16    // After a game over
+} GameButtons;
+
+typedef struct Room Room;
+
+typedef struct Connection
+{
+    int fd;
+    Room* room;                 // NULL until it's joined
+    struct Connection* next;    // In the hand-off list to a worker
+    bool writing;               // Waiting for EPOLLOUT
+    bool broken;                // Close it once the tick is done with it
+
+    unsigned char in[CONNECTION_IN_BUFFER];
+    int inSize;
+    unsigned char out[CONNECTION_OUT_BUFFER];
+    int outSize;
+} Connection;
+
+struct Room
+{
+    uint32_t id;
+    Game game;
+    Connection* members[ROOM_MAX_MEMBERS]; // The first one plays
+    int memberCount;
+
+    uint8_t buttons;            // As of the player's last input
+    uint32_t inputSequence;
+    uint32_t ackedSequence;
+    uint32_t tick;
+
+    SpectatorState known;       // What every member has
+    bool haveKnown;
+};
+
+typedef struct Worker
+{
+    pthread_t thread;
+    int index;
+    int epoll;
+    int wake;                   // eventfd: new connections are waiting in the hand-off list
+
+    pthread_mutex_t mutex;
+    Connection* handoff;        // In the order they joined: the first one into a room plays
+    Connection* handoffTail;
+
+    // Only the worker touches these
+    Room** rooms;               // Dense, for ticking
+    int roomCount;
+    int roomCapacity;
+    Room** table;               // Open addressing by room number, for joining
+    int tableCapacity;
+    SpectatorState next;
+
+    // Read by the stats printer whenever
+    atomic_int statRooms;
+    atomic_int statConnections;
+    atomic_llong statTicks;     // Room ticks
+    atomic_llong statLateTicks; // Worker ticks that ran late enough to drop time
+    atomic_llong statBusyNs;
+    atomic_llong statBytesOut;
+} Worker;
+
+static struct
+{
+    Worker* workers;
+    int workerCount;
+    atomic_bool quit;
+} server;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void OnStopSignal(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
+
+// Thousands of rooms on one machine is thousands of sockets, usually more than the default limit allows
+static void RaiseFileLimit(void)
+{
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void Put8(unsigned char** cursor, uint32_t value)
+{
+    *(*cursor)++ = (unsigned char)value;
+}
+
+static void Put16(unsigned char** cursor, uint32_t value)
+{
+    Put8(cursor, value & 0xFF);
+    Put8(cursor, value >> 8);
+}
+
+static void Put32(unsigned char** cursor, uint32_t value)
+{
+    Put16(cursor, value & 0xFFFF);
+    Put16(cursor, value >> 16);
+}
+
+static uint32_t Take16(const unsigned char* data)
+{
+    return data[0] | (uint32_t)data[1] << 8;
+}
+
+static uint32_t Take32(const unsigned char* data)
+{
+    return Take16(data) | Take16(data + 2) << 16;
+}
+
+// The length goes in front once we know it
+static int FinishMessage(unsigned char* message, unsigned char* end)
+{
+    int length = (int)(end - message) - 2;
+    message[0] = (unsigned char)(length & 0xFF);
+    message[1] = (unsigned char)(length >> 8);
+
+    return length + 2;
+}
+
+// Hands whole messages to `handle` and keeps the rest. False when something doesn't parse
+static bool SplitMessages(unsigned char* buffer, int* size, int capacity, bool (*handle)(void* context, const unsigned char* message, int length), void* context)
+{
+    int offset = 0;
+
+    while (*size - offset >= 2)
+    {
+        int length = (int)Take16(buffer + offset);
+
+        if (length == 0)
+        {
+            return false;
+        }
+
+        if (*size - offset - 2 < length)
+        {
+            break;
+        }
+
+        if (!handle(context, buffer + offset + 2, length))
+        {
+            return false;
+        }
+
+        offset += 2 + length;
+    }
+
+    memmove(buffer, buffer + offset, (size_t)(*size - offset));
+    *size -= offset;
+
+    // A message that can never fit in the buffer
+    return *size < 2 || (int)Take16(buffer) + 2 <= capacity;
+}
+
+static void SetNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+}
+
+// Server side
+
+static void Queue(Connection* connection, const unsigned char* data, int size)
+{
+    if (connection->broken)
+    {
+        return;
+    }
+
+    if (connection->outSize + size > CONNECTION_OUT_BUFFER)
+    {
+        connection->broken = true;
+        return;
+    }
+
+    memcpy(connection->out + connection->outSize, data, (size_t)size);
+    connection->outSize += size;
+}
+
+static void Flush(Worker* worker, Connection* connection)
+{
+    int sent = 0;
+
+    while (sent < connection->outSize)
+    {
+        ssize_t result = send(connection->fd, connection->out + sent, (size_t)(connection->outSize - sent), MSG_NOSIGNAL);
+
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+
+        if (result <= 0)
+        {
+            connection->broken = true;
+            return;
+        }
+
+        sent += (int)result;
+    }
+
+    memmove(connection->out, connection->out + sent, (size_t)(connection->outSize - sent));
+    connection->outSize -= sent;
+    atomic_fetch_add_explicit(&worker->statBytesOut, sent, memory_order_relaxed);
+
+    // Only ask to hear about room to write while there's something waiting, or it fires constantly
+    bool writing = connection->outSize > 0;
+
+    if (writing != connection->writing)
+    {
+        struct epoll_event event = { .events = EPOLLIN | (writing ? EPOLLOUT : 0), .data.ptr = connection };
+        epoll_ctl(worker->epoll, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->writing = writing;
+    }
+}
+
+static uint32_t HashRoom(uint32_t id)
+{
+    return id * 2654435761u;
+}
+
+static Room** FindRoomSlot(Worker* worker, uint32_t id)
+{
+    uint32_t mask = (uint32_t)worker->tableCapacity - 1;
+    uint32_t slot = HashRoom(id) & mask;
+
+    while (worker->table[slot] != NULL && worker->table[slot]->id != id)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return &worker->table[slot];
+}
+
+// Rebuilt from the dense list, which also clears out anything that was removed
+static bool RebuildRoomTable(Worker* worker, int capacity)
+{
+    Room** table = calloc((size_t)capacity, sizeof(Room*));
+
+    if (table == NULL)
+    {
+        return false;
+    }
+
+    free(worker->table);
+    worker->table = table;
+    worker->tableCapacity = capacity;
+
+    for (int i = 0; i < worker->roomCount; i++)
+    {
+        *FindRoomSlot(worker, worker->rooms[i]->id) = worker->rooms[i];
+    }
+
+    return true;
+}
+
+static Room* OpenRoom(Worker* worker, uint32_t id, uint64_t seed)
+{
+    Room** slot = FindRoomSlot(worker, id);
+
+    if (*slot != NULL)
+    {
+        return *slot;
+    }
+
+    if (worker->roomCount == worker->roomCapacity)
+    {
+        int capacity = worker->roomCapacity * 2;
+        Room** rooms = realloc(worker->rooms, (size_t)capacity * sizeof(Room*));
+
+        if (rooms == NULL)
+        {
+            return NULL;
+        }
+
+        worker->rooms = rooms;
+        worker->roomCapacity = capacity;
+    }
+
+    Room* room = calloc(1, sizeof(Room));
+
+    if (room == NULL)
+    {
+        return NULL;
+    }
+
+    // Game has a const member, so no plain assignment. No sparks on a server
+    Game game = InitHeadlessGame(1920, 1080);
+    UnloadParticleSystem(&game.particles);
+    memcpy(&room->game, &game, sizeof(Game));
+
+    room->id = id;
+    room->game.endless = true;
+    room->game.fixedLevelSeed = seed != 0 ? seed : id + 1;
+    ResetGame(&room->game);
+
+    worker->rooms[worker->roomCount++] = room;
+
+    // Keep the table at most half full, linear probing stays short that way
+    if (worker->roomCount * 2 > worker->tableCapacity)
+    {
+        if (!RebuildRoomTable(worker, worker->tableCapacity * 2))
+        {
+            worker->roomCount--;
+            free(room);
+            return NULL;
+        }
+    }
+    else
+    {
+        *FindRoomSlot(worker, id) = room;
+    }
+
+    atomic_store_explicit(&worker->statRooms, worker->roomCount, memory_order_relaxed);
+    return room;
+}
+
+static void CloseRoom(Worker* worker, Room* room)
+{
+    for (int i = 0; i < worker->roomCount; i++)
+    {
+        if (worker->rooms[i] == room)
+        {
+            worker->rooms[i] = worker->rooms[--worker->roomCount];
+            break;
+        }
+    }
+
+    // Linear probing can't just empty a slot, the ones after it might be lost. Rare enough to rebuild
+    RebuildRoomTable(worker, worker->tableCapacity);
+    free(room);
+
+    atomic_store_explicit(&worker->statRooms, worker->roomCount, memory_order_relaxed);
+}
+
+static void CloseConnection(Worker* worker, Connection* connection)
+{
+    Room* room = connection->room;
+
+    epoll_ctl(worker->epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+
+    if (room != NULL)
+    {
+        for (int i = 0; i < room->memberCount; i++)
+        {
+            if (room->members[i] == connection)
+            {
+                // Keep the order: when the player goes, the longest watching takes over
+                memmove(&room->members[i], &room->members[i + 1], (size_t)(room->memberCount - i - 1) * sizeof(Connection*));
+                room->memberCount--;
+                break;
+            }
+        }
+
+        if (room->memberCount == 0)
+        {
+            CloseRoom(worker, room);
+        }
+    }
+
+    free(connection);
+    atomic_fetch_sub_explicit(&worker->statConnections, 1, memory_order_relaxed);
+}
+
+static void SendWelcome(Connection* connection, Room* room, bool playing)
+{
+    unsigned char message[16];
+    unsigned char* cursor = message + 2;
+
+    Put8(&cursor, GAME_WELCOME);
+    Put32(&cursor, room->id);
+    Put8(&cursor, playing);
+    Put16(&cursor, ROOM_TICK_RATE);
+    Put16(&cursor, ROOM_STATE_INTERVAL);
+
+    Queue(connection, message, FinishMessage(message, cursor));
+}
+
+static bool HandleClientMessage(void* context, const unsigned char* message, int length)
+{
+    Connection* connection = context;
+    Room* room = connection->room;
+
+    if (message[0] != GAME_INPUT || length != GAME_INPUT_SIZE)
+    {
+        return false;
+    }
+
+    // Watchers can send all they like, only the player's count
+    if (room->members[0] == connection)
+    {
+        room->inputSequence = Take32(message + 1);
+        room->buttons = message[5];
+    }
+
+    return true;
+}
+
+// A connection the acceptor passed over, with its join request still in the buffer
+static void JoinRoom(Worker* worker, Connection* connection)
+{
+    const unsigned char* join = connection->in + 2;
+    uint32_t id = Take32(join + 1);
+    uint64_t seed = Take32(join + 5) | (uint64_t)Take32(join + 9) << 32;
+    int length = (int)Take16(connection->in);
+
+    connection->inSize -= 2 + length;
+    memmove(connection->in, connection->in + 2 + length, (size_t)connection->inSize);
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = connection };
+    Room* room = OpenRoom(worker, id, seed);
+
+    if (room == NULL || room->memberCount == ROOM_MAX_MEMBERS || epoll_ctl(worker->epoll, EPOLL_CTL_ADD, connection->fd, &event) != 0)
+    {
+        close(connection->fd);
+        free(connection);
+
+        if (room != NULL && room->memberCount == 0)
+        {
+            CloseRoom(worker, room);
+        }
+
+        return;
+    }
+
+    connection->room = room;
+    room->members[room->memberCount++] = connection;
+    atomic_fetch_add_explicit(&worker->statConnections, 1, memory_order_relaxed);
+
+    SendWelcome(connection, room, room->memberCount == 1);
+
+    // Whatever came in behind the join
+    if (!SplitMessages(connection->in, &connection->inSize, CONNECTION_IN_BUFFER, HandleClientMessage, connection))
+    {
+        connection->broken = true;
+    }
+
+    // Late: what the others have, the deltas follow with the next state
+    if (room->haveKnown)
+    {
+        unsigned char snapshot[SPECTATOR_MAX_MESSAGE];
+        Queue(connection, snapshot, EncodeSpectatorSnapshot(&room->known, snapshot, sizeof(snapshot)));
+    }
+
+    Flush(worker, connection);
+}
+
+static void ReadConnection(Connection* connection)
+{
+    while (!connection->broken)
+    {
+        ssize_t received = recv(connection->fd, connection->in + connection->inSize, (size_t)(CONNECTION_IN_BUFFER - connection->inSize), 0);
+
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+
+        if (received <= 0)
+        {
+            connection->broken = true;
+            break;
+        }
+
+        connection->inSize += (int)received;
+
+        if (!SplitMessages(connection->in, &connection->inSize, CONNECTION_IN_BUFFER, HandleClientMessage, connection))
+        {
+            connection->broken = true;
+        }
+    }
+}
+
+// What the player holds, as one tick of SimInput
+static SimInput BuildRoomInput(uint8_t buttons)
+{
+    SimInput input = {0};
+
+    input.left = buttons & GAME_BUTTON_LEFT;
+    input.right = buttons & GAME_BUTTON_RIGHT;
+    input.dash = buttons & GAME_BUTTON_DASH;
+    input.moving = input.left != input.right;
+    input.dashing = input.moving && input.dash;
+    input.moveSeconds = input.moving ? (input.right ? SIM_DT : -SIM_DT) * (input.dashing ? PLAYER_SPEED_BOOST : 1.0f) : 0.0f;
+    input.launch = buttons & GAME_BUTTON_LAUNCH;
+    input.launchSteer = input.right - input.left;
+
+    return input;
+}
+
+static void TickRoom(Worker* worker, Room* room)
+{
+    Game* game = &room->game;
+    SimInput input = BuildRoomInput(room->buttons);
+
+    // No level complete or game over screens to click through on a server
+    if (game->state == LEVEL_COMPLETE)
+    {
+        LoadNextLevel(game);
+    }
+    else if ((game->state == GAME_OVER || game->state == WIN) && (room->buttons & GAME_BUTTON_RESTART))
+    {
+        ResetGame(game);
+    }
+
+    for (int step = 0; step < ROOM_SIM_STEPS && game->state == PLAYING; step++)
+    {
+        StepSimulation(game, &input, SIM_DT);
+    }
+
+    room->tick++;
+
+    if (room->tick % ROOM_STATE_INTERVAL != 0)
+    {
+        return;
+    }
+
+    unsigned char message[SPECTATOR_MAX_MESSAGE];
+
+    if (room->ackedSequence != room->inputSequence)
+    {
+        unsigned char* cursor = message + 2;
+
+        Put8(&cursor, GAME_INPUT_ACK);
+        Put32(&cursor, room->inputSequence);
+        Put32(&cursor, room->tick);
+
+        Queue(room->members[0], message, FinishMessage(message, cursor));
+        room->ackedSequence = room->inputSequence;
+    }
+
+    CaptureSpectatorState(game, room->tick * 1000u / ROOM_TICK_RATE, &worker->next);
+    int size = EncodeSpectatorFrame(&room->known, &room->haveKnown, &worker->next, message, sizeof(message));
+
+    for (int i = 0; i < room->memberCount; i++)
+    {
+        Queue(room->members[i], message, size);
+    }
+}
+
+static void TakeHandoffs(Worker* worker)
+{
+    uint64_t count;
+    (void)!read(worker->wake, &count, sizeof(count));
+
+    pthread_mutex_lock(&worker->mutex);
+    Connection* list = worker->handoff;
+    worker->handoff = NULL;
+    worker->handoffTail = NULL;
+    pthread_mutex_unlock(&worker->mutex);
+
+    while (list != NULL)
+    {
+        Connection* next = list->next;
+        JoinRoom(worker, list);
+        list = next;
+    }
+}
+
+// Anything that broke during reads or the tick, and whatever's waiting to go out
+static void FlushRooms(Worker* worker)
+{
+    for (int i = worker->roomCount - 1; i >= 0; i--)
+    {
+        Room* room = worker->rooms[i];
+
+        // Backwards: closing the last member closes the room, which only moves rooms from the end
+        for (int j = room->memberCount - 1; j >= 0; j--)
+        {
+            Connection* connection = room->members[j];
+
+            if (!connection->broken && connection->outSize > 0 && !connection->writing)
+            {
+                Flush(worker, connection);
+            }
+
+            if (connection->broken)
+            {
+                CloseConnection(worker, connection);
+            }
+        }
+    }
+}
+
+static void* WorkerMain(void* argument)
+{
+    Worker* worker = argument;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    const double period = 1.0 / ROOM_TICK_RATE;
+    double nextTick = GetPreciseTime() + period;
+
+    // Best effort: a worker that stays on one core keeps its rooms in that core's cache
+    PinThreadToCore(worker->index % GetCoreCount());
+
+    while (!atomic_load(&server.quit))
+    {
+        double now = GetPreciseTime();
+        int timeout = nextTick > now ? (int)ceil((nextTick - now) * 1000.0) : 0;
+        int count = epoll_wait(worker->epoll, events, SERVER_MAX_EVENTS, timeout);
+        double start = GetPreciseTime();
+
+        for (int i = 0; i < count; i++)
+        {
+            Connection* connection = events[i].data.ptr;
+
+            if (connection == NULL)
+            {
+                TakeHandoffs(worker);
+                continue;
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                connection->broken = true;
+            }
+
+            if (events[i].events & EPOLLIN)
+            {
+                ReadConnection(connection);
+            }
+
+            if ((events[i].events & EPOLLOUT) && !connection->broken)
+            {
+                Flush(worker, connection);
+            }
+        }
+
+        // Same fixed tick for every room on this worker. After a long hitch drop the time, like the game does
+        int ticks = 0;
+
+        while (start >= nextTick)
+        {
+            if (ticks == ROOM_MAX_CATCH_UP)
+            {
+                atomic_fetch_add_explicit(&worker->statLateTicks, 1, memory_order_relaxed);
+                nextTick = start + period;
+                break;
+            }
+
+            for (int i = 0; i < worker->roomCount; i++)
+            {
+                TickRoom(worker, worker->rooms[i]);
+            }
+
+            atomic_fetch_add_explicit(&worker->statTicks, worker->roomCount, memory_order_relaxed);
+            nextTick += period;
+            ticks++;
+        }
+
+        FlushRooms(worker);
+
+        double end = GetPreciseTime();
+        atomic_fetch_add_explicit(&worker->statBusyNs, (long long)((end - start) * 1e9), memory_order_relaxed);
+    }
+
+    // Shutting down: every room and connection goes with the worker
+    while (worker->roomCount > 0)
+    {
+        Room* room = worker->rooms[worker->roomCount - 1];
+
+        for (int j = room->memberCount - 1; j >= 0; j--)
+        {
+            CloseConnection(worker, room->members[j]);
+        }
+    }
+
+    return NULL;
+}
+
+static bool StartWorker(Worker* worker, int index)
+{
+    worker->index = index;
+    worker->epoll = epoll_create1(0);
+    worker->wake = eventfd(0, EFD_NONBLOCK);
+    worker->roomCapacity = 64;
+    worker->rooms = malloc((size_t)worker->roomCapacity * sizeof(Room*));
+    worker->tableCapacity = 128;
+    worker->table = calloc((size_t)worker->tableCapacity, sizeof(Room*));
+    pthread_mutex_init(&worker->mutex, NULL);
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+
+    if (worker->epoll < 0 || worker->wake < 0 || worker->rooms == NULL || worker->table == NULL ||
+        epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->wake, &event) != 0 ||
+        pthread_create(&worker->thread, NULL, WorkerMain, worker) != 0)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static void HandOff(Connection* connection, uint32_t room)
+{
+    Worker* worker = &server.workers[room % (uint32_t)server.workerCount];
+
+    pthread_mutex_lock(&worker->mutex);
+    connection->next = NULL;
+
+    if (worker->handoffTail != NULL)
+    {
+        worker->handoffTail->next = connection;
+    }
+    else
+    {
+        worker->handoff = connection;
+    }
+
+    worker->handoffTail = connection;
+    pthread_mutex_unlock(&worker->mutex);
+
+    uint64_t one = 1;
+    (void)!write(worker->wake, &one, sizeof(one));
+}
+
+static void PrintServerStats(double seconds, long long* lastTicks, long long* lastBusyNs, long long* lastBytes)
+{
+    int rooms = 0;
+    int connections = 0;
+    long long ticks = 0;
+    long long late = 0;
+    long long bytes = 0;
+
+    printf("[%s] ", seconds > 0.0 ? "stats" : "final");
+
+    for (int i = 0; i < server.workerCount; i++)
+    {
+        Worker* worker = &server.workers[i];
+        long long workerBusy = atomic_load(&worker->statBusyNs);
+
+        rooms += atomic_load(&worker->statRooms);
+        connections += atomic_load(&worker->statConnections);
+        ticks += atomic_load(&worker->statTicks);
+        late += atomic_load(&worker->statLateTicks);
+        bytes += atomic_load(&worker->statBytesOut);
+
+        if (seconds > 0.0)
+        {
+            printf("%s%.0f%%", i == 0 ? "workers busy " : " ", (workerBusy - lastBusyNs[i]) / 1e9 / seconds * 100.0);
+            lastBusyNs[i] = workerBusy;
+        }
+    }
+
+    if (seconds > 0.0)
+    {
+        printf(", %d rooms, %d connections, %.0f room ticks/s, %.1f KB/s out, %lld late\n", rooms, connections,
+               (ticks - *lastTicks) / seconds, (bytes - *lastBytes) / 1024.0 / seconds, late);
+    }
+    else
+    {
+        printf("%lld room ticks, %.1f MB out, %lld late\n", ticks, bytes / 1048576.0, late);
+    }
+
+    *lastTicks = ticks;
+    *lastBytes = bytes;
+    fflush(stdout);
+}
+
+static int Serve(int port, int workerCount)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4096) != 0)
+    {
+        printf("Can't listen on port %d: %s\n", port, strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, OnStopSignal);
+    signal(SIGTERM, OnStopSignal);
+    signal(SIGPIPE, SIG_IGN);
+    RaiseFileLimit();
+
+    // Endless levels are generated by whichever worker needs one, right there. Microseconds
+    LoadLevelPack(LEVEL_PACK_FILE);
+
+    server.workers = calloc((size_t)workerCount, sizeof(Worker));
+
+    for (int i = 0; server.workers != NULL && i < workerCount; i++)
+    {
+        if (!StartWorker(&server.workers[i], i))
+        {
+            printf("Can't start worker %d\n", i);
+            break;
+        }
+
+        server.workerCount++;
+    }
+
+    if (server.workerCount == 0)
+    {
+        close(listener);
+        UnloadLevelPack();
+        return 1;
+    }
+
+    printf("Serving rooms on port %d with %d workers, %d ticks a second\n", port, server.workerCount, ROOM_TICK_RATE);
+    fflush(stdout);
+
+    /* This thread only accepts, and waits for each new connection to say which room it wants.
+     * Then the connection belongs to that room's worker */
+    int epoll = epoll_create1(0);
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    double lastPrint = GetPreciseTime();
+    long long lastTicks = 0;
+    long long lastBytes = 0;
+    long long* lastBusyNs = calloc((size_t)server.workerCount, sizeof(long long));
+
+    while (!stopRequested)
+    {
+        int count = epoll_wait(epoll, events, SERVER_MAX_EVENTS, 1000);
+
+        for (int i = 0; i < count; i++)
+        {
+            Connection* connection = events[i].data.ptr;
+
+            if (connection == NULL)
+            {
+                int fd;
+
+                while ((fd = accept(listener, NULL, NULL)) >= 0)
+                {
+                    connection = calloc(1, sizeof(Connection));
+
+                    if (connection == NULL)
+                    {
+                        close(fd);
+                        continue;
+                    }
+
+                    SetNonBlocking(fd);
+                    connection->fd = fd;
+
+                    struct epoll_event watch = { .events = EPOLLIN, .data.ptr = connection };
+                    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &watch);
+                }
+
+                continue;
+            }
+
+            ssize_t received = recv(connection->fd, connection->in + connection->inSize,
+                                    (size_t)(CONNECTION_IN_BUFFER - connection->inSize), 0);
+            bool closed = received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+
+            connection->inSize += received > 0 ? (int)received : 0;
+
+            // The first thing has to be a join, nothing else gets this far
+            bool whole = connection->inSize >= 2 + GAME_JOIN_SIZE;
+
+            if (connection->inSize >= 2 && Take16(connection->in) != GAME_JOIN_SIZE)
+            {
+                closed = true;
+            }
+            else if (whole && connection->in[2] != GAME_JOIN)
+            {
+                closed = true;
+            }
+
+            if (closed)
+            {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+                close(connection->fd);
+                free(connection);
+            }
+            else if (whole)
+            {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+                HandOff(connection, Take32(connection->in + 3));
+            }
+        }
+
+        double now = GetPreciseTime();
+
+        if (now - lastPrint >= SERVER_STATS_SECONDS)
+        {
+            PrintServerStats(now - lastPrint, &lastTicks, lastBusyNs, &lastBytes);
+            lastPrint = now;
+        }
+    }
+
+    // Connections still waiting to join are leaked to the exit, nothing else holds them
+    close(listener);
+    close(epoll);
+
+    atomic_store(&server.quit, true);
+
+    for (int i = 0; i < server.workerCount; i++)
+    {
+        pthread_join(server.workers[i].thread, NULL);
+        close(server.workers[i].epoll);
+        close(server.workers[i].wake);
+        free(server.workers[i].rooms);
+        free(server.workers[i].table);
+        pthread_mutex_destroy(&server.workers[i].mutex);
+    }
+
+    PrintServerStats(0.0, &lastTicks, lastBusyNs, &lastBytes);
+
+    free(lastBusyNs);
+    free(server.workers);
+    UnloadLevelPack();
+
+    return 0;
+}
+
+// Load generator side
+
+typedef struct LoadClient
+{
+    int fd;
+    uint32_t room;
+    bool playing;           // From the welcome, watchers never send input
+    bool welcomed;
+
+    SpectatorState state;
+    bool haveSnapshot;
+    uint8_t buttons;
+    uint32_t sequence;
+    double sentAt[64];      // By sequence, for the round trip
+
+    unsigned char in[SPECTATOR_MAX_MESSAGE * 2];
+    int inSize;
+} LoadClient;
+
+typedef struct LoadThread
+{
+    pthread_t thread;
+    LoadClient* clients;
+    int clientCount;
+    double endTime;
+
+    long long states;
+    long long snapshots;
+    long long bytesIn;
+    long long inputs;
+    int failures;           // Hung up on, or sent us something we couldn't read
+    float* latencies;       // Input to acknowledgement, milliseconds
+    int latencyCount;
+} LoadThread;
+
+static bool SendAll(int fd, const unsigned char* data, int size)
+{
+    while (size > 0)
+    {
+        ssize_t sent = send(fd, data, (size_t)size, MSG_NOSIGNAL);
+
+        if (sent < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            continue;
+        }
+
+        if (sent <= 0)
+        {
+            return false;
+        }
+
+        data += sent;
+        size -= (int)sent;
+    }
+
+    return true;
+}
+
+// What a person would press, seen from the state the server sent: get under the ball, serve, start over
+static uint8_t PlayLoadBot(const SpectatorState* state, uint32_t room)
+{
+    if (state->state == GAME_OVER || state->state == WIN)
+    {
+        return GAME_BUTTON_RESTART;
+    }
+
+    if (!(state->flags & SPECTATOR_BALL_ACTIVE))
+    {
+        return GAME_BUTTON_LAUNCH | ((room & 1) ? GAME_BUTTON_RIGHT : GAME_BUTTON_LEFT);
+    }
+
+    int paddle = state->paddleX + state->paddleWidth / 2;
+    int dx = state->ballX - paddle;
+    int deadZone = state->paddleWidth / 4;
+
+    return dx < -deadZone ? GAME_BUTTON_LEFT : (dx > deadZone ? GAME_BUTTON_RIGHT : 0);
+}
+
+typedef struct LoadMessageContext
+{
+    LoadThread* thread;
+    LoadClient* client;
+} LoadMessageContext;
+
+static bool HandleServerMessage(void* context, const unsigned char* message, int length)
+{
+    LoadThread* thread = ((LoadMessageContext*)context)->thread;
+    LoadClient* client = ((LoadMessageContext*)context)->client;
+
+    if (message[0] == GAME_WELCOME && length == 10)
+    {
+        client->welcomed = true;
+        client->playing = message[5] != 0;
+        return true;
+    }
+
+    if (message[0] == GAME_INPUT_ACK && length == 9)
+    {
+        uint32_t sequence = Take32(message + 1);
+
+        if (thread->latencyCount < LOAD_LATENCY_WINDOW && sequence + 64 > client->sequence)
+        {
+            thread->latencies[thread->latencyCount++] = (float)((GetPreciseTime() - client->sentAt[sequence % 64]) * 1000.0);
+        }
+
+        return true;
+    }
+
+    if (!ApplySpectatorMessage(&client->state, &client->haveSnapshot, message, length))
+    {
+        return false;
+    }
+
+    thread->states++;
+    thread->snapshots += message[0] == SPECTATOR_SNAPSHOT;
+
+    if (!client->playing)
+    {
+        return true;
+    }
+
+    uint8_t buttons = PlayLoadBot(&client->state, client->room);
+
+    // Only changes go out, the server keeps applying the last one
+    if (buttons != client->buttons)
+    {
+        unsigned char input[16];
+        unsigned char* cursor = input + 2;
+
+        client->buttons = buttons;
+        client->sequence++;
+        client->sentAt[client->sequence % 64] = GetPreciseTime();
+
+        Put8(&cursor, GAME_INPUT);
+        Put32(&cursor, client->sequence);
+        Put8(&cursor, buttons);
+
+        thread->inputs++;
+        return SendAll(client->fd, input, FinishMessage(input, cursor));
+    }
+
+    return true;
+}
+
+static void* LoadThreadMain(void* argument)
+{
+    LoadThread* thread = argument;
+    int epoll = epoll_create1(0);
+    struct epoll_event events[SERVER_MAX_EVENTS];
+
+    for (int i = 0; i < thread->clientCount; i++)
+    {
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = &thread->clients[i] };
+        epoll_ctl(epoll, EPOLL_CTL_ADD, thread->clients[i].fd, &event);
+    }
+
+    while (GetPreciseTime() < thread->endTime)
+    {
+        int count = epoll_wait(epoll, events, SERVER_MAX_EVENTS, 100);
+
+        for (int i = 0; i < count; i++)
+        {
+            LoadClient* client = events[i].data.ptr;
+            LoadMessageContext context = { thread, client };
+            bool failed = false;
+
+            while (true)
+            {
+                ssize_t received = recv(client->fd, client->in + client->inSize, sizeof(client->in) - (size_t)client->inSize, 0);
+
+                if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    break;
+                }
+
+                if (received <= 0)
+                {
+                    failed = errno != EINTR || received == 0;
+
+                    if (failed)
+                    {
+                        break;
+                    }
+
+                    continue;
+                }
+
+                thread->bytesIn += received;
+                client->inSize += (int)received;
+
+                if (!SplitMessages(client->in, &client->inSize, (int)sizeof(client->in), HandleServerMessage, &context))
+                {
+                    failed = true;
+                    break;
+                }
+            }
+
+            if (failed)
+            {
+                thread->failures++;
+                epoll_ctl(epoll, EPOLL_CTL_DEL, client->fd, NULL);
+            }
+        }
+    }
+
+    close(epoll);
+    return NULL;
+}
+
+static int ConnectLoadClient(const char* host, int port, uint32_t room)
+{
+    TcpSocket socket = ConnectTcp(host, port);
+
+    if (socket == TCP_INVALID_SOCKET)
+    {
+        return -1;
+    }
+
+    int fd = (int)socket;
+    unsigned char join[16];
+    unsigned char* cursor = join + 2;
+    uint64_t seed = room + 1;
+
+    Put8(&cursor, GAME_JOIN);
+    Put32(&cursor, room);
+    Put32(&cursor, (uint32_t)seed);
+    Put32(&cursor, (uint32_t)(seed >> 32));
+
+    if (!SendAll(fd, join, FinishMessage(join, cursor)))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int CompareFloats(const void* a, const void* b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static int RunLoad(const char* host, int port, int rooms, int watchers, double seconds, int threadCount)
+{
+    int total = rooms * (1 + watchers);
+    LoadClient* clients = calloc((size_t)total, sizeof(LoadClient));
+    LoadThread* threads = calloc((size_t)threadCount, sizeof(LoadThread));
+
+    signal(SIGPIPE, SIG_IGN);
+    RaiseFileLimit();
+
+    if (clients == NULL || threads == NULL)
+    {
+        printf("Out of memory for %d clients\n", total);
+        return 1;
+    }
+
+    // Players first, so every room is opened by the one that plays in it
+    double connectStart = GetPreciseTime();
+
+    for (int i = 0; i < total; i++)
+    {
+        clients[i].room = (uint32_t)(i % rooms);
+        clients[i].fd = ConnectLoadClient(host, port, clients[i].room);
+
+        if (clients[i].fd < 0)
+        {
+            printf("Only got %d of %d connections\n", i, total);
+            total = i;
+            break;
+        }
+    }
+
+    printf("%d connections (%d rooms) in %.2f s, running for %.0f s\n", total, rooms, GetPreciseTime() - connectStart, seconds);
+    fflush(stdout);
+
+    double endTime = GetPreciseTime() + seconds;
+    int perThread = (total + threadCount - 1) / threadCount;
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        LoadThread* thread = &threads[i];
+        int first = i * perThread;
+
+        thread->clients = clients + first;
+        thread->clientCount = first < total ? (total - first < perThread ? total - first : perThread) : 0;
+        thread->endTime = endTime;
+        thread->latencies = malloc(LOAD_LATENCY_WINDOW * sizeof(float));
+
+        pthread_create(&thread->thread, NULL, LoadThreadMain, thread);
+    }
+
+    long long states = 0, snapshots = 0, bytesIn = 0, inputs = 0;
+    int failures = 0, latencyCount = 0;
+    float* latencies = malloc((size_t)threadCount * LOAD_LATENCY_WINDOW * sizeof(float));
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        LoadThread* thread = &threads[i];
+        pthread_join(thread->thread, NULL);
+
+        states += thread->states;
+        snapshots += thread->snapshots;
+        bytesIn += thread->bytesIn;
+        inputs += thread->inputs;
+        failures += thread->failures;
+        memcpy(latencies + latencyCount, thread->latencies, (size_t)thread->latencyCount * sizeof(float));
+        latencyCount += thread->latencyCount;
+        free(thread->latencies);
+    }
+
+    int welcomed = 0;
+    long long scores = 0;
+
+    for (int i = 0; i < total; i++)
+    {
+        welcomed += clients[i].welcomed;
+        scores += clients[i].playing ? clients[i].state.score : 0;
+        close(clients[i].fd);
+    }
+
+    qsort(latencies, (size_t)latencyCount, sizeof(float), CompareFloats);
+
+    double expected = (double)total * ROOM_TICK_RATE / ROOM_STATE_INTERVAL * seconds;
+
+    printf("%d of %d welcomed, %d failed\n", welcomed, total, failures);
+    printf("%lld states (%.1f%% of %.0f expected, %lld snapshots), %.1f KB/s in, %.1f B/s per connection\n",
+           states, expected > 0.0 ? states * 100.0 / expected : 0.0, expected, snapshots, bytesIn / 1024.0 / seconds,
+           total > 0 ? bytesIn / seconds / total : 0.0);
+    printf("%lld inputs, acknowledged in p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", inputs,
+           latencyCount > 0 ? latencies[latencyCount / 2] : 0.0f, latencyCount > 0 ? latencies[latencyCount * 99 / 100] : 0.0f,
+           latencyCount > 0 ? latencies[latencyCount - 1] : 0.0f);
+    printf("Average score %.0f\n", rooms > 0 ? (double)scores / rooms : 0.0);
+
+    free(latencies);
+    free(threads);
+    free(clients);
+
+    return failures == 0 && welcomed == total ? 0 : 1;
+}
+
+static void PrintUsage(const char* program)
+{
+    printf("Usage: %s serve [--port n] [--threads n]\n", program);
+    printf("       %s load [--host h] [--port n] [--rooms n] [--watchers n] [--seconds s] [--threads n]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    const char* host = "127.0.0.1";
+    int port = SERVER_DEFAULT_PORT;
+    int threads = GetCoreCount();
+    int rooms = 1000;
+    int watchers = 0;
+    double seconds = 10.0;
+
+    for (int i = 2; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--host") == 0 && hasValue)
+        {
+            host = argv[++i];
+        }
+        else if (strcmp(argv[i], "--port") == 0 && hasValue)
+        {
+            port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--rooms") == 0 && hasValue)
+        {
+            rooms = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--watchers") == 0 && hasValue)
+        {
+            watchers = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+        {
+            seconds = atof(argv[++i]);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    threads = threads > 0 ? threads : 1;
+    watchers = watchers < 0 ? 0 : (watchers > ROOM_MAX_MEMBERS - 1 ? ROOM_MAX_MEMBERS - 1 : watchers);
+
+    if (strcmp(argv[1], "serve") == 0)
+    {
+        return Serve(port, threads);
+    }
+
+    if (strcmp(argv[1], "load") == 0 && rooms > 0)
+    {
+        return RunLoad(host, port, rooms, watchers, seconds, threads);
+    }
+
+    PrintUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,295 @@
+﻿#include "History.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "Timing.h"
+
+#define SNAPSHOT_WORDS (sizeof(GameSnapshot) / sizeof(uint32_t))
+
+_Static_assert(sizeof(GameSnapshot) % sizeof(uint32_t) == 0, "Deltas work on whole words");
+_Static_assert(SNAPSHOT_WORDS <= UINT16_MAX, "Delta runs address words with 16 bits");
+_Static_assert(HISTORY_BUDGET >= sizeof(GameSnapshot) * 4, "The history needs room for a few keyframes at least");
+
+/* A delta is a list of runs: which words of the snapshot changed, followed by their new values.
+ * Unchanged words between two changes are cheaper to copy than to start a new run for,
+ * so a run only ends after RUN_GAP unchanged words. */
+#define RUN_GAP 1
+
+typedef struct DeltaRun
+{
+    uint16_t word;
+    uint16_t count;
+} DeltaRun;
+
+typedef struct HistoryEntry
+{
+    uint32_t offset;
+    uint32_t size;
+    bool keyframe;
+} HistoryEntry;
+
+static struct
+{
+    unsigned char bytes[HISTORY_BUDGET];
+    HistoryEntry entries[HISTORY_MAX_TICKS];
+    int first;              // Oldest entry, always a keyframe
+    int count;
+    uint32_t writeOffset;   // Just past the newest entry
+    size_t bytesUsed;
+    int keyframes;
+    int sinceKeyframe;
+
+    // The newest tick, deltas are taken against it. Two of them, so moving on is just a swap
+    GameSnapshot states[2];
+    int newest;
+
+    double totalRecordTime;
+    long long records;
+    double worstRecordTime;
+    double lastRebuildTime;
+    float meanDeltaBytes;
+} history;
+
+static HistoryEntry* GetEntry(int index)
+{
+    return &history.entries[(history.first + index) % HISTORY_MAX_TICKS];
+}
+
+static void DropOldest(void)
+{
+    HistoryEntry* entry = GetEntry(0);
+
+    history.bytesUsed -= entry->size;
+    history.keyframes -= entry->keyframe ? 1 : 0;
+    history.first = (history.first + 1) % HISTORY_MAX_TICKS;
+    history.count--;
+}
+
+/* Entries sit in the ring in the order they were written, so whatever is in the way
+ * of the next write is always the oldest few. */
+static void FreeRange(uint32_t offset, uint32_t size)
+{
+    while (history.count > 0)
+    {
+        HistoryEntry* oldest = GetEntry(0);
+
+        if (oldest->offset >= offset + size || offset >= oldest->offset + oldest->size)
+        {
+            break;
+        }
+
+        DropOldest();
+    }
+}
+
+// A delta is useless without the keyframe it builds on
+static void DropOrphanedDeltas(void)
+{
+    while (history.count > 0 && !GetEntry(0)->keyframe)
+    {
+        DropOldest();
+    }
+}
+
+// False if it would take more than limit bytes, then a keyframe is smaller anyway
+static bool EncodeDelta(const uint32_t* from, const uint32_t* to, unsigned char* out, uint32_t limit, uint32_t* size)
+{
+    uint32_t written = 0;
+    uint32_t word = 0;
+
+    while (word < SNAPSHOT_WORDS)
+    {
+        if (from[word] == to[word])
+        {
+            word++;
+            continue;
+        }
+
+        uint32_t start = word;
+        uint32_t lastChanged = word;
+
+        for (word = start + 1; word < SNAPSHOT_WORDS && word - lastChanged <= RUN_GAP; word++)
+        {
+            if (from[word] != to[word])
+            {
+                lastChanged = word;
+            }
+        }
+
+        DeltaRun run = { .word = (uint16_t)start, .count = (uint16_t)(lastChanged - start + 1) };
+        uint32_t runBytes = run.count * sizeof(uint32_t);
+
+        if (written + sizeof(DeltaRun) + runBytes > limit)
+        {
+            return false;
+        }
+
+        memcpy(out + written, &run, sizeof(DeltaRun));
+        memcpy(out + written + sizeof(DeltaRun), &to[start], runBytes);
+        written += sizeof(DeltaRun) + runBytes;
+
+        word = lastChanged + 1;
+    }
+
+    *size = written;
+    return true;
+}
+
+static void ApplyDelta(uint32_t* words, const unsigned char* delta, uint32_t size)
+{
+    uint32_t read = 0;
+
+    while (read < size)
+    {
+        DeltaRun run;
+        memcpy(&run, delta + read, sizeof(DeltaRun));
+        memcpy(&words[run.word], delta + read + sizeof(DeltaRun), run.count * sizeof(uint32_t));
+        read += sizeof(DeltaRun) + run.count * sizeof(uint32_t);
+    }
+}
+
+void ClearHistory(void)
+{
+    history.first = 0;
+    history.count = 0;
+    history.writeOffset = 0;
+    history.bytesUsed = 0;
+    history.keyframes = 0;
+    history.sinceKeyframe = 0;
+}
+
+void RecordHistory(const Game* game)
+{
+    double start = GetPreciseTime();
+
+    GameSnapshot* previous = &history.states[history.newest];
+    GameSnapshot* current = &history.states[history.newest ^ 1];
+    CaptureSnapshot(game, current);
+
+    // Reserve room for the worst case, a keyframe. Wrap instead of splitting an entry over the end
+    const uint32_t reserve = sizeof(GameSnapshot);
+    uint32_t offset = history.writeOffset;
+
+    if (offset + reserve > HISTORY_BUDGET)
+    {
+        FreeRange(offset, HISTORY_BUDGET - offset);
+        offset = 0;
+    }
+
+    FreeRange(offset, reserve);
+
+    if (history.count == HISTORY_MAX_TICKS)
+    {
+        DropOldest();
+    }
+
+    DropOrphanedDeltas();
+
+    HistoryEntry entry = { .offset = offset };
+    entry.keyframe = history.count == 0 || history.sinceKeyframe >= HISTORY_KEYFRAME_INTERVAL - 1;
+
+    if (!entry.keyframe &&
+        !EncodeDelta((const uint32_t*)previous, (const uint32_t*)current, &history.bytes[offset], reserve, &entry.size))
+    {
+        entry.keyframe = true;
+    }
+
+    if (entry.keyframe)
+    {
+        memcpy(&history.bytes[offset], current, sizeof(GameSnapshot));
+        entry.size = sizeof(GameSnapshot);
+        history.keyframes++;
+        history.sinceKeyframe = 0;
+    }
+    else
+    {
+        history.meanDeltaBytes += (entry.size - history.meanDeltaBytes) * 0.05f;
+        history.sinceKeyframe++;
+    }
+
+    *GetEntry(history.count) = entry;
+    history.count++;
+    history.bytesUsed += entry.size;
+    history.writeOffset = offset + entry.size;
+    history.newest ^= 1;
+
+    double elapsed = GetPreciseTime() - start;
+    history.totalRecordTime += elapsed;
+    history.records++;
+
+    if (elapsed > history.worstRecordTime)
+    {
+        history.worstRecordTime = elapsed;
+    }
+}
+
+int GetHistoryLength(void)
+{
+    return history.count;
+}
+
+bool ReconstructHistory(int ticksAgo, GameSnapshot* snapshot)
+{
+    if (ticksAgo < 0 || ticksAgo >= history.count)
+    {
+        return false;
+    }
+
+    double start = GetPreciseTime();
+    int index = history.count - 1 - ticksAgo;
+    int keyframe = index;
+
+    // Never runs off the front, the oldest entry is always a keyframe
+    while (!GetEntry(keyframe)->keyframe)
+    {
+        keyframe--;
+    }
+
+    memcpy(snapshot, &history.bytes[GetEntry(keyframe)->offset], sizeof(GameSnapshot));
+
+    for (int i = keyframe + 1; i <= index; i++)
+    {
+        const HistoryEntry* entry = GetEntry(i);
+        ApplyDelta((uint32_t*)snapshot, &history.bytes[entry->offset], entry->size);
+    }
+
+    history.lastRebuildTime = GetPreciseTime() - start;
+
+    return true;
+}
+
+HistoryStats GetHistoryStats(void)
+{
+    HistoryStats stats =
+    {
+        .bytesUsed = history.bytesUsed,
+        .budget = HISTORY_BUDGET,
+        .ticks = history.count,
+        .keyframes = history.keyframes,
+        .seconds = (float)history.count / SIM_TICK_RATE,
+        .meanDeltaBytes = history.meanDeltaBytes,
+        .meanRecordUs = history.records > 0 ? history.totalRecordTime * 1000000.0 / history.records : 0.0,
+        .worstRecordUs = history.worstRecordTime * 1000000.0,
+        .lastRebuildUs = history.lastRebuildTime * 1000000.0
+    };
+
+    return stats;
+}
+
+void DrawHistoryStats(int x, int y)
+{
+    const int fontSize = 20;
+    HistoryStats stats = GetHistoryStats();
+
+    DrawRectangle(x - 10, y - 10, 560, 3 * (fontSize + 6) + 14, ColorAlpha(BLACK, 0.7f));
+
+    DrawText(TextFormat("History %zu / %zu KB  (%.1f s, %d keyframes)",
+                        stats.bytesUsed / 1024, stats.budget / 1024, stats.seconds, stats.keyframes),
+             x, y, fontSize, WHITE);
+
+    DrawText(TextFormat("Record %.2f us/tick (worst %.2f)  delta %.0f B",
+                        stats.meanRecordUs, stats.worstRecordUs, stats.meanDeltaBytes),
+             x, y + (fontSize + 6), fontSize, stats.meanRecordUs < 5.0 ? GREEN : YELLOW);
+
+    DrawText(TextFormat("Rebuild %.2f us", stats.lastRebuildUs), x, y + (fontSize + 6) * 2, fontSize, GRAY);
+}
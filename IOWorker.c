@@ -0,0 +1,301 @@
+﻿#include "IOWorker.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Leaderboard.h"
+#include "Snapshot.h"
+#include "Replay.h"
+
+// Simple ring buffer, guarded by the worker's mutex
+typedef struct IOQueue
+{
+    IORequest requests[IO_QUEUE_CAPACITY];
+    int head;
+    int count;
+} IOQueue;
+
+/* There's only ever one I/O thread, so its state lives here instead of in Game.
+ * (Game gets copied around by value, which would break any pointers the thread holds!) */
+static struct
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t drained; // The game thread emptied the completion queue
+    bool running;
+    bool quit;
+
+    IOQueue pending;    // Game → worker
+    IOQueue completed;  // Worker → game
+} worker;
+
+static bool PushRequest(IOQueue* queue, IORequest request)
+{
+    if (queue->count >= IO_QUEUE_CAPACITY)
+    {
+        return false;
+    }
+
+    queue->requests[(queue->head + queue->count) % IO_QUEUE_CAPACITY] = request;
+    queue->count++;
+
+    return true;
+}
+
+static IORequest PopRequest(IOQueue* queue)
+{
+    IORequest request = queue->requests[queue->head];
+    queue->head = (queue->head + 1) % IO_QUEUE_CAPACITY;
+    queue->count--;
+
+    return request;
+}
+
+// A completion nobody will ever pick up still owns whatever the worker loaded for it
+static void DiscardCompletion(IORequest* request)
+{
+    UnloadRunJournal(&request->journal);
+    free(request->snapshot);
+    request->snapshot = NULL;
+}
+
+/* Completions are never dropped: a loaded journal or snapshot only has one way back to the game.
+ * If the game thread is behind on polling we wait for it. The only time nobody will ever poll
+ * again is shutdown, and then there's no one left to hand it to anyway */
+static void CompleteRequest(IORequest request)
+{
+    if (request.callback == NULL)
+    {
+        return; // Fire and forget
+    }
+
+    pthread_mutex_lock(&worker.mutex);
+
+    while (worker.completed.count >= IO_QUEUE_CAPACITY && !worker.quit)
+    {
+        pthread_cond_wait(&worker.drained, &worker.mutex);
+    }
+
+    if (!PushRequest(&worker.completed, request))
+    {
+        DiscardCompletion(&request);
+    }
+
+    pthread_mutex_unlock(&worker.mutex);
+}
+
+static void RunRequest(IORequest* request)
+{
+    switch (request->type)
+    {
+        case IO_LOAD_RUNS:
+            request->journal = InitRunJournal();
+            request->success = LoadRunJournal(&request->journal);
+            ImportLegacyLeaderboard(&request->journal);
+        break;
+
+        case IO_COMPACT_RUNS:
+            request->success = CompactRunFiles();
+        break;
+
+        case IO_APPEND_TELEMETRY:
+            request->success = AppendTelemetryRow(&request->telemetry);
+        break;
+
+        case IO_SAVE_SNAPSHOT:
+            request->success = WriteSnapshotFile(SUSPEND_FILE, request->snapshot);
+            free(request->snapshot);
+            request->snapshot = NULL;
+        break;
+
+        case IO_LOAD_SNAPSHOT:
+            request->snapshot = malloc(sizeof(GameSnapshot));
+            request->success = request->snapshot != NULL && ReadSnapshotFile(SUSPEND_FILE, request->snapshot);
+
+            if (request->success)
+            {
+                remove(SUSPEND_FILE);
+            }
+        break;
+
+        case IO_SAVE_REPLAY:
+            request->success = WriteReplayFile(REPLAY_FILE, request->data, request->dataSize);
+            free(request->data);
+            request->data = NULL;
+        break;
+
+        case IO_APPEND_RUN: // Handled in batches, see IOWorkerThread
+        break;
+    }
+}
+
+static void* IOWorkerThread(void* argument)
+{
+    (void)argument;
+
+    IORequest batch[IO_QUEUE_CAPACITY];
+    RunRecord appends[IO_QUEUE_CAPACITY];
+
+    while (true)
+    {
+        // Sleep until there's work, then grab everything that's queued in one go
+        pthread_mutex_lock(&worker.mutex);
+
+        while (worker.pending.count == 0 && !worker.quit)
+        {
+            pthread_cond_wait(&worker.wake, &worker.mutex);
+        }
+
+        if (worker.pending.count == 0 && worker.quit)
+        {
+            pthread_mutex_unlock(&worker.mutex);
+            break;
+        }
+
+        int batchSize = 0;
+
+        while (worker.pending.count > 0)
+        {
+            batch[batchSize++] = PopRequest(&worker.pending);
+        }
+
+        pthread_mutex_unlock(&worker.mutex);
+
+        /* fsync batching: runs of back-to-back appends become one write and one sync.
+         * Order is still kept, so an append queued before a compaction lands before it. */
+        for (int i = 0; i < batchSize; )
+        {
+            if (batch[i].type != IO_APPEND_RUN)
+            {
+                RunRequest(&batch[i]);
+                CompleteRequest(batch[i]);
+                i++;
+                continue;
+            }
+
+            int first = i;
+            int appendCount = 0;
+
+            while (i < batchSize && batch[i].type == IO_APPEND_RUN)
+            {
+                appends[appendCount++] = batch[i].record;
+                i++;
+            }
+
+            bool success = WriteRunRecords(appends, appendCount);
+
+            for (int j = first; j < i; j++)
+            {
+                batch[j].success = success;
+                CompleteRequest(batch[j]);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+bool StartIOWorker(void)
+{
+    if (worker.running)
+    {
+        return true;
+    }
+
+    worker.pending = (IOQueue){0};
+    worker.completed = (IOQueue){0};
+    worker.quit = false;
+
+    pthread_mutex_init(&worker.mutex, NULL);
+    pthread_cond_init(&worker.wake, NULL);
+    pthread_cond_init(&worker.drained, NULL);
+
+    if (pthread_create(&worker.thread, NULL, IOWorkerThread, NULL) != 0)
+    {
+        printf("Failed to start I/O thread\n");
+        pthread_cond_destroy(&worker.drained);
+        pthread_cond_destroy(&worker.wake);
+        pthread_mutex_destroy(&worker.mutex);
+        return false;
+    }
+
+    worker.running = true;
+    return true;
+}
+
+void StopIOWorker(void)
+{
+    if (!worker.running)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&worker.mutex);
+    worker.quit = true;
+    pthread_cond_signal(&worker.wake);
+    pthread_cond_signal(&worker.drained);
+    pthread_mutex_unlock(&worker.mutex);
+
+    pthread_join(worker.thread, NULL);
+
+    // Nobody is left to receive these, but loaded journals still own memory
+    while (worker.completed.count > 0)
+    {
+        IORequest request = PopRequest(&worker.completed);
+        DiscardCompletion(&request);
+    }
+
+    pthread_cond_destroy(&worker.drained);
+    pthread_cond_destroy(&worker.wake);
+    pthread_mutex_destroy(&worker.mutex);
+    worker.running = false;
+}
+
+bool SubmitIORequest(IORequest request)
+{
+    if (!worker.running)
+    {
+        printf("I/O thread not running, dropping request %d\n", request.type);
+        return false;
+    }
+
+    pthread_mutex_lock(&worker.mutex);
+    bool queued = PushRequest(&worker.pending, request);
+    pthread_cond_signal(&worker.wake);
+    pthread_mutex_unlock(&worker.mutex);
+
+    if (!queued)
+    {
+        printf("I/O queue full, dropping request %d\n", request.type);
+    }
+
+    return queued;
+}
+
+// Called once per frame from the game thread: hands finished requests to their callbacks
+void PollIOCompletions(void* context)
+{
+    if (!worker.running)
+    {
+        return;
+    }
+
+    IORequest finished[IO_QUEUE_CAPACITY];
+    int finishedCount = 0;
+
+    // Copy out under the lock, run callbacks without it
+    pthread_mutex_lock(&worker.mutex);
+
+    while (worker.completed.count > 0)
+    {
+        finished[finishedCount++] = PopRequest(&worker.completed);
+    }
+
+    pthread_cond_signal(&worker.drained);
+    pthread_mutex_unlock(&worker.mutex);
+
+    for (int i = 0; i < finishedCount; i++)
+    {
+        finished[i].callback(&finished[i], context);
+    }
+}
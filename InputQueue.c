@@ -0,0 +1,46 @@
+﻿#include "InputQueue.h"
+
+void ResetInputQueue(InputQueue* queue)
+{
+    atomic_store_explicit(&queue->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&queue->tail, 0, memory_order_relaxed);
+}
+
+bool PushInputEvent(InputQueue* queue, InputEvent event)
+{
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (tail - head >= INPUT_QUEUE_CAPACITY)
+    {
+        return false; // Full, the game hasn't been reading (a very long hitch)
+    }
+
+    queue->events[tail & (INPUT_QUEUE_CAPACITY - 1)] = event;
+
+    // Release: the event is written before the consumer can see the new tail
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool PeekInputEvent(InputQueue* queue, InputEvent* event)
+{
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head == tail)
+    {
+        return false;
+    }
+
+    *event = queue->events[head & (INPUT_QUEUE_CAPACITY - 1)];
+    return true;
+}
+
+void PopInputEvent(InputQueue* queue)
+{
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    // Release: we're done reading the slot before the producer may reuse it
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+}
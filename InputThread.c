@@ -0,0 +1,117 @@
+﻿#include "InputThread.h"
+#include <pthread.h>
+#include <stdio.h>
+#include "Timing.h"
+
+// Like RunJournal.c, this file never includes raylib, so windows.h can't clash with it
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+// One input thread per process, so like the I/O worker its state lives here
+static struct
+{
+    InputQueue queue;
+    pthread_t thread;
+    atomic_bool quit;
+    bool running;
+} input;
+
+#ifdef _WIN32
+static const int virtualKeys[INPUT_KEY_COUNT] =
+{
+    [INPUT_KEY_LEFT] = VK_LEFT,
+    [INPUT_KEY_RIGHT] = VK_RIGHT,
+    [INPUT_KEY_DASH] = VK_LSHIFT,
+    [INPUT_KEY_LAUNCH] = VK_SPACE,
+    [INPUT_KEY_REWIND] = VK_BACK
+};
+
+// GetActiveWindow only works on the window's own thread, so we compare processes instead
+static bool IsGameInForeground(void)
+{
+    DWORD processId = 0;
+    GetWindowThreadProcessId(GetForegroundWindow(), &processId);
+
+    return processId == GetCurrentProcessId();
+}
+
+static void* InputThreadMain(void* argument)
+{
+    (void)argument;
+    bool held[INPUT_KEY_COUNT] = {0};
+
+    while (!atomic_load(&input.quit))
+    {
+        bool focused = IsGameInForeground();
+        double now = GetPreciseTime();
+
+        for (int key = 0; key < INPUT_KEY_COUNT; key++)
+        {
+            // Alt-tabbing away lets go of everything
+            bool down = focused && (GetAsyncKeyState(virtualKeys[key]) & 0x8000) != 0;
+
+            if (down != held[key])
+            {
+                held[key] = down;
+
+                if (!PushInputEvent(&input.queue, (InputEvent){ .time = now, .key = (InputKey)key, .down = down }))
+                {
+                    printf("Input queue full, dropping a key event\n");
+                }
+            }
+        }
+
+        SleepSeconds(INPUT_POLL_INTERVAL);
+    }
+
+    return NULL;
+}
+#endif
+
+bool StartInputThread(void)
+{
+    if (input.running)
+    {
+        return true;
+    }
+
+    ResetInputQueue(&input.queue);
+
+#ifdef _WIN32
+    atomic_store(&input.quit, false);
+
+    if (pthread_create(&input.thread, NULL, InputThreadMain, NULL) != 0)
+    {
+        printf("Failed to start input thread, falling back to per-frame input\n");
+        return false;
+    }
+
+    input.running = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void StopInputThread(void)
+{
+    if (!input.running)
+    {
+        return;
+    }
+
+    atomic_store(&input.quit, true);
+    pthread_join(input.thread, NULL);
+    input.running = false;
+}
+
+bool IsInputThreadRunning(void)
+{
+    return input.running;
+}
+
+InputQueue* GetInputQueue(void)
+{
+    return &input.queue;
+}
@@ -0,0 +1,513 @@
+﻿#include "JobSystem.h"
+#include <pthread.h>
+#include <raylib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "Timing.h"
+
+typedef struct Job
+{
+    const char* name;
+    JobFunction function;
+    void* data;
+    int first;
+    int last;
+    JobCounter* counter;
+} Job;
+
+/* The owner pushes and pops at the bottom (newest first, still warm in its cache), thieves take from the top.
+ * Jobs are a few dozen bytes and the critical sections a handful of instructions, so a spinlock per queue
+ * does the job: nobody ever holds it across anything slow. */
+typedef struct JobQueue
+{
+    atomic_flag lock;
+    atomic_int top;     // Oldest. Only changed under the lock, read without it to skip empty queues
+    atomic_int bottom;  // One past the newest
+    Job jobs[JOB_QUEUE_CAPACITY];
+} JobQueue;
+
+typedef struct JobWorker
+{
+    JobQueue queue;
+    pthread_t thread;
+
+    atomic_llong busyNanoseconds;
+    atomic_llong jobCount;
+    atomic_llong stealCount;
+} JobWorker;
+
+// One job system per process, like the I/O worker
+static struct
+{
+    JobWorker workers[JOB_MAX_WORKERS];
+    int workerCount;
+    bool running;
+
+    atomic_int queued;      // Jobs waiting in any queue, sleeping workers wake up for these
+    atomic_int sleeping;
+    atomic_bool quit;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+
+    JobProfilerHook hook;
+
+    // Utilization overlay, game thread only
+    double statsTime;
+    long long statsBusy[JOB_MAX_WORKERS];
+    float utilization[JOB_MAX_WORKERS];
+} jobs = { .workerCount = 1 };
+
+static _Thread_local int workerIndex = 0; // The game thread (and any other thread) is 0
+
+static void LockQueue(JobQueue* queue)
+{
+    while (atomic_flag_test_and_set_explicit(&queue->lock, memory_order_acquire))
+    {
+        SpinPause();
+    }
+}
+
+static void UnlockQueue(JobQueue* queue)
+{
+    atomic_flag_clear_explicit(&queue->lock, memory_order_release);
+}
+
+static bool PushJob(Job job)
+{
+    JobQueue* queue = &jobs.workers[workerIndex].queue;
+
+    LockQueue(queue);
+
+    int bottom = atomic_load_explicit(&queue->bottom, memory_order_relaxed);
+
+    if (bottom - atomic_load_explicit(&queue->top, memory_order_relaxed) >= JOB_QUEUE_CAPACITY)
+    {
+        UnlockQueue(queue);
+        return false;
+    }
+
+    queue->jobs[bottom & (JOB_QUEUE_CAPACITY - 1)] = job;
+    atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_relaxed);
+
+    UnlockQueue(queue);
+
+    // Counted after it's in, so whoever wakes up for it finds it
+    atomic_fetch_add(&jobs.queued, 1);
+
+    if (atomic_load(&jobs.sleeping) > 0)
+    {
+        pthread_mutex_lock(&jobs.mutex);
+        pthread_cond_signal(&jobs.wake);
+        pthread_mutex_unlock(&jobs.mutex);
+    }
+
+    return true;
+}
+
+// newest: the owner's end of the queue, otherwise the thief's
+static bool TakeJob(JobQueue* queue, bool newest, Job* job)
+{
+    if (atomic_load_explicit(&queue->bottom, memory_order_relaxed) <= atomic_load_explicit(&queue->top, memory_order_relaxed))
+    {
+        return false;
+    }
+
+    LockQueue(queue);
+
+    int top = atomic_load_explicit(&queue->top, memory_order_relaxed);
+    int bottom = atomic_load_explicit(&queue->bottom, memory_order_relaxed);
+    bool found = bottom > top;
+
+    if (found && newest)
+    {
+        *job = queue->jobs[(bottom - 1) & (JOB_QUEUE_CAPACITY - 1)];
+        atomic_store_explicit(&queue->bottom, bottom - 1, memory_order_relaxed);
+    }
+    else if (found)
+    {
+        *job = queue->jobs[top & (JOB_QUEUE_CAPACITY - 1)];
+        atomic_store_explicit(&queue->top, top + 1, memory_order_relaxed);
+    }
+
+    UnlockQueue(queue);
+
+    if (found)
+    {
+        atomic_fetch_sub(&jobs.queued, 1);
+    }
+
+    return found;
+}
+
+static void ExecuteJob(const Job* job)
+{
+    JobWorker* worker = &jobs.workers[workerIndex];
+
+    if (jobs.hook != NULL)
+    {
+        jobs.hook(job->name, workerIndex, true);
+    }
+
+    double start = GetPreciseTime();
+    job->function(job->data, job->first, job->last);
+    double elapsed = GetPreciseTime() - start;
+
+    atomic_fetch_add_explicit(&worker->busyNanoseconds, (long long)(elapsed * 1e9), memory_order_relaxed);
+    atomic_fetch_add_explicit(&worker->jobCount, 1, memory_order_relaxed);
+
+    if (jobs.hook != NULL)
+    {
+        jobs.hook(job->name, workerIndex, false);
+    }
+
+    // Last, whoever waits on it may reuse everything the job touched as soon as this hits zero
+    if (job->counter != NULL)
+    {
+        atomic_fetch_sub(&job->counter->pending, 1);
+    }
+}
+
+// Our own newest job, or someone else's oldest
+static bool RunOneJob(void)
+{
+    Job job;
+
+    if (TakeJob(&jobs.workers[workerIndex].queue, true, &job))
+    {
+        ExecuteJob(&job);
+        return true;
+    }
+
+    for (int i = 1; i < jobs.workerCount; i++)
+    {
+        int victim = (workerIndex + i) % jobs.workerCount;
+
+        if (TakeJob(&jobs.workers[victim].queue, false, &job))
+        {
+            atomic_fetch_add_explicit(&jobs.workers[workerIndex].stealCount, 1, memory_order_relaxed);
+            ExecuteJob(&job);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void* JobWorkerMain(void* argument)
+{
+    workerIndex = (int)(intptr_t)argument;
+    int idle = 0;
+
+    while (!atomic_load(&jobs.quit))
+    {
+        if (RunOneJob())
+        {
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < JOB_SPIN_COUNT)
+        {
+            SpinPause();
+            continue;
+        }
+
+        // Nothing for a while: sleep until something gets queued. Checked under the lock, PushJob signals under it
+        pthread_mutex_lock(&jobs.mutex);
+        atomic_fetch_add(&jobs.sleeping, 1);
+
+        while (atomic_load(&jobs.queued) == 0 && !atomic_load(&jobs.quit))
+        {
+            pthread_cond_wait(&jobs.wake, &jobs.mutex);
+        }
+
+        atomic_fetch_sub(&jobs.sleeping, 1);
+        pthread_mutex_unlock(&jobs.mutex);
+
+        idle = 0;
+    }
+
+    return NULL;
+}
+
+bool StartJobSystem(int workerCount)
+{
+    if (jobs.running)
+    {
+        return true;
+    }
+
+    int count = workerCount > 0 ? workerCount : GetCoreCount();
+    count = count < JOB_MAX_WORKERS ? count : JOB_MAX_WORKERS;
+
+    // A single core: the game thread does it all, same as never starting
+    if (count <= 1)
+    {
+        return true;
+    }
+
+    pthread_mutex_init(&jobs.mutex, NULL);
+    pthread_cond_init(&jobs.wake, NULL);
+    atomic_store(&jobs.quit, false);
+
+    jobs.workerCount = count;
+    jobs.running = true;
+
+    for (int i = 1; i < count; i++)
+    {
+        if (pthread_create(&jobs.workers[i].thread, NULL, JobWorkerMain, (void*)(intptr_t)i) != 0)
+        {
+            printf("Failed to start job worker %d, running jobs on the game thread\n", i);
+
+            // Nothing has been queued yet, so the ones that did start can simply be stopped again
+            jobs.workerCount = i;
+            StopJobSystem();
+            return false;
+        }
+    }
+
+    jobs.statsTime = GetPreciseTime();
+
+    printf("Job system: %d workers\n", count);
+    return true;
+}
+
+void StopJobSystem(void)
+{
+    if (!jobs.running)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&jobs.mutex);
+    atomic_store(&jobs.quit, true);
+    pthread_cond_broadcast(&jobs.wake);
+    pthread_mutex_unlock(&jobs.mutex);
+
+    for (int i = 1; i < jobs.workerCount; i++)
+    {
+        pthread_join(jobs.workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&jobs.wake);
+    pthread_mutex_destroy(&jobs.mutex);
+
+    jobs.workerCount = 1;
+    jobs.running = false;
+}
+
+int GetJobWorkerCount(void)
+{
+    return jobs.workerCount;
+}
+
+void RunJob(const char* name, JobFunction function, void* data, int first, int last, JobCounter* counter)
+{
+    Job job = { name, function, data, first, last, counter };
+
+    if (counter != NULL)
+    {
+        atomic_fetch_add(&counter->pending, 1);
+    }
+
+    // Nobody to hand it to, or no room: do it ourselves, right now
+    if (!jobs.running || !PushJob(job))
+    {
+        ExecuteJob(&job);
+    }
+}
+
+void RunParallelFor(const char* name, JobFunction function, void* data, int count, int batch, JobCounter* counter)
+{
+    batch = batch > 0 ? batch : 1;
+
+    for (int first = 0; first < count; first += batch)
+    {
+        RunJob(name, function, data, first, first + batch < count ? first + batch : count, counter);
+    }
+}
+
+void WaitForJobs(JobCounter* counter)
+{
+    while (atomic_load(&counter->pending) > 0)
+    {
+        if (!RunOneJob())
+        {
+            SpinPause();
+        }
+    }
+}
+
+int AddGraphJob(JobGraph* graph, const char* name, JobFunction function, void* data, int count, int batch)
+{
+    if (graph->nodeCount >= JOB_GRAPH_MAX_NODES)
+    {
+        printf("Job graph full, %s left out\n", name);
+        return -1;
+    }
+
+    int index = graph->nodeCount++;
+
+    graph->nodes[index] = (JobNode)
+    {
+        .name = name,
+        .function = function,
+        .data = data,
+        .count = count,
+        .batch = batch > 0 ? batch : count,
+        .graph = graph
+    };
+
+    return index;
+}
+
+bool AddGraphDependency(JobGraph* graph, int before, int after)
+{
+    if (before < 0 || after < 0 || before >= graph->nodeCount || after >= graph->nodeCount)
+    {
+        return false;
+    }
+
+    JobNode* node = &graph->nodes[before];
+
+    if (node->successorCount >= JOB_NODE_MAX_SUCCESSORS)
+    {
+        printf("Job graph: %s already has %d nodes after it\n", node->name, JOB_NODE_MAX_SUCCESSORS);
+        return false;
+    }
+
+    node->successors[node->successorCount++] = after;
+    graph->nodes[after].dependencies++;
+
+    return true;
+}
+
+static void ScheduleGraphNode(JobNode* node);
+
+// The continuation: whatever was waiting on this node may be able to go now
+static void FinishGraphNode(JobNode* node)
+{
+    JobGraph* graph = node->graph;
+
+    for (int i = 0; i < node->successorCount; i++)
+    {
+        JobNode* next = &graph->nodes[node->successors[i]];
+
+        if (atomic_fetch_sub(&next->waitingFor, 1) == 1)
+        {
+            ScheduleGraphNode(next);
+        }
+    }
+
+    // After the successors are counted in, or WaitForJobGraph could see zero too early
+    atomic_fetch_sub(&graph->nodesLeft.pending, 1);
+}
+
+static void RunGraphBatch(void* data, int first, int last)
+{
+    JobNode* node = data;
+    node->function(node->data, first, last);
+
+    if (atomic_fetch_sub(&node->unfinished, 1) == 1)
+    {
+        FinishGraphNode(node);
+    }
+}
+
+static void ScheduleGraphNode(JobNode* node)
+{
+    if (node->count <= 0)
+    {
+        FinishGraphNode(node);
+        return;
+    }
+
+    atomic_store(&node->unfinished, (node->count + node->batch - 1) / node->batch);
+    RunParallelFor(node->name, RunGraphBatch, node, node->count, node->batch, NULL);
+}
+
+void StartJobGraph(JobGraph* graph)
+{
+    atomic_store(&graph->nodesLeft.pending, graph->nodeCount);
+
+    // All of them first: without workers a root runs to the end, successors included, before the next one starts
+    for (int i = 0; i < graph->nodeCount; i++)
+    {
+        atomic_store(&graph->nodes[i].waitingFor, graph->nodes[i].dependencies);
+    }
+
+    for (int i = 0; i < graph->nodeCount; i++)
+    {
+        if (graph->nodes[i].dependencies == 0)
+        {
+            ScheduleGraphNode(&graph->nodes[i]);
+        }
+    }
+}
+
+void WaitForJobGraph(JobGraph* graph)
+{
+    WaitForJobs(&graph->nodesLeft);
+    graph->nodeCount = 0;
+}
+
+void SetJobProfilerHook(JobProfilerHook hook)
+{
+    jobs.hook = hook;
+}
+
+int GetJobWorkerStats(JobWorkerStats* stats, int maxWorkers)
+{
+    double now = GetPreciseTime();
+    double window = now - jobs.statsTime;
+
+    if (window >= JOB_STATS_INTERVAL)
+    {
+        for (int i = 0; i < jobs.workerCount; i++)
+        {
+            long long busy = atomic_load_explicit(&jobs.workers[i].busyNanoseconds, memory_order_relaxed);
+            jobs.utilization[i] = (float)((busy - jobs.statsBusy[i]) * 1e-9 / window);
+            jobs.statsBusy[i] = busy;
+        }
+
+        jobs.statsTime = now;
+    }
+
+    int count = jobs.workerCount < maxWorkers ? jobs.workerCount : maxWorkers;
+
+    for (int i = 0; i < count; i++)
+    {
+        stats[i] = (JobWorkerStats)
+        {
+            .utilization = jobs.utilization[i],
+            .jobs = atomic_load_explicit(&jobs.workers[i].jobCount, memory_order_relaxed),
+            .steals = atomic_load_explicit(&jobs.workers[i].stealCount, memory_order_relaxed)
+        };
+    }
+
+    return count;
+}
+
+// F3 overlay: a bar per worker. For the game thread only the jobs it ran count, not the rest of its frame
+void DrawJobStats(int x, int y)
+{
+    const int fontSize = 20;
+    const int barWidth = 120;
+    JobWorkerStats stats[JOB_MAX_WORKERS];
+    int count = GetJobWorkerStats(stats, JOB_MAX_WORKERS);
+
+    DrawRectangle(x - 10, y - 10, 560, (count + 1) * (fontSize + 6) + 14, ColorAlpha(BLACK, 0.7f));
+    DrawText(TextFormat("Jobs: %d workers, #0 is the game thread%s", count, jobs.running ? "" : " (no others)"),
+             x, y, fontSize, WHITE);
+
+    for (int i = 0; i < count; i++)
+    {
+        int rowY = y + (fontSize + 6) * (i + 1);
+        float utilization = stats[i].utilization < 1.0f ? stats[i].utilization : 1.0f;
+
+        DrawRectangle(x, rowY + 4, barWidth, fontSize - 8, ColorAlpha(GRAY, 0.4f));
+        DrawRectangle(x, rowY + 4, (int)(barWidth * utilization), fontSize - 8, utilization < 0.8f ? GREEN : YELLOW);
+        DrawText(TextFormat("#%d %3.0f%%  %lld jobs, %lld stolen", i, utilization * 100.0f, stats[i].jobs, stats[i].steals),
+                 x + barWidth + 10, rowY, fontSize, GRAY);
+    }
+}
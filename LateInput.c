@@ -0,0 +1,98 @@
+﻿#include "LateInput.h"
+#include "Timing.h"
+
+// Like RunJournal.c, this file never includes raylib, so windows.h can't clash with it
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+// Ring of per-frame input ages, filled by MarkPresent
+static struct
+{
+    double lastPresent;
+    double latchTime;
+    bool latched;
+    bool correction;
+
+    float simulatedAge[LATENCY_WINDOW];
+    float latchedAge[LATENCY_WINDOW];
+    bool corrected[LATENCY_WINDOW];
+    int head;
+    int count;
+} latency;
+
+PaddleKeys SamplePaddleKeys(void)
+{
+    PaddleKeys keys = {0};
+
+#ifdef _WIN32
+    // The high bit is "down right now", not "went down since the last call"
+    keys.valid = true;
+    keys.left = (GetAsyncKeyState(VK_LEFT) & 0x8000) != 0;
+    keys.right = (GetAsyncKeyState(VK_RIGHT) & 0x8000) != 0;
+    keys.dash = (GetAsyncKeyState(VK_LSHIFT) & 0x8000) != 0;
+
+    // Other apps' key presses aren't ours (no active window on our thread = we're in the background)
+    if (GetActiveWindow() == NULL)
+    {
+        keys = (PaddleKeys){0};
+    }
+#endif
+
+    return keys;
+}
+
+void MarkLateLatch(bool correction)
+{
+    latency.latchTime = GetPreciseTime();
+    latency.latched = true;
+    latency.correction = correction;
+}
+
+/* Called right after EndDrawing. raylib polled the input the simulation used at the end of the
+ * previous frame's EndDrawing, so that input is (now - last present) old when this frame shows up. */
+void MarkPresent(void)
+{
+    double now = GetPreciseTime();
+
+    if (latency.lastPresent > 0.0)
+    {
+        double simulatedAge = now - latency.lastPresent;
+        double latchedAge = latency.latched ? now - latency.latchTime : simulatedAge;
+
+        latency.simulatedAge[latency.head] = (float)simulatedAge;
+        latency.latchedAge[latency.head] = (float)latchedAge;
+        latency.corrected[latency.head] = latency.latched && latency.correction;
+        latency.head = (latency.head + 1) % LATENCY_WINDOW;
+        latency.count += latency.count < LATENCY_WINDOW ? 1 : 0;
+    }
+
+    latency.lastPresent = now;
+    latency.latched = false;
+    latency.correction = false;
+}
+
+InputLatencyStats GetInputLatencyStats(void)
+{
+    InputLatencyStats stats = { .samples = latency.count };
+
+    for (int i = 0; i < latency.count; i++)
+    {
+        stats.simulatedMs += latency.simulatedAge[i];
+        stats.latchedMs += latency.latchedAge[i];
+        stats.worstSimulatedMs = latency.simulatedAge[i] > stats.worstSimulatedMs ? latency.simulatedAge[i] : stats.worstSimulatedMs;
+        stats.worstLatchedMs = latency.latchedAge[i] > stats.worstLatchedMs ? latency.latchedAge[i] : stats.worstLatchedMs;
+        stats.corrections += latency.corrected[i] ? 1 : 0;
+    }
+
+    if (latency.count > 0)
+    {
+        stats.simulatedMs = stats.simulatedMs * 1000.0 / latency.count;
+        stats.latchedMs = stats.latchedMs * 1000.0 / latency.count;
+    }
+
+    stats.worstSimulatedMs *= 1000.0;
+    stats.worstLatchedMs *= 1000.0;
+
+    return stats;
+}
@@ -2,96 +2,190 @@
 #include <stdio.h>
 #include <raylib.h>
 #include <time.h>
+#include "Game.h"
+#include "IOWorker.h"
 
 Leaderboard InitLeaderboard(void)
 {
     Leaderboard leaderboard = {0};
+    leaderboard.journal = InitRunJournal();
     LoadLeaderboard(&leaderboard);
 
     return leaderboard;
 }
 
-bool SaveLeaderboard(const Leaderboard* leaderboard)
+/* We used to fwrite the whole Leaderboard struct on every new entry.
+ * Now every run is appended to the journal as it happens, so "saving" just means
+ * asking the I/O thread to compact the journal into a fresh snapshot (our checkpoint). */
+bool SaveLeaderboard(Leaderboard* leaderboard)
 {
-    FILE* file = fopen(LEADERBOARD_FILE, "wb");
+    leaderboard->journal.appendsSinceCompaction = 0;
+
+    return SubmitIORequest((IORequest){ .type = IO_COMPACT_RUNS });
+}
+
+// The old top-10 file: struct layout from before the run journal
+typedef struct {
+    LeaderboardEntry entries[MAX_LEADERBOARD_ENTRIES];
+    int count;
+} LegacyLeaderboard;
+
+// One-time import of the old leaderboard.dat, so nobody loses their high scores. Runs on the I/O thread!
+void ImportLegacyLeaderboard(RunJournal* journal)
+{
+    FILE* file = fopen(LEADERBOARD_FILE, "rb");
 
     if (!file)
     {
-        printf("Failed to open leaderboard file\n");
-        return false;
+        return;
     }
 
-    /* Here we're writing our leaderboard struct in bytes to our save file
-     * size_t fwrite(const void *ptr, size_t size, size_t count, FILE *stream);
-     */
-    size_t written = fwrite(leaderboard, sizeof(Leaderboard), 1, file);
+    LegacyLeaderboard legacy;
+    size_t read = fread(&legacy, sizeof(LegacyLeaderboard), 1, file);
     fclose(file);
 
-    return written == 1;
+    if (read != 1 || GetRunCount(journal) > 0)
+    {
+        return;
+    }
+
+    RunRecord imported[MAX_LEADERBOARD_ENTRIES];
+    int importedCount = 0;
+
+    for (int i = 0; i < legacy.count && i < MAX_LEADERBOARD_ENTRIES; i++)
+    {
+        // Turn "YYYY-MM-DD HH:MM:SS" back into a timestamp
+        struct tm timeinfo = {0};
+
+        sscanf(legacy.entries[i].date, "%d-%d-%d %d:%d:%d",
+               &timeinfo.tm_year, &timeinfo.tm_mon, &timeinfo.tm_mday,
+               &timeinfo.tm_hour, &timeinfo.tm_min, &timeinfo.tm_sec);
+
+        timeinfo.tm_year -= 1900;
+        timeinfo.tm_mon -= 1;
+        timeinfo.tm_isdst = -1;
+
+        RunRecord record =
+        {
+            .timestamp = (long long)mktime(&timeinfo),
+            .score = legacy.entries[i].score,
+            .maxCombo = legacy.entries[i].maxCombo,
+            .sequence = journal->nextSequence
+        };
+
+        record.checksum = CalculateRunChecksum(&record);
+        InsertRunRecord(journal, record);
+        imported[importedCount++] = record;
+    }
+
+    // Into the journal, then move the old file out of the way so we never import twice
+    if (WriteRunRecords(imported, importedCount))
+    {
+        rename(LEADERBOARD_FILE, LEADERBOARD_FILE ".imported");
+    }
 }
 
-bool LoadLeaderboard(Leaderboard* leaderboard)
+// Game thread: the I/O thread finished building the index, so we take it over
+static void OnRunsLoaded(IORequest* request, void* context)
 {
-    FILE* file = fopen(LEADERBOARD_FILE, "rb");
+    Leaderboard* leaderboard = &((Game*)context)->leaderboard;
 
-    if (!file)
+    UnloadRunJournal(&leaderboard->journal);
+    leaderboard->journal = request->journal;
+    leaderboard->loading = false;
+    leaderboard->loadQueued = false;
+
+    // Runs that finished while we were still loading
+    for (int i = 0; i < leaderboard->pendingCount; i++)
     {
-        return false;
+        AddLeaderboardEntry(leaderboard, leaderboard->pending[i].score, leaderboard->pending[i].maxCombo);
     }
 
-    size_t read = fread(leaderboard, sizeof(Leaderboard), 1, file);
-    fclose(file);
-
-    return read == 1;
+    leaderboard->pendingCount = 0;
+    RefreshLeaderboardEntries(leaderboard);
 }
 
-void AddLeaderboardEntry(Leaderboard* leaderboard, int score, int maxCombo)
+/* Non-blocking! The actual reading happens on the I/O thread, OnRunsLoaded picks up the result.
+ * Until then we're "loading" even if the request didn't make it into the queue: numbering runs
+ * from the empty journal we start with would hand out sequence numbers the real one already used. */
+bool LoadLeaderboard(Leaderboard* leaderboard)
 {
-    time_t now;
-    time(&now);
-    struct tm* timeinfo = localtime(&now);
-
-    LeaderboardEntry newEntry =
+    leaderboard->loading = true;
+    leaderboard->loadQueued = SubmitIORequest((IORequest)
     {
-        .score = score,
-        .maxCombo = maxCombo
-    };
+        .type = IO_LOAD_RUNS,
+        .callback = OnRunsLoaded
+    });
 
-    // Here we're formatting the date and time to a string
-    strftime(newEntry.date, sizeof(newEntry.date), "%Y-%m-%d %H:%M:%S", timeinfo);
+    return leaderboard->loadQueued;
+}
 
-    // Find new entry position: sort by score
-    int insertPos = 0;
+// Pulls the top 10 out of the journal index for drawing: O(log n + 10)
+void RefreshLeaderboardEntries(Leaderboard* leaderboard)
+{
+    RunRecord top[MAX_LEADERBOARD_ENTRIES];
+    leaderboard->count = GetTopRuns(&leaderboard->journal, top, MAX_LEADERBOARD_ENTRIES);
+    leaderboard->revision++;
 
-    while (insertPos < leaderboard->count && insertPos < MAX_LEADERBOARD_ENTRIES &&
-           leaderboard->entries[insertPos].score > score)
+    for (int i = 0; i < leaderboard->count; i++)
     {
-        insertPos++;
+        LeaderboardEntry* entry = &leaderboard->entries[i];
+        time_t timestamp = (time_t)top[i].timestamp;
+        struct tm* timeinfo = localtime(&timestamp);
+
+        entry->score = top[i].score;
+        entry->maxCombo = top[i].maxCombo;
+
+        // Here we're formatting the date and time to a string
+        if (timeinfo)
+        {
+            strftime(entry->date, sizeof(entry->date), "%Y-%m-%d %H:%M:%S", timeinfo);
+        }
+        else
+        {
+            entry->date[0] = '\0';
+        }
     }
+}
 
-    // If Score too low and board full
-    if (insertPos >= MAX_LEADERBOARD_ENTRIES)
+void AddLeaderboardEntry(Leaderboard* leaderboard, int score, int maxCombo)
+{
+    // Still loading: we don't know the next run number yet, so park it until OnRunsLoaded
+    if (leaderboard->loading)
     {
+        if (!leaderboard->loadQueued)
+        {
+            LoadLeaderboard(leaderboard);
+        }
+
+        if (leaderboard->pendingCount < MAX_PENDING_RUNS)
+        {
+            leaderboard->pending[leaderboard->pendingCount++] = (LeaderboardEntry){ .score = score, .maxCombo = maxCombo };
+        }
+
+        leaderboard->lastRank = 0;
         return;
     }
 
-    // Compare scores to sort them!
-    for (int i = (leaderboard->count < MAX_LEADERBOARD_ENTRIES - 1 ?
-              leaderboard->count : MAX_LEADERBOARD_ENTRIES - 1);
-              i > insertPos; i--)
-    {
-        leaderboard->entries[i] = leaderboard->entries[i - 1];
-    }
+    // Index is updated right away, the disk write is queued for the I/O thread
+    RunRecord record = CreateRunRecord(&leaderboard->journal, score, maxCombo);
+    SubmitIORequest((IORequest){ .type = IO_APPEND_RUN, .record = record });
+
+    // "Your rank is #N of M", both straight from the order-statistic index
+    leaderboard->lastRank = GetRunRank(&leaderboard->journal, &record);
+    leaderboard->lastTotal = GetRunCount(&leaderboard->journal);
 
-    // Insert new entry
-    leaderboard->entries[insertPos] = newEntry;
-    if (leaderboard->count < MAX_LEADERBOARD_ENTRIES)
+    if (++leaderboard->journal.appendsSinceCompaction >= RUN_COMPACT_INTERVAL)
     {
-        leaderboard->count++;
+        SaveLeaderboard(leaderboard);
     }
 
-    // Save after updating!
-    SaveLeaderboard(leaderboard);
+    RefreshLeaderboardEntries(leaderboard);
+}
+
+void UnloadLeaderboard(Leaderboard* leaderboard)
+{
+    UnloadRunJournal(&leaderboard->journal);
 }
 
 void DrawLeaderboardScreen(const Leaderboard* leaderboard, int screenWidth, int screenHeight)
@@ -2,11 +2,26 @@
 #include <raymath.h>
 #include <stdio.h>
 #include <tgmath.h>
+#include "LevelGenerator.h"
+#include "Snapshot.h"
+
+_Static_assert(BLOCK_NORMAL == LEVEL_CELL_NORMAL && BLOCK_SOLID == LEVEL_CELL_SOLID &&
+               BLOCK_BONUS == LEVEL_CELL_BONUS, "Level pack cell types must match BlockType");
+
+// Like the I/O worker, there's only ever one level pack, so it lives here
+static LevelPack levelPack;
+static bool hasLevelPack = false;
 
 void DrawLevelComplete(Game game)
 {
     const char* completeText = "LEVEL COMPLETE!";
-    const char* nextText = "Press SPACE to continue";
+    char nextText[96] = "Press SPACE to continue";
+    const char* nextName = game.endless ? "" : GetLevelName(game.currentLevel + 1);
+
+    if (nextName[0] != '\0')
+    {
+        snprintf(nextText, sizeof(nextText), "Next: %s - Press SPACE to continue", nextName);
+    }
 
     char levelText[32];
     sprintf(levelText, "Level %d Complete!", game.currentLevel);
@@ -129,6 +144,7 @@ void LoadNextLevel(Game* game)
     // Initialize and play =)
     InitializeLevel(game, game->currentLevel);
     game->state = PLAYING;
+    MarkLevelStart(game);
 }
 
 void CalculateLevelProgression(int currentLevel, float* speedIncrease, float* widthDecrease)
@@ -177,6 +193,107 @@ void InitializeLevel(Game* game, int level)
     game->combo = 0;
 
     // Initialize blocks
+    BuildLevelBlocks(game, level);
+
+    ClearParticles(&game->particles);
+
+    game->inMenu = false;
+}
+
+int CalculateLevelBonus(int level, int currentScore)
+{
+    int baseBonus = LEVEL_BONUS_MULTIPLIER * level;
+    int scoreBonus = currentScore * SCORE_BONUS_MULTIPLIER;
+
+    return baseBonus + scoreBonus;
+}
+
+bool LoadLevelPack(const char* path)
+{
+    UnloadLevelPack();
+
+    if (!OpenLevelPack(path, &levelPack))
+    {
+        printf("No level pack at %s, using the built-in levels\n", path);
+        return false;
+    }
+
+    hasLevelPack = true;
+    printf("Loaded %d levels from %s\n", levelPack.levelCount, path);
+
+    return true;
+}
+
+void UnloadLevelPack(void)
+{
+    if (hasLevelPack)
+    {
+        CloseLevelPack(&levelPack);
+        hasLevelPack = false;
+    }
+}
+
+int GetLevelCount(void)
+{
+    return hasLevelPack ? levelPack.levelCount : PROCEDURAL_LEVEL_COUNT;
+}
+
+// Empty for the built-in levels, they never had names
+const char* GetLevelName(int level)
+{
+    return hasLevelPack ? GetPackedLevelName(&levelPack, level - 1) : "";
+}
+
+uint32_t GetLevelPackChecksum(void)
+{
+    return hasLevelPack ? levelPack.header->checksum : 0;
+}
+
+void BuildLevelBlocks(Game* game, int level)
+{
+    if (game->endless)
+    {
+        GeneratedLevel generated;
+
+        /* Normally the generator thread finished this one while the last level was being played.
+         * Level 1 (or a generator that fell behind) is generated right here, it's only microseconds. */
+        if (!TakeGeneratedLevel(game->levelSeed, level, &generated))
+        {
+            GenerateLevel(game->levelSeed, level, &generated);
+        }
+
+        game->currentBlockRows = generated.rows;
+        game->currentBlockColumns = generated.columns;
+
+        InitPackedBlocks(game->blocks, game->screenWidth, game->screenHeight,
+                         generated.cells, generated.rows, generated.columns, GetGeneratorPalette(),
+                         game->isTimewarpActive);
+
+        // And get going on the next one while this one is played
+        RequestGeneratedLevel(game->levelSeed, level + 1);
+        return;
+    }
+
+    if (hasLevelPack)
+    {
+        int rows, columns;
+        const LevelCell* cells = GetPackedLevel(&levelPack, level - 1, &rows, &columns);
+
+        if (cells != NULL)
+        {
+            game->currentBlockRows = rows;
+            game->currentBlockColumns = columns;
+
+            InitPackedBlocks(game->blocks, game->screenWidth, game->screenHeight,
+                             cells, rows, columns, levelPack.palette,
+                             game->isTimewarpActive);
+            return;
+        }
+
+        printf("Level %d is missing or damaged in the level pack, using a built-in layout\n", level);
+    }
+
+    // The built-in levels: the grid grows by a row and a column every level
     game->currentBlockRows = Clamp(MIN_BLOCK_ROWS + (level - 1),
                                 MIN_BLOCK_ROWS,
                                 MAX_BLOCK_ROWS);
@@ -188,14 +305,4 @@ void InitializeLevel(Game* game, int level)
     InitBlocks(game->blocks, game->screenWidth, game->screenHeight,
               game->currentBlockRows, game->currentBlockColumns,
               game->isTimewarpActive);
-
-    game->inMenu = false;
 }
-
-int CalculateLevelBonus(int level, int currentScore)
-{
-    int baseBonus = LEVEL_BONUS_MULTIPLIER * level;
-    int scoreBonus = currentScore * SCORE_BONUS_MULTIPLIER;
-
-    return baseBonus + scoreBonus;
-}
\ No newline at end of file
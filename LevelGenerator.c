@@ -0,0 +1,377 @@
+﻿#include "LevelGenerator.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+// Shared by every generated level. Index 0 is "shade by lives", like in level packs
+static const uint32_t generatorPalette[LEVEL_PACK_PALETTE_SIZE] =
+{
+    0x00000000,
+    0xFF8000FF, // Amber
+    0x00C8FFFF, // Cyan
+    0xFF3060FF, // Red
+    0xFFE040FF, // Yellow
+    0xB060FFFF, // Violet
+    0x40FFB0FF, // Mint
+    0xFF80C0FF, // Pink
+};
+
+#define GENERATOR_PALETTE_COLORS 7
+
+static const char* patternNames[PATTERN_COUNT] =
+{
+    "Wall", "Pyramid", "Diamond", "Checkers", "Stripes", "Frames", "Scatter"
+};
+
+static const char* symmetryNames[SYMMETRY_COUNT] =
+{
+    "Wild", "Mirrored", "Quartered"
+};
+
+// Everything the generator decides once per level, before touching any cell
+typedef struct LevelPlan
+{
+    uint64_t seed;
+    int rows;
+    int columns;
+    LevelPattern pattern;
+    LevelSymmetry symmetry;
+    LivesLayout livesLayout;
+    float averageLives;
+    float density;          // Scatter only
+    bool verticalStripes;   // Stripes only
+    float solidChance;
+    bool banded;            // Colour whole rows from the palette instead of shading by lives
+    int bandOffset;
+} LevelPlan;
+
+// splitmix64: tiny, fast, and every bit of the seed matters
+static uint64_t MixSeed(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+
+    return value ^ (value >> 31);
+}
+
+static uint32_t NextRandom(uint64_t* state)
+{
+    *state = MixSeed(*state);
+    return (uint32_t)(*state >> 32);
+}
+
+static int RandomRange(uint64_t* state, int min, int max)
+{
+    return min + (int)(NextRandom(state) % (uint32_t)(max - min + 1));
+}
+
+static float RandomFloat(uint64_t* state)
+{
+    return (NextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+/* Per-cell randomness comes from hashing the cell's coordinates, not from a running sequence.
+ * Mirrored cells fold onto the same coordinates, so they get the same numbers for free. */
+static float CellRandom(const LevelPlan* plan, int row, int col, uint64_t salt)
+{
+    uint64_t hash = MixSeed(plan->seed ^ MixSeed(((uint64_t)row << 32) | (uint64_t)col) ^ (salt * 0xD6E8FEB86659FD93ull));
+    return (hash >> 40) * (1.0f / 16777216.0f);
+}
+
+static void FoldCell(const LevelPlan* plan, int* row, int* col)
+{
+    if (plan->symmetry != SYMMETRY_NONE && *col >= plan->columns / 2)
+    {
+        *col = plan->columns - 1 - *col;
+    }
+
+    if (plan->symmetry == SYMMETRY_QUAD && *row >= plan->rows / 2)
+    {
+        *row = plan->rows - 1 - *row;
+    }
+}
+
+static bool IsCellInPattern(const LevelPlan* plan, int row, int col)
+{
+    // -1 to 1 across the grid, 0 to 1 down it
+    float u = plan->columns > 1 ? (2.0f * col / (plan->columns - 1)) - 1.0f : 0.0f;
+    float v = plan->rows > 1 ? (float)row / (plan->rows - 1) : 0.0f;
+    int ring = (int)fminf(fminf(row, col), fminf(plan->rows - 1 - row, plan->columns - 1 - col));
+
+    switch (plan->pattern)
+    {
+        case PATTERN_PYRAMID: return fabsf(u) <= 0.15f + v;
+        case PATTERN_DIAMOND: return fabsf(u) + fabsf(2.0f * v - 1.0f) <= 1.1f;
+        case PATTERN_CHECKER: return (row + col) % 2 == 0;
+        case PATTERN_STRIPES: return plan->verticalStripes ? col % 2 == 0 : row % 2 == 0;
+        case PATTERN_FRAME: return ring % 2 == 0;
+        case PATTERN_SCATTER: return CellRandom(plan, row, col, 1) < plan->density;
+        default: return true;
+    }
+}
+
+// 0.5 to 1.5, scaled by the difficulty target afterwards
+static float GetLivesWeight(const LevelPlan* plan, int row, int col)
+{
+    switch (plan->livesLayout)
+    {
+        case LIVES_TOP_HEAVY:
+            return plan->rows > 1 ? 1.5f - (float)row / (plan->rows - 1) : 1.0f;
+
+        case LIVES_CORE:
+        {
+            float u = plan->columns > 1 ? (2.0f * col / (plan->columns - 1)) - 1.0f : 0.0f;
+            float v = plan->rows > 1 ? (2.0f * row / (plan->rows - 1)) - 1.0f : 0.0f;
+            return 1.5f - fminf(1.0f, sqrtf(u * u + v * v) * 0.75f);
+        }
+
+        default:
+            FoldCell(plan, &row, &col); // Keep the symmetry
+            return 0.5f + CellRandom(plan, row, col, 2);
+    }
+}
+
+// The difficulty target: bigger grids and tougher blocks, level by level
+static LevelPlan PlanLevel(uint64_t seed, int level)
+{
+    uint64_t state = seed;
+    LevelPlan plan = { .seed = seed };
+
+    plan.rows = GENERATOR_MIN_ROWS + level / 2;
+    plan.columns = GENERATOR_MIN_COLUMNS + level / 3;
+    plan.rows = plan.rows > GENERATOR_MAX_ROWS ? GENERATOR_MAX_ROWS : plan.rows;
+    plan.columns = plan.columns > GENERATOR_MAX_COLUMNS ? GENERATOR_MAX_COLUMNS : plan.columns;
+
+    // The first few levels stay full walls, patterns with holes in them come once the grid is bigger
+    plan.pattern = level <= 2 ? PATTERN_FULL : (LevelPattern)RandomRange(&state, 0, PATTERN_COUNT - 1);
+    plan.symmetry = (LevelSymmetry)RandomRange(&state, 0, SYMMETRY_COUNT - 1);
+    plan.livesLayout = (LivesLayout)RandomRange(&state, 0, LIVES_LAYOUT_COUNT - 1);
+    plan.averageLives = fminf(1.5f + level * 0.3f, 7.0f);
+    plan.density = 0.45f + RandomFloat(&state) * 0.3f;
+    plan.verticalStripes = RandomRange(&state, 0, 1) == 1;
+    plan.solidChance = level >= 6 && RandomRange(&state, 0, 2) == 0 ? 0.06f + fminf(level * 0.005f, 0.08f) : 0.0f;
+    plan.banded = RandomRange(&state, 0, 1) == 1;
+    plan.bandOffset = RandomRange(&state, 0, GENERATOR_PALETTE_COLORS - 1);
+
+    return plan;
+}
+
+void GenerateLevel(uint64_t seed, int level, GeneratedLevel* out)
+{
+    // Every level gets its own seed, so level 12 doesn't depend on how 1-11 came out
+    uint64_t levelSeed = MixSeed(seed ^ MixSeed((uint64_t)level));
+    LevelPlan plan = PlanLevel(levelSeed, level);
+
+    memset(out, 0, sizeof(*out));
+    out->seed = seed;
+    out->level = level;
+    out->rows = plan.rows;
+    out->columns = plan.columns;
+
+    for (int row = 0; row < plan.rows; row++)
+    {
+        for (int col = 0; col < plan.columns; col++)
+        {
+            int sourceRow = row, sourceCol = col;
+            FoldCell(&plan, &sourceRow, &sourceCol);
+
+            if (!IsCellInPattern(&plan, sourceRow, sourceCol))
+            {
+                continue;
+            }
+
+            LevelCell* cell = &out->cells[row * plan.columns + col];
+            float weight = GetLivesWeight(&plan, row, col);
+            int lives = (int)lroundf(plan.averageLives * weight);
+
+            cell->lives = (uint8_t)(lives < 1 ? 1 : (lives > LEVEL_PACK_MAX_LIVES ? LEVEL_PACK_MAX_LIVES : lives));
+            cell->type = CellRandom(&plan, sourceRow, sourceCol, 3) < plan.solidChance ? LEVEL_CELL_SOLID : LEVEL_CELL_NORMAL;
+            cell->color = plan.banded ? (uint8_t)(1 + (row + plan.bandOffset) % GENERATOR_PALETTE_COLORS) : 0;
+
+            if (cell->type == LEVEL_CELL_SOLID)
+            {
+                cell->lives = 1;
+                cell->color = 0;
+            }
+            else
+            {
+                out->blockCount++;
+                out->totalLives += cell->lives;
+            }
+        }
+    }
+
+    // A level full of solids (or a tiny scatter) could never be cleared, so top it up with a plain row
+    if (out->blockCount < plan.columns)
+    {
+        for (int col = 0; col < plan.columns; col++)
+        {
+            LevelCell* cell = &out->cells[col];
+
+            if (cell->lives == 0 || cell->type == LEVEL_CELL_SOLID)
+            {
+                *cell = (LevelCell){ .lives = 1, .type = LEVEL_CELL_NORMAL };
+                out->blockCount++;
+                out->totalLives++;
+            }
+        }
+    }
+
+    // A few bonus blocks, picked from the destructible ones
+    uint64_t state = MixSeed(levelSeed ^ 0xB0B05ull);
+    int bonusCount = 1 + level / 8;
+    bonusCount = bonusCount > GENERATOR_MAX_BONUS ? GENERATOR_MAX_BONUS : bonusCount;
+
+    for (int attempt = 0; attempt < 32 && bonusCount > 0; attempt++)
+    {
+        LevelCell* cell = &out->cells[RandomRange(&state, 0, plan.rows * plan.columns - 1)];
+
+        if (cell->lives > 0 && cell->type == LEVEL_CELL_NORMAL)
+        {
+            cell->type = LEVEL_CELL_BONUS;
+            bonusCount--;
+        }
+    }
+
+    snprintf(out->name, sizeof(out->name), "%s %s", symmetryNames[plan.symmetry], patternNames[plan.pattern]);
+}
+
+const uint32_t* GetGeneratorPalette(void)
+{
+    return generatorPalette;
+}
+
+// Like the I/O worker, one generator thread per process, so its state lives here
+static struct
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    bool running;
+    bool quit;
+
+    bool hasRequest;
+    uint64_t requestSeed;
+    int requestLevel;
+
+    bool hasResult;
+    GeneratedLevel result;
+} generator;
+
+static void* GeneratorMain(void* argument)
+{
+    (void)argument;
+    GeneratedLevel level;
+
+    pthread_mutex_lock(&generator.mutex);
+
+    while (true)
+    {
+        while (!generator.hasRequest && !generator.quit)
+        {
+            pthread_cond_wait(&generator.wake, &generator.mutex);
+        }
+
+        if (generator.quit)
+        {
+            break;
+        }
+
+        uint64_t seed = generator.requestSeed;
+        int levelNumber = generator.requestLevel;
+        generator.hasRequest = false;
+
+        // Generate without the lock, the game thread can keep asking in the meantime
+        pthread_mutex_unlock(&generator.mutex);
+        GenerateLevel(seed, levelNumber, &level);
+        pthread_mutex_lock(&generator.mutex);
+
+        generator.result = level;
+        generator.hasResult = true;
+    }
+
+    pthread_mutex_unlock(&generator.mutex);
+    return NULL;
+}
+
+bool StartLevelGenerator(void)
+{
+    if (generator.running)
+    {
+        return true;
+    }
+
+    pthread_mutex_init(&generator.mutex, NULL);
+    pthread_cond_init(&generator.wake, NULL);
+    generator.quit = false;
+    generator.hasRequest = false;
+    generator.hasResult = false;
+
+    if (pthread_create(&generator.thread, NULL, GeneratorMain, NULL) != 0)
+    {
+        printf("Failed to start level generator thread, levels will be generated on load\n");
+        pthread_cond_destroy(&generator.wake);
+        pthread_mutex_destroy(&generator.mutex);
+        return false;
+    }
+
+    generator.running = true;
+    return true;
+}
+
+void StopLevelGenerator(void)
+{
+    if (!generator.running)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&generator.mutex);
+    generator.quit = true;
+    pthread_cond_signal(&generator.wake);
+    pthread_mutex_unlock(&generator.mutex);
+
+    pthread_join(generator.thread, NULL);
+    pthread_cond_destroy(&generator.wake);
+    pthread_mutex_destroy(&generator.mutex);
+    generator.running = false;
+}
+
+// Only the newest request matters, an older one still waiting just gets replaced
+void RequestGeneratedLevel(uint64_t seed, int level)
+{
+    if (!generator.running)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&generator.mutex);
+    generator.requestSeed = seed;
+    generator.requestLevel = level;
+    generator.hasRequest = true;
+    pthread_cond_signal(&generator.wake);
+    pthread_mutex_unlock(&generator.mutex);
+}
+
+bool TakeGeneratedLevel(uint64_t seed, int level, GeneratedLevel* out)
+{
+    if (!generator.running)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&generator.mutex);
+
+    bool ready = generator.hasResult && generator.result.seed == seed && generator.result.level == level;
+
+    if (ready)
+    {
+        *out = generator.result;
+        generator.hasResult = false;
+    }
+
+    pthread_mutex_unlock(&generator.mutex);
+    return ready;
+}
@@ -0,0 +1,204 @@
+﻿#include "LevelPack.h"
+#include <stdio.h>
+#include <string.h>
+
+uint32_t HashLevelPackBytes(const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Offset and length both inside the file, and aligned so we can read it in place
+static bool IsRangeInFile(const LevelPack* pack, uint32_t offset, size_t length)
+{
+    return offset % 4 == 0 && offset <= pack->file.size && length <= pack->file.size - offset;
+}
+
+bool OpenLevelPack(const char* path, LevelPack* pack)
+{
+    *pack = (LevelPack){0};
+
+    if (!MapFileReadOnly(path, &pack->file))
+    {
+        return false;
+    }
+
+    const LevelPackHeader* header = (const LevelPackHeader*)pack->file.data;
+
+    if (pack->file.size < sizeof(LevelPackHeader) || header->magic != LEVEL_PACK_MAGIC)
+    {
+        printf("%s is not a level pack\n", path);
+        CloseLevelPack(pack);
+        return false;
+    }
+
+    if (header->version != LEVEL_PACK_VERSION)
+    {
+        printf("%s is level pack version %u, we only read version %d\n", path, header->version, LEVEL_PACK_VERSION);
+        CloseLevelPack(pack);
+        return false;
+    }
+
+    pack->header = header;
+
+    if (header->fileSize != pack->file.size ||
+        !IsRangeInFile(pack, header->paletteOffset, LEVEL_PACK_PALETTE_SIZE * sizeof(uint32_t)) ||
+        !IsRangeInFile(pack, header->tocOffset, (size_t)header->levelCount * sizeof(LevelPackEntry)))
+    {
+        printf("%s is truncated or damaged\n", path);
+        CloseLevelPack(pack);
+        return false;
+    }
+
+    pack->palette = (const uint32_t*)(pack->file.data + header->paletteOffset);
+    pack->toc = (const LevelPackEntry*)(pack->file.data + header->tocOffset);
+    pack->levelCount = (int)header->levelCount;
+
+    return true;
+}
+
+void CloseLevelPack(LevelPack* pack)
+{
+    UnmapFile(&pack->file);
+    *pack = (LevelPack){0};
+}
+
+const LevelCell* GetPackedLevel(const LevelPack* pack, int index, int* rows, int* columns)
+{
+    if (index < 0 || index >= pack->levelCount)
+    {
+        return NULL;
+    }
+
+    const LevelPackEntry* entry = &pack->toc[index];
+
+    if (entry->rows < 1 || entry->rows > LEVEL_PACK_MAX_ROWS ||
+        entry->columns < 1 || entry->columns > LEVEL_PACK_MAX_COLUMNS ||
+        !IsRangeInFile(pack, entry->cellOffset, (size_t)entry->rows * entry->columns * sizeof(LevelCell)))
+    {
+        return NULL;
+    }
+
+    *rows = entry->rows;
+    *columns = entry->columns;
+
+    return (const LevelCell*)(pack->file.data + entry->cellOffset);
+}
+
+const char* GetPackedLevelName(const LevelPack* pack, int index)
+{
+    if (index < 0 || index >= pack->levelCount)
+    {
+        return "";
+    }
+
+    uint32_t offset = pack->toc[index].nameOffset;
+
+    // The name has to end before the file does
+    if (offset >= pack->file.size || memchr(pack->file.data + offset, '\0', pack->file.size - offset) == NULL)
+    {
+        return "";
+    }
+
+    return (const char*)(pack->file.data + offset);
+}
+
+static bool ValidateLevel(const LevelPack* pack, int index, bool verbose)
+{
+    const LevelPackEntry* entry = &pack->toc[index];
+    int rows, columns;
+    const LevelCell* cells = GetPackedLevel(pack, index, &rows, &columns);
+
+    if (cells == NULL)
+    {
+        printf("Level %d: bad size %dx%d or cells outside the file\n", index + 1, entry->rows, entry->columns);
+        return false;
+    }
+
+    bool valid = true;
+    int destructible = 0;
+
+    for (int i = 0; i < rows * columns; i++)
+    {
+        const LevelCell* cell = &cells[i];
+
+        if (cell->lives == 0)
+        {
+            continue;
+        }
+
+        if (cell->lives > LEVEL_PACK_MAX_LIVES || cell->type >= LEVEL_CELL_TYPE_COUNT ||
+            cell->color >= LEVEL_PACK_PALETTE_SIZE || cell->reserved != 0)
+        {
+            printf("Level %d: bad block at row %d, column %d\n", index + 1, i / columns + 1, i % columns + 1);
+            valid = false;
+        }
+
+        destructible += cell->type != LEVEL_CELL_SOLID;
+    }
+
+    if (destructible != entry->blockCount)
+    {
+        printf("Level %d: TOC says %d blocks, found %d\n", index + 1, entry->blockCount, destructible);
+        valid = false;
+    }
+
+    if (destructible == 0)
+    {
+        printf("Level %d: nothing to destroy, it can never be cleared\n", index + 1);
+        valid = false;
+    }
+
+    if (HashLevelPackBytes(cells, (size_t)rows * columns * sizeof(LevelCell)) != entry->checksum)
+    {
+        printf("Level %d: checksum mismatch\n", index + 1);
+        valid = false;
+    }
+
+    const char* name = GetPackedLevelName(pack, index);
+
+    if (name[0] == '\0' || strlen(name) >= LEVEL_PACK_MAX_NAME)
+    {
+        printf("Level %d: missing or overlong name\n", index + 1);
+        valid = false;
+    }
+
+    if (verbose && valid)
+    {
+        printf("Level %3d  %2dx%-2d  %3d blocks  %s\n", index + 1, rows, columns, destructible, name);
+    }
+
+    return valid;
+}
+
+bool ValidateLevelPack(const LevelPack* pack, bool verbose)
+{
+    bool valid = true;
+    const unsigned char* body = pack->file.data + sizeof(LevelPackHeader);
+
+    if (HashLevelPackBytes(body, pack->file.size - sizeof(LevelPackHeader)) != pack->header->checksum)
+    {
+        printf("File checksum mismatch\n");
+        valid = false;
+    }
+
+    if (pack->levelCount == 0)
+    {
+        printf("The pack has no levels\n");
+        valid = false;
+    }
+
+    for (int i = 0; i < pack->levelCount; i++)
+    {
+        valid &= ValidateLevel(pack, i, verbose);
+    }
+
+    return valid;
+}
@@ -0,0 +1,522 @@
+﻿#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "LevelPack.h"
+
+/* Offline level pack tool!
+ *   LevelPackTool compile <levels.txt> <levels.pack>
+ *   LevelPackTool validate <levels.pack>
+ *   LevelPackTool dump <levels.pack> <level>
+ *   LevelPackTool bench <levels.pack>
+ *
+ * The text format, one level after another:
+ *   // Comments start with two slashes
+ *   palette 1 FF8000          Custom colour 1-15, shared by the whole pack
+ *   level Name Of The Level
+ *   3 3 3 . 3 3 3             One line per row, one token per column
+ *   2 # 2+ 2 2+ # 2
+ *   end
+ * Tokens: "." no block, "#" solid, "N" a block with N lives (1-9), "N+" a bonus block.
+ * Add "/C" to colour a block with palette entry C, e.g. "4/2" or "4+/2". */
+
+#define MAX_PACK_LEVELS 4096
+#define MAX_LINE 1024
+
+typedef struct SourceLevel
+{
+    char name[LEVEL_PACK_MAX_NAME];
+    int rows;
+    int columns;
+    LevelCell cells[LEVEL_PACK_MAX_ROWS * LEVEL_PACK_MAX_COLUMNS];
+} SourceLevel;
+
+typedef struct SourcePack
+{
+    uint32_t palette[LEVEL_PACK_PALETTE_SIZE];
+    SourceLevel* levels;
+    int levelCount;
+} SourcePack;
+
+static double NowMilliseconds(void)
+{
+    return (double)clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static char* TrimLine(char* line)
+{
+    while (*line != '\0' && isspace((unsigned char)*line))
+    {
+        line++;
+    }
+
+    // "#" is a solid block, so comments use "//" instead
+    if (strncmp(line, "//", 2) == 0)
+    {
+        *line = '\0';
+    }
+
+    size_t length = strlen(line);
+
+    while (length > 0 && isspace((unsigned char)line[length - 1]))
+    {
+        line[--length] = '\0';
+    }
+
+    return line;
+}
+
+static bool ParseCell(const char* token, LevelCell* cell)
+{
+    *cell = (LevelCell){0};
+
+    if (strcmp(token, ".") == 0)
+    {
+        return true;
+    }
+
+    if (strcmp(token, "#") == 0)
+    {
+        *cell = (LevelCell){ .lives = 1, .type = LEVEL_CELL_SOLID };
+        return true;
+    }
+
+    if (token[0] < '1' || token[0] > '0' + LEVEL_PACK_MAX_LIVES)
+    {
+        return false;
+    }
+
+    cell->lives = (uint8_t)(token[0] - '0');
+    cell->type = LEVEL_CELL_NORMAL;
+    token++;
+
+    if (*token == '+')
+    {
+        cell->type = LEVEL_CELL_BONUS;
+        token++;
+    }
+
+    if (*token == '/')
+    {
+        char* end;
+        long color = strtol(token + 1, &end, 10);
+
+        if (end == token + 1 || color < 1 || color >= LEVEL_PACK_PALETTE_SIZE)
+        {
+            return false;
+        }
+
+        cell->color = (uint8_t)color;
+        token = end;
+    }
+
+    return *token == '\0';
+}
+
+static bool ParseRow(char* line, SourceLevel* level, const char* path, int lineNumber)
+{
+    if (level->rows == LEVEL_PACK_MAX_ROWS)
+    {
+        printf("%s:%d: more than %d rows\n", path, lineNumber, LEVEL_PACK_MAX_ROWS);
+        return false;
+    }
+
+    LevelCell* row = &level->cells[level->rows * LEVEL_PACK_MAX_COLUMNS];
+    int columns = 0;
+
+    for (char* token = strtok(line, " \t"); token != NULL; token = strtok(NULL, " \t"))
+    {
+        if (columns == LEVEL_PACK_MAX_COLUMNS)
+        {
+            printf("%s:%d: more than %d columns\n", path, lineNumber, LEVEL_PACK_MAX_COLUMNS);
+            return false;
+        }
+
+        if (!ParseCell(token, &row[columns]))
+        {
+            printf("%s:%d: can't read block \"%s\"\n", path, lineNumber, token);
+            return false;
+        }
+
+        columns++;
+    }
+
+    // Every row of a level has to be the same width
+    if (level->rows > 0 && columns != level->columns)
+    {
+        printf("%s:%d: %d columns, the rows above have %d\n", path, lineNumber, columns, level->columns);
+        return false;
+    }
+
+    level->columns = columns;
+    level->rows++;
+    return true;
+}
+
+static bool ParseSource(const char* path, SourcePack* source)
+{
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        printf("Can't open %s\n", path);
+        return false;
+    }
+
+    source->levels = malloc(MAX_PACK_LEVELS * sizeof(SourceLevel));
+
+    if (source->levels == NULL)
+    {
+        fclose(file);
+        return false;
+    }
+
+    char buffer[MAX_LINE];
+    int lineNumber = 0;
+    SourceLevel* level = NULL;
+    bool ok = true;
+
+    while (ok && fgets(buffer, sizeof(buffer), file) != NULL)
+    {
+        lineNumber++;
+        char* line = TrimLine(buffer);
+
+        if (line[0] == '\0')
+        {
+            continue;
+        }
+
+        if (strncmp(line, "palette ", 8) == 0)
+        {
+            int index;
+            unsigned int rgb;
+
+            if (sscanf(line + 8, "%d %x", &index, &rgb) != 2 || index < 1 || index >= LEVEL_PACK_PALETTE_SIZE)
+            {
+                printf("%s:%d: palette wants an index 1-%d and an RRGGBB colour\n",
+                       path, lineNumber, LEVEL_PACK_PALETTE_SIZE - 1);
+                ok = false;
+            }
+            else
+            {
+                source->palette[index] = (rgb << 8) | 0xFF;
+            }
+        }
+        else if (strncmp(line, "level ", 6) == 0 || strcmp(line, "level") == 0)
+        {
+            if (level != NULL)
+            {
+                printf("%s:%d: level inside a level, missing \"end\"?\n", path, lineNumber);
+                ok = false;
+            }
+            else if (source->levelCount == MAX_PACK_LEVELS)
+            {
+                printf("%s:%d: more than %d levels\n", path, lineNumber, MAX_PACK_LEVELS);
+                ok = false;
+            }
+            else
+            {
+                level = &source->levels[source->levelCount];
+                *level = (SourceLevel){0};
+
+                const char* name = line[5] == ' ' ? TrimLine(line + 6) : "";
+                snprintf(level->name, sizeof(level->name), "%s", name[0] != '\0' ? name : "Untitled");
+            }
+        }
+        else if (strcmp(line, "end") == 0)
+        {
+            if (level == NULL || level->rows == 0)
+            {
+                printf("%s:%d: \"end\" without a level\n", path, lineNumber);
+                ok = false;
+            }
+            else
+            {
+                source->levelCount++;
+                level = NULL;
+            }
+        }
+        else if (level != NULL)
+        {
+            ok = ParseRow(line, level, path, lineNumber);
+        }
+        else
+        {
+            printf("%s:%d: rows have to be inside a level\n", path, lineNumber);
+            ok = false;
+        }
+    }
+
+    if (ok && level != NULL)
+    {
+        printf("%s: the last level is missing its \"end\"\n", path);
+        ok = false;
+    }
+
+    fclose(file);
+    return ok;
+}
+
+// The pack is written exactly like it's read: we build the whole file in memory, then write it once
+static bool WritePack(const SourcePack* source, const char* path)
+{
+    size_t paletteOffset = sizeof(LevelPackHeader);
+    size_t tocOffset = paletteOffset + LEVEL_PACK_PALETTE_SIZE * sizeof(uint32_t);
+    size_t cellsOffset = tocOffset + (size_t)source->levelCount * sizeof(LevelPackEntry);
+    size_t namesOffset = cellsOffset;
+
+    for (int i = 0; i < source->levelCount; i++)
+    {
+        namesOffset += (size_t)source->levels[i].rows * source->levels[i].columns * sizeof(LevelCell);
+    }
+
+    size_t size = namesOffset;
+
+    for (int i = 0; i < source->levelCount; i++)
+    {
+        size += strlen(source->levels[i].name) + 1;
+    }
+
+    size = (size + 3) & ~(size_t)3;
+
+    unsigned char* data = calloc(1, size);
+
+    if (data == NULL)
+    {
+        return false;
+    }
+
+    memcpy(data + paletteOffset, source->palette, sizeof(source->palette));
+
+    LevelPackEntry* toc = (LevelPackEntry*)(data + tocOffset);
+    size_t cellCursor = cellsOffset;
+    size_t nameCursor = namesOffset;
+
+    for (int i = 0; i < source->levelCount; i++)
+    {
+        const SourceLevel* level = &source->levels[i];
+        LevelCell* cells = (LevelCell*)(data + cellCursor);
+        int blockCount = 0;
+
+        // The source keeps rows MAX_COLUMNS apart, the pack stores them tightly
+        for (int row = 0; row < level->rows; row++)
+        {
+            for (int col = 0; col < level->columns; col++)
+            {
+                LevelCell cell = level->cells[row * LEVEL_PACK_MAX_COLUMNS + col];
+                cells[row * level->columns + col] = cell;
+                blockCount += cell.lives > 0 && cell.type != LEVEL_CELL_SOLID;
+            }
+        }
+
+        size_t cellBytes = (size_t)level->rows * level->columns * sizeof(LevelCell);
+
+        toc[i] = (LevelPackEntry)
+        {
+            .cellOffset = (uint32_t)cellCursor,
+            .rows = (uint8_t)level->rows,
+            .columns = (uint8_t)level->columns,
+            .blockCount = (uint16_t)blockCount,
+            .nameOffset = (uint32_t)nameCursor,
+            .checksum = HashLevelPackBytes(cells, cellBytes)
+        };
+
+        size_t nameLength = strlen(level->name) + 1;
+        memcpy(data + nameCursor, level->name, nameLength);
+
+        cellCursor += cellBytes;
+        nameCursor += nameLength;
+    }
+
+    LevelPackHeader* header = (LevelPackHeader*)data;
+
+    *header = (LevelPackHeader)
+    {
+        .magic = LEVEL_PACK_MAGIC,
+        .version = LEVEL_PACK_VERSION,
+        .levelCount = (uint32_t)source->levelCount,
+        .paletteOffset = (uint32_t)paletteOffset,
+        .tocOffset = (uint32_t)tocOffset,
+        .fileSize = (uint32_t)size,
+        .checksum = HashLevelPackBytes(data + sizeof(LevelPackHeader), size - sizeof(LevelPackHeader))
+    };
+
+    FILE* file = fopen(path, "wb");
+    bool written = file != NULL && fwrite(data, 1, size, file) == size;
+
+    if (file != NULL)
+    {
+        written &= fclose(file) == 0;
+    }
+
+    if (!written)
+    {
+        printf("Can't write %s\n", path);
+    }
+
+    free(data);
+    return written;
+}
+
+static int Compile(const char* sourcePath, const char* packPath)
+{
+    SourcePack source = {0};
+    bool ok = ParseSource(sourcePath, &source);
+
+    if (ok && source.levelCount == 0)
+    {
+        printf("%s has no levels\n", sourcePath);
+        ok = false;
+    }
+
+    ok = ok && WritePack(&source, packPath);
+    free(source.levels);
+
+    if (!ok)
+    {
+        return 1;
+    }
+
+    // Never ship something the game would refuse
+    LevelPack pack;
+
+    if (!OpenLevelPack(packPath, &pack))
+    {
+        return 1;
+    }
+
+    ok = ValidateLevelPack(&pack, false);
+    printf("%s: %d levels, %zu bytes%s\n", packPath, pack.levelCount, pack.file.size, ok ? "" : " (INVALID)");
+    CloseLevelPack(&pack);
+
+    return ok ? 0 : 1;
+}
+
+static void DumpLevel(const LevelPack* pack, int index)
+{
+    int rows, columns;
+    const LevelCell* cells = GetPackedLevel(pack, index, &rows, &columns);
+
+    if (cells == NULL)
+    {
+        printf("No level %d (the pack has %d)\n", index + 1, pack->levelCount);
+        return;
+    }
+
+    printf("level %s\n", GetPackedLevelName(pack, index));
+
+    // Prints the same text format compile reads, so a pack can be turned back into source
+    for (int row = 0; row < rows; row++)
+    {
+        for (int col = 0; col < columns; col++)
+        {
+            const LevelCell* cell = &cells[row * columns + col];
+            char token[16] = ".";
+
+            if (cell->lives > 0 && cell->type == LEVEL_CELL_SOLID)
+            {
+                snprintf(token, sizeof(token), "#");
+            }
+            else if (cell->lives > 0)
+            {
+                int length = snprintf(token, sizeof(token), "%d%s", cell->lives, cell->type == LEVEL_CELL_BONUS ? "+" : "");
+
+                if (cell->color != 0)
+                {
+                    snprintf(token + length, sizeof(token) - length, "/%d", cell->color);
+                }
+            }
+
+            printf(col == 0 ? "%s" : " %s", token);
+        }
+
+        printf("\n");
+    }
+
+    printf("end\n");
+}
+
+// Same work the game does per level: TOC lookup, then one pass over the cells
+static int Bench(const LevelPack* pack)
+{
+    const int passes = 2000;
+    long long touched = 0;
+    double start = NowMilliseconds();
+
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (int i = 0; i < pack->levelCount; i++)
+        {
+            int rows, columns;
+            const LevelCell* cells = GetPackedLevel(pack, i, &rows, &columns);
+
+            for (int cell = 0; cells != NULL && cell < rows * columns; cell++)
+            {
+                touched += cells[cell].lives + cells[cell].type + pack->palette[cells[cell].color & (LEVEL_PACK_PALETTE_SIZE - 1)];
+            }
+        }
+    }
+
+    double elapsed = NowMilliseconds() - start;
+    double loads = (double)passes * pack->levelCount;
+
+    printf("%.0f level loads in %.1f ms, %.3f us per level (checksum %lld)\n",
+           loads, elapsed, elapsed * 1000.0 / loads, touched);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s compile <levels.txt> <levels.pack> | validate <pack> | dump <pack> <level> | bench <pack>\n", argv[0]);
+        return 1;
+    }
+
+    const char* command = argv[1];
+
+    if (strcmp(command, "compile") == 0)
+    {
+        if (argc < 4)
+        {
+            printf("compile wants a source and an output file\n");
+            return 1;
+        }
+
+        return Compile(argv[2], argv[3]);
+    }
+
+    LevelPack pack;
+
+    if (!OpenLevelPack(argv[2], &pack))
+    {
+        printf("Can't open %s\n", argv[2]);
+        return 1;
+    }
+
+    int result = 0;
+
+    if (strcmp(command, "validate") == 0)
+    {
+        bool valid = ValidateLevelPack(&pack, true);
+        printf("%s: %d levels, %s\n", argv[2], pack.levelCount, valid ? "OK" : "INVALID");
+        result = valid ? 0 : 1;
+    }
+    else if (strcmp(command, "dump") == 0 && argc > 3)
+    {
+        DumpLevel(&pack, atoi(argv[3]) - 1);
+    }
+    else if (strcmp(command, "bench") == 0)
+    {
+        result = Bench(&pack);
+    }
+    else
+    {
+        printf("Unknown command %s\n", command);
+        result = 1;
+    }
+
+    CloseLevelPack(&pack);
+    return result;
+}
@@ -2,6 +2,15 @@
 #include <math.h>
 #include <raylib.h>
 
+static const char* menuOptions[] =
+{
+    "PLAY",
+    "ENDLESS",
+    "LEADERBOARD",
+    "TUTORIAL",
+    "QUIT"
+};
+
 void UpdateMainMenu(Game* game)
 {
     game->menuArrowTimer += GetFrameTime() * 12.0f;
@@ -59,6 +68,8 @@ void UpdateMainMenu(Game* game)
         switch (game->selectedOption)
         {
             case MENU_PLAY:
+            case MENU_ENDLESS:
+                game->endless = game->selectedOption == MENU_ENDLESS;
                 ResetGame(game);
                 game->state = PLAYING;
                 game->inMenu = false;
@@ -94,23 +105,10 @@ void DrawMainMenu(Game game)
         return;
     }
 
-    const char* menuOptions[] =
-    {
-        "PLAY",
-        "LEADERBOARD",
-        "TUTORIAL",
-        "QUIT"
-    };
-
-    // Calculate arrow opacity (0-1) using sine wave
-    float arrowAlpha = (sinf(game.menuArrowTimer) + 1.0f) * 0.5f;
-    const int spacing = 50;
-    const int arrowSpacing = 20;
-
     const Vector2 menuStart =
     {
         game.screenWidth / 2,
-        game.screenHeight / 2 - ((MENU_COUNT - 1) * spacing) / 2
+        game.screenHeight / 2 - ((MENU_COUNT - 1) * MENU_SPACING) / 2
     };
 
     const char* title = "BREAKOUT-C";
@@ -121,35 +119,16 @@ void DrawMainMenu(Game game)
         FONT_TITLE_SIZE,
         WHITE);
 
-    // Draw menu options
+    // Draw menu options (the pulsing arrows are drawn live on top, see DrawMenuArrows)
     for (int i = 0; i < MENU_COUNT; i++)
     {
         Color optionColor = (i == game.selectedOption) ? GREEN : WHITE;
         int textWidth = MeasureText(menuOptions[i], FONT_SIZE);
 
-        if (i == game.selectedOption)
-        {
-            // Create pulsing arrow color
-            Color arrowColor = GREEN;
-            arrowColor.a = (unsigned char)(255 * arrowAlpha);
-
-            DrawText(">",
-                menuStart.x - textWidth/2 - arrowSpacing,
-                menuStart.y + i * spacing,
-                FONT_SIZE,
-                arrowColor);
-
-            DrawText("<",
-                menuStart.x + textWidth/2 + arrowSpacing - 10,
-                menuStart.y + i * spacing,
-                FONT_SIZE,
-                arrowColor);
-        }
-
         // Menu options
         DrawText(menuOptions[i],
             menuStart.x - textWidth/2,
-            menuStart.y + i * spacing,
+            menuStart.y + i * MENU_SPACING,
             FONT_SIZE,
             optionColor);
     }
@@ -165,6 +144,39 @@ void DrawMainMenu(Game game)
         LIGHTGRAY);
 }
 
+/* The menu itself is cached in a texture, but the arrows pulse every frame.
+ * So they're drawn straight to the screen on top, like the UI layer during gameplay. */
+void DrawMenuArrows(Game game)
+{
+    // Calculate arrow opacity (0-1) using sine wave
+    float arrowAlpha = (sinf(game.menuArrowTimer) + 1.0f) * 0.5f;
+    const int arrowSpacing = 20;
+
+    const Vector2 menuStart =
+    {
+        game.screenWidth / 2,
+        game.screenHeight / 2 - ((MENU_COUNT - 1) * MENU_SPACING) / 2
+    };
+
+    int textWidth = MeasureText(menuOptions[game.selectedOption], FONT_SIZE);
+
+    // Create pulsing arrow color
+    Color arrowColor = GREEN;
+    arrowColor.a = (unsigned char)(255 * arrowAlpha);
+
+    DrawText(">",
+        menuStart.x - textWidth/2 - arrowSpacing,
+        menuStart.y + game.selectedOption * MENU_SPACING,
+        FONT_SIZE,
+        arrowColor);
+
+    DrawText("<",
+        menuStart.x + textWidth/2 + arrowSpacing - 10,
+        menuStart.y + game.selectedOption * MENU_SPACING,
+        FONT_SIZE,
+        arrowColor);
+}
+
 void DrawTutorial(Game game)
 {
     const char* title = "TUTORIAL";
@@ -0,0 +1,102 @@
+﻿#include "MappedFile.h"
+
+// Like RunJournal.c, this file never includes raylib, so windows.h can't clash with it
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+bool MapFileReadOnly(const char* path, MappedFile* mapped)
+{
+    *mapped = (MappedFile){0};
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mapped->data = data;
+    mapped->size = (size_t)size.QuadPart;
+    mapped->fileHandle = file;
+    mapped->mappingHandle = mapping;
+#else
+    int file = open(path, O_RDONLY);
+
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file); // The mapping keeps its own reference
+
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    mapped->data = data;
+    mapped->size = (size_t)info.st_size;
+#endif
+
+    return true;
+}
+
+void UnmapFile(MappedFile* mapped)
+{
+    if (mapped->data == NULL)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapped->data);
+    CloseHandle(mapped->mappingHandle);
+    CloseHandle(mapped->fileHandle);
+#else
+    munmap((void*)mapped->data, mapped->size);
+#endif
+
+    *mapped = (MappedFile){0};
+}
@@ -0,0 +1,290 @@
+﻿#include "Particles.h"
+#include <math.h>
+#include <string.h>
+#include <rlgl.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define PARTICLES_USE_SSE 1
+#endif
+
+// Xorshift! Way cheaper than rand() when a block explodes into 40 shards at once
+static float RandomUnit(unsigned int* seed)
+{
+    unsigned int x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+
+    return (x >> 8) * (1.0f / 16777216.0f); // 0 to 1
+}
+
+ParticleSystem InitParticleSystem(int capacity)
+{
+    // Round up to a multiple of 4, so the SIMD pass never needs a scalar tail
+    capacity = (capacity + 3) & ~3;
+
+    size_t floatArray = capacity * sizeof(float);
+    size_t totalSize = floatArray * 6 + capacity * sizeof(Color);
+
+    ParticleSystem system =
+    {
+        .memory = MemAlloc(totalSize), // MemAlloc zeroes the memory for us
+        .capacity = capacity,
+        .count = 0,
+        .seed = 0x9E3779B9u,
+        .culledCount = 0
+    };
+
+    // Carve our single allocation into the separate arrays
+    unsigned char* cursor = (unsigned char*)system.memory;
+    system.positionX = (float*)cursor;       cursor += floatArray;
+    system.positionY = (float*)cursor;       cursor += floatArray;
+    system.velocityX = (float*)cursor;       cursor += floatArray;
+    system.velocityY = (float*)cursor;       cursor += floatArray;
+    system.life = (float*)cursor;            cursor += floatArray;
+    system.inverseMaxLife = (float*)cursor;  cursor += floatArray;
+    system.color = (Color*)cursor;
+
+    return system;
+}
+
+void SpawnParticleBurst(ParticleSystem* system, Rectangle area, Color color, int count)
+{
+    if (system->memory == NULL || count <= 0)
+    {
+        return;
+    }
+
+    /* Graceful culling: once we pass the high-water mark, bursts get thinned out linearly,
+     * reaching zero exactly when the pool is full. This way we never hit a hard wall mid-burst. */
+    int allowed = count;
+    int highWater = (int)(system->capacity * PARTICLE_HIGH_WATER);
+
+    if (system->count > highWater)
+    {
+        float room = (float)(system->capacity - system->count) / (float)(system->capacity - highWater);
+        allowed = (int)(count * room);
+    }
+
+    int freeSlots = system->capacity - system->count;
+
+    if (allowed > freeSlots)
+    {
+        allowed = freeSlots;
+    }
+
+    system->culledCount += count - allowed;
+
+    for (int i = 0; i < allowed; i++)
+    {
+        int index = system->count++;
+
+        float angle = RandomUnit(&system->seed) * 2.0f * PI;
+        float speed = PARTICLE_MIN_SPEED + RandomUnit(&system->seed) * (PARTICLE_MAX_SPEED - PARTICLE_MIN_SPEED);
+        float life = PARTICLE_MIN_LIFE + RandomUnit(&system->seed) * (PARTICLE_MAX_LIFE - PARTICLE_MIN_LIFE);
+
+        system->positionX[index] = area.x + RandomUnit(&system->seed) * area.width;
+        system->positionY[index] = area.y + RandomUnit(&system->seed) * area.height;
+        system->velocityX[index] = cosf(angle) * speed;
+        system->velocityY[index] = sinf(angle) * speed;
+        system->life[index] = life;
+        system->inverseMaxLife[index] = 1.0f / life;
+        system->color[index] = color;
+    }
+}
+
+/* The hot loop! Gravity, drag, movement and fading for shards [first, last).
+ * With SSE2 we do four particles per instruction. Our capacity is a multiple of 4, and so is `first`,
+ * so running past last only touches the next range's shards or dead slots, which is harmless... as long as
+ * the next range isn't being updated at the same time, so job batches are multiples of 4 too. */
+static void IntegrateParticles(ParticleSystem* system, int first, int last, float deltaTime, float damping)
+{
+    float* restrict positionX = system->positionX;
+    float* restrict positionY = system->positionY;
+    float* restrict velocityX = system->velocityX;
+    float* restrict velocityY = system->velocityY;
+    float* restrict life = system->life;
+
+    float gravityStep = PARTICLE_GRAVITY * deltaTime;
+
+#ifdef PARTICLES_USE_SSE
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 damp = _mm_set1_ps(damping);
+    const __m128 gravity = _mm_set1_ps(gravityStep);
+
+    for (int i = first; i < last; i += 4)
+    {
+        __m128 vx = _mm_mul_ps(_mm_loadu_ps(velocityX + i), damp);
+        __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(velocityY + i), gravity), damp);
+
+        _mm_storeu_ps(velocityX + i, vx);
+        _mm_storeu_ps(velocityY + i, vy);
+        _mm_storeu_ps(positionX + i, _mm_add_ps(_mm_loadu_ps(positionX + i), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(positionY + i, _mm_add_ps(_mm_loadu_ps(positionY + i), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), dt));
+    }
+#else
+    // Plain loop, simple enough for the compiler to vectorize on its own
+    for (int i = first; i < last; i++)
+    {
+        velocityX[i] *= damping;
+        velocityY[i] = (velocityY[i] + gravityStep) * damping;
+        positionX[i] += velocityX[i] * deltaTime;
+        positionY[i] += velocityY[i] * deltaTime;
+        life[i] -= deltaTime;
+    }
+#endif
+}
+
+// Swap-remove dead shards, this keeps the live ones packed at the front
+static void CompactParticles(ParticleSystem* system)
+{
+    int i = 0;
+
+    while (i < system->count)
+    {
+        if (system->life[i] > 0.0f)
+        {
+            i++;
+            continue;
+        }
+
+        int last = --system->count;
+
+        system->positionX[i] = system->positionX[last];
+        system->positionY[i] = system->positionY[last];
+        system->velocityX[i] = system->velocityX[last];
+        system->velocityY[i] = system->velocityY[last];
+        system->life[i] = system->life[last];
+        system->inverseMaxLife[i] = system->inverseMaxLife[last];
+        system->color[i] = system->color[last];
+    }
+}
+
+void UpdateParticles(ParticleSystem* system, float deltaTime)
+{
+    if (system->count == 0)
+    {
+        return;
+    }
+
+    float damping = fmaxf(0.0f, 1.0f - PARTICLE_DRAG * deltaTime);
+    IntegrateParticles(system, 0, system->count, deltaTime, damping);
+    CompactParticles(system);
+}
+
+static void IntegrateParticlesJob(void* data, int first, int last)
+{
+    ParticleSystem* system = data;
+    IntegrateParticles(system, first, last, system->stepTime, system->stepDamping);
+}
+
+static void CompactParticlesJob(void* data, int first, int last)
+{
+    (void)first;
+    (void)last;
+    CompactParticles(data);
+}
+
+/* UpdateParticles as two graph nodes: the integration split into batches across the workers,
+ * then the compaction, which has to see all of them. The system can't be touched until the graph is done. */
+void AddParticleJobs(JobGraph* graph, ParticleSystem* system, float deltaTime)
+{
+    if (system->count == 0)
+    {
+        return;
+    }
+
+    if (graph->nodeCount + 2 > JOB_GRAPH_MAX_NODES)
+    {
+        // No room in this frame's graph, do it all right here instead
+        UpdateParticles(system, deltaTime);
+        return;
+    }
+
+    system->stepTime = deltaTime;
+    system->stepDamping = fmaxf(0.0f, 1.0f - PARTICLE_DRAG * deltaTime);
+
+    int integrate = AddGraphJob(graph, "particles", IntegrateParticlesJob, system, system->count, PARTICLE_JOB_BATCH);
+    int compact = AddGraphJob(graph, "particle compaction", CompactParticlesJob, system, 1, 1);
+    AddGraphDependency(graph, integrate, compact);
+}
+
+/* Instead of calling DrawRectanglePro 100k times, we feed rlgl all our quads in one go.
+ * rlgl flushes its own vertex buffer when it fills up, so this stays a handful of draw calls. */
+void DrawParticles(const ParticleSystem* system)
+{
+    if (system->count == 0)
+    {
+        return;
+    }
+
+    // Same white texel raylib uses for shapes, so we share its batch
+    Texture2D shapesTexture = GetShapesTexture();
+    Rectangle shapesRect = GetShapesTextureRectangle();
+
+    float u0 = shapesRect.x / shapesTexture.width;
+    float v0 = shapesRect.y / shapesTexture.height;
+    float u1 = (shapesRect.x + shapesRect.width) / shapesTexture.width;
+    float v1 = (shapesRect.y + shapesRect.height) / shapesTexture.height;
+
+    const float halfWidth = PARTICLE_WIDTH * 0.5f;
+
+    rlSetTexture(shapesTexture.id);
+    rlBegin(RL_QUADS);
+    {
+        for (int i = 0; i < system->count; i++)
+        {
+            float vx = system->velocityX[i];
+            float vy = system->velocityY[i];
+            float speed = sqrtf(vx * vx + vy * vy);
+
+            // Shards point along their velocity, and stretch the faster they go
+            float dirX = speed > 0.0f ? vx / speed : 0.0f;
+            float dirY = speed > 0.0f ? vy / speed : 1.0f;
+            float halfLength = (PARTICLE_LENGTH + speed * PARTICLE_STREAK) * 0.5f;
+
+            float alongX = dirX * halfLength;
+            float alongY = dirY * halfLength;
+            float acrossX = -dirY * halfWidth;
+            float acrossY = dirX * halfWidth;
+
+            float x = system->positionX[i];
+            float y = system->positionY[i];
+
+            Color color = system->color[i];
+            float alpha = system->life[i] * system->inverseMaxLife[i];
+            color.a = (unsigned char)(color.a * alpha);
+
+            rlColor4ub(color.r, color.g, color.b, color.a);
+
+            // Same winding as DrawRectanglePro: top-left, bottom-left, bottom-right, top-right
+            rlTexCoord2f(u0, v0);
+            rlVertex2f(x - alongX - acrossX, y - alongY - acrossY);
+
+            rlTexCoord2f(u0, v1);
+            rlVertex2f(x - alongX + acrossX, y - alongY + acrossY);
+
+            rlTexCoord2f(u1, v1);
+            rlVertex2f(x + alongX + acrossX, y + alongY + acrossY);
+
+            rlTexCoord2f(u1, v0);
+            rlVertex2f(x + alongX - acrossX, y + alongY - acrossY);
+        }
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+void ClearParticles(ParticleSystem* system)
+{
+    system->count = 0;
+}
+
+void UnloadParticleSystem(ParticleSystem* system)
+{
+    MemFree(system->memory);
+    *system = (ParticleSystem){0};
+}
@@ -29,31 +29,15 @@ Player InitPlayer(int width, int height)
     return player;
 }
 
-void UpdatePlayerMovement(Player* player, float deltaTime, float screenWidth)
+// The input was already integrated over the tick (see BuildTickInput), so the dash boost is in moveSeconds too
+void UpdatePlayerMovement(Player* player, const SimInput* input, float timeScale, float screenWidth)
 {
     Vector2 prevPosition = player->position;
-    float moveAmount = 0.0f;
-    bool isMoving = false;
+    float moveAmount = player->speed * input->moveSeconds * timeScale;
+    bool isMoving = input->moving;
     bool wasDashing = player->isDashing;
 
-    // Handle horizontal movement
-    if (IsKeyDown(KEY_RIGHT))
-    {
-        moveAmount = player->speed * deltaTime;
-        isMoving = true;
-    }
-    else if (IsKeyDown(KEY_LEFT))
-    {
-        moveAmount = -player->speed * deltaTime;
-        isMoving = true;
-    }
-
-    bool shouldDash = isMoving && IsKeyDown(KEY_LEFT_SHIFT);
-
-    if (shouldDash)
-    {
-        moveAmount *= PLAYER_SPEED_BOOST;
-    }
+    bool shouldDash = isMoving && input->dashing;
 
     // Check if we just started dashing
     if (shouldDash && !wasDashing)
@@ -90,61 +74,72 @@ void UpdatePlayerTrail(Player* player, Vector2 prevPosition)
     player->trail.currentIndex = (player->trail.currentIndex + 1) % PLAYER_TRAIL_LENGTH;
 }
 
-void DrawPlayerWithTrail(const Player* player)
+/* One ribbon as thick as the paddle, down the middle of where it's been, newest first. It carries on past the
+ * oldest centre by a fifth of the paddle, where the trailing edge of the old trail's smallest rectangle was */
+int GetPlayerTrailRibbon(const Player* player, RibbonPoint points[PLAYER_TRAIL_RIBBON_POINTS])
 {
-    if (player->isDashing)
+    if (!player->isDashing)
     {
-        Vector2 prevPos = player->position;
+        return 0;
+    }
 
-        // We simply initialise all of our trail positions to the player's current position
-        for (int i = 0; i < PLAYER_TRAIL_LENGTH; i++)
+    Vector2 center = { player->width / 2.0f, player->height / 2.0f };
+    Vector2 previous = MyVector2Add(player->position, center);
+    int count = 0;
+
+    Color headColor = player->color;
+    headColor.a = (unsigned char)(0.4f * 255);
+    points[count++] = (RibbonPoint){ previous, player->height / 2.0f, headColor };
+
+    for (int i = 1; i <= PLAYER_TRAIL_LENGTH; i++)
+    {
+        Vector2 trailPos = MyVector2Add(player->trail.positions
+        [
+            (player->trail.currentIndex - i + PLAYER_TRAIL_LENGTH) % PLAYER_TRAIL_LENGTH
+        ], center);
+
+        // A dash starts with the whole ring on one spot
+        if (MyVector2DistanceSquared(trailPos, previous) < 0.25f)
         {
-            Vector2 trailPos = player->trail.positions
-            [
-                (player->trail.currentIndex - i + PLAYER_TRAIL_LENGTH) % PLAYER_TRAIL_LENGTH
-            ];
-
-            // Fade from 0.4 to 0.0
-            float alpha = (float)(PLAYER_TRAIL_LENGTH - i) / PLAYER_TRAIL_LENGTH;
-            alpha *= 0.4f; // Maximum opacity
-
-            // Calculate width scale (from 1.0 to 0.4)
-            float widthScale = 0.4f + (0.6f * alpha);
-
-            Color trailColor =
-            {
-                player->color.r,  // Use player's current color
-                player->color.g,
-                player->color.b,
-                (unsigned char)(alpha * 255) // Convert 0-1 to 0-255
-            };
-
-            // Calculate centered position for scaled width
-            float scaledWidth = player->width * widthScale;
-            float xOffset = (player->width - scaledWidth) / 2;
-
-            // Drawing our trail ^^
-            DrawRectangle
-            (
-                trailPos.x + xOffset,
-                trailPos.y,
-                scaledWidth,
-                player->height,
-                trailColor
-            );
+            continue;
         }
+
+        // Fade from 0.4 towards 0.0, the tail gets there
+        float alpha = (float)(PLAYER_TRAIL_LENGTH - i + 1) / PLAYER_TRAIL_LENGTH;
+        alpha *= 0.4f; // Maximum opacity
+
+        Color trailColor = player->color;
+        trailColor.a = (unsigned char)(alpha * 255);
+
+        points[count++] = (RibbonPoint){ trailPos, player->height / 2.0f, trailColor };
+        previous = trailPos;
+    }
+
+    if (count >= 2)
+    {
+        // The tail: the last stretch carried on, fading out
+        Vector2 direction = MyVector2Normalize(MyVector2Subtract(points[count - 1].position, points[count - 2].position));
+        float tailWidth = player->width * 0.4f;
+
+        points[count] = points[count - 1];
+        points[count].position = MyVector2Add(points[count - 1].position, MyVector2Scale(direction, tailWidth / 2));
+        points[count].color.a = 0;
+        count++;
     }
 
-    // Draw player
-    DrawRectangle
-    (
-        player->position.x,
-        player->position.y,
-        player->width,
-        player->height,
-        player->color
-    );
+    return count;
+}
+
+// Just the dash trail, the paddle itself is late-latched and drawn by Game.c
+void RecordPlayerTrail(RenderCommandBuffer* commands, const Player* player)
+{
+    RibbonPoint points[PLAYER_TRAIL_RIBBON_POINTS];
+    int count = GetPlayerTrailRibbon(player, points);
+
+    // Drawing our trail ^^
+    PushRibbon(commands, RENDER_LAYER_TRAILS, points, count);
 }
+
 void UpdatePlayerColor(Player* player, bool isTimewarpActive)
 {
     player->color = isTimewarpActive ? PLAYER_COLOR_PURPLE : PLAYER_COLOR;
@@ -2,7 +2,6 @@
 #include "Game.h"
 #include "Player.h"
 #include <math.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include "BlocksManager.h"
 
@@ -34,7 +33,7 @@ float CalculateSpawnChance(PowerUpSpawnSystem* system, int combo, int score)
 }
 
 // Determine if a powerup should spawn based on current conditions
-bool CheckPowerUpSpawn(PowerUpSpawnSystem* system, int combo, int score, float deltaTime)
+bool CheckPowerUpSpawn(PowerUpSpawnSystem* system, int combo, int score, float deltaTime, SimRandom* random)
 {
     // Update the cooldown timer
     system->cooldownTimer -= deltaTime;
@@ -45,14 +44,13 @@ bool CheckPowerUpSpawn(PowerUpSpawnSystem* system, int combo, int score, float d
     }
 
     float chance = CalculateSpawnChance(system, combo, score);
-    float roll = (float)rand() / RAND_MAX;
+    float roll = SimRandomFloat(random);
 
     // On success, restart cooldown!
     if (roll < chance)
     {
         system->currentChance = system->baseChance;
         system->cooldownTimer = system->cooldownDuration;
-        printf("Spawn successful, cooldown started: %.2f seconds\n", system->cooldownDuration);
 
         return true;
     }
@@ -105,6 +103,10 @@ PowerUp CreatePowerUp(Vector2 position, PowerUpType type, float duration)
             powerUp.duration = PU_DAMAGE_DURATION;
         break;
 
+        case POWERUP_REWIND:
+            powerUp.color = PU_REWIND_COLOR;
+        break;
+
         default:
             powerUp.color = WHITE;
         break;
@@ -129,7 +131,7 @@ void UpdatePowerUp(PowerUp* powerUp, float deltaTime)
 void ApplyPowerUpEffect(PowerUp* powerUp, Player* player, Game* game)
 {
     powerUp->wasPickedUp = true;
-    powerUp->startTime = GetTime();
+    powerUp->startTime = game->simTime;
 
     switch(powerUp->type)
     {
@@ -172,6 +174,16 @@ void ApplyPowerUpEffect(PowerUp* powerUp, Player* player, Game* game)
             powerUp->active = true;
             game->ball.radius += 3;
         break;
+
+        case POWERUP_REWIND:
+            if (game->rewindCharges < PU_REWIND_MAX_CHARGES)
+            {
+                game->rewindCharges++;
+            }
+
+            powerUp->duration = PU_DEFAULT_DURATION;
+            powerUp->active = false;
+        break;
     }
 }
 
@@ -268,6 +280,7 @@ void HandlePowerUpCollisions(Game* game)
             if (!alreadyActive)
             {
                 ApplyPowerUpEffect(powerUp, &game->player, game);
+                game->telemetry.powerUpsCollected[powerUp->type]++;
                 powerUp->active = true;
                 powerUp->wasPickedUp = true;
                 game->powerUpCount--;
@@ -293,10 +306,10 @@ bool CheckPowerUpCollision(const PowerUp* powerUp, Rectangle playerRect)
 }
 
 // Our general update method. We also make sure to remove power-ups if the player misses them in the killZone!
-void UpdatePowerUps(Game* game)
+// deltaTime is one unscaled simulation tick, durations count in simulated time
+void UpdatePowerUps(Game* game, float deltaTime)
 {
-    double currentTime = GetTime();
-    float deltaTime = GetFrameTime();
+    double currentTime = game->simTime;
 
     for (int i = 0; i < PU_MAX_COUNT; i++)
     {
@@ -359,6 +372,9 @@ void UpdatePowerUps(Game* game)
                         game->ball.damageMultiplier = 1;
                         game->ball.radius -= 2;
                     break;
+
+                    default: // Life and rewind aren't timed
+                    break;
                 }
 
                 powerUp->active = false;
@@ -371,19 +387,19 @@ void UpdatePowerUps(Game* game)
 }
 
 // Draw all active powerups in Game C!
-void DrawPowerUps(Game* game)
+void RecordPowerUps(RenderCommandBuffer* commands, const Game* game)
 {
     for (int i = 0; i < PU_MAX_COUNT; i++)
     {
         if (game->powerUps[i].active && !game->powerUps[i].wasPickedUp)
         {
-            DrawPowerUp(game->powerUps[i]);
+            RecordPowerUp(commands, game->powerUps[i]);
         }
     }
 }
 
 // Draw individual powerup with appropriate icon
-void DrawPowerUp(PowerUp powerUp)
+void RecordPowerUp(RenderCommandBuffer* commands, PowerUp powerUp)
 {
     if (!powerUp.active)
     {
@@ -395,7 +411,7 @@ void DrawPowerUp(PowerUp powerUp)
     pulsingColor.a = (unsigned char)(255 * alpha);
 
     // Outer circle!
-    DrawCircleV(powerUp.position, powerUp.radius, pulsingColor);
+    PushCircle(commands, RENDER_LAYER_POWERUPS, powerUp.position, powerUp.radius, pulsingColor);
 
     // Here we try to draw an ICON for each type of power up
     const char* text;
@@ -426,6 +442,10 @@ void DrawPowerUp(PowerUp powerUp)
             text = "D";
         break;
 
+        case POWERUP_REWIND:
+            text = "R";
+        break;
+
         default:
             text = "?";
         break;
@@ -441,7 +461,7 @@ void DrawPowerUp(PowerUp powerUp)
         powerUp.position.y - textHeight / 2
     );
 
-    DrawText(text, textPosition.x, textPosition.y, fontSize, BLACK);
+    PushText(commands, RENDER_LAYER_POWERUP_GLYPHS, text, textPosition.x, textPosition.y, fontSize, BLACK);
 }
 
 // To display our power ups, we're drawing a timer for each type as an indictator
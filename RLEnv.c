@@ -0,0 +1,445 @@
+﻿#include "RLEnv.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FastForward.h"
+#include "Game.h"
+#include "SoftRenderer.h"
+#include "Timing.h"
+
+// One slice of the games per thread. Slice 0 is the calling thread's
+typedef struct RLWorker
+{
+    RLEnv* env;
+    pthread_t thread;
+    int first;
+    int last;           // Exclusive
+    int core;
+} RLWorker;
+
+// What an episode needs remembered between steps
+typedef struct RLEpisode
+{
+    uint64_t number;
+    int steps;
+    int score;
+    int lives;
+} RLEpisode;
+
+struct RLEnv
+{
+    RLEnvConfig config;
+    RLEnvBuffers buffers;
+    Game* games;
+    RLEpisode* episodes;
+
+    RLWorker workers[RL_ENV_MAX_THREADS];
+    int threadCount;
+    bool resetting;         // What the current batch is, set before it's handed out
+
+    pthread_mutex_t mutex;  // Only for sleeping workers, the hand-off itself is the two atomics
+    pthread_cond_t wake;
+    atomic_int batch;       // Bumped for every reset and step
+    atomic_int busy;        // Workers still playing the current batch
+    atomic_bool quit;
+};
+
+// Every game gets its own levels each episode, the same ones for the same seed whatever the thread count
+static uint64_t GetEpisodeSeed(const RLEnv* env, int index, uint64_t episode)
+{
+    uint64_t seed = env->config.seed ^ ((uint64_t)index * 0x9E3779B97F4A7C15ull) ^ (episode * 0xD1B54A32D192ED03ull);
+
+    // SplitMix64's finaliser, neighbouring games shouldn't get neighbouring seeds
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ull;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBull;
+    seed ^= seed >> 31;
+
+    return seed != 0 ? seed : 1; // 0 means a random seed to ResetGame
+}
+
+static SimInput GetActionInput(int32_t action)
+{
+    SimInput input = {0};
+
+    switch (action)
+    {
+        case RL_ACTION_LEFT:
+        case RL_ACTION_DASH_LEFT:
+        case RL_ACTION_RIGHT:
+        case RL_ACTION_DASH_RIGHT:
+            input.dashing = action == RL_ACTION_DASH_LEFT || action == RL_ACTION_DASH_RIGHT;
+            input.dash = input.dashing;
+            input.left = action == RL_ACTION_LEFT || action == RL_ACTION_DASH_LEFT;
+            input.right = !input.left;
+            input.moving = true;
+            input.moveSeconds = (input.left ? -SIM_DT : SIM_DT) * (input.dashing ? PLAYER_SPEED_BOOST : 1.0f);
+            break;
+        case RL_ACTION_LAUNCH:
+            input.launch = true;
+            break;
+        default:
+            break;
+    }
+
+    return input;
+}
+
+static void WriteObservation(const Game* game, RLObservation* observation)
+{
+    float width = (float)game->screenWidth;
+    float height = (float)game->screenHeight;
+
+    memset(observation, 0, sizeof(*observation));
+
+    observation->ballX = game->ball.position.x / width;
+    observation->ballY = game->ball.position.y / height;
+    observation->ballDirectionX = game->ball.direction.x;
+    observation->ballDirectionY = game->ball.direction.y;
+    observation->ballSpeed = game->ball.speed / BALL_SPEED_MAX;
+    observation->ballInPlay = game->ball.active ? 1.0f : 0.0f;
+    observation->paddleX = (game->player.position.x + game->player.width / 2.0f) / width;
+    observation->paddleWidth = game->player.width / width;
+    observation->lives = (float)game->player.lives;
+    observation->level = (float)game->currentLevel;
+    observation->blockRows = (float)game->currentBlockRows;
+    observation->blockColumns = (float)game->currentBlockColumns;
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        const PowerUp* powerUp = &game->powerUps[i];
+
+        if (!powerUp->active || powerUp->type >= POWERUP_COUNT)
+        {
+            continue;
+        }
+
+        if (powerUp->wasPickedUp)
+        {
+            observation->effects[powerUp->type] = powerUp->remainingDuration;
+            continue;
+        }
+
+        observation->fallingPowerUps[i][0] = powerUp->position.x / width;
+        observation->fallingPowerUps[i][1] = powerUp->position.y / height;
+        observation->fallingPowerUps[i][2] = (float)(powerUp->type + 1);
+    }
+
+    observation->effects[POWERUP_REWIND] = (float)game->rewindCharges;
+
+    for (int row = 0; row < game->currentBlockRows; row++)
+    {
+        for (int col = 0; col < game->currentBlockColumns; col++)
+        {
+            const Block* block = &game->blocks[row][col];
+            int bit = row * BLOCK_GRID_COLUMNS + col;
+
+            if (block->active)
+            {
+                observation->blocks[bit / 32] |= 1u << (bit % 32);
+
+                if (block->type == BLOCK_SOLID)
+                {
+                    observation->solidBlocks[bit / 32] |= 1u << (bit % 32);
+                }
+            }
+        }
+    }
+}
+
+static void WriteGameOutput(RLEnv* env, int index)
+{
+    WriteObservation(&env->games[index], &env->buffers.observations[index]);
+
+    if (env->buffers.frames != NULL)
+    {
+        size_t frameSize = (size_t)env->config.frameWidth * env->config.frameHeight;
+        SoftFramebuffer frame =
+        {
+            .pixels = (Color*)env->buffers.frames + (size_t)index * frameSize,
+            .width = env->config.frameWidth,
+            .height = env->config.frameHeight
+        };
+
+        RenderGameSoftware(&env->games[index], &frame);
+    }
+}
+
+static void BeginEpisode(RLEnv* env, int index)
+{
+    Game* game = &env->games[index];
+    RLEpisode* episode = &env->episodes[index];
+
+    episode->number++;
+    game->endless = !env->config.campaign;
+    game->fixedLevelSeed = GetEpisodeSeed(env, index, episode->number);
+    ResetGame(game);
+
+    episode->steps = 0;
+    episode->score = game->player.score;
+    episode->lives = game->player.lives;
+}
+
+static void StepGame(RLEnv* env, int index)
+{
+    Game* game = &env->games[index];
+    RLEpisode* episode = &env->episodes[index];
+    SimInput input = GetActionInput(env->buffers.actions[index]);
+    int ticks = env->config.ticksPerStep;
+    int done = 0;
+
+    while (done < ticks && game->state == PLAYING)
+    {
+        done += FastForwardSimulation(game, &input, ticks - done, NULL);
+
+        // The level bonus counts towards this step's reward
+        if (game->state == LEVEL_COMPLETE)
+        {
+            LoadNextLevel(game);
+        }
+    }
+
+    int livesLost = episode->lives - game->player.lives;
+    float reward = (float)(game->player.score - episode->score) / BASE_SCORE;
+
+    env->buffers.rewards[index] = reward - (livesLost > 0 ? livesLost * RL_LIFE_PENALTY : 0.0f);
+    episode->score = game->player.score;
+    episode->lives = game->player.lives;
+    episode->steps++;
+
+    uint8_t outcome = RL_RUNNING;
+
+    if (game->state == GAME_OVER || game->state == WIN)
+    {
+        outcome = RL_TERMINATED;
+    }
+    else if (env->config.maxEpisodeSteps > 0 && episode->steps >= env->config.maxEpisodeSteps)
+    {
+        outcome = RL_TRUNCATED;
+    }
+
+    env->buffers.dones[index] = outcome;
+
+    if (outcome != RL_RUNNING)
+    {
+        BeginEpisode(env, index);
+    }
+
+    WriteGameOutput(env, index);
+}
+
+static void RunSlice(RLEnv* env, const RLWorker* worker)
+{
+    for (int i = worker->first; i < worker->last; i++)
+    {
+        if (env->resetting)
+        {
+            BeginEpisode(env, i);
+            env->buffers.rewards[i] = 0.0f;
+            env->buffers.dones[i] = RL_RUNNING;
+            WriteGameOutput(env, i);
+        }
+        else
+        {
+            StepGame(env, i);
+        }
+    }
+}
+
+/* The next batch usually comes right after the policy has run, so spin a while before sleeping.
+ * Bumping the batch number happens under the mutex, so one that lands as we go to sleep isn't missed. */
+static int WaitForBatch(RLEnv* env, int seen)
+{
+    for (int spin = 0; spin < RL_ENV_SPIN_COUNT; spin++)
+    {
+        if (atomic_load(&env->batch) != seen || atomic_load(&env->quit))
+        {
+            return atomic_load(&env->batch);
+        }
+
+        SpinPause();
+    }
+
+    pthread_mutex_lock(&env->mutex);
+
+    while (atomic_load(&env->batch) == seen && !atomic_load(&env->quit))
+    {
+        pthread_cond_wait(&env->wake, &env->mutex);
+    }
+
+    pthread_mutex_unlock(&env->mutex);
+
+    return atomic_load(&env->batch);
+}
+
+static void* WorkerMain(void* argument)
+{
+    RLWorker* worker = argument;
+    RLEnv* env = worker->env;
+    int seen = 0;
+
+    if (env->config.pinThreads && !PinThreadToCore(worker->core))
+    {
+        printf("Couldn't pin an environment worker to core %d\n", worker->core);
+    }
+
+    while (true)
+    {
+        seen = WaitForBatch(env, seen);
+
+        if (atomic_load(&env->quit))
+        {
+            break;
+        }
+
+        RunSlice(env, worker);
+        atomic_fetch_sub(&env->busy, 1);
+    }
+
+    return NULL;
+}
+
+// Hands the batch out, plays the caller's own slice, and returns once every game has been through it
+static void RunBatch(RLEnv* env, bool resetting)
+{
+    env->resetting = resetting;
+    atomic_store(&env->busy, env->threadCount - 1);
+
+    pthread_mutex_lock(&env->mutex);
+    atomic_fetch_add(&env->batch, 1);
+    pthread_cond_broadcast(&env->wake);
+    pthread_mutex_unlock(&env->mutex);
+
+    RunSlice(env, &env->workers[0]);
+
+    while (atomic_load(&env->busy) > 0)
+    {
+        SpinPause();
+    }
+}
+
+static void StopWorkers(RLEnv* env, int started)
+{
+    pthread_mutex_lock(&env->mutex);
+    atomic_store(&env->quit, true);
+    pthread_cond_broadcast(&env->wake);
+    pthread_mutex_unlock(&env->mutex);
+
+    for (int i = 1; i < started; i++)
+    {
+        pthread_join(env->workers[i].thread, NULL);
+    }
+}
+
+RLEnv* CreateRLEnv(const RLEnvConfig* config, const RLEnvBuffers* buffers)
+{
+    if (config->envCount <= 0 || buffers->actions == NULL || buffers->observations == NULL ||
+        buffers->rewards == NULL || buffers->dones == NULL)
+    {
+        printf("CreateRLEnv needs at least one game, and actions, observations, rewards and dones buffers\n");
+        return NULL;
+    }
+
+    RLEnv* env = calloc(1, sizeof(RLEnv));
+
+    if (env == NULL)
+    {
+        return NULL;
+    }
+
+    env->config = *config;
+    env->buffers = *buffers;
+    env->config.ticksPerStep = config->ticksPerStep > 0 ? config->ticksPerStep : RL_DEFAULT_TICKS_PER_STEP;
+    env->config.screenWidth = config->screenWidth > 0 ? config->screenWidth : RL_DEFAULT_WIDTH;
+    env->config.screenHeight = config->screenHeight > 0 ? config->screenHeight : RL_DEFAULT_HEIGHT;
+    env->config.frameWidth = config->frameWidth > 0 ? config->frameWidth : RL_DEFAULT_FRAME_WIDTH;
+    env->config.frameHeight = config->frameHeight > 0 ? config->frameHeight : RL_DEFAULT_FRAME_HEIGHT;
+
+    int threads = config->threadCount > 0 ? config->threadCount : GetCoreCount();
+    threads = threads < RL_ENV_MAX_THREADS ? threads : RL_ENV_MAX_THREADS;
+    env->threadCount = threads < config->envCount ? threads : config->envCount;
+
+    env->games = calloc(config->envCount, sizeof(Game));
+    env->episodes = calloc(config->envCount, sizeof(RLEpisode));
+
+    if (env->games == NULL || env->episodes == NULL)
+    {
+        free(env->games);
+        free(env->episodes);
+        free(env);
+        return NULL;
+    }
+
+    for (int i = 0; i < config->envCount; i++)
+    {
+        // Game has a const member, so no plain assignment
+        Game game = InitHeadlessGame(env->config.screenWidth, env->config.screenHeight);
+
+        // Headless, nothing ever clears the sparks away, they'd fill all 2.7 MB of them in every game
+        UnloadParticleSystem(&game.particles);
+        memcpy(&env->games[i], &game, sizeof(Game));
+    }
+
+    pthread_mutex_init(&env->mutex, NULL);
+    pthread_cond_init(&env->wake, NULL);
+
+    // Contiguous slices, so neighbouring threads only ever share the cache lines at the edges
+    for (int i = 0; i < env->threadCount; i++)
+    {
+        RLWorker* worker = &env->workers[i];
+        worker->env = env;
+        worker->first = (int)((long long)config->envCount * i / env->threadCount);
+        worker->last = (int)((long long)config->envCount * (i + 1) / env->threadCount);
+        worker->core = i % GetCoreCount();
+    }
+
+    for (int i = 1; i < env->threadCount; i++)
+    {
+        if (pthread_create(&env->workers[i].thread, NULL, WorkerMain, &env->workers[i]) != 0)
+        {
+            printf("Failed to start environment worker %d\n", i);
+            StopWorkers(env, i);
+            env->threadCount = i; // So DestroyRLEnv doesn't join them again
+            DestroyRLEnv(env);
+            return NULL;
+        }
+    }
+
+    return env;
+}
+
+void DestroyRLEnv(RLEnv* env)
+{
+    if (env == NULL)
+    {
+        return;
+    }
+
+    if (!atomic_load(&env->quit))
+    {
+        StopWorkers(env, env->threadCount);
+    }
+
+    for (int i = 0; i < env->config.envCount; i++)
+    {
+        UnloadParticleSystem(&env->games[i].particles);
+    }
+
+    pthread_cond_destroy(&env->wake);
+    pthread_mutex_destroy(&env->mutex);
+
+    free(env->games);
+    free(env->episodes);
+    free(env);
+}
+
+void ResetRLEnv(RLEnv* env)
+{
+    RunBatch(env, true);
+}
+
+void StepRLEnv(RLEnv* env)
+{
+    RunBatch(env, false);
+}
@@ -0,0 +1,100 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RLEnv.h"
+#include "Timing.h"
+
+/* How many environment steps a second PaddleEnv manages, with random actions standing in for a policy.
+ *   RLEnvBench [games] [threads] [seconds] [frames]
+ * threads 0 is one per core. frames 1 renders the low-res frames as well. */
+
+#define BENCH_DEFAULT_GAMES 4096
+#define BENCH_DEFAULT_SECONDS 5.0
+#define BENCH_TARGET_STEPS 1000000.0    // A second
+
+int main(int argc, char** argv)
+{
+    int games = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_GAMES;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    double seconds = argc > 3 ? atof(argv[3]) : BENCH_DEFAULT_SECONDS;
+    bool frames = argc > 4 && atoi(argv[4]) != 0;
+
+    if (games <= 0 || threads < 0 || seconds <= 0.0)
+    {
+        printf("Usage: %s [games] [threads] [seconds] [frames]\n", argv[0]);
+        return 1;
+    }
+
+    // What a trainer would put in shared memory
+    RLEnvBuffers buffers =
+    {
+        .actions = calloc(games, sizeof(int32_t)),
+        .observations = calloc(games, sizeof(RLObservation)),
+        .rewards = calloc(games, sizeof(float)),
+        .dones = calloc(games, sizeof(uint8_t)),
+        .frames = frames ? calloc(games, RL_DEFAULT_FRAME_WIDTH * RL_DEFAULT_FRAME_HEIGHT * sizeof(Color)) : NULL
+    };
+
+    RLEnvConfig config =
+    {
+        .envCount = games,
+        .threadCount = threads,
+        .seed = 1,
+        .pinThreads = true
+    };
+
+    RLEnv* env = CreateRLEnv(&config, &buffers);
+
+    if (env == NULL)
+    {
+        return 1;
+    }
+
+    int32_t* actions = (int32_t*)buffers.actions;
+    uint32_t random = 12345;
+    long long steps = 0;
+    long long episodes = 0;
+    double reward = 0.0;
+
+    ResetRLEnv(env);
+
+    double start = GetPreciseTime();
+    double elapsed = 0.0;
+
+    while (elapsed < seconds)
+    {
+        for (int i = 0; i < games; i++)
+        {
+            // Any action, launch included, so balls that get lost come back into play
+            random = random * 1664525u + 1013904223u;
+            actions[i] = (int32_t)((random >> 16) % RL_ACTION_COUNT);
+        }
+
+        StepRLEnv(env);
+
+        for (int i = 0; i < games; i++)
+        {
+            episodes += buffers.dones[i] != RL_RUNNING ? 1 : 0;
+            reward += buffers.rewards[i];
+        }
+
+        steps += games;
+        elapsed = GetPreciseTime() - start;
+    }
+
+    double rate = steps / elapsed;
+
+    printf("%d games, %s: %lld steps in %.2f s = %.0f steps/s (target %.0f: %s)\n",
+           games, frames ? "with frames" : "no frames", steps, elapsed, rate, BENCH_TARGET_STEPS,
+           rate >= BENCH_TARGET_STEPS ? "OK" : "TOO SLOW");
+    printf("  %lld episodes finished, mean reward per step %.3f\n", episodes, steps > 0 ? reward / steps : 0.0);
+
+    DestroyRLEnv(env);
+    free(actions);
+    free(buffers.observations);
+    free(buffers.rewards);
+    free(buffers.dones);
+    free(buffers.frames);
+
+    return rate >= BENCH_TARGET_STEPS ? 0 : 1;
+}
@@ -0,0 +1,474 @@
+﻿#include "RenderCommands.h"
+#include <math.h>
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <string.h>
+
+void ClearRenderCommands(RenderCommandBuffer* buffer)
+{
+    buffer->count = 0;
+    buffer->textUsed = 0;
+    buffer->ribbonPointsUsed = 0;
+    buffer->droppedCount = 0;
+    buffer->sorted = false;
+}
+
+/* Sort key, most significant first: layer (8 bits), texture (24 bits), then the command's own index,
+ * which keeps the sort stable and is all we need to find the command again afterwards. */
+static RenderCommand* AddCommand(RenderCommandBuffer* buffer, RenderLayer layer, RenderCommandType type, unsigned int texture)
+{
+    if (buffer->count >= RENDER_MAX_COMMANDS)
+    {
+        buffer->droppedCount++;
+        return NULL;
+    }
+
+    int index = buffer->count++;
+    RenderCommand* command = &buffer->commands[index];
+
+    command->type = type;
+    command->texture = texture;
+    buffer->keys[index] = ((unsigned long long)(layer & 0xFF) << 56) |
+                          ((unsigned long long)(texture & 0xFFFFFF) << 32) |
+                          (unsigned long long)index;
+    buffer->sorted = false;
+
+    return command;
+}
+
+void PushRectangle(RenderCommandBuffer* buffer, RenderLayer layer, int x, int y, int width, int height, Color color)
+{
+    RenderCommand* command = AddCommand(buffer, layer, RENDER_RECTANGLE, GetShapesTexture().id);
+
+    if (command != NULL)
+    {
+        command->color = color;
+        command->rectangle = (Rectangle){ (float)x, (float)y, (float)width, (float)height };
+    }
+}
+
+void PushRectangleLines(RenderCommandBuffer* buffer, RenderLayer layer, int x, int y, int width, int height, Color color)
+{
+    RenderCommand* command = AddCommand(buffer, layer, RENDER_RECTANGLE_LINES, GetShapesTexture().id);
+
+    if (command != NULL)
+    {
+        command->color = color;
+        command->rectangle = (Rectangle){ (float)x, (float)y, (float)width, (float)height };
+    }
+}
+
+void PushCircle(RenderCommandBuffer* buffer, RenderLayer layer, Vector2 center, float radius, Color color)
+{
+    RenderCommand* command = AddCommand(buffer, layer, RENDER_CIRCLE, GetShapesTexture().id);
+
+    if (command != NULL)
+    {
+        command->color = color;
+        command->circle.center = center;
+        command->circle.radius = radius;
+    }
+}
+
+// The text is copied, the caller's string can go away straight after
+void PushText(RenderCommandBuffer* buffer, RenderLayer layer, const char* text, int x, int y, int fontSize, Color color)
+{
+    int length = (int)strlen(text) + 1;
+
+    if (buffer->textUsed + length > RENDER_MAX_TEXT)
+    {
+        buffer->droppedCount++;
+        return;
+    }
+
+    RenderCommand* command = AddCommand(buffer, layer, RENDER_TEXT, GetFontDefault().texture.id);
+
+    if (command != NULL)
+    {
+        command->color = color;
+        command->text.position = (Vector2){ (float)x, (float)y };
+        command->text.fontSize = fontSize;
+        command->text.textOffset = buffer->textUsed;
+
+        memcpy(&buffer->text[buffer->textUsed], text, length);
+        buffer->textUsed += length;
+    }
+}
+
+void PushTexture(RenderCommandBuffer* buffer, RenderLayer layer, Texture2D texture, Rectangle source, Rectangle dest, Color tint)
+{
+    RenderCommand* command = AddCommand(buffer, layer, RENDER_TEXTURE, texture.id);
+
+    if (command != NULL)
+    {
+        command->color = tint;
+        command->blit.texture = texture;
+        command->blit.source = source;
+        command->blit.dest = dest;
+    }
+}
+
+void PushCustom(RenderCommandBuffer* buffer, RenderLayer layer, RenderCallback draw, const void* data)
+{
+    RenderCommand* command = AddCommand(buffer, layer, RENDER_CUSTOM, 0);
+
+    if (command != NULL)
+    {
+        command->custom.draw = draw;
+        command->custom.data = data;
+    }
+}
+
+void PushRibbon(RenderCommandBuffer* buffer, RenderLayer layer, const RibbonPoint* points, int count)
+{
+    if (count < 2)
+    {
+        return;
+    }
+
+    if (buffer->ribbonPointsUsed + count > RENDER_MAX_RIBBON_POINTS)
+    {
+        buffer->droppedCount++;
+        return;
+    }
+
+    RenderCommand* command = AddCommand(buffer, layer, RENDER_RIBBON, GetShapesTexture().id);
+
+    if (command != NULL)
+    {
+        command->ribbon.pointOffset = buffer->ribbonPointsUsed;
+        command->ribbon.pointCount = count;
+
+        memcpy(&buffer->ribbonPoints[buffer->ribbonPointsUsed], points, count * sizeof(RibbonPoint));
+        buffer->ribbonPointsUsed += count;
+    }
+}
+
+static int CompareKeys(const void* a, const void* b)
+{
+    unsigned long long left = *(const unsigned long long*)a;
+    unsigned long long right = *(const unsigned long long*)b;
+
+    return (left > right) - (left < right);
+}
+
+void SortRenderCommands(RenderCommandBuffer* buffer)
+{
+    if (!buffer->sorted)
+    {
+        qsort(buffer->keys, buffer->count, sizeof(buffer->keys[0]), CompareKeys);
+        buffer->sorted = true;
+    }
+}
+
+// One textured quad, in the same corner order as raylib's own (top-left, bottom-left, bottom-right, top-right)
+static void EmitQuad(Rectangle dest, float u0, float v0, float u1, float v1)
+{
+    rlTexCoord2f(u0, v0);
+    rlVertex2f(dest.x, dest.y);
+
+    rlTexCoord2f(u0, v1);
+    rlVertex2f(dest.x, dest.y + dest.height);
+
+    rlTexCoord2f(u1, v1);
+    rlVertex2f(dest.x + dest.width, dest.y + dest.height);
+
+    rlTexCoord2f(u1, v0);
+    rlVertex2f(dest.x + dest.width, dest.y);
+}
+
+// Like DrawCircleV in quads mode: each quad is the centre plus two segments of the rim
+static void EmitCircle(Vector2 center, float radius, Rectangle shapesUV)
+{
+    const float step = 360.0f / RENDER_CIRCLE_SEGMENTS;
+    float angle = 0.0f;
+
+    for (int i = 0; i < RENDER_CIRCLE_SEGMENTS / 2; i++)
+    {
+        rlTexCoord2f(shapesUV.x, shapesUV.y);
+        rlVertex2f(center.x, center.y);
+
+        rlTexCoord2f(shapesUV.x + shapesUV.width, shapesUV.y);
+        rlVertex2f(center.x + cosf(DEG2RAD * (angle + step * 2.0f)) * radius,
+                   center.y + sinf(DEG2RAD * (angle + step * 2.0f)) * radius);
+
+        rlTexCoord2f(shapesUV.x + shapesUV.width, shapesUV.y + shapesUV.height);
+        rlVertex2f(center.x + cosf(DEG2RAD * (angle + step)) * radius,
+                   center.y + sinf(DEG2RAD * (angle + step)) * radius);
+
+        rlTexCoord2f(shapesUV.x, shapesUV.y + shapesUV.height);
+        rlVertex2f(center.x + cosf(DEG2RAD * angle) * radius,
+                   center.y + sinf(DEG2RAD * angle) * radius);
+
+        angle += step * 2.0f;
+    }
+}
+
+// DrawText's layout (DrawTextEx + DrawTextCodepoint), but only the quads: the batch is already ours
+static void EmitText(const char* text, Vector2 position, int fontSize, Font font)
+{
+    const int defaultFontSize = 10;
+
+    if (fontSize < defaultFontSize)
+    {
+        fontSize = defaultFontSize;
+    }
+
+    float spacing = (float)(fontSize / defaultFontSize);
+    float scale = (float)fontSize / font.baseSize;
+    float padding = (float)font.glyphPadding;
+    float offsetX = 0.0f;
+    float offsetY = 0.0f;
+
+    for (int i = 0; text[i] != '\0';)
+    {
+        int codepointSize = 0;
+        int codepoint = GetCodepointNext(&text[i], &codepointSize);
+        int index = GetGlyphIndex(font, codepoint);
+
+        i += codepointSize;
+
+        if (codepoint == '\n')
+        {
+            offsetY += fontSize + RENDER_TEXT_LINE_SPACING;
+            offsetX = 0.0f;
+            continue;
+        }
+
+        Rectangle glyph = font.recs[index];
+
+        if (codepoint != ' ' && codepoint != '\t')
+        {
+            Rectangle dest =
+            {
+                position.x + offsetX + (font.glyphs[index].offsetX - padding) * scale,
+                position.y + offsetY + (font.glyphs[index].offsetY - padding) * scale,
+                (glyph.width + 2.0f * padding) * scale,
+                (glyph.height + 2.0f * padding) * scale
+            };
+
+            EmitQuad(dest,
+                     (glyph.x - padding) / font.texture.width,
+                     (glyph.y - padding) / font.texture.height,
+                     (glyph.x + glyph.width + padding) / font.texture.width,
+                     (glyph.y + glyph.height + padding) / font.texture.height);
+        }
+
+        float advance = font.glyphs[index].advanceX != 0 ? (float)font.glyphs[index].advanceX : glyph.width;
+        offsetX += advance * scale + spacing;
+    }
+}
+
+/* Each point's edge goes across the spine, along the average of the segments either side, so neighbouring
+ * quads share their edge exactly. Corners come out in EmitQuad's winding whichever way the path runs */
+static void EmitRibbon(const RibbonPoint* points, int count, Rectangle shapesUV)
+{
+    Vector2 previousLeft = {0};
+    Vector2 previousRight = {0};
+    Color previousColor = {0};
+
+    for (int i = 0; i < count; i++)
+    {
+        Vector2 before = points[i > 0 ? i - 1 : i].position;
+        Vector2 after = points[i < count - 1 ? i + 1 : i].position;
+        Vector2 tangent = Vector2Subtract(after, before);
+
+        // Doubling straight back (a bounce) cancels out, the segment behind still has a direction
+        if (Vector2LengthSqr(tangent) < 0.0001f && i > 0)
+        {
+            tangent = Vector2Subtract(points[i].position, points[i - 1].position);
+        }
+
+        tangent = Vector2Normalize(tangent);
+
+        Vector2 across = { -tangent.y * points[i].halfWidth, tangent.x * points[i].halfWidth };
+        Vector2 left = Vector2Subtract(points[i].position, across);
+        Vector2 right = Vector2Add(points[i].position, across);
+        Color color = points[i].color;
+
+        if (i > 0)
+        {
+            rlColor4ub(previousColor.r, previousColor.g, previousColor.b, previousColor.a);
+            rlTexCoord2f(shapesUV.x, shapesUV.y);
+            rlVertex2f(previousLeft.x, previousLeft.y);
+
+            rlTexCoord2f(shapesUV.x, shapesUV.y + shapesUV.height);
+            rlVertex2f(previousRight.x, previousRight.y);
+
+            rlColor4ub(color.r, color.g, color.b, color.a);
+            rlTexCoord2f(shapesUV.x + shapesUV.width, shapesUV.y + shapesUV.height);
+            rlVertex2f(right.x, right.y);
+
+            rlTexCoord2f(shapesUV.x + shapesUV.width, shapesUV.y);
+            rlVertex2f(left.x, left.y);
+        }
+
+        previousLeft = left;
+        previousRight = right;
+        previousColor = color;
+    }
+}
+
+// DrawTexturePro with no origin or rotation. A negative source width/height flips, like raylib
+static void EmitTexture(const RenderCommand* command)
+{
+    Texture2D texture = command->blit.texture;
+    Rectangle source = command->blit.source;
+    bool flipX = false;
+
+    if (source.width < 0)
+    {
+        flipX = true;
+        source.width *= -1;
+    }
+
+    if (source.height < 0)
+    {
+        source.y -= source.height;
+    }
+
+    float u0 = source.x / texture.width;
+    float u1 = (source.x + source.width) / texture.width;
+    float v0 = source.y / texture.height;
+    float v1 = (source.y + source.height) / texture.height;
+
+    if (flipX)
+    {
+        float swap = u0;
+        u0 = u1;
+        u1 = swap;
+    }
+
+    EmitQuad(command->blit.dest, u0, v0, u1, v1);
+}
+
+void SubmitRenderCommands(RenderCommandBuffer* buffer)
+{
+    SortRenderCommands(buffer);
+
+    Texture2D shapesTexture = GetShapesTexture();
+    Rectangle shapesRect = GetShapesTextureRectangle();
+    Rectangle shapesUV =
+    {
+        shapesRect.x / shapesTexture.width,
+        shapesRect.y / shapesTexture.height,
+        shapesRect.width / shapesTexture.width,
+        shapesRect.height / shapesTexture.height
+    };
+    Font font = GetFontDefault();
+
+    bool inBatch = false;
+    unsigned int batchTexture = 0;
+
+    buffer->submittedCount = buffer->count;
+    buffer->batchCount = 0;
+
+    for (int i = 0; i < buffer->count; i++)
+    {
+        const RenderCommand* command = &buffer->commands[buffer->keys[i] & 0xFFFFFFFFu];
+
+        if (command->type == RENDER_CUSTOM)
+        {
+            if (inBatch)
+            {
+                rlEnd();
+                rlSetTexture(0);
+                inBatch = false;
+            }
+
+            command->custom.draw(command->custom.data);
+            buffer->batchCount++;
+            continue;
+        }
+
+        // A new batch only when the texture changes. rlgl flushes on its own if the vertex buffer fills up
+        if (!inBatch || command->texture != batchTexture)
+        {
+            if (inBatch)
+            {
+                rlEnd();
+            }
+
+            rlSetTexture(command->texture);
+            rlBegin(RL_QUADS);
+            rlNormal3f(0.0f, 0.0f, 1.0f);
+
+            batchTexture = command->texture;
+            inBatch = true;
+            buffer->batchCount++;
+        }
+
+        Color color = command->color;
+        rlColor4ub(color.r, color.g, color.b, color.a);
+
+        switch (command->type)
+        {
+            case RENDER_RECTANGLE:
+                EmitQuad(command->rectangle, shapesUV.x, shapesUV.y,
+                         shapesUV.x + shapesUV.width, shapesUV.y + shapesUV.height);
+            break;
+
+            case RENDER_RECTANGLE_LINES:
+            {
+                Rectangle r = command->rectangle;
+                Rectangle sides[4] =
+                {
+                    { r.x, r.y, r.width, 1.0f },                            // Top
+                    { r.x, r.y + r.height - 1.0f, r.width, 1.0f },          // Bottom
+                    { r.x, r.y + 1.0f, 1.0f, r.height - 2.0f },             // Left
+                    { r.x + r.width - 1.0f, r.y + 1.0f, 1.0f, r.height - 2.0f } // Right
+                };
+
+                for (int side = 0; side < 4; side++)
+                {
+                    EmitQuad(sides[side], shapesUV.x, shapesUV.y,
+                             shapesUV.x + shapesUV.width, shapesUV.y + shapesUV.height);
+                }
+            } break;
+
+            case RENDER_CIRCLE:
+                EmitCircle(command->circle.center, command->circle.radius, shapesUV);
+            break;
+
+            case RENDER_TEXT:
+                EmitText(&buffer->text[command->text.textOffset], command->text.position, command->text.fontSize, font);
+            break;
+
+            case RENDER_TEXTURE:
+                EmitTexture(command);
+            break;
+
+            case RENDER_RIBBON:
+                EmitRibbon(&buffer->ribbonPoints[command->ribbon.pointOffset], command->ribbon.pointCount, shapesUV);
+            break;
+
+            default:
+            break;
+        }
+    }
+
+    if (inBatch)
+    {
+        rlEnd();
+        rlSetTexture(0);
+    }
+}
+
+// F3 overlay: how well the sort is doing
+void DrawRenderStats(const RenderCommandBuffer* buffer, int x, int y)
+{
+    const int fontSize = 20;
+
+    DrawRectangle(x - 10, y - 10, 560, (fontSize + 6) + 14, ColorAlpha(BLACK, 0.7f));
+    if (buffer->droppedCount > 0)
+    {
+        DrawText(TextFormat("Render: %d commands in %d batches, %d dropped",
+                            buffer->submittedCount, buffer->batchCount, buffer->droppedCount), x, y, fontSize, RED);
+    }
+    else
+    {
+        DrawText(TextFormat("Render: %d commands in %d batches", buffer->submittedCount, buffer->batchCount),
+                 x, y, fontSize, WHITE);
+    }
+}
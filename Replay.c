@@ -0,0 +1,908 @@
+﻿#include "Replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FastForward.h"
+#include "IOWorker.h"
+#include "Level.h"
+
+_Static_assert(sizeof(ReplayHeader) == 64, "Replay header layout changed");
+
+typedef struct ByteBuffer
+{
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} ByteBuffer;
+
+// Like the other subsystems, there's only ever one recording going on
+static struct
+{
+    bool recording;
+    int screenWidth;
+    int screenHeight;
+    uint32_t levelPackChecksum;
+
+    ReplayInput* inputs;
+    int tickCount;
+    int inputCapacity;
+
+    ReplayKeyframe* keyframes;  // Offsets get filled in when encoding
+    GameSnapshot* snapshots;
+    int keyframeCount;
+    int keyframeCapacity;
+} recorder;
+
+static uint32_t HashReplayBytes(const unsigned char* bytes, size_t size)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+ReplayInput PackReplayInput(const SimInput* input)
+{
+    ReplayInput packed = { .moveSeconds = input->moveSeconds };
+
+    // The rewind key never reaches StepSimulation, so it isn't stored
+    packed.flags |= input->moveSeconds != 0.0f ? REPLAY_INPUT_MOVE : 0;
+    packed.flags |= input->moving ? REPLAY_INPUT_MOVING : 0;
+    packed.flags |= input->dashing ? REPLAY_INPUT_DASHING : 0;
+    packed.flags |= input->launch ? REPLAY_INPUT_LAUNCH : 0;
+    packed.flags |= input->launchSteer < 0 ? REPLAY_INPUT_STEER_LEFT : 0;
+    packed.flags |= input->launchSteer > 0 ? REPLAY_INPUT_STEER_RIGHT : 0;
+    packed.flags |= input->left ? REPLAY_INPUT_LEFT : 0;
+    packed.flags |= input->right ? REPLAY_INPUT_RIGHT : 0;
+    packed.flags |= input->dash ? REPLAY_INPUT_DASH : 0;
+
+    return packed;
+}
+
+SimInput UnpackReplayInput(uint32_t flags, float moveSeconds)
+{
+    return (SimInput)
+    {
+        .moveSeconds = (flags & REPLAY_INPUT_MOVE) ? moveSeconds : 0.0f,
+        .moving = (flags & REPLAY_INPUT_MOVING) != 0,
+        .dashing = (flags & REPLAY_INPUT_DASHING) != 0,
+        .launch = (flags & REPLAY_INPUT_LAUNCH) != 0,
+        .launchSteer = (flags & REPLAY_INPUT_STEER_LEFT) ? -1 : ((flags & REPLAY_INPUT_STEER_RIGHT) ? 1 : 0),
+        .left = (flags & REPLAY_INPUT_LEFT) != 0,
+        .right = (flags & REPLAY_INPUT_RIGHT) != 0,
+        .dash = (flags & REPLAY_INPUT_DASH) != 0
+    };
+}
+
+static bool SameInput(const ReplayInput* a, const ReplayInput* b)
+{
+    return a->flags == b->flags && memcmp(&a->moveSeconds, &b->moveSeconds, sizeof(float)) == 0;
+}
+
+static bool GrowArray(void** array, int* capacity, int needed, size_t elementSize)
+{
+    if (needed <= *capacity)
+    {
+        return true;
+    }
+
+    int newCapacity = *capacity > 0 ? *capacity * 2 : 1024;
+    void* grown = realloc(*array, (size_t)newCapacity * elementSize);
+
+    if (grown == NULL)
+    {
+        return false;
+    }
+
+    *array = grown;
+    *capacity = newCapacity;
+
+    return true;
+}
+
+static void StopRecording(const char* reason)
+{
+    printf("Replay recording stopped: %s\n", reason);
+    recorder.recording = false;
+}
+
+static void AddKeyframe(const Game* game, uint32_t flags)
+{
+    int capacity = recorder.keyframeCapacity;
+
+    if (!GrowArray((void**)&recorder.keyframes, &recorder.keyframeCapacity, recorder.keyframeCount + 1, sizeof(ReplayKeyframe)))
+    {
+        StopRecording("out of memory");
+        return;
+    }
+
+    // Both arrays share one capacity, so the snapshots follow along by hand
+    if (recorder.keyframeCapacity != capacity)
+    {
+        GameSnapshot* snapshots = realloc(recorder.snapshots, (size_t)recorder.keyframeCapacity * sizeof(GameSnapshot));
+
+        if (snapshots == NULL)
+        {
+            recorder.keyframeCapacity = capacity;
+            StopRecording("out of memory");
+            return;
+        }
+
+        recorder.snapshots = snapshots;
+    }
+
+    GameSnapshot* snapshot = &recorder.snapshots[recorder.keyframeCount];
+    memset(snapshot, 0, sizeof(GameSnapshot)); // Padding too, so the same run always writes the same file
+    CaptureSnapshot(game, snapshot);
+
+    recorder.keyframes[recorder.keyframeCount] = (ReplayKeyframe){ .tick = (uint32_t)recorder.tickCount, .flags = flags };
+    recorder.keyframeCount++;
+}
+
+void BeginReplayRecording(const Game* game)
+{
+    recorder.recording = true;
+    recorder.screenWidth = game->screenWidth;
+    recorder.screenHeight = game->screenHeight;
+    recorder.levelPackChecksum = GetLevelPackChecksum();
+    recorder.tickCount = 0;
+    recorder.keyframeCount = 0;
+
+    AddKeyframe(game, 0);
+}
+
+void RecordReplayTick(const Game* game, const SimInput* input)
+{
+    if (!recorder.recording)
+    {
+        return;
+    }
+
+    bool hasKeyframe = recorder.keyframeCount > 0 &&
+                       recorder.keyframes[recorder.keyframeCount - 1].tick == (uint32_t)recorder.tickCount;
+
+    if (recorder.tickCount % REPLAY_KEYFRAME_INTERVAL == 0 && !hasKeyframe)
+    {
+        AddKeyframe(game, 0);
+    }
+
+    if (!GrowArray((void**)&recorder.inputs, &recorder.inputCapacity, recorder.tickCount + 1, sizeof(ReplayInput)))
+    {
+        StopRecording("out of memory");
+        return;
+    }
+
+    recorder.inputs[recorder.tickCount++] = PackReplayInput(input);
+}
+
+/* A rewind took the game back droppedTicks ticks. The replay shows the run as it counted:
+ * the scrubbed-over ticks are dropped, and a cut keyframe jumps playback to the rewound state. */
+void CutReplayRecording(const Game* game, int droppedTicks)
+{
+    if (!recorder.recording)
+    {
+        return;
+    }
+
+    recorder.tickCount -= droppedTicks < recorder.tickCount ? droppedTicks : recorder.tickCount;
+
+    while (recorder.keyframeCount > 0 && recorder.keyframes[recorder.keyframeCount - 1].tick >= (uint32_t)recorder.tickCount)
+    {
+        recorder.keyframeCount--;
+    }
+
+    AddKeyframe(game, REPLAY_KEYFRAME_CUT);
+}
+
+void FinishReplayRecording(const Game* game)
+{
+    if (!recorder.recording)
+    {
+        return;
+    }
+
+    recorder.recording = false;
+
+    size_t size;
+    unsigned char* data = EncodeReplay(game, &size);
+
+    // The I/O thread frees it once it's on disk
+    if (data != NULL && !SubmitIORequest((IORequest){ .type = IO_SAVE_REPLAY, .data = data, .dataSize = size }))
+    {
+        free(data);
+    }
+}
+
+void FreeReplayRecording(void)
+{
+    free(recorder.inputs);
+    free(recorder.keyframes);
+    free(recorder.snapshots);
+    memset(&recorder, 0, sizeof(recorder));
+}
+
+static void WriteBytes(ByteBuffer* buffer, const void* bytes, size_t size)
+{
+    if (buffer->size + size > buffer->capacity && !buffer->failed)
+    {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity : 65536;
+
+        while (capacity < buffer->size + size)
+        {
+            capacity *= 2;
+        }
+
+        unsigned char* grown = realloc(buffer->data, capacity);
+
+        if (grown == NULL)
+        {
+            buffer->failed = true;
+        }
+        else
+        {
+            buffer->data = grown;
+            buffer->capacity = capacity;
+        }
+    }
+
+    if (buffer->failed)
+    {
+        return;
+    }
+
+    memcpy(buffer->data + buffer->size, bytes, size);
+    buffer->size += size;
+}
+
+// LEB128: 7 bits a byte, most runs and flags fit in one
+static void WriteVarint(ByteBuffer* buffer, uint32_t value)
+{
+    unsigned char bytes[5];
+    int count = 0;
+
+    do
+    {
+        bytes[count] = value & 0x7F;
+        value >>= 7;
+        bytes[count] |= value != 0 ? 0x80 : 0;
+        count++;
+    } while (value != 0);
+
+    WriteBytes(buffer, bytes, count);
+}
+
+// Keyframes and the index get read in place, so they start 8-byte aligned
+static void AlignBuffer(ByteBuffer* buffer)
+{
+    static const unsigned char zeros[8] = {0};
+    WriteBytes(buffer, zeros, (8 - buffer->size % 8) % 8);
+}
+
+unsigned char* EncodeReplay(const Game* game, size_t* size)
+{
+    ByteBuffer buffer = {0};
+    ReplayKeyframe* index = malloc((size_t)(recorder.keyframeCount > 0 ? recorder.keyframeCount : 1) * sizeof(ReplayKeyframe));
+
+    if (index == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(index, recorder.keyframes, (size_t)recorder.keyframeCount * sizeof(ReplayKeyframe));
+
+    ReplayHeader header =
+    {
+        .magic = REPLAY_MAGIC,
+        .version = REPLAY_VERSION,
+        .tickRate = SIM_TICK_RATE,
+        .tickCount = (uint32_t)recorder.tickCount,
+        .snapshotSize = sizeof(GameSnapshot),
+        .snapshotVersion = SNAPSHOT_VERSION,
+        .screenWidth = recorder.screenWidth,
+        .screenHeight = recorder.screenHeight,
+        .levelPackChecksum = recorder.levelPackChecksum,
+        .finalScore = game->player.score,
+        .finalLevel = game->currentLevel,
+        .finalMaxCombo = game->maxCombo,
+        .physics = SIM_PHYSICS
+    };
+
+    WriteBytes(&buffer, &header, sizeof(header)); // Placeholder, the offsets are patched in at the end
+    header.inputOffset = (uint32_t)buffer.size;
+
+    int keyframe = 0;
+    int tick = 0;
+
+    while (tick < recorder.tickCount)
+    {
+        // A keyframe has to be able to start decoding right here, so runs stop at every one of them
+        while (keyframe < recorder.keyframeCount && index[keyframe].tick <= (uint32_t)tick)
+        {
+            index[keyframe++].inputOffset = (uint32_t)buffer.size;
+        }
+
+        int end = keyframe < recorder.keyframeCount ? (int)index[keyframe].tick : recorder.tickCount;
+        const ReplayInput* input = &recorder.inputs[tick];
+        int run = 1;
+
+        while (tick + run < end && SameInput(&recorder.inputs[tick + run], input))
+        {
+            run++;
+        }
+
+        WriteVarint(&buffer, (uint32_t)run);
+        WriteVarint(&buffer, input->flags);
+
+        if (input->flags & REPLAY_INPUT_MOVE)
+        {
+            WriteBytes(&buffer, &input->moveSeconds, sizeof(float));
+        }
+
+        tick += run;
+    }
+
+    // A cut at the very end has no input after it
+    while (keyframe < recorder.keyframeCount)
+    {
+        index[keyframe++].inputOffset = (uint32_t)buffer.size;
+    }
+
+    header.inputSize = (uint32_t)buffer.size - header.inputOffset;
+
+    for (int i = 0; i < recorder.keyframeCount; i++)
+    {
+        AlignBuffer(&buffer);
+        index[i].snapshotOffset = (uint32_t)buffer.size;
+        WriteBytes(&buffer, &recorder.snapshots[i], sizeof(GameSnapshot));
+    }
+
+    AlignBuffer(&buffer);
+
+    ReplayFooter footer =
+    {
+        .indexOffset = (uint32_t)buffer.size,
+        .keyframeCount = (uint32_t)recorder.keyframeCount,
+        .magic = REPLAY_FOOTER_MAGIC
+    };
+
+    WriteBytes(&buffer, index, (size_t)recorder.keyframeCount * sizeof(ReplayKeyframe));
+    free(index);
+
+    if (buffer.failed)
+    {
+        free(buffer.data);
+        return NULL;
+    }
+
+    memcpy(buffer.data, &header, sizeof(header));
+    footer.checksum = HashReplayBytes(buffer.data, buffer.size);
+    WriteBytes(&buffer, &footer, sizeof(footer));
+
+    if (buffer.failed)
+    {
+        free(buffer.data);
+        return NULL;
+    }
+
+    *size = buffer.size;
+    return buffer.data;
+}
+
+bool WriteReplayFile(const char* path, const unsigned char* data, size_t size)
+{
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    FILE* file = fopen(tempPath, "wb");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    bool written = fwrite(data, 1, size, file) == size;
+    written &= fclose(file) == 0;
+
+    if (!written || !ReplaceRunFile(tempPath, path))
+    {
+        remove(tempPath);
+        return false;
+    }
+
+    return true;
+}
+
+static bool IsRangeBefore(uint32_t offset, size_t length, uint32_t end)
+{
+    return offset <= end && length <= end - offset;
+}
+
+// Everything in the file gets checked before any of it is used, a replay can come from anywhere
+static bool ValidateReplay(const char* name, Replay* replay)
+{
+    const unsigned char* data = replay->file.data;
+    size_t size = replay->file.size;
+    ReplayFooter footer;
+
+    if (size < sizeof(ReplayHeader) + sizeof(ReplayFooter))
+    {
+        printf("%s is not a replay\n", name);
+        return false;
+    }
+
+    // The footer comes first: it says where everything else is
+    memcpy(&footer, data + size - sizeof(ReplayFooter), sizeof(ReplayFooter));
+    const ReplayHeader* header = (const ReplayHeader*)data;
+
+    if (header->magic != REPLAY_MAGIC || footer.magic != REPLAY_FOOTER_MAGIC)
+    {
+        printf("%s is not a replay, or it's truncated\n", name);
+        return false;
+    }
+
+    if (header->version != REPLAY_VERSION || header->tickRate != SIM_TICK_RATE ||
+        header->snapshotSize != sizeof(GameSnapshot) || header->snapshotVersion != SNAPSHOT_VERSION)
+    {
+        printf("%s was recorded by a different version of the game\n", name);
+        return false;
+    }
+
+    if (header->physics != SIM_PHYSICS)
+    {
+        printf("%s was recorded with %s physics, this build plays with the other kind\n",
+               name, header->physics == SIM_PHYSICS_FIXED ? "fixed-point" : "float");
+        return false;
+    }
+
+    uint32_t indexEnd = (uint32_t)(size - sizeof(ReplayFooter));
+
+    if (footer.keyframeCount == 0 || footer.indexOffset % 8 != 0 ||
+        !IsRangeBefore(footer.indexOffset, (size_t)footer.keyframeCount * sizeof(ReplayKeyframe), indexEnd) ||
+        footer.indexOffset + footer.keyframeCount * sizeof(ReplayKeyframe) != indexEnd ||
+        !IsRangeBefore(header->inputOffset, header->inputSize, footer.indexOffset))
+    {
+        printf("%s is damaged\n", name);
+        return false;
+    }
+
+    const ReplayKeyframe* index = (const ReplayKeyframe*)(data + footer.indexOffset);
+    uint32_t inputEnd = header->inputOffset + header->inputSize;
+
+    for (uint32_t i = 0; i < footer.keyframeCount; i++)
+    {
+        bool ordered = i == 0 ? index[i].tick == 0 : index[i].tick > index[i - 1].tick;
+
+        if (!ordered || index[i].tick > header->tickCount || index[i].snapshotOffset % 8 != 0 ||
+            !IsRangeBefore(index[i].snapshotOffset, sizeof(GameSnapshot), footer.indexOffset) ||
+            index[i].inputOffset < header->inputOffset || index[i].inputOffset > inputEnd)
+        {
+            printf("%s has a damaged keyframe index (keyframe %u)\n", name, i);
+            return false;
+        }
+    }
+
+    replay->header = header;
+    replay->index = index;
+    replay->keyframeCount = (int)footer.keyframeCount;
+
+    return true;
+}
+
+bool OpenReplay(const char* path, Replay* replay)
+{
+    *replay = (Replay){0};
+
+    if (!MapFileReadOnly(path, &replay->file))
+    {
+        printf("Can't open %s\n", path);
+        return false;
+    }
+
+    replay->mapped = true;
+
+    if (!ValidateReplay(path, replay))
+    {
+        CloseReplay(replay);
+        return false;
+    }
+
+    return true;
+}
+
+bool OpenReplayMemory(const void* data, size_t size, const char* name, Replay* replay)
+{
+    *replay = (Replay){0};
+    replay->file.data = data;
+    replay->file.size = size;
+
+    if (((uintptr_t)data % 8) != 0 || !ValidateReplay(name, replay))
+    {
+        *replay = (Replay){0};
+        return false;
+    }
+
+    return true;
+}
+
+void CloseReplay(Replay* replay)
+{
+    if (replay->mapped)
+    {
+        UnmapFile(&replay->file);
+    }
+
+    *replay = (Replay){0};
+}
+
+bool CheckReplayChecksum(const Replay* replay)
+{
+    ReplayFooter footer;
+    size_t hashed = replay->file.size - sizeof(ReplayFooter);
+
+    memcpy(&footer, replay->file.data + hashed, sizeof(ReplayFooter));
+
+    return HashReplayBytes(replay->file.data, hashed) == footer.checksum;
+}
+
+bool LoadReplayKeyframe(const Replay* replay, int keyframe, GameSnapshot* snapshot)
+{
+    if (keyframe < 0 || keyframe >= replay->keyframeCount)
+    {
+        return false;
+    }
+
+    memcpy(snapshot, replay->file.data + replay->index[keyframe].snapshotOffset, sizeof(GameSnapshot));
+
+    return snapshot->magic == SNAPSHOT_MAGIC && snapshot->size == sizeof(GameSnapshot);
+}
+
+// Binary search, the index is sorted by tick
+int FindReplayKeyframe(const Replay* replay, int tick)
+{
+    int low = 0;
+    int high = replay->keyframeCount - 1;
+    int found = -1;
+
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+
+        if (replay->index[middle].tick <= (uint32_t)tick)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return found;
+}
+
+static bool ReadVarint(const unsigned char* data, uint32_t* offset, uint32_t end, uint32_t* value)
+{
+    *value = 0;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (*offset >= end)
+        {
+            return false;
+        }
+
+        unsigned char byte = data[(*offset)++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ReadRun(ReplayCursor* cursor)
+{
+    const Replay* replay = cursor->replay;
+    const unsigned char* data = replay->file.data;
+    uint32_t end = replay->header->inputOffset + replay->header->inputSize;
+    uint32_t run, flags;
+    float moveSeconds = 0.0f;
+
+    if (!ReadVarint(data, &cursor->inputOffset, end, &run) || run == 0 ||
+        !ReadVarint(data, &cursor->inputOffset, end, &flags))
+    {
+        return false;
+    }
+
+    if (flags & REPLAY_INPUT_MOVE)
+    {
+        if (end - cursor->inputOffset < sizeof(float))
+        {
+            return false;
+        }
+
+        memcpy(&moveSeconds, data + cursor->inputOffset, sizeof(float));
+        cursor->inputOffset += sizeof(float);
+    }
+
+    cursor->runLeft = (int)run;
+    cursor->runInput = UnpackReplayInput(flags, moveSeconds);
+
+    return true;
+}
+
+bool ReplayTick(ReplayCursor* cursor, Game* game, SimInput* input)
+{
+    const Replay* replay = cursor->replay;
+
+    if (cursor->tick >= (int)replay->header->tickCount)
+    {
+        return false;
+    }
+
+    cursor->cut = false;
+
+    // Regular keyframes we just pass by, only a cut means the timeline jumps
+    while (cursor->nextKeyframe < replay->keyframeCount && replay->index[cursor->nextKeyframe].tick <= (uint32_t)cursor->tick)
+    {
+        const ReplayKeyframe* keyframe = &replay->index[cursor->nextKeyframe];
+
+        if (keyframe->tick == (uint32_t)cursor->tick && (keyframe->flags & REPLAY_KEYFRAME_CUT))
+        {
+            GameSnapshot snapshot; // Not static, the verifier plays replays on several threads at once
+
+            if (!LoadReplayKeyframe(replay, cursor->nextKeyframe, &snapshot))
+            {
+                return false;
+            }
+
+            ApplySnapshot(game, &snapshot);
+            cursor->inputOffset = keyframe->inputOffset;
+            cursor->runLeft = 0;
+            cursor->cut = true;
+        }
+
+        cursor->nextKeyframe++;
+    }
+
+    // In the game, this is where the LEVEL COMPLETE screen waited for SPACE
+    if (game->state == LEVEL_COMPLETE)
+    {
+        LoadNextLevel(game);
+    }
+
+    if (cursor->runLeft == 0 && !ReadRun(cursor))
+    {
+        printf("Replay input ends early at tick %d\n", cursor->tick);
+        return false;
+    }
+
+    *input = cursor->runInput;
+    cursor->runLeft--;
+    cursor->tick++;
+
+    return true;
+}
+
+/* Plays the tick ReplayTick just gave out, and the rest of its run up to `end` in the same go: runs are ticks
+ * of identical input that never cross a keyframe, exactly what FastForwardSimulation wants. */
+static void PlayReplayRun(ReplayCursor* cursor, Game* game, const SimInput* input, int end)
+{
+    int ticks = 1 + cursor->runLeft;
+    int last = cursor->tick - 1;
+
+    ticks = last + ticks > end ? end - last : ticks;
+
+    int played = game->state == PLAYING ? FastForwardSimulation(game, input, ticks, NULL) : 0;
+
+    if (played == 0)
+    {
+        StepSimulation(game, input, SIM_DT);
+        played = 1;
+    }
+
+    cursor->runLeft -= played - 1;
+    cursor->tick += played - 1;
+}
+
+bool SeekReplay(const Replay* replay, ReplayCursor* cursor, Game* game, int tick)
+{
+    GameSnapshot snapshot;
+
+    tick = tick < 0 ? 0 : tick;
+    tick = tick > (int)replay->header->tickCount ? (int)replay->header->tickCount : tick;
+
+    int keyframe = FindReplayKeyframe(replay, tick);
+
+    if (!LoadReplayKeyframe(replay, keyframe, &snapshot) || !RestoreSnapshot(game, &snapshot))
+    {
+        return false;
+    }
+
+    *cursor = (ReplayCursor)
+    {
+        .replay = replay,
+        .tick = (int)replay->index[keyframe].tick,
+        .inputOffset = replay->index[keyframe].inputOffset,
+        .nextKeyframe = keyframe + 1
+    };
+
+    // Then simulate the rest of the way, at most REPLAY_KEYFRAME_INTERVAL ticks
+    while (cursor->tick < tick)
+    {
+        SimInput input;
+
+        if (!ReplayTick(cursor, game, &input))
+        {
+            return false;
+        }
+
+        PlayReplayRun(cursor, game, &input, tick);
+    }
+
+    return true;
+}
+
+static const char* verdictNames[REPLAY_VERDICT_COUNT] =
+{
+    [REPLAY_VALID] = "valid",
+    [REPLAY_DAMAGED] = "damaged",
+    [REPLAY_OTHER_LEVELS] = "other levels",
+    [REPLAY_NOT_FROM_START] = "not from the start",
+    [REPLAY_BAD_CUT] = "bad rewind",
+    [REPLAY_DIVERGED] = "diverged",
+    [REPLAY_UNFINISHED] = "unfinished",
+    [REPLAY_WRONG_CLAIM] = "wrong claim"
+};
+
+const char* GetReplayVerdictName(ReplayVerdict verdict)
+{
+    return verdict >= 0 && verdict < REPLAY_VERDICT_COUNT ? verdictNames[verdict] : "?";
+}
+
+// The run the replay claims to start with, built the way the menu builds it
+static bool IsFreshRun(const Replay* replay, Game* game, const GameSnapshot* recorded)
+{
+    GameSnapshot fresh;
+    uint64_t fixedLevelSeed = game->fixedLevelSeed;
+
+    game->screenWidth = replay->header->screenWidth;
+    game->screenHeight = replay->header->screenHeight;
+    game->endless = recorded->endless;
+    game->fixedLevelSeed = recorded->levelSeed; // The one random thing about a new run
+    ResetGame(game);
+    game->fixedLevelSeed = fixedLevelSeed;
+
+    CaptureSnapshot(game, &fresh);
+
+    return CompareSnapshots(&fresh, recorded) == NULL;
+}
+
+/* A rewind puts the game back where it was a moment ago, and the replay drops the ticks it scrubbed over.
+ * So the cut lands exactly on the state we simulated up to here, except for the charge it used:
+ * a rewind costs one charge of the state it lands on (see StepRewind). Anything else is a replay
+ * handing itself charges it never picked up. */
+static bool IsHonestCut(const Game* game, const GameSnapshot* recorded)
+{
+    GameSnapshot simulated;
+
+    CaptureSnapshot(game, &simulated);
+
+    if (simulated.rewindCharges == 0 || recorded->rewindCharges != simulated.rewindCharges - 1)
+    {
+        return false;
+    }
+
+    simulated.rewindCharges = recorded->rewindCharges;
+
+    return CompareSnapshots(&simulated, recorded) == NULL;
+}
+
+ReplayCheck CheckReplayRun(const Replay* replay, Game* game, int claimedScore, int claimedMaxCombo)
+{
+    ReplayCheck check = { .verdict = REPLAY_VALID, .failedTick = -1 };
+    GameSnapshot recorded;
+    GameSnapshot simulated;
+
+    if (!CheckReplayChecksum(replay) || !LoadReplayKeyframe(replay, 0, &recorded))
+    {
+        check.verdict = REPLAY_DAMAGED;
+        return check;
+    }
+
+    if (replay->header->levelPackChecksum != GetLevelPackChecksum())
+    {
+        check.verdict = REPLAY_OTHER_LEVELS;
+        return check;
+    }
+
+    if (!IsFreshRun(replay, game, &recorded))
+    {
+        check.verdict = REPLAY_NOT_FROM_START;
+        check.failedTick = 0;
+        return check;
+    }
+
+    ReplayCursor cursor =
+    {
+        .replay = replay,
+        .inputOffset = replay->index[0].inputOffset,
+        .nextKeyframe = 1
+    };
+
+    SimInput input;
+    bool ended = false;
+
+    while (!ended && cursor.tick < (int)replay->header->tickCount)
+    {
+        int next = cursor.nextKeyframe;
+
+        // ReplayTick would just load a cut, so look at it first
+        if (next < replay->keyframeCount && replay->index[next].tick == (uint32_t)cursor.tick &&
+            (replay->index[next].flags & REPLAY_KEYFRAME_CUT))
+        {
+            if (!LoadReplayKeyframe(replay, next, &recorded) || !IsHonestCut(game, &recorded))
+            {
+                check.verdict = REPLAY_BAD_CUT;
+                check.failedTick = cursor.tick;
+                break;
+            }
+        }
+
+        if (!ReplayTick(&cursor, game, &input))
+        {
+            check.verdict = REPLAY_DAMAGED;
+            check.failedTick = cursor.tick;
+            break;
+        }
+
+        // Regular keyframes are redundant, but if one disagrees somebody edited something
+        next = cursor.nextKeyframe - 1;
+
+        if (!cursor.cut && next > 0 && replay->index[next].tick == (uint32_t)(cursor.tick - 1))
+        {
+            CaptureSnapshot(game, &simulated);
+
+            if (!LoadReplayKeyframe(replay, next, &recorded) || CompareSnapshots(&simulated, &recorded) != NULL)
+            {
+                check.verdict = REPLAY_DIVERGED;
+                check.failedTick = cursor.tick - 1;
+                break;
+            }
+        }
+
+        PlayReplayRun(&cursor, game, &input, (int)replay->header->tickCount);
+        ended = game->state == GAME_OVER || game->state == WIN;
+    }
+
+    check.score = game->player.score;
+    check.maxCombo = game->maxCombo;
+    check.ticks = cursor.tick;
+
+    if (check.verdict != REPLAY_VALID)
+    {
+        return check;
+    }
+
+    // The recording stops on the tick the run ends, more input after it means it was stitched onto something
+    if (ended != (cursor.tick == (int)replay->header->tickCount))
+    {
+        check.verdict = ended ? REPLAY_DIVERGED : REPLAY_UNFINISHED;
+        check.failedTick = cursor.tick;
+    }
+    else if (check.score != claimedScore || check.maxCombo != claimedMaxCombo)
+    {
+        check.verdict = REPLAY_WRONG_CLAIM;
+    }
+
+    return check;
+}
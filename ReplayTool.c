@@ -0,0 +1,407 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Game.h"
+#include "Level.h"
+#include "Replay.h"
+#include "SoftRenderer.h"
+#include "Timing.h"
+
+#define BENCH_SEEKS 200
+#define SEEK_TARGET_MS 10.0
+#define FRAME_DEFAULT_WIDTH 480     // A quarter of 1080p, plenty for golden images
+#define FRAME_DEFAULT_HEIGHT 270
+
+// "1234" is a tick, "12:34.5" is minutes and seconds of play
+static int ParseTick(const char* text)
+{
+    const char* colon = strchr(text, ':');
+
+    if (colon == NULL)
+    {
+        return atoi(text);
+    }
+
+    double seconds = atoi(text) * 60.0 + atof(colon + 1);
+    return (int)(seconds * SIM_TICK_RATE + 0.5);
+}
+
+static void FormatTick(int tick, char* text, size_t size)
+{
+    double seconds = (double)tick / SIM_TICK_RATE;
+    snprintf(text, size, "%d:%05.2f", (int)(seconds / 60.0), seconds - (int)(seconds / 60.0) * 60.0);
+}
+
+// Same blocks as when it was recorded, or the whole replay plays out differently
+static void LoadReplayLevels(const Replay* replay)
+{
+    if (replay->header->levelPackChecksum == 0)
+    {
+        return;
+    }
+
+    LoadLevelPack(LEVEL_PACK_FILE);
+
+    if (GetLevelPackChecksum() != replay->header->levelPackChecksum)
+    {
+        printf("Warning: recorded with a different %s, this replay will probably diverge\n", LEVEL_PACK_FILE);
+    }
+}
+
+static int CountBlocksLeft(const Game* game)
+{
+    int count = 0;
+
+    for (int row = 0; row < game->currentBlockRows; row++)
+    {
+        for (int col = 0; col < game->currentBlockColumns; col++)
+        {
+            const Block* block = &game->blocks[row][col];
+            count += block->active && block->type != BLOCK_SOLID ? 1 : 0;
+        }
+    }
+
+    return count;
+}
+
+static void PrintState(const Game* game, int tick)
+{
+    char time[32];
+    FormatTick(tick, time, sizeof(time));
+
+    printf("Tick %d (%s): level %d, score %d, lives %d, combo %d, %d blocks left\n",
+           tick, time, game->currentLevel, game->player.score, game->player.lives, game->combo, CountBlocksLeft(game));
+    printf("  paddle x %.1f, ball (%.1f, %.1f) %s, %d power-ups falling or active\n",
+           game->player.position.x, game->ball.position.x, game->ball.position.y,
+           game->ball.active ? "in play" : "on the paddle", game->powerUpCount);
+}
+
+static int Info(const Replay* replay, const char* path)
+{
+    const ReplayHeader* header = replay->header;
+    char duration[32];
+    int cuts = 0;
+
+    FormatTick((int)header->tickCount, duration, sizeof(duration));
+
+    for (int i = 0; i < replay->keyframeCount; i++)
+    {
+        cuts += (replay->index[i].flags & REPLAY_KEYFRAME_CUT) ? 1 : 0;
+    }
+
+    size_t keyframeBytes = (size_t)replay->keyframeCount * sizeof(GameSnapshot);
+
+    printf("%s: replay version %u, %zu bytes\n", path, header->version, replay->file.size);
+    printf("  %u ticks at %u Hz (%s), %dx%d, %s, %s physics\n", header->tickCount, header->tickRate, duration,
+           header->screenWidth, header->screenHeight, header->levelPackChecksum ? "level pack" : "built-in levels",
+           header->physics == SIM_PHYSICS_FIXED ? "fixed-point" : "float");
+    printf("  final score %d on level %d, max combo %d\n", header->finalScore, header->finalLevel, header->finalMaxCombo);
+    printf("  input: %u bytes, %.3f bytes/tick\n", header->inputSize,
+           header->tickCount > 0 ? (double)header->inputSize / header->tickCount : 0.0);
+    printf("  keyframes: %d (%d cuts from rewinds), %zu bytes, every %d s\n",
+           replay->keyframeCount, cuts, keyframeBytes, REPLAY_KEYFRAME_SECONDS);
+
+    return 0;
+}
+
+// Play the whole thing and check every keyframe against what we simulated
+static int Verify(const Replay* replay, Game* game)
+{
+    if (!CheckReplayChecksum(replay))
+    {
+        printf("Checksum mismatch, the file is damaged\n");
+        return 1;
+    }
+
+    ReplayCursor cursor;
+
+    if (!SeekReplay(replay, &cursor, game, 0))
+    {
+        printf("Can't load the first keyframe\n");
+        return 1;
+    }
+
+    static GameSnapshot simulated;
+    static GameSnapshot recorded;
+    int next = 1;
+    int checked = 0;
+    SimInput input;
+    double start = GetPreciseTime();
+
+    while (ReplayTick(&cursor, game, &input))
+    {
+        int tick = cursor.tick - 1;
+
+        while (next < replay->keyframeCount && replay->index[next].tick < (uint32_t)tick)
+        {
+            next++;
+        }
+
+        // Cuts were just loaded, comparing them with themselves proves nothing
+        if (next < replay->keyframeCount && replay->index[next].tick == (uint32_t)tick && !cursor.cut)
+        {
+            memset(&simulated, 0, sizeof(simulated));
+            CaptureSnapshot(game, &simulated);
+            LoadReplayKeyframe(replay, next, &recorded);
+
+            const char* field = CompareSnapshots(&simulated, &recorded);
+
+            if (field != NULL)
+            {
+                char time[32];
+                FormatTick(tick, time, sizeof(time));
+                printf("DIVERGED at tick %d (%s): %s differs from keyframe %d\n", tick, time, field, next);
+                return 1;
+            }
+
+            checked++;
+        }
+
+        StepSimulation(game, &input, SIM_DT);
+    }
+
+    double elapsed = GetPreciseTime() - start;
+
+    if (cursor.tick != (int)replay->header->tickCount)
+    {
+        printf("Input stream is damaged at tick %d\n", cursor.tick);
+        return 1;
+    }
+
+    if (game->player.score != replay->header->finalScore)
+    {
+        printf("DIVERGED: finished with score %d, the recording says %d\n", game->player.score, replay->header->finalScore);
+        return 1;
+    }
+
+    printf("OK: %d ticks, %d keyframes checked, final score %d (%.0f ticks/s)\n",
+           cursor.tick, checked, game->player.score, elapsed > 0.0 ? cursor.tick / elapsed : 0.0);
+
+    return 0;
+}
+
+// What the verification daemon does with a submitted replay, for one file
+static int Check(const Replay* replay, Game* game)
+{
+    double start = GetPreciseTime();
+    ReplayCheck check = CheckReplayRun(replay, game, replay->header->finalScore, replay->header->finalMaxCombo);
+    double elapsed = GetPreciseTime() - start;
+
+    if (check.verdict != REPLAY_VALID)
+    {
+        printf("REJECTED (%s) at tick %d: simulated score %d, max combo %d; the file claims %d, %d\n",
+               GetReplayVerdictName(check.verdict), check.failedTick, check.score, check.maxCombo,
+               replay->header->finalScore, replay->header->finalMaxCombo);
+        return 1;
+    }
+
+    printf("ACCEPTED: score %d, max combo %d, %d ticks in %.1f ms\n",
+           check.score, check.maxCombo, check.ticks, elapsed * 1000.0);
+
+    return 0;
+}
+
+static int Seek(const Replay* replay, Game* game, int tick)
+{
+    ReplayCursor cursor;
+    double start = GetPreciseTime();
+
+    if (!SeekReplay(replay, &cursor, game, tick))
+    {
+        printf("Seek to tick %d failed\n", tick);
+        return 1;
+    }
+
+    double elapsed = (GetPreciseTime() - start) * 1000.0;
+
+    PrintState(game, cursor.tick);
+    printf("  seek took %.2f ms\n", elapsed);
+
+    return 0;
+}
+
+static int Bench(const Replay* replay, Game* game)
+{
+    ReplayCursor cursor;
+    SimRandom random = SeedSimRandom(12345);
+    double total = 0.0;
+    double worst = 0.0;
+
+    for (int i = 0; i < BENCH_SEEKS; i++)
+    {
+        int tick = (int)(SimRandomFloat(&random) * replay->header->tickCount);
+        double start = GetPreciseTime();
+
+        if (!SeekReplay(replay, &cursor, game, tick))
+        {
+            printf("Seek to tick %d failed\n", tick);
+            return 1;
+        }
+
+        double elapsed = (GetPreciseTime() - start) * 1000.0;
+        total += elapsed;
+        worst = elapsed > worst ? elapsed : worst;
+    }
+
+    printf("%d random seeks: mean %.3f ms, worst %.3f ms (target %.0f ms: %s)\n",
+           BENCH_SEEKS, total / BENCH_SEEKS, worst, SEEK_TARGET_MS, worst < SEEK_TARGET_MS ? "OK" : "TOO SLOW");
+
+    return worst < SEEK_TARGET_MS ? 0 : 1;
+}
+
+// The game screen at `tick`, drawn by the software renderer. For golden images, no GPU or window needed
+static int Frame(const Replay* replay, Game* game, int tick, const char* outPath, int width, int height)
+{
+    ReplayCursor cursor;
+
+    if (width <= 0 || height <= 0)
+    {
+        printf("Frame size %dx%d makes no sense\n", width, height);
+        return 1;
+    }
+
+    if (!SeekReplay(replay, &cursor, game, tick))
+    {
+        printf("Seek to tick %d failed\n", tick);
+        return 1;
+    }
+
+    SoftFramebuffer frame = { .pixels = MemAlloc(width * height * sizeof(Color)), .width = width, .height = height };
+    RenderGameSoftware(game, &frame);
+
+    Image image =
+    {
+        .data = frame.pixels,
+        .width = width,
+        .height = height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    bool written = ExportImage(image, outPath);
+    MemFree(frame.pixels);
+
+    if (!written)
+    {
+        printf("Failed to write %s\n", outPath);
+        return 1;
+    }
+
+    printf("Wrote %s: tick %d at %dx%d\n", outPath, cursor.tick, width, height);
+    return 0;
+}
+
+// Re-record [from, to) as a new replay, starting from the state at `from`
+static int Trim(const Replay* replay, Game* game, const char* outPath, int from, int to)
+{
+    ReplayCursor cursor;
+
+    if (from < 0 || to <= from || to > (int)replay->header->tickCount)
+    {
+        printf("Trim range %d..%d is outside the replay (0..%u)\n", from, to, replay->header->tickCount);
+        return 1;
+    }
+
+    if (!SeekReplay(replay, &cursor, game, from))
+    {
+        printf("Seek to tick %d failed\n", from);
+        return 1;
+    }
+
+    BeginReplayRecording(game);
+
+    SimInput input;
+
+    while (cursor.tick < to && ReplayTick(&cursor, game, &input))
+    {
+        if (cursor.cut)
+        {
+            CutReplayRecording(game, 0);
+        }
+
+        RecordReplayTick(game, &input);
+        StepSimulation(game, &input, SIM_DT);
+    }
+
+    size_t size;
+    unsigned char* data = EncodeReplay(game, &size);
+    bool written = data != NULL && WriteReplayFile(outPath, data, size);
+
+    free(data);
+    FreeReplayRecording();
+
+    if (!written)
+    {
+        printf("Failed to write %s\n", outPath);
+        return 1;
+    }
+
+    printf("Wrote %s: %d ticks, %zu bytes\n", outPath, to - from, size);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s info <replay> | verify <replay> | check <replay> | seek <replay> <tick|m:ss> | bench <replay>"
+               " | trim <replay> <out> <from> <to> | frame <replay> <tick|m:ss> <out.png> [width height]\n", argv[0]);
+        return 1;
+    }
+
+    const char* command = argv[1];
+    Replay replay;
+
+    if (!OpenReplay(argv[2], &replay))
+    {
+        return 1;
+    }
+
+    LoadReplayLevels(&replay);
+
+    // The simulation runs in screen space, so it needs the same "screen"
+    Game game = InitHeadlessGame(replay.header->screenWidth, replay.header->screenHeight);
+    int result = 0;
+
+    if (strcmp(command, "info") == 0)
+    {
+        result = Info(&replay, argv[2]);
+    }
+    else if (strcmp(command, "verify") == 0)
+    {
+        result = Verify(&replay, &game);
+    }
+    else if (strcmp(command, "check") == 0)
+    {
+        result = Check(&replay, &game);
+    }
+    else if (strcmp(command, "seek") == 0 && argc > 3)
+    {
+        result = Seek(&replay, &game, ParseTick(argv[3]));
+    }
+    else if (strcmp(command, "bench") == 0)
+    {
+        result = Bench(&replay, &game);
+    }
+    else if (strcmp(command, "trim") == 0 && argc > 5)
+    {
+        result = Trim(&replay, &game, argv[3], ParseTick(argv[4]), ParseTick(argv[5]));
+    }
+    else if (strcmp(command, "frame") == 0 && argc > 4)
+    {
+        int width = argc > 6 ? atoi(argv[5]) : FRAME_DEFAULT_WIDTH;
+        int height = argc > 6 ? atoi(argv[6]) : FRAME_DEFAULT_HEIGHT;
+        result = Frame(&replay, &game, ParseTick(argv[3]), argv[4], width, height);
+    }
+    else
+    {
+        printf("Unknown command %s\n", command);
+        result = 1;
+    }
+
+    UnloadParticleSystem(&game.particles);
+    UnloadLevelPack();
+    CloseReplay(&replay);
+
+    return result;
+}
@@ -0,0 +1,903 @@
+﻿#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Game.h"
+#include "Level.h"
+#include "Replay.h"
+#include "Timing.h"
+
+/* Replay verification daemon: scores only count once their replay plays out to them.
+ *   ReplayVerifier serve [--socket path] [--threads n]
+ *   ReplayVerifier submit <replay> [score maxCombo]   (the claim defaults to what the file says)
+ *   ReplayVerifier bench <replay> [count] [connections]
+ *   ReplayVerifier stats
+ * Clients talk to it over a local Unix socket and can send any number of replays on one connection.
+ * Each replay is re-simulated with CheckReplayRun by one of the worker threads, on its own headless Game,
+ * flat out. Unix only, the game itself never needs it. */
+
+#define VERIFY_SOCKET_PATH "replayverify.sock"
+#define VERIFY_MAGIC 0x56524B42                     // "BKRV"
+#define VERIFY_MAX_REPLAY_BYTES (64 * 1024 * 1024)  // Hours of play, anything bigger isn't a replay
+#define VERIFY_MAX_CONNECTIONS 1024                 // Clients at once, past that we hang up
+#define VERIFY_LATENCY_WINDOW 8192                  // Percentiles are over the last this many replays
+#define VERIFY_STATS_SECONDS 10
+#define VERIFY_TIMEOUT_SECONDS 30
+
+typedef enum VerifyRequestType
+{
+    VERIFY_REPLAY = 1,      // Followed by replaySize bytes of replay file
+    VERIFY_STATS = 2
+} VerifyRequestType;
+
+// Both ends are on the same machine, so everything goes over the wire as plain structs
+typedef struct VerifyRequest
+{
+    uint32_t magic;
+    uint32_t type;
+    int32_t claimedScore;
+    int32_t claimedMaxCombo;
+    uint32_t replaySize;
+    uint32_t reserved;
+} VerifyRequest;
+
+typedef struct VerifyResponse
+{
+    uint32_t magic;
+    uint32_t verdict;       // ReplayVerdict, REPLAY_VALID means accepted
+    int32_t score;          // What the simulation came to
+    int32_t maxCombo;
+    int32_t ticks;
+    int32_t failedTick;
+    double verifyMs;        // From the request arriving to the answer, on the server
+} VerifyResponse;
+
+typedef struct VerifyStats
+{
+    uint32_t magic;
+    uint32_t threads;
+    double uptime;
+    uint64_t verdicts[REPLAY_VERDICT_COUNT];
+    uint64_t ticks;
+    double busySeconds;     // Summed over the workers
+    double latencyP50Ms;
+    double latencyP99Ms;
+    double latencyMaxMs;
+} VerifyStats;
+
+// A connection with a request waiting on it, and since when
+typedef struct PendingRequest
+{
+    int connection;
+    double readyTime;
+} PendingRequest;
+
+/* Idle connections sit in the accept loop's poll set. Once one has a request, it goes in the queue
+ * for the next free worker, which answers that one request and hands the connection back.
+ * That way a client sending replays back to back only ever gets its share of the workers. */
+static struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    PendingRequest queue[VERIFY_MAX_CONNECTIONS];   // A ring like the I/O worker's
+    int head;
+    int count;
+    int returned[VERIFY_MAX_CONNECTIONS];           // Answered, back to the poll set
+    int returnedCount;
+    int openConnections;
+    int wakePipe[2];                                // Workers poke the accept loop through this
+    bool quit;
+
+    pthread_t* threads;
+    int threadCount;
+    double startTime;
+
+    // Counters, under their own lock so workers never wait on the accept loop
+    pthread_mutex_t statsMutex;
+    uint64_t verdicts[REPLAY_VERDICT_COUNT];
+    uint64_t ticks;
+    double busySeconds;
+    float latencies[VERIFY_LATENCY_WINDOW];
+    int latencyCount;
+    int latencyNext;
+} service;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void OnStopSignal(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
+
+static bool ReadAll(int connection, void* data, size_t size)
+{
+    unsigned char* bytes = data;
+
+    while (size > 0)
+    {
+        ssize_t got = read(connection, bytes, size);
+
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (got <= 0)
+        {
+            return false;
+        }
+
+        bytes += got;
+        size -= (size_t)got;
+    }
+
+    return true;
+}
+
+static bool WriteAll(int connection, const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+
+    while (size > 0)
+    {
+        ssize_t sent = send(connection, bytes, size, MSG_NOSIGNAL);
+
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (sent <= 0)
+        {
+            return false;
+        }
+
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+
+    return true;
+}
+
+static int CompareFloats(const void* a, const void* b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static double GetPercentile(const float* sorted, int count, double percentile)
+{
+    if (count == 0)
+    {
+        return 0.0;
+    }
+
+    int index = (int)(percentile / 100.0 * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+// latency is from the request arriving to the answer, busy only the part a worker spent on it
+static void RecordVerdict(ReplayVerdict verdict, int ticks, double busySeconds, double latencySeconds)
+{
+    pthread_mutex_lock(&service.statsMutex);
+
+    service.verdicts[verdict]++;
+    service.ticks += (uint64_t)ticks;
+    service.busySeconds += busySeconds;
+    service.latencies[service.latencyNext] = (float)(latencySeconds * 1000.0);
+    service.latencyNext = (service.latencyNext + 1) % VERIFY_LATENCY_WINDOW;
+    service.latencyCount += service.latencyCount < VERIFY_LATENCY_WINDOW ? 1 : 0;
+
+    pthread_mutex_unlock(&service.statsMutex);
+}
+
+static VerifyStats GetServiceStats(void)
+{
+    float sorted[VERIFY_LATENCY_WINDOW];
+    VerifyStats stats = { .magic = VERIFY_MAGIC, .threads = (uint32_t)service.threadCount };
+
+    pthread_mutex_lock(&service.statsMutex);
+
+    memcpy(stats.verdicts, service.verdicts, sizeof(stats.verdicts));
+    stats.ticks = service.ticks;
+    stats.busySeconds = service.busySeconds;
+
+    int count = service.latencyCount;
+    memcpy(sorted, service.latencies, (size_t)count * sizeof(float));
+
+    pthread_mutex_unlock(&service.statsMutex);
+
+    // Sorting a few thousand floats is quicker than keeping a histogram in step
+    qsort(sorted, (size_t)count, sizeof(float), CompareFloats);
+    stats.latencyP50Ms = GetPercentile(sorted, count, 50.0);
+    stats.latencyP99Ms = GetPercentile(sorted, count, 99.0);
+    stats.latencyMaxMs = count > 0 ? sorted[count - 1] : 0.0;
+
+    stats.uptime = GetPreciseTime() - service.startTime;
+
+    return stats;
+}
+
+static uint64_t CountVerified(const VerifyStats* stats)
+{
+    uint64_t total = 0;
+
+    for (int i = 0; i < REPLAY_VERDICT_COUNT; i++)
+    {
+        total += stats->verdicts[i];
+    }
+
+    return total;
+}
+
+static void PrintServiceStats(const VerifyStats* stats)
+{
+    uint64_t total = CountVerified(stats);
+    uint64_t accepted = stats->verdicts[REPLAY_VALID];
+
+    printf("[%6.0f s] %llu replays (%llu accepted, %llu rejected), %.0f/min, %u threads at %.2fM ticks/s each\n",
+           stats->uptime, (unsigned long long)total, (unsigned long long)accepted, (unsigned long long)(total - accepted),
+           stats->uptime > 0.0 ? total * 60.0 / stats->uptime : 0.0, stats->threads,
+           stats->busySeconds > 0.0 ? stats->ticks / stats->busySeconds / 1000000.0 : 0.0);
+    printf("           latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           stats->latencyP50Ms, stats->latencyP99Ms, stats->latencyMaxMs);
+
+    for (int i = 1; i < REPLAY_VERDICT_COUNT; i++)
+    {
+        if (stats->verdicts[i] > 0)
+        {
+            printf("           %llu %s\n", (unsigned long long)stats->verdicts[i], GetReplayVerdictName((ReplayVerdict)i));
+        }
+    }
+
+    fflush(stdout);
+}
+
+static void PushRequest(PendingRequest request)
+{
+    pthread_mutex_lock(&service.mutex);
+
+    // Can't overflow, every connection is in here at most once
+    service.queue[(service.head + service.count) % VERIFY_MAX_CONNECTIONS] = request;
+    service.count++;
+    pthread_cond_signal(&service.wake);
+
+    pthread_mutex_unlock(&service.mutex);
+}
+
+// False once we're shutting down and nothing is left
+static bool PopRequest(PendingRequest* request)
+{
+    pthread_mutex_lock(&service.mutex);
+
+    while (service.count == 0 && !service.quit)
+    {
+        pthread_cond_wait(&service.wake, &service.mutex);
+    }
+
+    bool popped = service.count > 0;
+
+    if (popped)
+    {
+        *request = service.queue[service.head];
+        service.head = (service.head + 1) % VERIFY_MAX_CONNECTIONS;
+        service.count--;
+    }
+
+    pthread_mutex_unlock(&service.mutex);
+
+    return popped;
+}
+
+static void ReturnConnection(int connection)
+{
+    pthread_mutex_lock(&service.mutex);
+    service.returned[service.returnedCount++] = connection;
+    pthread_mutex_unlock(&service.mutex);
+
+    char poke = 0;
+    (void)!write(service.wakePipe[1], &poke, 1);
+}
+
+static void CloseConnection(int connection)
+{
+    close(connection);
+
+    pthread_mutex_lock(&service.mutex);
+    service.openConnections--;
+    pthread_mutex_unlock(&service.mutex);
+}
+
+typedef struct VerifyBuffer
+{
+    unsigned char* data;
+    size_t capacity;
+} VerifyBuffer;
+
+static bool ReserveBuffer(VerifyBuffer* buffer, size_t size)
+{
+    if (size <= buffer->capacity)
+    {
+        return true;
+    }
+
+    // malloc'd memory is aligned for anything, OpenReplayMemory needs 8 bytes
+    unsigned char* data = realloc(buffer->data, size);
+
+    if (data == NULL)
+    {
+        return false;
+    }
+
+    buffer->data = data;
+    buffer->capacity = size;
+
+    return true;
+}
+
+// One request. False when the client hung up or sent something we don't understand
+static bool ServeRequest(int connection, double readyTime, Game* game, VerifyBuffer* buffer)
+{
+    VerifyRequest request;
+    double start = GetPreciseTime();
+
+    if (!ReadAll(connection, &request, sizeof(request)) || request.magic != VERIFY_MAGIC)
+    {
+        return false;
+    }
+
+    if (request.type == VERIFY_STATS)
+    {
+        VerifyStats stats = GetServiceStats();
+        return WriteAll(connection, &stats, sizeof(stats));
+    }
+
+    if (request.type != VERIFY_REPLAY || request.replaySize > VERIFY_MAX_REPLAY_BYTES ||
+        !ReserveBuffer(buffer, request.replaySize) || !ReadAll(connection, buffer->data, request.replaySize))
+    {
+        return false;
+    }
+
+    VerifyResponse response = { .magic = VERIFY_MAGIC, .verdict = REPLAY_DAMAGED, .failedTick = -1 };
+    Replay replay;
+
+    if (OpenReplayMemory(buffer->data, request.replaySize, "Submitted replay", &replay))
+    {
+        ReplayCheck check = CheckReplayRun(&replay, game, request.claimedScore, request.claimedMaxCombo);
+
+        response.verdict = check.verdict;
+        response.score = check.score;
+        response.maxCombo = check.maxCombo;
+        response.ticks = check.ticks;
+        response.failedTick = check.failedTick;
+
+        CloseReplay(&replay);
+    }
+
+    double now = GetPreciseTime();
+    response.verifyMs = (now - readyTime) * 1000.0;
+
+    RecordVerdict((ReplayVerdict)response.verdict, response.ticks, now - start, now - readyTime);
+
+    return WriteAll(connection, &response, sizeof(response));
+}
+
+static void* VerifyThread(void* argument)
+{
+    (void)argument;
+
+    // One Game per thread for good, CheckReplayRun sets it up from scratch for every replay
+    Game game = InitHeadlessGame(1920, 1080);
+    VerifyBuffer buffer = { 0 };
+    PendingRequest request;
+
+    while (PopRequest(&request))
+    {
+        if (ServeRequest(request.connection, request.readyTime, &game, &buffer))
+        {
+            ReturnConnection(request.connection);
+        }
+        else
+        {
+            CloseConnection(request.connection);
+        }
+    }
+
+    free(buffer.data);
+    UnloadParticleSystem(&game.particles);
+
+    return NULL;
+}
+
+static void AcceptConnection(int listener, struct pollfd* watched, int* watchedCount)
+{
+    int connection = accept(listener, NULL, NULL);
+
+    if (connection < 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&service.mutex);
+    bool room = service.openConnections < VERIFY_MAX_CONNECTIONS;
+    service.openConnections += room ? 1 : 0;
+    pthread_mutex_unlock(&service.mutex);
+
+    // Full up: hanging up is the back pressure, the client can try again
+    if (!room)
+    {
+        close(connection);
+        return;
+    }
+
+    // A client that stalls halfway through a request doesn't get to keep its worker
+    struct timeval timeout = { .tv_sec = VERIFY_TIMEOUT_SECONDS };
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    watched[(*watchedCount)++] = (struct pollfd){ .fd = connection, .events = POLLIN };
+}
+
+static int Serve(const char* path, int threadCount)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        printf("Socket path %s is too long\n", path);
+        return 1;
+    }
+
+    strcpy(address.sun_path, path);
+
+    // The replays have to play on the same blocks they were recorded on
+    LoadLevelPack(LEVEL_PACK_FILE);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    // A socket file left behind by a daemon that crashed would make bind fail
+    unlink(path);
+
+    if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, 128) != 0 || pipe(service.wakePipe) != 0)
+    {
+        printf("Can't listen on %s: %s\n", path, strerror(errno));
+
+        if (listener >= 0)
+        {
+            close(listener);
+        }
+
+        UnloadLevelPack();
+        return 1;
+    }
+
+    signal(SIGINT, OnStopSignal);
+    signal(SIGTERM, OnStopSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    fcntl(service.wakePipe[0], F_SETFL, O_NONBLOCK);
+    pthread_mutex_init(&service.mutex, NULL);
+    pthread_cond_init(&service.wake, NULL);
+    pthread_mutex_init(&service.statsMutex, NULL);
+    service.startTime = GetPreciseTime();
+    service.threads = calloc((size_t)threadCount, sizeof(pthread_t));
+
+    for (int i = 0; service.threads != NULL && i < threadCount; i++)
+    {
+        if (pthread_create(&service.threads[i], NULL, VerifyThread, NULL) != 0)
+        {
+            break;
+        }
+
+        service.threadCount++;
+    }
+
+    if (service.threadCount == 0)
+    {
+        printf("Can't start any verification threads\n");
+        stopRequested = 1;
+    }
+    else
+    {
+        printf("Verifying replays on %s with %d threads (level pack %08x)\n", path, service.threadCount, GetLevelPackChecksum());
+        fflush(stdout);
+    }
+
+    // Only this thread touches the poll set: the listener, the wake pipe, then every idle connection
+    static struct pollfd watched[VERIFY_MAX_CONNECTIONS + 2];
+    int watchedCount = 2;
+    double lastPrint = service.startTime;
+    uint64_t lastTotal = 0;
+
+    watched[0] = (struct pollfd){ .fd = listener, .events = POLLIN };
+    watched[1] = (struct pollfd){ .fd = service.wakePipe[0], .events = POLLIN };
+
+    while (!stopRequested)
+    {
+        // Wake up now and then even when nothing happens, for the stats and to notice a signal
+        if (poll(watched, (nfds_t)watchedCount, 1000) > 0)
+        {
+            double now = GetPreciseTime();
+
+            // Backwards, so the swap with the last one doesn't skip anything
+            for (int i = watchedCount - 1; i >= 2; i--)
+            {
+                if (watched[i].revents != 0)
+                {
+                    PushRequest((PendingRequest){ .connection = watched[i].fd, .readyTime = now });
+                    watched[i] = watched[--watchedCount];
+                }
+            }
+
+            if (watched[1].revents != 0)
+            {
+                char pokes[64];
+
+                while (read(service.wakePipe[0], pokes, sizeof(pokes)) > 0)
+                {
+                    // Just empty it, the returned list is what counts
+                }
+
+                pthread_mutex_lock(&service.mutex);
+
+                for (int i = 0; i < service.returnedCount; i++)
+                {
+                    watched[watchedCount++] = (struct pollfd){ .fd = service.returned[i], .events = POLLIN };
+                }
+
+                service.returnedCount = 0;
+                pthread_mutex_unlock(&service.mutex);
+            }
+
+            if (watched[0].revents != 0)
+            {
+                AcceptConnection(listener, watched, &watchedCount);
+            }
+        }
+
+        double now = GetPreciseTime();
+
+        if (now - lastPrint >= VERIFY_STATS_SECONDS)
+        {
+            VerifyStats stats = GetServiceStats();
+            uint64_t total = CountVerified(&stats);
+
+            if (total != lastTotal)
+            {
+                PrintServiceStats(&stats);
+            }
+
+            lastPrint = now;
+            lastTotal = total;
+        }
+    }
+
+    close(listener);
+    unlink(path);
+
+    // Whatever is already queued still gets an answer
+    pthread_mutex_lock(&service.mutex);
+    service.quit = true;
+    pthread_cond_broadcast(&service.wake);
+    pthread_mutex_unlock(&service.mutex);
+
+    for (int i = 0; i < service.threadCount; i++)
+    {
+        pthread_join(service.threads[i], NULL);
+    }
+
+    for (int i = 2; i < watchedCount; i++)
+    {
+        close(watched[i].fd);
+    }
+
+    for (int i = 0; i < service.returnedCount; i++)
+    {
+        close(service.returned[i]);
+    }
+
+    close(service.wakePipe[0]);
+    close(service.wakePipe[1]);
+
+    VerifyStats stats = GetServiceStats();
+    PrintServiceStats(&stats);
+
+    free(service.threads);
+    pthread_mutex_destroy(&service.statsMutex);
+    pthread_cond_destroy(&service.wake);
+    pthread_mutex_destroy(&service.mutex);
+    UnloadLevelPack();
+
+    return 0;
+}
+
+static int Connect(const char* path)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (connection >= 0 && connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(connection);
+        connection = -1;
+    }
+
+    if (connection < 0)
+    {
+        printf("Can't reach the verifier on %s: %s\n", path, strerror(errno));
+    }
+
+    return connection;
+}
+
+static bool SendReplay(int connection, const Replay* replay, int claimedScore, int claimedMaxCombo, VerifyResponse* response)
+{
+    VerifyRequest request =
+    {
+        .magic = VERIFY_MAGIC,
+        .type = VERIFY_REPLAY,
+        .claimedScore = claimedScore,
+        .claimedMaxCombo = claimedMaxCombo,
+        .replaySize = (uint32_t)replay->file.size
+    };
+
+    return WriteAll(connection, &request, sizeof(request)) &&
+           WriteAll(connection, replay->file.data, replay->file.size) &&
+           ReadAll(connection, response, sizeof(*response)) && response->magic == VERIFY_MAGIC;
+}
+
+static bool RequestStats(const char* path, VerifyStats* stats)
+{
+    int connection = Connect(path);
+
+    if (connection < 0)
+    {
+        return false;
+    }
+
+    VerifyRequest request = { .magic = VERIFY_MAGIC, .type = VERIFY_STATS };
+    bool received = WriteAll(connection, &request, sizeof(request)) &&
+                    ReadAll(connection, stats, sizeof(*stats)) && stats->magic == VERIFY_MAGIC;
+
+    close(connection);
+
+    return received;
+}
+
+static int Submit(const char* path, const Replay* replay, int claimedScore, int claimedMaxCombo)
+{
+    int connection = Connect(path);
+
+    if (connection < 0)
+    {
+        return 1;
+    }
+
+    VerifyResponse response;
+    bool answered = SendReplay(connection, replay, claimedScore, claimedMaxCombo, &response);
+
+    close(connection);
+
+    if (!answered)
+    {
+        printf("The verifier hung up without an answer\n");
+        return 1;
+    }
+
+    if (response.verdict != REPLAY_VALID)
+    {
+        printf("REJECTED (%s) at tick %d: simulated score %d, max combo %d; claimed %d, %d (%.1f ms)\n",
+               GetReplayVerdictName((ReplayVerdict)response.verdict), response.failedTick,
+               response.score, response.maxCombo, claimedScore, claimedMaxCombo, response.verifyMs);
+        return 1;
+    }
+
+    printf("ACCEPTED: score %d, max combo %d, %d ticks (%.1f ms)\n",
+           response.score, response.maxCombo, response.ticks, response.verifyMs);
+
+    return 0;
+}
+
+typedef struct BenchClient
+{
+    pthread_t thread;
+    const char* path;
+    const Replay* replay;
+    int count;
+    float* latencies;       // Round trips as the client sees them, ms
+    int answered;
+    int accepted;
+} BenchClient;
+
+// One connection, requests back to back, like a game server forwarding finished runs
+static void* BenchThread(void* argument)
+{
+    BenchClient* client = argument;
+    int connection = Connect(client->path);
+
+    for (int i = 0; connection >= 0 && i < client->count; i++)
+    {
+        VerifyResponse response;
+        double start = GetPreciseTime();
+
+        if (!SendReplay(connection, client->replay, client->replay->header->finalScore,
+                        client->replay->header->finalMaxCombo, &response))
+        {
+            break;
+        }
+
+        client->latencies[client->answered++] = (float)((GetPreciseTime() - start) * 1000.0);
+        client->accepted += response.verdict == REPLAY_VALID ? 1 : 0;
+    }
+
+    if (connection >= 0)
+    {
+        close(connection);
+    }
+
+    return NULL;
+}
+
+static int Bench(const char* path, const Replay* replay, int count, int connections)
+{
+    connections = connections < 1 ? 1 : connections;
+    count = count < connections ? connections : count;
+
+    BenchClient* clients = calloc((size_t)connections, sizeof(BenchClient));
+    float* latencies = calloc((size_t)count, sizeof(float));
+
+    if (clients == NULL || latencies == NULL)
+    {
+        free(clients);
+        free(latencies);
+        return 1;
+    }
+
+    double start = GetPreciseTime();
+    int given = 0;
+    int started = 0;
+
+    for (int i = 0; i < connections; i++)
+    {
+        BenchClient* client = &clients[i];
+
+        client->path = path;
+        client->replay = replay;
+        client->count = count / connections + (i < count % connections ? 1 : 0);
+        client->latencies = latencies + given;
+        given += client->count;
+
+        if (pthread_create(&client->thread, NULL, BenchThread, client) != 0)
+        {
+            break;
+        }
+
+        started++;
+    }
+
+    int answered = 0;
+    int accepted = 0;
+
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(clients[i].thread, NULL);
+
+        // Pack the answered ones together, a client that gave up early leaves a gap
+        memmove(latencies + answered, clients[i].latencies, (size_t)clients[i].answered * sizeof(float));
+        answered += clients[i].answered;
+        accepted += clients[i].accepted;
+    }
+
+    double elapsed = GetPreciseTime() - start;
+
+    qsort(latencies, (size_t)answered, sizeof(float), CompareFloats);
+
+    printf("%d of %d replays answered (%d accepted) in %.2f s over %d connections: %.0f replays/min\n",
+           answered, count, accepted, elapsed, connections, elapsed > 0.0 ? answered * 60.0 / elapsed : 0.0);
+    printf("  round trip p50 %.2f ms, p99 %.2f ms, max %.2f ms (%u ticks per replay)\n",
+           GetPercentile(latencies, answered, 50.0), GetPercentile(latencies, answered, 99.0),
+           answered > 0 ? latencies[answered - 1] : 0.0, replay->header->tickCount);
+
+    VerifyStats stats;
+
+    if (RequestStats(path, &stats))
+    {
+        printf("Server:\n");
+        PrintServiceStats(&stats);
+    }
+
+    free(clients);
+    free(latencies);
+
+    return answered == count ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    const char* socketPath = VERIFY_SOCKET_PATH;
+    int threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* arguments[8];
+    int argumentCount = 0;
+
+    // --options anywhere, the rest in order
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+        {
+            socketPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threadCount = atoi(argv[++i]);
+        }
+        else if (argumentCount < 8)
+        {
+            arguments[argumentCount++] = argv[i];
+        }
+    }
+
+    threadCount = threadCount < 1 ? 1 : threadCount;
+
+    if (argumentCount >= 1 && strcmp(arguments[0], "serve") == 0)
+    {
+        return Serve(socketPath, threadCount);
+    }
+
+    if (argumentCount >= 1 && strcmp(arguments[0], "stats") == 0)
+    {
+        VerifyStats stats;
+
+        if (!RequestStats(socketPath, &stats))
+        {
+            return 1;
+        }
+
+        PrintServiceStats(&stats);
+        return 0;
+    }
+
+    if (argumentCount < 2 || (strcmp(arguments[0], "submit") != 0 && strcmp(arguments[0], "bench") != 0))
+    {
+        printf("Usage: %s serve [--threads n] | submit <replay> [score maxCombo] | bench <replay> [count] [connections]"
+               " | stats  (all take --socket <path>, default %s)\n", argv[0], VERIFY_SOCKET_PATH);
+        return 1;
+    }
+
+    Replay replay;
+
+    if (!OpenReplay(arguments[1], &replay))
+    {
+        return 1;
+    }
+
+    int result;
+
+    if (strcmp(arguments[0], "submit") == 0)
+    {
+        bool claimed = argumentCount >= 4;
+        result = Submit(socketPath, &replay, claimed ? atoi(arguments[2]) : replay.header->finalScore,
+                        claimed ? atoi(arguments[3]) : replay.header->finalMaxCombo);
+    }
+    else
+    {
+        result = Bench(socketPath, &replay, argumentCount >= 3 ? atoi(arguments[2]) : 1000,
+                       argumentCount >= 4 ? atoi(arguments[3]) : threadCount);
+    }
+
+    CloseReplay(&replay);
+
+    return result;
+}
@@ -0,0 +1,574 @@
+﻿#include "Rollback.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// On the wire, followed by inputCount ReplayInputs. Both ends run the same build, so no byte swapping
+typedef struct RollbackPacket
+{
+    uint32_t magic;
+    uint32_t seed;          // Low half of the match seed, packets from another match are ignored
+    int32_t player;         // Sender's
+    int32_t tick;           // Sender's next tick to simulate, for time sync
+    int32_t ackTick;        // The first of our inputs the sender doesn't have yet
+    int32_t firstTick;      // Of the inputs that follow
+    int32_t inputCount;
+    int32_t hashTick;       // -1: no hash yet
+    uint32_t hash;
+    uint32_t reserved;
+    double sentAt;          // Sender's clock
+    double echoSentAt;      // The newest sentAt the sender had from us...
+    double echoHeld;        // ...and how long it sat on it before this packet went out
+} RollbackPacket;
+
+_Static_assert(sizeof(RollbackPacket) == 64, "Rollback packet layout changed");
+_Static_assert(sizeof(RollbackPacket) + ROLLBACK_MAX_PACKET_INPUTS * sizeof(ReplayInput) <= UDP_MAX_PACKET,
+               "Rollback packets have to fit in one datagram");
+
+typedef struct DelayedPacket
+{
+    double sendAt;
+    int size;
+    unsigned char data[UDP_MAX_PACKET];
+} DelayedPacket;
+
+typedef struct ConfirmedHash
+{
+    int tick;               // -1: empty
+    uint32_t hash;
+} ConfirmedHash;
+
+struct RollbackSession
+{
+    VersusMatch match;
+    int localPlayer;
+    int inputDelay;
+    uint64_t seed;
+
+    UdpSocket socket;
+    UdpAddress remote;
+    NetConditions conditions;
+    SimRandom lossRandom;   // The injector's dice. Nothing to do with the simulation's
+    DelayedPacket delayed[ROLLBACK_DELAY_SLOTS];
+    int delayedCount;
+
+    double clock;           // Real time the next tick starts at
+    bool connected;
+
+    // Inputs by tick, modulo ROLLBACK_INPUT_HISTORY
+    ReplayInput localInputs[ROLLBACK_INPUT_HISTORY];
+    ReplayInput remoteInputs[ROLLBACK_INPUT_HISTORY];
+    ReplayInput usedRemote[ROLLBACK_INPUT_HISTORY];     // What each tick actually ran with, guess or not
+    int localInputTick;     // The first tick without local input yet
+    int remoteInputTick;    // The first tick without remote input yet: everything before it is confirmed
+    int remoteAckTick;      // The first of our inputs the peer doesn't have yet
+    int firstMismatch;      // Earliest tick that ran on a wrong guess, INT_MAX: none
+
+    VersusState saved[ROLLBACK_WINDOW];                 // State before each tick, modulo ROLLBACK_WINDOW
+
+    ConfirmedHash localHashes[ROLLBACK_HASH_HISTORY];
+    ConfirmedHash remoteHashes[ROLLBACK_HASH_HISTORY];
+    int nextHashTick;
+
+    // Time sync
+    int remoteTick;
+    double remoteTickAt;
+    int nextSyncTick;
+
+    // RTT
+    double lastRemoteSentAt;
+    double lastRemoteSentReceivedAt;
+
+    RollbackStats stats;
+};
+
+RollbackSession* CreateRollbackSession(const RollbackConfig* config)
+{
+    if (config->localPlayer < 0 || config->localPlayer >= VERSUS_PLAYERS)
+    {
+        printf("Versus: player has to be 0 or 1\n");
+        return NULL;
+    }
+
+    RollbackSession* session = calloc(1, sizeof(RollbackSession));
+
+    if (session == NULL)
+    {
+        printf("Versus: out of memory\n");
+        return NULL;
+    }
+
+    if (!ResolveUdpAddress(config->remoteHost, config->remotePort, &session->remote))
+    {
+        free(session);
+        return NULL;
+    }
+
+    session->socket = OpenUdpSocket(config->localPort);
+
+    if (session->socket == UDP_INVALID_SOCKET)
+    {
+        free(session);
+        return NULL;
+    }
+
+    session->localPlayer = config->localPlayer;
+    session->inputDelay = config->inputDelay > 0 ? config->inputDelay : ROLLBACK_DEFAULT_INPUT_DELAY;
+    session->inputDelay = session->inputDelay < ROLLBACK_MAX_INPUT_DELAY ? session->inputDelay : ROLLBACK_MAX_INPUT_DELAY;
+    session->seed = config->seed;
+    session->conditions = config->conditions;
+    session->lossRandom = SeedSimRandom(config->seed ^ (uint64_t)(config->localPlayer + 1) * 0x9E3779B97F4A7C15ull);
+
+    InitVersusMatch(&session->match, config->screenWidth, config->screenHeight, config->seed);
+
+    // The first inputDelay ticks have no input on either side, so they're known from the start
+    session->localInputTick = session->inputDelay;
+    session->remoteInputTick = session->inputDelay;
+    session->firstMismatch = INT_MAX;
+    session->nextHashTick = ROLLBACK_HASH_INTERVAL;
+    session->nextSyncTick = ROLLBACK_SYNC_INTERVAL;
+
+    for (int i = 0; i < ROLLBACK_HASH_HISTORY; i++)
+    {
+        session->localHashes[i].tick = -1;
+        session->remoteHashes[i].tick = -1;
+    }
+
+    session->stats.desyncTick = -1;
+
+    return session;
+}
+
+void DestroyRollbackSession(RollbackSession* session)
+{
+    if (session == NULL)
+    {
+        return;
+    }
+
+    CloseUdpSocket(session->socket);
+    FreeVersusMatch(&session->match);
+    free(session);
+}
+
+static bool SameInput(const ReplayInput* a, const ReplayInput* b)
+{
+    return a->flags == b->flags && memcmp(&a->moveSeconds, &b->moveSeconds, sizeof(float)) == 0;
+}
+
+// What we run a tick with when the peer's input isn't here yet: the last one we had, still held, but no new launch
+static ReplayInput GetRemoteInput(const RollbackSession* session, int tick)
+{
+    if (tick < session->remoteInputTick)
+    {
+        return session->remoteInputs[tick % ROLLBACK_INPUT_HISTORY];
+    }
+
+    ReplayInput guess = {0};
+
+    if (session->remoteInputTick > 0)
+    {
+        guess = session->remoteInputs[(session->remoteInputTick - 1) % ROLLBACK_INPUT_HISTORY];
+    }
+
+    guess.flags &= ~(uint32_t)(REPLAY_INPUT_LAUNCH | REPLAY_INPUT_STEER_LEFT | REPLAY_INPUT_STEER_RIGHT);
+    return guess;
+}
+
+// The next tick of the match: save the state before it (for rollbacks), then step with what we know or guess
+static void SimulateTick(RollbackSession* session)
+{
+    int tick = session->match.tick;
+    ReplayInput local = session->localInputs[tick % ROLLBACK_INPUT_HISTORY];
+    ReplayInput remote = GetRemoteInput(session, tick);
+
+    SaveVersusState(&session->match, &session->saved[tick % ROLLBACK_WINDOW]);
+    session->usedRemote[tick % ROLLBACK_INPUT_HISTORY] = remote;
+
+    SimInput inputs[VERSUS_PLAYERS];
+    inputs[session->localPlayer] = UnpackReplayInput(local.flags, local.moveSeconds);
+    inputs[1 - session->localPlayer] = UnpackReplayInput(remote.flags, remote.moveSeconds);
+
+    StepVersusMatch(&session->match, inputs);
+}
+
+static void RollBack(RollbackSession* session)
+{
+    int from = session->firstMismatch;
+    int to = session->match.tick;
+
+    session->firstMismatch = INT_MAX;
+
+    if (from >= to)
+    {
+        return;
+    }
+
+    // Never happens: we stop simulating before anything unconfirmed can leave the window
+    if (to - from >= ROLLBACK_WINDOW)
+    {
+        printf("Versus: can't roll back %d ticks, only %d are saved\n", to - from, ROLLBACK_WINDOW);
+        return;
+    }
+
+    LoadVersusState(&session->match, &session->saved[from % ROLLBACK_WINDOW]);
+
+    while (session->match.tick < to)
+    {
+        SimulateTick(session);
+    }
+
+    int depth = to - from;
+    session->stats.rollbacks++;
+    session->stats.rolledBackTicks += depth;
+    session->stats.longestRollback = depth > session->stats.longestRollback ? depth : session->stats.longestRollback;
+}
+
+static void SendPacket(RollbackSession* session, const void* data, int size, double now)
+{
+    NetConditions* conditions = &session->conditions;
+
+    if (conditions->lossPercent > 0.0f && SimRandomFloat(&session->lossRandom) * 100.0f < conditions->lossPercent)
+    {
+        session->stats.packetsDropped++;
+        return;
+    }
+
+    if (conditions->delayMs <= 0 && conditions->jitterMs <= 0)
+    {
+        SendUdp(session->socket, &session->remote, data, size);
+        session->stats.packetsSent++;
+        return;
+    }
+
+    // The injector is full: that's a lot of packets in flight, treat it as loss
+    if (session->delayedCount == ROLLBACK_DELAY_SLOTS)
+    {
+        session->stats.packetsDropped++;
+        return;
+    }
+
+    int jitter = conditions->jitterMs > 0 ? SimRandomRange(&session->lossRandom, -conditions->jitterMs, conditions->jitterMs) : 0;
+    int delay = conditions->delayMs + jitter > 0 ? conditions->delayMs + jitter : 0;
+
+    DelayedPacket* packet = &session->delayed[session->delayedCount++];
+    packet->sendAt = now + delay / 1000.0;
+    packet->size = size;
+    memcpy(packet->data, data, (size_t)size);
+}
+
+static void FlushDelayedPackets(RollbackSession* session, double now)
+{
+    int kept = 0;
+
+    for (int i = 0; i < session->delayedCount; i++)
+    {
+        DelayedPacket* packet = &session->delayed[i];
+
+        if (packet->sendAt > now)
+        {
+            if (kept != i)
+            {
+                session->delayed[kept] = *packet;
+            }
+
+            kept++;
+            continue;
+        }
+
+        SendUdp(session->socket, &session->remote, packet->data, packet->size);
+        session->stats.packetsSent++;
+    }
+
+    session->delayedCount = kept;
+}
+
+// Everything the peer hasn't acknowledged, oldest first, and our newest confirmed hash
+static void SendInputs(RollbackSession* session, double now)
+{
+    unsigned char buffer[UDP_MAX_PACKET];
+    RollbackPacket* packet = (RollbackPacket*)buffer;
+    ReplayInput* inputs = (ReplayInput*)(buffer + sizeof(RollbackPacket));
+
+    // RunRollbackSession stalls before this could be more than a packet holds
+    int first = session->remoteAckTick;
+
+    memset(packet, 0, sizeof(*packet));
+    packet->magic = ROLLBACK_PACKET_MAGIC;
+    packet->seed = (uint32_t)session->seed;
+    packet->player = session->localPlayer;
+    packet->tick = session->match.tick;
+    packet->ackTick = session->remoteInputTick;
+    packet->firstTick = first;
+    packet->inputCount = session->localInputTick - first;
+    packet->hashTick = -1;
+    packet->sentAt = now;
+    packet->echoSentAt = session->lastRemoteSentAt;
+    packet->echoHeld = session->lastRemoteSentAt > 0.0 ? now - session->lastRemoteSentReceivedAt : 0.0;
+
+    int newestHash = (session->nextHashTick / ROLLBACK_HASH_INTERVAL - 1) % ROLLBACK_HASH_HISTORY;
+
+    if (session->nextHashTick > ROLLBACK_HASH_INTERVAL && session->localHashes[newestHash].tick >= 0)
+    {
+        packet->hashTick = session->localHashes[newestHash].tick;
+        packet->hash = session->localHashes[newestHash].hash;
+    }
+
+    for (int i = 0; i < packet->inputCount; i++)
+    {
+        inputs[i] = session->localInputs[(first + i) % ROLLBACK_INPUT_HISTORY];
+    }
+
+    SendPacket(session, buffer, (int)sizeof(RollbackPacket) + packet->inputCount * (int)sizeof(ReplayInput), now);
+}
+
+static void CompareHashes(RollbackSession* session, int slot)
+{
+    const ConfirmedHash* local = &session->localHashes[slot];
+    const ConfirmedHash* remote = &session->remoteHashes[slot];
+
+    if (local->tick < 0 || local->tick != remote->tick)
+    {
+        return;
+    }
+
+    if (local->hash == remote->hash)
+    {
+        session->stats.checkedHashes++;
+    }
+    else if (session->stats.desyncTick < 0 || local->tick < session->stats.desyncTick)
+    {
+        session->stats.desyncTick = local->tick;
+        printf("Versus: DESYNC by tick %d (ours %08x, theirs %08x)\n", local->tick, local->hash, remote->hash);
+    }
+}
+
+static void ReceivePacket(RollbackSession* session, const unsigned char* data, int size, double now)
+{
+    const RollbackPacket* packet = (const RollbackPacket*)data;
+
+    if (size < (int)sizeof(RollbackPacket) || packet->magic != ROLLBACK_PACKET_MAGIC ||
+        packet->inputCount < 0 || packet->inputCount > ROLLBACK_MAX_PACKET_INPUTS ||
+        size != (int)sizeof(RollbackPacket) + packet->inputCount * (int)sizeof(ReplayInput))
+    {
+        return;
+    }
+
+    if (packet->seed != (uint32_t)session->seed || packet->player == session->localPlayer)
+    {
+        printf("Versus: ignoring a packet from a different match (seed or player number don't fit)\n");
+        return;
+    }
+
+    session->stats.packetsReceived++;
+
+    if (!session->connected)
+    {
+        session->connected = true;
+        session->clock = now;
+        printf("Versus: connected, you are player %d\n", session->localPlayer);
+    }
+
+    // Packets can arrive out of order, so only ever move forward
+    if (packet->ackTick > session->remoteAckTick)
+    {
+        session->remoteAckTick = packet->ackTick;
+    }
+
+    if (packet->tick > session->remoteTick)
+    {
+        session->remoteTick = packet->tick;
+        session->remoteTickAt = now;
+    }
+
+    if (packet->sentAt > session->lastRemoteSentAt)
+    {
+        session->lastRemoteSentAt = packet->sentAt;
+        session->lastRemoteSentReceivedAt = now;
+    }
+
+    if (packet->echoSentAt > 0.0)
+    {
+        double rtt = (now - packet->echoSentAt - packet->echoHeld) * 1000.0;
+        session->stats.rttMs = session->stats.rttMs == 0.0 ? rtt : session->stats.rttMs * 0.9 + rtt * 0.1;
+    }
+
+    const ReplayInput* inputs = (const ReplayInput*)(data + sizeof(RollbackPacket));
+
+    for (int i = 0; i < packet->inputCount; i++)
+    {
+        int tick = packet->firstTick + i;
+
+        // Already have it, or there's a gap before it (can't happen with in-order acks, but packets are packets)
+        if (tick != session->remoteInputTick)
+        {
+            continue;
+        }
+
+        session->remoteInputs[tick % ROLLBACK_INPUT_HISTORY] = inputs[i];
+        session->remoteInputTick++;
+
+        // Already simulated with a guess: if the guess was wrong, everything from here is
+        if (tick < session->match.tick && !SameInput(&session->usedRemote[tick % ROLLBACK_INPUT_HISTORY], &inputs[i]) &&
+            tick < session->firstMismatch)
+        {
+            session->firstMismatch = tick;
+        }
+    }
+
+    // Every packet repeats the peer's newest hash, only a new one needs comparing
+    int slot = (packet->hashTick / ROLLBACK_HASH_INTERVAL) % ROLLBACK_HASH_HISTORY;
+
+    if (packet->hashTick >= 0 && packet->hashTick % ROLLBACK_HASH_INTERVAL == 0 && session->remoteHashes[slot].tick != packet->hashTick)
+    {
+        session->remoteHashes[slot].tick = packet->hashTick;
+        session->remoteHashes[slot].hash = packet->hash;
+        CompareHashes(session, slot);
+    }
+}
+
+// Hash the saved states that can't change any more: every input before them is confirmed, and they've run
+static void RecordConfirmedHashes(RollbackSession* session)
+{
+    int confirmed = session->remoteInputTick < session->match.tick ? session->remoteInputTick : session->match.tick - 1;
+
+    session->stats.confirmedTick = confirmed;
+
+    while (session->nextHashTick <= confirmed && session->nextHashTick < session->match.tick)
+    {
+        int tick = session->nextHashTick;
+        int slot = (tick / ROLLBACK_HASH_INTERVAL) % ROLLBACK_HASH_HISTORY;
+
+        // Fell out of the window somehow (a long hitch), skip ahead rather than hash the wrong tick
+        if (session->match.tick - tick >= ROLLBACK_WINDOW)
+        {
+            session->nextHashTick += ROLLBACK_HASH_INTERVAL;
+            continue;
+        }
+
+        session->localHashes[slot].tick = tick;
+        session->localHashes[slot].hash = HashVersusState(&session->saved[tick % ROLLBACK_WINDOW]);
+        session->nextHashTick += ROLLBACK_HASH_INTERVAL;
+
+        CompareHashes(session, slot);
+    }
+}
+
+// Ticks we're ahead of the peer right now: its last reported tick, plus what it ran since then
+static float GetAdvantage(const RollbackSession* session, double now)
+{
+    double oneWay = session->stats.rttMs / 2000.0;
+    double remoteNow = session->remoteTick + (now - session->remoteTickAt + oneWay) * SIM_TICK_RATE;
+
+    return (float)(session->match.tick - remoteNow);
+}
+
+void RunRollbackSession(RollbackSession* session, double now, RollbackInputSource source, void* context)
+{
+    unsigned char buffer[UDP_MAX_PACKET];
+    UdpAddress from;
+    int size;
+
+    while ((size = ReceiveUdp(session->socket, &from, buffer, sizeof(buffer))) > 0)
+    {
+        if (SameUdpAddress(&from, &session->remote))
+        {
+            ReceivePacket(session, buffer, size, now);
+        }
+    }
+
+    if (session->firstMismatch != INT_MAX)
+    {
+        RollBack(session);
+    }
+
+    if (session->connected)
+    {
+        int ticks = 0;
+
+        session->stats.advantage = GetAdvantage(session, now);
+
+        while (session->clock + SIM_DT <= now)
+        {
+            int tick = session->match.tick;
+
+            // A long hitch: drop the time instead of freezing up trying to simulate all of it
+            if (ticks == SIM_MAX_TICKS_PER_FRAME)
+            {
+                session->clock = now;
+                break;
+            }
+
+            /* Sit a tick out when we're too far ahead: either nothing's confirmed for almost the whole window
+             * (the next tick couldn't be rolled back), the next input wouldn't fit in a packet with everything
+             * the peer hasn't acknowledged (it only takes inputs in order, it would never catch up),
+             * or the peer is behind us and we should let it catch up.
+             * The input of the tick we skip isn't lost, it carries over into the next one. */
+            bool windowFull = tick - session->remoteInputTick >= ROLLBACK_WINDOW - 1;
+            bool unackedFull = tick + session->inputDelay + 1 - session->remoteAckTick > ROLLBACK_MAX_PACKET_INPUTS;
+            bool aheadOfPeer = session->stats.advantage > ROLLBACK_SYNC_THRESHOLD && tick >= session->nextSyncTick;
+
+            if (windowFull || unackedFull || aheadOfPeer)
+            {
+                session->nextSyncTick = aheadOfPeer ? tick + ROLLBACK_SYNC_INTERVAL : session->nextSyncTick;
+                session->stats.advantage -= 1.0f;
+                session->stats.stalls++;
+                session->clock += SIM_DT;
+                ticks++;
+                continue;
+            }
+
+            SimInput input = source(context, &session->match, session->clock, session->clock + SIM_DT);
+            int inputTick = tick + session->inputDelay;
+
+            session->localInputs[inputTick % ROLLBACK_INPUT_HISTORY] = PackReplayInput(&input);
+            session->localInputTick = inputTick + 1;
+
+            SimulateTick(session);
+            session->clock += SIM_DT;
+            ticks++;
+        }
+
+        RecordConfirmedHashes(session);
+    }
+
+    // Until we've heard from the peer this is just a hello, with no inputs past the delay ticks
+    SendInputs(session, now);
+    FlushDelayedPackets(session, now);
+
+    session->stats.connected = session->connected;
+}
+
+const VersusMatch* GetRollbackMatch(const RollbackSession* session)
+{
+    return &session->match;
+}
+
+int GetRollbackLocalPlayer(const RollbackSession* session)
+{
+    return session->localPlayer;
+}
+
+RollbackStats GetRollbackStats(const RollbackSession* session)
+{
+    return session->stats;
+}
+
+bool GetConfirmedHash(const RollbackSession* session, int tick, uint32_t* hash)
+{
+    if (tick < 0 || tick % ROLLBACK_HASH_INTERVAL != 0)
+    {
+        return false;
+    }
+
+    const ConfirmedHash* entry = &session->localHashes[(tick / ROLLBACK_HASH_INTERVAL) % ROLLBACK_HASH_HISTORY];
+
+    if (entry->tick != tick)
+    {
+        return false;
+    }
+
+    *hash = entry->hash;
+    return true;
+}
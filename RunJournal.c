@@ -0,0 +1,807 @@
+﻿#include "RunJournal.h"
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <io.h>         // _commit
+    #include <windows.h>    // MoveFileExA (this file never includes raylib, so no name clashes)
+#else
+    #include <unistd.h>     // fsync
+#endif
+
+#define RUN_READ_CHUNK 4096
+
+// ---------------------------------------------------------------------------------
+// Order-statistic treap
+// ---------------------------------------------------------------------------------
+
+// "Better" means ranked higher: bigger score first, and on ties the run that happened first
+static bool IsBetterRun(const RunRecord* a, const RunRecord* b)
+{
+    if (a->score != b->score)
+    {
+        return a->score > b->score;
+    }
+
+    return a->sequence < b->sequence;
+}
+
+static unsigned int NextPriority(RunJournal* journal)
+{
+    unsigned int x = journal->prioritySeed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    journal->prioritySeed = x;
+
+    return x;
+}
+
+static int NodeSize(const RunJournal* journal, int node)
+{
+    return node < 0 ? 0 : journal->nodes[node].size;
+}
+
+static void UpdateNodeSize(RunJournal* journal, int node)
+{
+    RunIndexNode* n = &journal->nodes[node];
+    n->size = 1 + NodeSize(journal, n->left) + NodeSize(journal, n->right);
+}
+
+static bool ReserveNodes(RunJournal* journal, int count)
+{
+    if (count <= journal->nodeCapacity)
+    {
+        return true;
+    }
+
+    // Doubling past INT_MAX / 2 would overflow, so the last step goes straight to what's asked for
+    size_t newCapacity = journal->nodeCapacity > 0 ? (size_t)journal->nodeCapacity : 1024;
+
+    while (newCapacity < (size_t)count)
+    {
+        newCapacity = newCapacity <= INT_MAX / 2 ? newCapacity * 2 : (size_t)count;
+    }
+
+    RunIndexNode* nodes = NULL;
+
+    if (newCapacity <= SIZE_MAX / sizeof(RunIndexNode))
+    {
+        nodes = realloc(journal->nodes, newCapacity * sizeof(RunIndexNode));
+    }
+
+    if (!nodes)
+    {
+        printf("Failed to grow run index to %zu entries\n", newCapacity);
+        return false;
+    }
+
+    journal->nodes = nodes;
+    journal->nodeCapacity = (int)newCapacity;
+
+    return true;
+}
+
+// Splits a subtree into runs ranked above the key (left) and everything else (right)
+static void SplitIndex(RunJournal* journal, int node, const RunRecord* key, int* left, int* right)
+{
+    if (node < 0)
+    {
+        *left = -1;
+        *right = -1;
+        return;
+    }
+
+    RunIndexNode* n = &journal->nodes[node];
+
+    if (IsBetterRun(&n->record, key))
+    {
+        SplitIndex(journal, n->right, key, &n->right, right);
+        *left = node;
+    }
+    else
+    {
+        SplitIndex(journal, n->left, key, left, &n->left);
+        *right = node;
+    }
+
+    UpdateNodeSize(journal, node);
+}
+
+static int InsertNode(RunJournal* journal, int node, int newNode)
+{
+    if (node < 0)
+    {
+        return newNode;
+    }
+
+    RunIndexNode* n = &journal->nodes[node];
+    RunIndexNode* inserted = &journal->nodes[newNode];
+
+    // Higher priority floats up: the new node takes this spot and splits the subtree under it
+    if (inserted->priority > n->priority)
+    {
+        SplitIndex(journal, node, &inserted->record, &inserted->left, &inserted->right);
+        UpdateNodeSize(journal, newNode);
+        return newNode;
+    }
+
+    if (IsBetterRun(&inserted->record, &n->record))
+    {
+        n->left = InsertNode(journal, n->left, newNode);
+    }
+    else
+    {
+        n->right = InsertNode(journal, n->right, newNode);
+    }
+
+    UpdateNodeSize(journal, node);
+    return node;
+}
+
+void InsertRunRecord(RunJournal* journal, RunRecord record)
+{
+    if (!ReserveNodes(journal, journal->nodeCount + 1))
+    {
+        return;
+    }
+
+    int newNode = journal->nodeCount++;
+
+    journal->nodes[newNode] = (RunIndexNode)
+    {
+        .record = record,
+        .left = -1,
+        .right = -1,
+        .size = 1,
+        .priority = NextPriority(journal)
+    };
+
+    journal->root = InsertNode(journal, journal->root, newNode);
+
+    if (record.sequence >= journal->nextSequence)
+    {
+        journal->nextSequence = record.sequence + 1;
+    }
+}
+
+/* Snapshots are already in rank order, so instead of n inserts (n log n)
+ * we build a perfectly balanced tree straight from the sorted nodes in O(n). */
+static int BuildBalancedIndex(RunJournal* journal, int low, int high)
+{
+    if (low > high)
+    {
+        return -1;
+    }
+
+    int middle = low + (high - low) / 2;
+    RunIndexNode* n = &journal->nodes[middle];
+
+    n->left = BuildBalancedIndex(journal, low, middle - 1);
+    n->right = BuildBalancedIndex(journal, middle + 1, high);
+    UpdateNodeSize(journal, middle);
+
+    return middle;
+}
+
+// After a balanced build we still need valid heap priorities, so we sift them down bottom-up
+static void HeapifyIndex(RunJournal* journal, int node)
+{
+    if (node < 0)
+    {
+        return;
+    }
+
+    HeapifyIndex(journal, journal->nodes[node].left);
+    HeapifyIndex(journal, journal->nodes[node].right);
+
+    int current = node;
+
+    while (current >= 0)
+    {
+        RunIndexNode* n = &journal->nodes[current];
+        int largest = current;
+
+        if (n->left >= 0 && journal->nodes[n->left].priority > journal->nodes[largest].priority)
+        {
+            largest = n->left;
+        }
+
+        if (n->right >= 0 && journal->nodes[n->right].priority > journal->nodes[largest].priority)
+        {
+            largest = n->right;
+        }
+
+        if (largest == current)
+        {
+            break;
+        }
+
+        unsigned int swap = n->priority;
+        n->priority = journal->nodes[largest].priority;
+        journal->nodes[largest].priority = swap;
+        current = largest;
+    }
+}
+
+int GetRunCount(const RunJournal* journal)
+{
+    return NodeSize(journal, journal->root);
+}
+
+// 1-based rank: 1 + how many runs are ranked above this one
+int GetRunRank(const RunJournal* journal, const RunRecord* record)
+{
+    int better = 0;
+    int node = journal->root;
+
+    while (node >= 0)
+    {
+        const RunIndexNode* n = &journal->nodes[node];
+
+        if (IsBetterRun(&n->record, record))
+        {
+            better += 1 + NodeSize(journal, n->left);
+            node = n->right;
+        }
+        else
+        {
+            node = n->left;
+        }
+    }
+
+    return better + 1;
+}
+
+bool GetRunAtRank(const RunJournal* journal, int rank, RunRecord* outRecord)
+{
+    int node = journal->root;
+
+    while (node >= 0)
+    {
+        const RunIndexNode* n = &journal->nodes[node];
+        int leftSize = NodeSize(journal, n->left);
+
+        if (rank <= leftSize)
+        {
+            node = n->left;
+        }
+        else if (rank == leftSize + 1)
+        {
+            *outRecord = n->record;
+            return true;
+        }
+        else
+        {
+            rank -= leftSize + 1;
+            node = n->right;
+        }
+    }
+
+    return false;
+}
+
+/* In-order walk that stops after `count` runs: O(log n + count).
+ * If the tree ever gets deeper than the stack, the rest comes from rank lookups instead, slower but never short */
+int GetTopRuns(const RunJournal* journal, RunRecord* outRecords, int count)
+{
+    int stack[RUN_INDEX_MAX_DEPTH];
+    int stackSize = 0;
+    int found = 0;
+    int node = journal->root;
+
+    while ((node >= 0 || stackSize > 0) && found < count)
+    {
+        while (node >= 0)
+        {
+            if (stackSize == RUN_INDEX_MAX_DEPTH)
+            {
+                while (found < count && GetRunAtRank(journal, found + 1, &outRecords[found]))
+                {
+                    found++;
+                }
+
+                return found;
+            }
+
+            stack[stackSize++] = node;
+            node = journal->nodes[node].left;
+        }
+
+        node = stack[--stackSize];
+        outRecords[found++] = journal->nodes[node].record;
+        node = journal->nodes[node].right;
+    }
+
+    return found;
+}
+
+// ---------------------------------------------------------------------------------
+// Files
+// ---------------------------------------------------------------------------------
+
+// FNV-1a over everything but the checksum itself
+unsigned int CalculateRunChecksum(const RunRecord* record)
+{
+    const unsigned char* bytes = (const unsigned char*)record;
+    unsigned int hash = 2166136261u;
+
+    for (size_t i = 0; i < offsetof(RunRecord, checksum); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// Pushes everything we wrote all the way down to the disk, not just into the OS cache
+static bool SyncRunFile(FILE* file)
+{
+    if (fflush(file) != 0)
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Atomic swap of a finished temp file over the real one: readers see either the old or the new file, never half
+bool ReplaceRunFile(const char* tempPath, const char* path)
+{
+#ifdef _WIN32
+    return MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(tempPath, path) == 0;
+#endif
+}
+
+static bool WriteEmptyJournal(unsigned int generation)
+{
+    const char* tempPath = RUN_JOURNAL_FILE ".tmp";
+    FILE* file = fopen(tempPath, "wb");
+
+    if (!file)
+    {
+        printf("Failed to create run journal\n");
+        return false;
+    }
+
+    RunFileHeader header =
+    {
+        .magic = RUN_JOURNAL_MAGIC,
+        .version = RUN_JOURNAL_VERSION,
+        .generation = generation
+    };
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    written = SyncRunFile(file) && written;
+    written = (fclose(file) == 0) && written;
+
+    return written && ReplaceRunFile(tempPath, RUN_JOURNAL_FILE);
+}
+
+static bool LoadRunSnapshot(RunJournal* journal)
+{
+    FILE* file = fopen(RUN_SNAPSHOT_FILE, "rb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    RunFileHeader header;
+    long long records = -1;
+
+    // The count is only as good as the file: never reserve for more records than are actually there
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        records = ((long long)ftell(file) - (long long)sizeof(header)) / (long long)sizeof(RunRecord);
+    }
+
+    if (records < 0 || fseek(file, 0, SEEK_SET) != 0 || fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != RUN_SNAPSHOT_MAGIC || header.version != RUN_JOURNAL_VERSION ||
+        header.count > (unsigned long long)records || header.count > INT_MAX ||
+        !ReserveNodes(journal, (int)header.count))
+    {
+        printf("Ignoring unreadable run snapshot\n");
+        fclose(file);
+        return false;
+    }
+
+    // Read straight into the node pool, chunk by chunk
+    RunRecord chunk[RUN_READ_CHUNK];
+    int loaded = 0;
+
+    while (loaded < (int)header.count)
+    {
+        int wanted = (int)header.count - loaded;
+        wanted = wanted < RUN_READ_CHUNK ? wanted : RUN_READ_CHUNK;
+
+        size_t read = fread(chunk, sizeof(RunRecord), wanted, file);
+
+        for (size_t i = 0; i < read; i++)
+        {
+            if (chunk[i].checksum != CalculateRunChecksum(&chunk[i]))
+            {
+                continue; // Skip damaged records, keep the rest
+            }
+
+            journal->nodes[loaded].record = chunk[i];
+            journal->nodes[loaded].priority = NextPriority(journal);
+
+            if (chunk[i].sequence >= journal->nextSequence)
+            {
+                journal->nextSequence = chunk[i].sequence + 1;
+            }
+
+            loaded++;
+        }
+
+        if ((int)read < wanted)
+        {
+            header.count = loaded; // Truncated snapshot, use what we got
+            break;
+        }
+    }
+
+    fclose(file);
+
+    journal->nodeCount = loaded;
+    journal->root = BuildBalancedIndex(journal, 0, loaded - 1);
+    HeapifyIndex(journal, journal->root);
+
+    journal->generation = header.generation;
+    journal->journalOffset = header.journalOffset;
+
+    return true;
+}
+
+// Replays everything in the journal past the point we've already loaded
+static bool LoadJournalTail(RunJournal* journal)
+{
+    FILE* file = fopen(RUN_JOURNAL_FILE, "rb");
+    RunFileHeader header;
+
+    if (!file || fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != RUN_JOURNAL_MAGIC || header.version != RUN_JOURNAL_VERSION ||
+        header.generation < journal->generation)
+    {
+        // No journal yet (or a stale one from before our snapshot): start a fresh generation
+        if (file)
+        {
+            fclose(file);
+        }
+
+        journal->generation++;
+        journal->journalOffset = sizeof(RunFileHeader);
+
+        return WriteEmptyJournal(journal->generation);
+    }
+
+    // A newer generation than our snapshot means the snapshot already covers the old journal entirely
+    if (header.generation > journal->generation || journal->journalOffset < (long long)sizeof(RunFileHeader))
+    {
+        journal->generation = header.generation;
+        journal->journalOffset = sizeof(RunFileHeader);
+    }
+
+    fseek(file, (long)journal->journalOffset, SEEK_SET);
+
+    RunRecord chunk[RUN_READ_CHUNK];
+    bool damaged = false;
+    size_t read;
+
+    while (!damaged && (read = fread(chunk, sizeof(RunRecord), RUN_READ_CHUNK, file)) > 0)
+    {
+        for (size_t i = 0; i < read; i++)
+        {
+            if (chunk[i].checksum != CalculateRunChecksum(&chunk[i]))
+            {
+                damaged = true;
+                break;
+            }
+
+            InsertRunRecord(journal, chunk[i]);
+            journal->journalOffset += sizeof(RunRecord);
+            journal->appendsSinceCompaction++;
+        }
+    }
+
+    // A half-written record at the end (crash mid-append) also counts as damage
+    fseek(file, 0, SEEK_END);
+    damaged = damaged || ftell(file) != (long)journal->journalOffset;
+    fclose(file);
+
+    // Anything after a damaged record can't be trusted, so we fold the good part into a new snapshot
+    if (damaged)
+    {
+        printf("Run journal has a damaged tail, compacting\n");
+
+        if (!CompactRunFiles())
+        {
+            return false;
+        }
+
+        journal->generation++;
+        journal->journalOffset = sizeof(RunFileHeader);
+        journal->appendsSinceCompaction = 0;
+    }
+
+    return true;
+}
+
+RunJournal InitRunJournal(void)
+{
+    return (RunJournal)
+    {
+        .nodes = NULL,
+        .nodeCount = 0,
+        .nodeCapacity = 0,
+        .root = -1,
+        .generation = 0,
+        .journalOffset = 0,
+        .nextSequence = 1,
+        .appendsSinceCompaction = 0,
+        .prioritySeed = 0x2545F491u,
+        .snapshotLoaded = false
+    };
+}
+
+/* Incremental! The snapshot (our checkpoint) is read once, after that
+ * every call only replays journal records we haven't seen yet. */
+bool LoadRunJournal(RunJournal* journal)
+{
+    if (!journal->snapshotLoaded)
+    {
+        LoadRunSnapshot(journal);
+        journal->snapshotLoaded = true;
+    }
+
+    return LoadJournalTail(journal);
+}
+
+// Memory only! Hands out the next run number and puts the run in the index
+RunRecord CreateRunRecord(RunJournal* journal, int score, int maxCombo)
+{
+    RunRecord record =
+    {
+        .timestamp = (long long)time(NULL),
+        .score = score,
+        .maxCombo = maxCombo,
+        .sequence = journal->nextSequence
+    };
+
+    record.checksum = CalculateRunChecksum(&record);
+    InsertRunRecord(journal, record);
+
+    return record;
+}
+
+// Append-only: a batch of runs goes to the end of the journal with a single sync
+bool WriteRunRecords(const RunRecord* records, int count)
+{
+    FILE* file = fopen(RUN_JOURNAL_FILE, "ab");
+
+    if (!file)
+    {
+        printf("Failed to open run journal\n");
+        return false;
+    }
+
+    bool written = fwrite(records, sizeof(RunRecord), count, file) == (size_t)count;
+    written = SyncRunFile(file) && written;
+    written = (fclose(file) == 0) && written;
+
+    return written;
+}
+
+static int CompareRunRecords(const void* a, const void* b)
+{
+    const RunRecord* runA = a;
+    const RunRecord* runB = b;
+
+    if (IsBetterRun(runA, runB))
+    {
+        return -1;
+    }
+
+    return IsBetterRun(runB, runA) ? 1 : 0;
+}
+
+// Reads the next good record from the snapshot, chunk by chunk
+static bool NextSnapshotRecord(FILE* file, RunRecord* chunk, int* chunkSize, int* chunkIndex, int* remaining, RunRecord* out)
+{
+    while (true)
+    {
+        if (*chunkIndex >= *chunkSize)
+        {
+            if (*remaining <= 0)
+            {
+                return false;
+            }
+
+            int wanted = *remaining < RUN_READ_CHUNK ? *remaining : RUN_READ_CHUNK;
+            *chunkSize = (int)fread(chunk, sizeof(RunRecord), wanted, file);
+            *chunkIndex = 0;
+            *remaining = *chunkSize < wanted ? 0 : *remaining - wanted;
+
+            if (*chunkSize == 0)
+            {
+                return false;
+            }
+        }
+
+        RunRecord* record = &chunk[(*chunkIndex)++];
+
+        if (record->checksum == CalculateRunChecksum(record))
+        {
+            *out = *record;
+            return true;
+        }
+    }
+}
+
+/* Compaction, purely on files so it never needs the game's index:
+ * 1. Work out which journal records the snapshot doesn't have yet (same rules as loading)
+ * 2. Sort those (there are only a few hundred) and merge them with the already sorted snapshot
+ * 3. Write the result to a temp file, sync, and atomically swap it in
+ * 4. Start a fresh, empty journal generation
+ * The snapshot remembers which journal generation/offset it covers, so a crash between
+ * steps 3 and 4 just means the next load skips journal records the snapshot already has. */
+bool CompactRunFiles(void)
+{
+    FILE* snapshot = fopen(RUN_SNAPSHOT_FILE, "rb");
+    RunFileHeader snapshotHeader = {0};
+
+    if (snapshot && (fread(&snapshotHeader, sizeof(snapshotHeader), 1, snapshot) != 1 ||
+        snapshotHeader.magic != RUN_SNAPSHOT_MAGIC || snapshotHeader.version != RUN_JOURNAL_VERSION))
+    {
+        printf("Ignoring unreadable run snapshot\n");
+        fclose(snapshot);
+        snapshot = NULL;
+        snapshotHeader = (RunFileHeader){0};
+    }
+
+    FILE* journalFile = fopen(RUN_JOURNAL_FILE, "rb");
+    RunFileHeader journalHeader = {0};
+    bool journalValid = journalFile && fread(&journalHeader, sizeof(journalHeader), 1, journalFile) == 1 &&
+                        journalHeader.magic == RUN_JOURNAL_MAGIC && journalHeader.version == RUN_JOURNAL_VERSION &&
+                        journalHeader.generation >= snapshotHeader.generation;
+
+    unsigned int generation = journalValid ? journalHeader.generation : snapshotHeader.generation;
+    long long journalOffset = sizeof(RunFileHeader);
+
+    // 1. Journal records the snapshot doesn't cover
+    RunRecord* fresh = NULL;
+    int freshCount = 0;
+
+    if (journalValid)
+    {
+        if (snapshot && snapshotHeader.generation == journalHeader.generation &&
+            snapshotHeader.journalOffset > journalOffset)
+        {
+            journalOffset = snapshotHeader.journalOffset;
+        }
+
+        fseek(journalFile, 0, SEEK_END);
+        long long journalSize = ftell(journalFile);
+        int maxFresh = journalSize > journalOffset ? (int)((journalSize - journalOffset) / sizeof(RunRecord)) : 0;
+
+        fresh = malloc((maxFresh > 0 ? maxFresh : 1) * sizeof(RunRecord));
+        fseek(journalFile, (long)journalOffset, SEEK_SET);
+
+        if (fresh)
+        {
+            freshCount = (int)fread(fresh, sizeof(RunRecord), maxFresh, journalFile);
+        }
+
+        // Stop at the first damaged record, same as loading
+        for (int i = 0; i < freshCount; i++)
+        {
+            if (fresh[i].checksum != CalculateRunChecksum(&fresh[i]))
+            {
+                freshCount = i;
+                break;
+            }
+        }
+
+        journalOffset += (long long)freshCount * sizeof(RunRecord);
+    }
+
+    if (journalFile)
+    {
+        fclose(journalFile);
+    }
+
+    // 2. Sort the fresh ones, then merge while writing
+    qsort(fresh, freshCount, sizeof(RunRecord), CompareRunRecords);
+
+    const char* tempPath = RUN_SNAPSHOT_FILE ".tmp";
+    FILE* file = fopen(tempPath, "wb");
+
+    if (!file)
+    {
+        printf("Failed to open run snapshot\n");
+        free(fresh);
+
+        if (snapshot)
+        {
+            fclose(snapshot);
+        }
+
+        return false;
+    }
+
+    RunFileHeader header =
+    {
+        .magic = RUN_SNAPSHOT_MAGIC,
+        .version = RUN_JOURNAL_VERSION,
+        .generation = generation,
+        .count = 0, // Filled in once we know how many good records made it
+        .journalOffset = journalOffset
+    };
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    RunRecord chunk[RUN_READ_CHUNK];
+    int chunkSize = 0;
+    int chunkIndex = 0;
+    int remaining = snapshot ? (int)snapshotHeader.count : 0;
+
+    RunRecord old;
+    bool hasOld = snapshot && NextSnapshotRecord(snapshot, chunk, &chunkSize, &chunkIndex, &remaining, &old);
+    int freshIndex = 0;
+
+    while (written && (hasOld || freshIndex < freshCount))
+    {
+        if (hasOld && (freshIndex >= freshCount || !IsBetterRun(&fresh[freshIndex], &old)))
+        {
+            written = fwrite(&old, sizeof(RunRecord), 1, file) == 1;
+            hasOld = NextSnapshotRecord(snapshot, chunk, &chunkSize, &chunkIndex, &remaining, &old);
+        }
+        else
+        {
+            written = fwrite(&fresh[freshIndex++], sizeof(RunRecord), 1, file) == 1;
+        }
+
+        header.count++;
+    }
+
+    free(fresh);
+
+    if (snapshot)
+    {
+        fclose(snapshot);
+    }
+
+    // 3. Real count into the header, sync, swap
+    written = written && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    written = SyncRunFile(file) && written;
+    written = (fclose(file) == 0) && written;
+
+    if (!written || !ReplaceRunFile(tempPath, RUN_SNAPSHOT_FILE))
+    {
+        printf("Failed to write run snapshot\n");
+        remove(tempPath);
+        return false;
+    }
+
+    // 4. Fresh journal
+    return WriteEmptyJournal(generation + 1);
+}
+
+void UnloadRunJournal(RunJournal* journal)
+{
+    free(journal->nodes);
+    *journal = InitRunJournal();
+}
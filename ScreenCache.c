@@ -0,0 +1,70 @@
+﻿#include "ScreenCache.h"
+
+ScreenCache InitScreenCache(int width, int height)
+{
+    ScreenCache cache =
+    {
+        .texture = LoadRenderTexture(width, height),
+        .key = 0,
+        .valid = false,
+        .rebuilt = false,
+        .rebuildCount = 0
+    };
+
+    return cache;
+}
+
+// FNV-1a, one int at a time
+unsigned int HashScreenKey(unsigned int key, int value)
+{
+    if (key == 0)
+    {
+        key = 2166136261u;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        key ^= (unsigned int)(value >> (i * 8)) & 0xFF;
+        key *= 16777619u;
+    }
+
+    return key;
+}
+
+/* Call every frame with the current key. Only when the key changed do we open the texture
+ * for drawing, everything else is skipped, which is the whole point! */
+bool BeginScreenCache(ScreenCache* cache, unsigned int key)
+{
+    cache->rebuilt = false;
+
+    if (cache->valid && cache->key == key)
+    {
+        return false;
+    }
+
+    cache->key = key;
+    cache->valid = true;
+    cache->rebuilt = true;
+    cache->rebuildCount++;
+
+    BeginTextureMode(cache->texture);
+    ClearBackground(BLACK);
+
+    return true;
+}
+
+void EndScreenCache(ScreenCache* cache)
+{
+    (void)cache;
+    EndTextureMode();
+}
+
+void InvalidateScreenCache(ScreenCache* cache)
+{
+    cache->valid = false;
+}
+
+void UnloadScreenCache(ScreenCache* cache)
+{
+    UnloadRenderTexture(cache->texture);
+}
@@ -0,0 +1,137 @@
+﻿#include "Simulation.h"
+#include <raylib.h>
+#include "Player.h"
+#include "Timing.h"
+
+static const int raylibKeys[INPUT_KEY_COUNT] =
+{
+    [INPUT_KEY_LEFT] = KEY_LEFT,
+    [INPUT_KEY_RIGHT] = KEY_RIGHT,
+    [INPUT_KEY_DASH] = KEY_LEFT_SHIFT,
+    [INPUT_KEY_LAUNCH] = KEY_SPACE,
+    [INPUT_KEY_REWIND] = KEY_BACKSPACE
+};
+
+/* Without an input thread, the main thread is the producer instead: once per frame we turn raylib's
+ * key state into events. Still frame-quantized, but at least taps shorter than a frame aren't lost. */
+void PollFrameInput(InputState* state, InputQueue* queue)
+{
+    double now = GetPreciseTime();
+    bool tapped[INPUT_KEY_COUNT] = {0};
+
+    // GetKeyPressed remembers keys that went down this frame, even if they're already back up
+    for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed())
+    {
+        for (int i = 0; i < INPUT_KEY_COUNT; i++)
+        {
+            tapped[i] |= key == raylibKeys[i];
+        }
+    }
+
+    for (int i = 0; i < INPUT_KEY_COUNT; i++)
+    {
+        bool down = IsKeyDown(raylibKeys[i]);
+
+        if (tapped[i] && !down && !state->polled[i])
+        {
+            PushInputEvent(queue, (InputEvent){ .time = now, .key = (InputKey)i, .down = true });
+            PushInputEvent(queue, (InputEvent){ .time = now, .key = (InputKey)i, .down = false });
+        }
+        else if (down != state->polled[i])
+        {
+            PushInputEvent(queue, (InputEvent){ .time = now, .key = (InputKey)i, .down = down });
+        }
+
+        state->polled[i] = down;
+    }
+}
+
+// Outside gameplay: keep track of what's held, but a SPACE that closed a menu must not launch the ball
+void DiscardInput(InputState* state, InputQueue* queue, double before)
+{
+    InputEvent event;
+
+    while (PeekInputEvent(queue, &event) && event.time < before)
+    {
+        state->held[event.key] = event.down;
+        PopInputEvent(queue);
+    }
+}
+
+static void AccumulateMovement(SimInput* input, const InputState* state, double seconds)
+{
+    // Same rules as always: right wins over left, dashing only counts while moving
+    float direction = state->held[INPUT_KEY_RIGHT] ? 1.0f : (state->held[INPUT_KEY_LEFT] ? -1.0f : 0.0f);
+
+    if (direction == 0.0f || seconds <= 0.0)
+    {
+        return;
+    }
+
+    bool dashing = state->held[INPUT_KEY_DASH];
+
+    input->moving = true;
+    input->dashing |= dashing;
+    input->moveSeconds += direction * (float)seconds * (dashing ? PLAYER_SPEED_BOOST : 1.0f);
+}
+
+/* Walks through every event inside [tickStart, tickEnd), and integrates the paddle movement
+ * piece by piece in between them. A key held for 1.3 ticks moves the paddle for exactly 1.3 ticks. */
+SimInput BuildTickInput(InputState* state, InputQueue* queue, double tickStart, double tickEnd)
+{
+    SimInput input = {0};
+    double segmentStart = tickStart;
+    InputEvent event;
+
+    while (PeekInputEvent(queue, &event) && event.time < tickEnd)
+    {
+        // Anything older than this tick (we were behind) simply counts from the start of it
+        double at = event.time > segmentStart ? event.time : segmentStart;
+
+        AccumulateMovement(&input, state, at - segmentStart);
+        segmentStart = at;
+
+        if (event.key == INPUT_KEY_LAUNCH && event.down && !state->held[INPUT_KEY_LAUNCH] && !input.launch)
+        {
+            input.launch = true;
+            input.launchSteer = state->held[INPUT_KEY_RIGHT] ? 1 : (state->held[INPUT_KEY_LEFT] ? -1 : 0);
+        }
+
+        state->held[event.key] = event.down;
+        PopInputEvent(queue);
+    }
+
+    AccumulateMovement(&input, state, tickEnd - segmentStart);
+
+    input.left = state->held[INPUT_KEY_LEFT];
+    input.right = state->held[INPUT_KEY_RIGHT];
+    input.dash = state->held[INPUT_KEY_DASH];
+    input.rewind = state->held[INPUT_KEY_REWIND];
+
+    return input;
+}
+
+SimRandom SeedSimRandom(uint64_t seed)
+{
+    return (SimRandom){ .state = seed };
+}
+
+// splitmix64: one add and a few multiplies, and the whole state is a single number to snapshot
+uint32_t NextSimRandom(SimRandom* random)
+{
+    uint64_t value = (random->state += 0x9E3779B97F4A7C15ull);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+
+    return (uint32_t)((value ^ (value >> 31)) >> 32);
+}
+
+int SimRandomRange(SimRandom* random, int min, int max)
+{
+    return min + (int)(NextSimRandom(random) % (uint32_t)(max - min + 1));
+}
+
+float SimRandomFloat(SimRandom* random)
+{
+    return (NextSimRandom(random) >> 8) * (1.0f / 16777216.0f);
+}
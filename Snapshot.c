@@ -0,0 +1,325 @@
+﻿#include "Snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "IOWorker.h"
+#include "History.h"
+#include "Replay.h"
+
+_Static_assert(sizeof(((Game*)0)->powerUps) == sizeof(((GameSnapshot*)0)->powerUps), "Snapshot power-ups must match Game");
+
+// Retrying always goes back to the same point, so one snapshot is all we keep
+static GameSnapshot levelStart;
+static bool hasLevelStart = false;
+
+void CaptureSnapshot(const Game* game, GameSnapshot* snapshot)
+{
+    snapshot->magic = SNAPSHOT_MAGIC;
+    snapshot->version = SNAPSHOT_VERSION;
+    snapshot->size = sizeof(GameSnapshot);
+    snapshot->checksum = 0;
+
+    snapshot->state = game->state;
+    snapshot->currentLevel = game->currentLevel;
+    snapshot->endless = game->endless;
+    snapshot->levelSeed = game->levelSeed;
+    snapshot->random = game->random;
+    snapshot->simTime = game->simTime;
+
+    snapshot->player = game->player;
+    snapshot->ball = game->ball;
+    snapshot->blockRows = game->currentBlockRows;
+    snapshot->blockColumns = game->currentBlockColumns;
+    memcpy(snapshot->blocks, game->blocks, sizeof(snapshot->blocks));
+
+    memcpy(snapshot->powerUps, game->powerUps, sizeof(snapshot->powerUps));
+    snapshot->powerUpCount = game->powerUpCount;
+    snapshot->spawnSystem = game->spawnSystem;
+    snapshot->isTimewarpActive = game->isTimewarpActive;
+    snapshot->timeScale = game->timeScale;
+    snapshot->rewindCharges = game->rewindCharges;
+
+    snapshot->combo = game->combo;
+    snapshot->maxCombo = game->maxCombo;
+    snapshot->lastScoreGained = game->lastScoreGained;
+    snapshot->lastScoreTimer = game->lastScoreTimer;
+
+    snapshot->telemetry = game->telemetry;
+}
+
+void ApplySnapshot(Game* game, const GameSnapshot* snapshot)
+{
+    game->state = snapshot->state;
+    game->currentLevel = snapshot->currentLevel;
+    game->endless = snapshot->endless;
+    game->levelSeed = snapshot->levelSeed;
+    game->random = snapshot->random;
+    game->simTime = snapshot->simTime;
+
+    game->player = snapshot->player;
+    game->ball = snapshot->ball;
+    game->currentBlockRows = snapshot->blockRows;
+    game->currentBlockColumns = snapshot->blockColumns;
+    memcpy(game->blocks, snapshot->blocks, sizeof(game->blocks));
+
+    memcpy(game->powerUps, snapshot->powerUps, sizeof(game->powerUps));
+    game->powerUpCount = snapshot->powerUpCount;
+    game->spawnSystem = snapshot->spawnSystem;
+    game->isTimewarpActive = snapshot->isTimewarpActive;
+    game->timeScale = snapshot->timeScale;
+    game->rewindCharges = snapshot->rewindCharges;
+
+    game->combo = snapshot->combo;
+    game->maxCombo = snapshot->maxCombo;
+    game->lastScoreGained = snapshot->lastScoreGained;
+    game->lastScoreTimer = snapshot->lastScoreTimer;
+
+    game->telemetry = snapshot->telemetry;
+}
+
+bool RestoreSnapshot(Game* game, const GameSnapshot* snapshot)
+{
+    if (snapshot->magic != SNAPSHOT_MAGIC || snapshot->version != SNAPSHOT_VERSION ||
+        snapshot->size != sizeof(GameSnapshot))
+    {
+        printf("Snapshot is from a different version of the game, ignoring it\n");
+        return false;
+    }
+
+    ApplySnapshot(game, snapshot);
+
+    // Nothing to rewind into from here, the history belonged to wherever we were before
+    if (!game->headless)
+    {
+        ClearHistory();
+    }
+
+    game->rewindTicks = 0;
+
+    // Presentation only, it just starts over
+    ClearParticles(&game->particles);
+    game->inMenu = false;
+    game->input.clockRunning = false;
+    game->uiUpdateTimer = game->UI_UPDATE_INTERVAL;
+
+    return true;
+}
+
+/* Field by field, padding and presentation don't count: colours, trails, the score popup and the purple tint
+ * of timewarp only change how things look. Neither do blocks outside the level's grid or power-ups
+ * that aren't active, those are leftovers from earlier levels (or runs) that the simulation never reads.
+ * Everything else does, the replay verifier relies on that to catch doctored keyframes. */
+#define COMPARE_FIELD(field) if (memcmp(&a->field, &b->field, sizeof(a->field)) != 0) return #field
+
+const char* CompareSnapshots(const GameSnapshot* a, const GameSnapshot* b)
+{
+    COMPARE_FIELD(state);
+    COMPARE_FIELD(currentLevel);
+    COMPARE_FIELD(endless);
+    COMPARE_FIELD(levelSeed);
+    COMPARE_FIELD(random);
+    COMPARE_FIELD(simTime);
+
+    COMPARE_FIELD(player.position);
+    COMPARE_FIELD(player.baseSpeed);
+    COMPARE_FIELD(player.speed);
+    COMPARE_FIELD(player.height);
+    COMPARE_FIELD(player.baseWidth);
+    COMPARE_FIELD(player.width);
+    COMPARE_FIELD(player.lives);
+    COMPARE_FIELD(player.score);
+    COMPARE_FIELD(player.isDashing);
+
+    COMPARE_FIELD(ball.position);
+    COMPARE_FIELD(ball.direction);
+    COMPARE_FIELD(ball.radius);
+    COMPARE_FIELD(ball.speed);
+    COMPARE_FIELD(ball.active);
+    COMPARE_FIELD(ball.isGhost);
+    COMPARE_FIELD(ball.damageMultiplier);
+    COMPARE_FIELD(ball.currentMinSpeed);
+    COMPARE_FIELD(ball.currentMaxSpeed);
+
+    COMPARE_FIELD(blockRows);
+    COMPARE_FIELD(blockColumns);
+
+    int rows = a->blockRows < BLOCK_GRID_ROWS ? a->blockRows : BLOCK_GRID_ROWS;
+    int columns = a->blockColumns < BLOCK_GRID_COLUMNS ? a->blockColumns : BLOCK_GRID_COLUMNS;
+
+    for (int row = 0; row < rows; row++)
+    {
+        for (int col = 0; col < columns; col++)
+        {
+            COMPARE_FIELD(blocks[row][col].position);
+            COMPARE_FIELD(blocks[row][col].width);
+            COMPARE_FIELD(blocks[row][col].height);
+            COMPARE_FIELD(blocks[row][col].lives);
+            COMPARE_FIELD(blocks[row][col].active);
+            COMPARE_FIELD(blocks[row][col].type);
+        }
+    }
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        COMPARE_FIELD(powerUps[i].active);
+
+        if (!a->powerUps[i].active)
+        {
+            continue;
+        }
+
+        COMPARE_FIELD(powerUps[i].type);
+        COMPARE_FIELD(powerUps[i].position);
+        COMPARE_FIELD(powerUps[i].velocity);
+        COMPARE_FIELD(powerUps[i].radius);
+        COMPARE_FIELD(powerUps[i].duration);
+        COMPARE_FIELD(powerUps[i].remainingDuration);
+        COMPARE_FIELD(powerUps[i].wasPickedUp);
+        COMPARE_FIELD(powerUps[i].startTime);
+    }
+
+    COMPARE_FIELD(powerUpCount);
+    COMPARE_FIELD(spawnSystem);
+    COMPARE_FIELD(timeScale);
+    COMPARE_FIELD(rewindCharges);
+    COMPARE_FIELD(combo);
+    COMPARE_FIELD(maxCombo);
+    COMPARE_FIELD(telemetry);
+
+    return NULL;
+}
+
+#undef COMPARE_FIELD
+
+void MarkLevelStart(const Game* game)
+{
+    // Retry and rewind belong to the one interactive game. Headless games (replays, the verifier's threads) keep out
+    if (game->headless)
+    {
+        return;
+    }
+
+    CaptureSnapshot(game, &levelStart);
+    hasLevelStart = true;
+
+    // Rewind stops at the start of the level
+    ClearHistory();
+}
+
+// Back to the very first tick of the level: same blocks, same lives, same random numbers
+bool RetryLevel(Game* game)
+{
+    return hasLevelStart && RestoreSnapshot(game, &levelStart);
+}
+
+static uint32_t HashSnapshot(const GameSnapshot* snapshot)
+{
+    const unsigned char* bytes = (const unsigned char*)snapshot;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < sizeof(GameSnapshot); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+bool WriteSnapshotFile(const char* path, GameSnapshot* snapshot)
+{
+    char tempPath[256];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    snapshot->checksum = 0;
+    snapshot->checksum = HashSnapshot(snapshot);
+
+    FILE* file = fopen(tempPath, "wb");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    bool written = fwrite(snapshot, sizeof(GameSnapshot), 1, file) == 1;
+    written &= fclose(file) == 0;
+
+    // Same trick as the run journal: a crash mid-write leaves the old file (or none), never half of one
+    if (!written || !ReplaceRunFile(tempPath, path))
+    {
+        remove(tempPath);
+        return false;
+    }
+
+    return true;
+}
+
+bool ReadSnapshotFile(const char* path, GameSnapshot* snapshot)
+{
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    bool read = fread(snapshot, sizeof(GameSnapshot), 1, file) == 1;
+    fclose(file);
+
+    if (!read)
+    {
+        return false;
+    }
+
+    uint32_t checksum = snapshot->checksum;
+    snapshot->checksum = 0;
+
+    return snapshot->magic == SNAPSHOT_MAGIC && HashSnapshot(snapshot) == checksum;
+}
+
+void SuspendGame(const Game* game)
+{
+    // Only a run in progress is worth keeping, menus and end screens just start fresh
+    if (game->inMenu || (game->state != PLAYING && game->state != LEVEL_COMPLETE))
+    {
+        return;
+    }
+
+    GameSnapshot* snapshot = calloc(1, sizeof(GameSnapshot));
+
+    if (snapshot == NULL)
+    {
+        return;
+    }
+
+    CaptureSnapshot(game, snapshot);
+
+    // The I/O thread frees it once it's on disk
+    if (!SubmitIORequest((IORequest){ .type = IO_SAVE_SNAPSHOT, .snapshot = snapshot }))
+    {
+        free(snapshot);
+    }
+}
+
+// Game thread: the suspended run is loaded, pick it up if we're still sitting in the main menu
+static void OnSuspendLoaded(IORequest* request, void* context)
+{
+    Game* game = context;
+
+    if (request->success && game->state == MAIN_MENU && RestoreSnapshot(game, request->snapshot))
+    {
+        MarkLevelStart(game);
+        BeginReplayRecording(game);
+        printf("Resumed the suspended run at level %d\n", game->currentLevel);
+    }
+
+    free(request->snapshot);
+}
+
+void ResumeSuspendedGame(void)
+{
+    SubmitIORequest((IORequest)
+    {
+        .type = IO_LOAD_SNAPSHOT,
+        .callback = OnSuspendLoaded
+    });
+}
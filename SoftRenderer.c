@@ -0,0 +1,566 @@
+﻿#include "SoftRenderer.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "Game.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SOFT_USE_SSE 1
+#endif
+
+// Screen space to framebuffer pixels
+typedef struct SoftView
+{
+    SoftFramebuffer* target;
+    float scaleX;
+    float scaleY;
+} SoftView;
+
+static uint32_t PackColor(Color color)
+{
+    uint32_t packed;
+    memcpy(&packed, &color, sizeof(packed));
+
+    return packed;
+}
+
+// x / 255, rounded, for x up to 255 * 255
+static inline int Divide255(int x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/* `count` pixels towards `color` by weight / 255. The alpha channel blends towards 255,
+ * so an opaque framebuffer stays opaque, like the game texture we clear to BLACK. */
+static void BlendSpan(Color* pixels, int count, Color color, int weight)
+{
+    if (count <= 0 || weight <= 0)
+    {
+        return;
+    }
+
+    color.a = 255;
+    weight = weight < 255 ? weight : 255;
+
+    int i = 0;
+
+    if (weight == 255)
+    {
+        uint32_t packed = PackColor(color);
+
+#ifdef SOFT_USE_SSE
+        __m128i fill = _mm_set1_epi32((int)packed);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_si128((__m128i*)(pixels + i), fill);
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            memcpy(&pixels[i], &packed, sizeof(packed));
+        }
+
+        return;
+    }
+
+#ifdef SOFT_USE_SSE
+    // Four pixels, 16 channels, widened to 16 bits in two halves
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i source = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)PackColor(color)), zero),
+                                           _mm_set1_epi16((short)weight));
+    const __m128i keep = _mm_set1_epi16((short)(255 - weight));
+    const __m128i half = _mm_set1_epi16(128);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i destination = _mm_loadu_si128((const __m128i*)(pixels + i));
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(destination, zero), keep), source);
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(destination, zero), keep), source);
+
+        // Divide255, lane by lane
+        low = _mm_add_epi16(low, half);
+        high = _mm_add_epi16(high, half);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+        _mm_storeu_si128((__m128i*)(pixels + i), _mm_packus_epi16(low, high));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        pixels[i].r = (unsigned char)Divide255(color.r * weight + pixels[i].r * (255 - weight));
+        pixels[i].g = (unsigned char)Divide255(color.g * weight + pixels[i].g * (255 - weight));
+        pixels[i].b = (unsigned char)Divide255(color.b * weight + pixels[i].b * (255 - weight));
+        pixels[i].a = (unsigned char)Divide255(255 * weight + pixels[i].a * (255 - weight));
+    }
+}
+
+// The colour's own alpha, times how much of the pixel is covered
+static int GetWeight(Color color, float coverage)
+{
+    return (int)(color.a * coverage + 0.5f);
+}
+
+void SoftClear(SoftFramebuffer* target, Color color)
+{
+    for (int row = 0; row < target->height; row++)
+    {
+        BlendSpan(target->pixels + (size_t)row * target->width, target->width, color, 255);
+    }
+}
+
+void SoftFillRectangle(SoftFramebuffer* target, float x, float y, float width, float height, Color color)
+{
+    float left = fmaxf(x, 0.0f);
+    float top = fmaxf(y, 0.0f);
+    float right = fminf(x + width, (float)target->width);
+    float bottom = fminf(y + height, (float)target->height);
+
+    if (right <= left || bottom <= top)
+    {
+        return;
+    }
+
+    int first = (int)left;
+    int last = (int)ceilf(right) - 1;   // Inclusive, the partly covered column at each end
+
+    for (int row = (int)top; row < (int)ceilf(bottom); row++)
+    {
+        Color* pixels = target->pixels + (size_t)row * target->width;
+        float rowCoverage = fminf(bottom, row + 1.0f) - fmaxf(top, (float)row);
+
+        if (first == last)
+        {
+            BlendSpan(pixels + first, 1, color, GetWeight(color, (right - left) * rowCoverage));
+            continue;
+        }
+
+        BlendSpan(pixels + first, 1, color, GetWeight(color, (first + 1.0f - left) * rowCoverage));
+        BlendSpan(pixels + first + 1, last - first - 1, color, GetWeight(color, rowCoverage));
+        BlendSpan(pixels + last, 1, color, GetWeight(color, (right - last) * rowCoverage));
+    }
+}
+
+/* Row by row: the ellipse's extent at SOFT_CIRCLE_SUBROWS heights inside the row. Pixels inside all of them
+ * are fully covered and go in one span, the few on the edges get the average of what each sample covers. */
+void SoftFillEllipse(SoftFramebuffer* target, float centerX, float centerY, float radiusX, float radiusY, Color color)
+{
+    if (radiusX <= 0.0f || radiusY <= 0.0f)
+    {
+        return;
+    }
+
+    int top = (int)fmaxf(floorf(centerY - radiusY), 0.0f);
+    int bottom = (int)fminf(ceilf(centerY + radiusY), (float)target->height);
+
+    for (int row = top; row < bottom; row++)
+    {
+        float spanLeft[SOFT_CIRCLE_SUBROWS];
+        float spanRight[SOFT_CIRCLE_SUBROWS];
+        float outerLeft = INFINITY;
+        float outerRight = -INFINITY;
+        float innerLeft = -INFINITY;
+        float innerRight = INFINITY;
+
+        for (int s = 0; s < SOFT_CIRCLE_SUBROWS; s++)
+        {
+            float dy = (row + (s + 0.5f) / SOFT_CIRCLE_SUBROWS - centerY) / radiusY;
+            float halfWidth = dy * dy < 1.0f ? radiusX * sqrtf(1.0f - dy * dy) : 0.0f;
+
+            spanLeft[s] = centerX - halfWidth;
+            spanRight[s] = centerX + halfWidth;
+
+            if (halfWidth > 0.0f)
+            {
+                outerLeft = fminf(outerLeft, spanLeft[s]);
+                outerRight = fmaxf(outerRight, spanRight[s]);
+            }
+
+            innerLeft = fmaxf(innerLeft, spanLeft[s]);
+            innerRight = fminf(innerRight, spanRight[s]);
+        }
+
+        if (outerRight <= outerLeft)
+        {
+            continue;
+        }
+
+        int first = (int)fmaxf(floorf(outerLeft), 0.0f);
+        int end = (int)fminf(ceilf(outerRight), (float)target->width);
+        int innerFirst = (int)fminf(fmaxf(ceilf(innerLeft), (float)first), (float)end);
+        int innerEnd = (int)fmaxf(fminf(floorf(innerRight), (float)end), (float)innerFirst);
+        Color* pixels = target->pixels + (size_t)row * target->width;
+
+        BlendSpan(pixels + innerFirst, innerEnd - innerFirst, color, GetWeight(color, 1.0f));
+
+        for (int x = first; x < end; x++)
+        {
+            if (x == innerFirst && innerEnd > innerFirst)
+            {
+                x = innerEnd - 1;
+                continue;
+            }
+
+            float covered = 0.0f;
+
+            for (int s = 0; s < SOFT_CIRCLE_SUBROWS; s++)
+            {
+                covered += fmaxf(fminf(spanRight[s], x + 1.0f) - fmaxf(spanLeft[s], (float)x), 0.0f);
+            }
+
+            BlendSpan(pixels + x, 1, color, GetWeight(color, covered / SOFT_CIRCLE_SUBROWS));
+        }
+    }
+}
+
+static float Cross(Vector2 origin, Vector2 a, Vector2 b)
+{
+    return (a.x - origin.x) * (b.y - origin.y) - (a.y - origin.y) * (b.x - origin.x);
+}
+
+// Where the line through an edge is at height y. Top end first, so triangles sharing the edge get the same x
+static float GetEdgeX(Vector2 from, Vector2 to, float y)
+{
+    if (from.y > to.y)
+    {
+        Vector2 swap = from;
+        from = to;
+        to = swap;
+    }
+
+    return from.x + (y - from.y) * (to.x - from.x) / (to.y - from.y);
+}
+
+/* Like SoftFillEllipse, the triangle's extent at SOFT_CIRCLE_SUBROWS heights per row decides coverage. Each pixel's
+ * colour is the corners' blended at its centre, as GL interpolates a vertex colour; with one colour the fully
+ * covered middle of the row goes in one span. Edges in `smoothEdges` (bit n is corner n to the next) are
+ * anti-aliased, the rest take the pixels whose centres they cover, so triangles sharing one leave no seam */
+static void FillTriangle(SoftFramebuffer* target, const Vector2 corners[3], const Color colors[3], int smoothEdges)
+{
+    Vector2 a = corners[0];
+    Vector2 b = corners[1];
+    Vector2 c = corners[2];
+    float area = Cross(a, b, c);
+
+    if (fabsf(area) < 0.0001f)
+    {
+        return;
+    }
+
+    bool uniform = PackColor(colors[0]) == PackColor(colors[1]) && PackColor(colors[0]) == PackColor(colors[2]);
+
+    int top = (int)fmaxf(floorf(fminf(a.y, fminf(b.y, c.y))), 0.0f);
+    int bottom = (int)fminf(ceilf(fmaxf(a.y, fmaxf(b.y, c.y))), (float)target->height);
+
+    for (int row = top; row < bottom; row++)
+    {
+        float spanLeft[SOFT_CIRCLE_SUBROWS];
+        float spanRight[SOFT_CIRCLE_SUBROWS];
+        float outerLeft = INFINITY;
+        float outerRight = -INFINITY;
+        float innerLeft = -INFINITY;
+        float innerRight = INFINITY;
+
+        for (int s = 0; s < SOFT_CIRCLE_SUBROWS; s++)
+        {
+            float y = row + (s + 0.5f) / SOFT_CIRCLE_SUBROWS;
+
+            int leftEdge = 0;
+            int rightEdge = 0;
+
+            spanLeft[s] = INFINITY;
+            spanRight[s] = -INFINITY;
+
+            for (int edge = 0; edge < 3; edge++)
+            {
+                Vector2 from = corners[edge];
+                Vector2 to = corners[(edge + 1) % 3];
+
+                if ((from.y <= y) == (to.y <= y))
+                {
+                    continue;
+                }
+
+                float x = GetEdgeX(from, to, y);
+
+                if (x < spanLeft[s])
+                {
+                    spanLeft[s] = x;
+                    leftEdge = edge;
+                }
+
+                if (x > spanRight[s])
+                {
+                    spanRight[s] = x;
+                    rightEdge = edge;
+                }
+            }
+
+            // A hard edge is where it crosses the middle of the row for every sample, so its pixels aren't shared
+            if (!(smoothEdges & (1 << leftEdge)))
+            {
+                spanLeft[s] = ceilf(GetEdgeX(corners[leftEdge], corners[(leftEdge + 1) % 3], row + 0.5f) - 0.5f);
+            }
+
+            if (!(smoothEdges & (1 << rightEdge)))
+            {
+                spanRight[s] = ceilf(GetEdgeX(corners[rightEdge], corners[(rightEdge + 1) % 3], row + 0.5f) - 0.5f);
+            }
+
+            if (spanRight[s] > spanLeft[s])
+            {
+                outerLeft = fminf(outerLeft, spanLeft[s]);
+                outerRight = fmaxf(outerRight, spanRight[s]);
+            }
+            else
+            {
+                spanLeft[s] = spanRight[s] = 0.0f;
+            }
+
+            innerLeft = fmaxf(innerLeft, spanLeft[s]);
+            innerRight = fminf(innerRight, spanRight[s]);
+        }
+
+        if (outerRight <= outerLeft)
+        {
+            continue;
+        }
+
+        int first = (int)fmaxf(floorf(outerLeft), 0.0f);
+        int end = (int)fminf(ceilf(outerRight), (float)target->width);
+        int innerFirst = end;
+        int innerEnd = end;
+        Color* pixels = target->pixels + (size_t)row * target->width;
+
+        if (uniform)
+        {
+            innerFirst = (int)fminf(fmaxf(ceilf(innerLeft), (float)first), (float)end);
+            innerEnd = (int)fmaxf(fminf(floorf(innerRight), (float)end), (float)innerFirst);
+
+            BlendSpan(pixels + innerFirst, innerEnd - innerFirst, colors[0], GetWeight(colors[0], 1.0f));
+        }
+
+        for (int x = first; x < end; x++)
+        {
+            if (x == innerFirst && innerEnd > innerFirst)
+            {
+                x = innerEnd - 1;
+                continue;
+            }
+
+            float covered = 0.0f;
+
+            for (int s = 0; s < SOFT_CIRCLE_SUBROWS; s++)
+            {
+                covered += fmaxf(fminf(spanRight[s], x + 1.0f) - fmaxf(spanLeft[s], (float)x), 0.0f);
+            }
+
+            if (covered <= 0.0f)
+            {
+                continue;
+            }
+
+            // Barycentric weights at the pixel's centre, kept inside the triangle for the edge pixels
+            Vector2 center = { x + 0.5f, row + 0.5f };
+            float weights[3] =
+            {
+                fmaxf(Cross(center, b, c) / area, 0.0f),
+                fmaxf(Cross(center, c, a) / area, 0.0f),
+                fmaxf(Cross(center, a, b) / area, 0.0f)
+            };
+            float total = weights[0] + weights[1] + weights[2];
+            float channels[4] = {0};
+
+            for (int corner = 0; corner < 3; corner++)
+            {
+                float weight = total > 0.0f ? weights[corner] / total : 1.0f / 3.0f;
+
+                channels[0] += colors[corner].r * weight;
+                channels[1] += colors[corner].g * weight;
+                channels[2] += colors[corner].b * weight;
+                channels[3] += colors[corner].a * weight;
+            }
+
+            Color color =
+            {
+                (unsigned char)(channels[0] + 0.5f),
+                (unsigned char)(channels[1] + 0.5f),
+                (unsigned char)(channels[2] + 0.5f),
+                (unsigned char)(channels[3] + 0.5f)
+            };
+
+            BlendSpan(pixels + x, 1, color, GetWeight(color, covered / SOFT_CIRCLE_SUBROWS));
+        }
+    }
+}
+
+void SoftFillTriangle(SoftFramebuffer* target, Vector2 a, Vector2 b, Vector2 c, Color colorA, Color colorB, Color colorC)
+{
+    Vector2 corners[3] = { a, b, c };
+    Color colors[3] = { colorA, colorB, colorC };
+
+    FillTriangle(target, corners, colors, 0x7);
+}
+
+static void FillScreenRectangle(const SoftView* view, float x, float y, float width, float height, Color color)
+{
+    SoftFillRectangle(view->target, x * view->scaleX, y * view->scaleY, width * view->scaleX, height * view->scaleY,
+                      color);
+}
+
+static void FillScreenCircle(const SoftView* view, Vector2 center, float radius, Color color)
+{
+    SoftFillEllipse(view->target, center.x * view->scaleX, center.y * view->scaleY,
+                    radius * view->scaleX, radius * view->scaleY, color);
+}
+
+/* EmitRibbon's quads, each as the two triangles GL draws it as: the corners are worked out in screen space
+ * and only then scaled, so a framebuffer with another aspect squashes the ribbon the same way */
+static void DrawSoftRibbon(const SoftView* view, const RibbonPoint* points, int count)
+{
+    Vector2 previousLeft = {0};
+    Vector2 previousRight = {0};
+    Color previousColor = {0};
+
+    for (int i = 0; i < count; i++)
+    {
+        Vector2 before = points[i > 0 ? i - 1 : i].position;
+        Vector2 after = points[i < count - 1 ? i + 1 : i].position;
+        Vector2 tangent = MyVector2Subtract(after, before);
+
+        if (MyVector2LengthSquared(tangent) < 0.0001f && i > 0)
+        {
+            tangent = MyVector2Subtract(points[i].position, points[i - 1].position);
+        }
+
+        tangent = MyVector2Normalize(tangent);
+
+        Vector2 across = { -tangent.y * points[i].halfWidth, tangent.x * points[i].halfWidth };
+        Vector2 left = MyVector2Subtract(points[i].position, across);
+        Vector2 right = MyVector2Add(points[i].position, across);
+
+        left = (Vector2){ left.x * view->scaleX, left.y * view->scaleY };
+        right = (Vector2){ right.x * view->scaleX, right.y * view->scaleY };
+
+        if (i > 0)
+        {
+            // Only the ribbon's outline is anti-aliased: its sides, and the ends across the first and last point
+            Vector2 first[3] = { previousLeft, previousRight, right };
+            Vector2 second[3] = { previousLeft, right, left };
+            Color firstColors[3] = { previousColor, previousColor, points[i].color };
+            Color secondColors[3] = { previousColor, points[i].color, points[i].color };
+
+            FillTriangle(view->target, first, firstColors, 0x2 | (i == 1 ? 0x1 : 0));
+            FillTriangle(view->target, second, secondColors, 0x4 | (i == count - 1 ? 0x2 : 0));
+        }
+
+        previousLeft = left;
+        previousRight = right;
+        previousColor = points[i].color;
+    }
+}
+
+// RecordPlayerTrail, from the same ribbon
+static void DrawSoftPlayerTrail(const SoftView* view, const Player* player)
+{
+    RibbonPoint points[PLAYER_TRAIL_RIBBON_POINTS];
+    int count = GetPlayerTrailRibbon(player, points);
+
+    DrawSoftRibbon(view, points, count);
+}
+
+// RecordBlocks, without the lives
+static void DrawSoftBlocks(const SoftView* view, const Game* game)
+{
+    for (int row = 0; row < game->currentBlockRows; row++)
+    {
+        for (int col = 0; col < game->currentBlockColumns; col++)
+        {
+            const Block* block = &game->blocks[row][col];
+
+            if (!block->active)
+            {
+                continue;
+            }
+
+            float x = (float)(int)block->position.x;
+            float y = (float)(int)block->position.y;
+
+            FillScreenRectangle(view, x, y, block->width, block->height, block->color);
+
+            // DrawRectangleLines: a one pixel frame inside the block
+            if (block->type == BLOCK_BONUS)
+            {
+                FillScreenRectangle(view, x, y, block->width, 1, WHITE);
+                FillScreenRectangle(view, x, y + block->height - 1, block->width, 1, WHITE);
+                FillScreenRectangle(view, x, y + 1, 1, block->height - 2, WHITE);
+                FillScreenRectangle(view, x + block->width - 1, y + 1, 1, block->height - 2, WHITE);
+            }
+        }
+    }
+}
+
+// RecordBall's trail, from the same ribbon. Drawn apart from the ball, which goes on a layer above it
+static void DrawSoftBallTrail(const SoftView* view, const Ball* ball)
+{
+    if (ball->active)
+    {
+        RibbonPoint points[BALL_TRAIL_RIBBON_POINTS];
+        int count = GetBallTrailRibbon(ball, points);
+
+        DrawSoftRibbon(view, points, count);
+    }
+}
+
+// RecordBall
+static void DrawSoftBall(const SoftView* view, const Ball* ball)
+{
+    if (ball->active)
+    {
+        FillScreenCircle(view, ball->position, ball->radius, ball->currentColor);
+    }
+}
+
+// RecordPowerUps, without the glyphs
+static void DrawSoftPowerUps(const SoftView* view, const Game* game)
+{
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        const PowerUp* powerUp = &game->powerUps[i];
+
+        if (powerUp->active && !powerUp->wasPickedUp)
+        {
+            Color pulsingColor = powerUp->color;
+            pulsingColor.a = (unsigned char)(255 * (0.7f + (sinf(powerUp->pulseTimer) * 0.3f)));
+
+            FillScreenCircle(view, powerUp->position, powerUp->radius, pulsingColor);
+        }
+    }
+}
+
+// Same order as the render layers. The paddle goes last, where DrawLatchedPaddle puts it (minus the latching)
+void RenderGameSoftware(const Game* game, SoftFramebuffer* target)
+{
+    SoftView view =
+    {
+        .target = target,
+        .scaleX = (float)target->width / game->screenWidth,
+        .scaleY = (float)target->height / game->screenHeight
+    };
+
+    SoftClear(target, BLACK);
+
+    DrawSoftPlayerTrail(&view, &game->player);
+    DrawSoftBlocks(&view, game);
+    DrawSoftBallTrail(&view, &game->ball);
+    DrawSoftBall(&view, &game->ball);
+    DrawSoftPowerUps(&view, game);
+
+    FillScreenRectangle(&view, game->player.position.x, game->player.position.y,
+                        game->player.width, game->player.height, game->player.color);
+}
@@ -0,0 +1,942 @@
+﻿#include "Spectator.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Timing.h"
+
+#define SNAPSHOT_HEADER_BYTES 64    // Everything in a snapshot but the blocks and power-ups, rounded up
+#define SNAPSHOT_BLOCK_BYTES 14
+#define SNAPSHOT_POWERUP_BYTES 8
+
+_Static_assert(SNAPSHOT_HEADER_BYTES + BLOCK_GRID_ROWS * BLOCK_GRID_COLUMNS * SNAPSHOT_BLOCK_BYTES +
+               PU_MAX_COUNT * SNAPSHOT_POWERUP_BYTES <= SPECTATOR_MAX_MESSAGE, "A snapshot has to fit in one message");
+
+// Little-endian on the wire whatever the machine, byte by byte
+typedef struct MessageWriter
+{
+    unsigned char* data;
+    int size;
+    int capacity;
+    bool full;
+} MessageWriter;
+
+typedef struct MessageReader
+{
+    const unsigned char* data;
+    int size;
+    int offset;
+    bool bad;
+} MessageReader;
+
+static void Put8(MessageWriter* writer, uint32_t value)
+{
+    if (writer->size == writer->capacity)
+    {
+        writer->full = true;
+        return;
+    }
+
+    writer->data[writer->size++] = (unsigned char)value;
+}
+
+static void Put16(MessageWriter* writer, uint32_t value)
+{
+    Put8(writer, value & 0xFF);
+    Put8(writer, (value >> 8) & 0xFF);
+}
+
+static void Put32(MessageWriter* writer, uint32_t value)
+{
+    Put16(writer, value & 0xFFFF);
+    Put16(writer, value >> 16);
+}
+
+static void PutColor(MessageWriter* writer, Color color)
+{
+    Put8(writer, color.r);
+    Put8(writer, color.g);
+    Put8(writer, color.b);
+    Put8(writer, color.a);
+}
+
+static uint32_t Take8(MessageReader* reader)
+{
+    if (reader->offset == reader->size)
+    {
+        reader->bad = true;
+        return 0;
+    }
+
+    return reader->data[reader->offset++];
+}
+
+static uint32_t Take16(MessageReader* reader)
+{
+    uint32_t low = Take8(reader);
+    return low | Take8(reader) << 8;
+}
+
+static uint32_t Take32(MessageReader* reader)
+{
+    uint32_t low = Take16(reader);
+    return low | Take16(reader) << 16;
+}
+
+static Color TakeColor(MessageReader* reader)
+{
+    Color color;
+    color.r = (unsigned char)Take8(reader);
+    color.g = (unsigned char)Take8(reader);
+    color.b = (unsigned char)Take8(reader);
+    color.a = (unsigned char)Take8(reader);
+    return color;
+}
+
+// Room for the length, filled in by EndMessage
+static void BeginMessage(MessageWriter* writer, unsigned char* buffer, int capacity, SpectatorMessageType type)
+{
+    *writer = (MessageWriter){ .data = buffer, .capacity = capacity };
+    Put16(writer, 0);
+    Put8(writer, type);
+}
+
+static int EndMessage(MessageWriter* writer)
+{
+    if (writer->full)
+    {
+        return 0;
+    }
+
+    int length = writer->size - 2;
+    writer->data[0] = (unsigned char)(length & 0xFF);
+    writer->data[1] = (unsigned char)(length >> 8);
+
+    return writer->size;
+}
+
+static uint16_t QuantizePosition(float value)
+{
+    float subpixels = roundf(value * SPECTATOR_SUBPIXELS);
+    return (uint16_t)(subpixels < 0.0f ? 0.0f : (subpixels > 65535.0f ? 65535.0f : subpixels));
+}
+
+static int16_t QuantizePixels(float value)
+{
+    float pixels = roundf(value);
+    return (int16_t)(pixels < -32768.0f ? -32768.0f : (pixels > 32767.0f ? 32767.0f : pixels));
+}
+
+void CaptureSpectatorState(const Game* game, uint32_t time, SpectatorState* state)
+{
+    const Ball* ball = &game->ball;
+    const Player* player = &game->player;
+
+    state->time = time;
+    state->screenWidth = (int16_t)game->screenWidth;
+    state->screenHeight = (int16_t)game->screenHeight;
+
+    state->state = (uint8_t)game->state;
+    state->flags = (ball->active ? SPECTATOR_BALL_ACTIVE : 0) | (game->isTimewarpActive ? SPECTATOR_TIMEWARP : 0);
+    state->ballX = QuantizePosition(ball->position.x);
+    state->ballY = QuantizePosition(ball->position.y);
+    state->ballRadius = QuantizePosition(ball->radius);
+    state->ballColor = ball->currentColor;
+    state->paddleX = QuantizePosition(player->position.x);
+    state->paddleY = QuantizePosition(player->position.y);
+    state->paddleWidth = QuantizePosition((float)player->width);
+    state->paddleHeight = QuantizePosition((float)player->height);
+    state->paddleColor = player->color;
+    state->score = player->score;
+    state->lives = (uint8_t)(player->lives < 0 ? 0 : (player->lives > 255 ? 255 : player->lives));
+    state->level = (uint16_t)game->currentLevel;
+    state->combo = (uint16_t)(game->combo > 65535 ? 65535 : game->combo);
+    state->timeScale = (uint8_t)fminf(roundf(game->timeScale * 100.0f), 255.0f);
+
+    state->rows = (uint8_t)game->currentBlockRows;
+    state->columns = (uint8_t)game->currentBlockColumns;
+
+    for (int row = 0; row < state->rows; row++)
+    {
+        for (int col = 0; col < state->columns; col++)
+        {
+            const Block* block = &game->blocks[row][col];
+            SpectatorBlock* captured = &state->blocks[row][col];
+
+            captured->x = QuantizePixels(block->position.x);
+            captured->y = QuantizePixels(block->position.y);
+            captured->width = (int16_t)block->width;
+            captured->height = (int16_t)block->height;
+            captured->lives = (int8_t)(!block->active ? -1 : (block->lives > 127 ? 127 : (block->lives < 0 ? 0 : block->lives)));
+            captured->type = (uint8_t)block->type;
+            captured->tint = block->tint;
+        }
+    }
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        const PowerUp* powerUp = &game->powerUps[i];
+        SpectatorPowerUp* captured = &state->powerUps[i];
+
+        captured->visible = powerUp->active && !powerUp->wasPickedUp;
+        captured->type = (uint8_t)powerUp->type;
+        captured->x = QuantizePosition(powerUp->position.x);
+        captured->y = QuantizePosition(powerUp->position.y);
+        captured->speed = QuantizePixels(powerUp->velocity.y);
+    }
+}
+
+/* Falling power-ups between updates. Integers only, so the game's copy of what the spectators know and
+ * the spectators' own stay exactly the same */
+static void AdvanceSpectatorPowerUps(SpectatorState* state, uint32_t milliseconds)
+{
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        SpectatorPowerUp* powerUp = &state->powerUps[i];
+
+        if (!powerUp->visible)
+        {
+            continue;
+        }
+
+        int64_t moved = (int64_t)powerUp->speed * state->timeScale * milliseconds * SPECTATOR_SUBPIXELS / 100000;
+        int64_t y = powerUp->y + moved;
+
+        powerUp->y = (uint16_t)(y < 0 ? 0 : (y > 65535 ? 65535 : y));
+    }
+}
+
+static bool SameBlockLayout(const SpectatorState* a, const SpectatorState* b)
+{
+    if (a->rows != b->rows || a->columns != b->columns || a->screenWidth != b->screenWidth || a->screenHeight != b->screenHeight)
+    {
+        return false;
+    }
+
+    for (int row = 0; row < a->rows; row++)
+    {
+        for (int col = 0; col < a->columns; col++)
+        {
+            const SpectatorBlock* first = &a->blocks[row][col];
+            const SpectatorBlock* second = &b->blocks[row][col];
+
+            if (first->x != second->x || first->y != second->y || first->width != second->width ||
+                first->height != second->height || first->type != second->type ||
+                memcmp(&first->tint, &second->tint, sizeof(Color)) != 0)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int EncodeSpectatorSnapshot(const SpectatorState* state, unsigned char* buffer, int capacity)
+{
+    MessageWriter writer;
+    BeginMessage(&writer, buffer, capacity, SPECTATOR_SNAPSHOT);
+
+    Put8(&writer, SPECTATOR_VERSION);
+    Put32(&writer, state->time);
+    Put16(&writer, (uint16_t)state->screenWidth);
+    Put16(&writer, (uint16_t)state->screenHeight);
+
+    Put8(&writer, state->state);
+    Put8(&writer, state->flags);
+    Put16(&writer, state->ballX);
+    Put16(&writer, state->ballY);
+    Put16(&writer, state->ballRadius);
+    PutColor(&writer, state->ballColor);
+    Put16(&writer, state->paddleX);
+    Put16(&writer, state->paddleY);
+    Put16(&writer, state->paddleWidth);
+    Put16(&writer, state->paddleHeight);
+    PutColor(&writer, state->paddleColor);
+    Put32(&writer, (uint32_t)state->score);
+    Put8(&writer, state->lives);
+    Put16(&writer, state->level);
+    Put16(&writer, state->combo);
+    Put8(&writer, state->timeScale);
+
+    Put8(&writer, state->rows);
+    Put8(&writer, state->columns);
+
+    for (int row = 0; row < state->rows; row++)
+    {
+        for (int col = 0; col < state->columns; col++)
+        {
+            const SpectatorBlock* block = &state->blocks[row][col];
+
+            Put16(&writer, (uint16_t)block->x);
+            Put16(&writer, (uint16_t)block->y);
+            Put16(&writer, (uint16_t)block->width);
+            Put16(&writer, (uint16_t)block->height);
+            Put8(&writer, (uint8_t)block->lives);
+            Put8(&writer, block->type);
+            PutColor(&writer, block->tint);
+        }
+    }
+
+    int visible = 0;
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        visible += state->powerUps[i].visible;
+    }
+
+    Put8(&writer, visible);
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        const SpectatorPowerUp* powerUp = &state->powerUps[i];
+
+        if (powerUp->visible)
+        {
+            Put8(&writer, i);
+            Put8(&writer, powerUp->type);
+            Put16(&writer, powerUp->x);
+            Put16(&writer, powerUp->y);
+            Put16(&writer, (uint16_t)powerUp->speed);
+        }
+    }
+
+    return EndMessage(&writer);
+}
+
+/* Everything in `next` that `known` doesn't have yet, and `known` catches up as it goes. Falling power-ups
+ * are dead-reckoned first, and only the ones that appeared, went, or drifted are sent */
+static int EncodeSpectatorDelta(SpectatorState* known, const SpectatorState* next, unsigned char* buffer, int capacity)
+{
+    uint32_t elapsed = next->time - known->time;
+    elapsed = elapsed > 65535 ? 65535 : elapsed;
+
+    AdvanceSpectatorPowerUps(known, elapsed);
+    known->time += elapsed;
+
+    int changedBlocks = 0;
+    int changedPowerUps = 0;
+    bool powerUpChanged[PU_MAX_COUNT] = {0};
+
+    for (int row = 0; row < next->rows; row++)
+    {
+        for (int col = 0; col < next->columns; col++)
+        {
+            changedBlocks += known->blocks[row][col].lives != next->blocks[row][col].lives;
+        }
+    }
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        const SpectatorPowerUp* was = &known->powerUps[i];
+        const SpectatorPowerUp* now = &next->powerUps[i];
+
+        if (was->visible != now->visible || (now->visible && (was->type != now->type || was->x != now->x ||
+            abs((int)was->y - (int)now->y) > SPECTATOR_POWERUP_DRIFT || was->speed != now->speed)))
+        {
+            powerUpChanged[i] = true;
+            changedPowerUps++;
+        }
+    }
+
+    uint32_t mask = 0;
+    mask |= (known->state != next->state || known->flags != next->flags) ? SPECTATOR_FIELD_STATE : 0;
+    mask |= (known->ballX != next->ballX || known->ballY != next->ballY) ? SPECTATOR_FIELD_BALL : 0;
+    mask |= (known->ballRadius != next->ballRadius || memcmp(&known->ballColor, &next->ballColor, sizeof(Color)) != 0) ? SPECTATOR_FIELD_BALL_LOOK : 0;
+    mask |= known->paddleX != next->paddleX ? SPECTATOR_FIELD_PADDLE : 0;
+    mask |= (known->paddleY != next->paddleY || known->paddleWidth != next->paddleWidth || known->paddleHeight != next->paddleHeight ||
+             memcmp(&known->paddleColor, &next->paddleColor, sizeof(Color)) != 0) ? SPECTATOR_FIELD_PADDLE_LOOK : 0;
+    mask |= known->score != next->score ? SPECTATOR_FIELD_SCORE : 0;
+    mask |= (known->lives != next->lives || known->level != next->level || known->combo != next->combo) ? SPECTATOR_FIELD_COUNTERS : 0;
+    mask |= known->timeScale != next->timeScale ? SPECTATOR_FIELD_TIME_SCALE : 0;
+    mask |= changedBlocks > 0 ? SPECTATOR_FIELD_BLOCKS : 0;
+    mask |= changedPowerUps > 0 ? SPECTATOR_FIELD_POWERUPS : 0;
+
+    MessageWriter writer;
+    BeginMessage(&writer, buffer, capacity, SPECTATOR_DELTA);
+    Put16(&writer, elapsed);
+    Put16(&writer, mask);
+
+    if (mask & SPECTATOR_FIELD_STATE)
+    {
+        Put8(&writer, next->state);
+        Put8(&writer, next->flags);
+    }
+
+    if (mask & SPECTATOR_FIELD_BALL)
+    {
+        Put16(&writer, next->ballX);
+        Put16(&writer, next->ballY);
+    }
+
+    if (mask & SPECTATOR_FIELD_BALL_LOOK)
+    {
+        Put16(&writer, next->ballRadius);
+        PutColor(&writer, next->ballColor);
+    }
+
+    if (mask & SPECTATOR_FIELD_PADDLE)
+    {
+        Put16(&writer, next->paddleX);
+    }
+
+    if (mask & SPECTATOR_FIELD_PADDLE_LOOK)
+    {
+        Put16(&writer, next->paddleY);
+        Put16(&writer, next->paddleWidth);
+        Put16(&writer, next->paddleHeight);
+        PutColor(&writer, next->paddleColor);
+    }
+
+    if (mask & SPECTATOR_FIELD_SCORE)
+    {
+        Put32(&writer, (uint32_t)next->score);
+    }
+
+    if (mask & SPECTATOR_FIELD_COUNTERS)
+    {
+        Put8(&writer, next->lives);
+        Put16(&writer, next->level);
+        Put16(&writer, next->combo);
+    }
+
+    if (mask & SPECTATOR_FIELD_TIME_SCALE)
+    {
+        Put8(&writer, next->timeScale);
+    }
+
+    if (mask & SPECTATOR_FIELD_BLOCKS)
+    {
+        Put16(&writer, changedBlocks);
+
+        for (int row = 0; row < next->rows; row++)
+        {
+            for (int col = 0; col < next->columns; col++)
+            {
+                if (known->blocks[row][col].lives != next->blocks[row][col].lives)
+                {
+                    Put16(&writer, row * next->columns + col);
+                    Put8(&writer, (uint8_t)next->blocks[row][col].lives);
+                }
+            }
+        }
+    }
+
+    if (mask & SPECTATOR_FIELD_POWERUPS)
+    {
+        Put8(&writer, changedPowerUps);
+
+        for (int i = 0; i < PU_MAX_COUNT; i++)
+        {
+            const SpectatorPowerUp* powerUp = &next->powerUps[i];
+
+            if (!powerUpChanged[i])
+            {
+                continue;
+            }
+
+            // High bit: here it is (again). Without it: it's gone
+            Put8(&writer, i | (powerUp->visible ? 0x80 : 0));
+
+            if (powerUp->visible)
+            {
+                Put8(&writer, powerUp->type);
+                Put16(&writer, powerUp->x);
+                Put16(&writer, powerUp->y);
+                Put16(&writer, (uint16_t)powerUp->speed);
+            }
+
+            known->powerUps[i] = *powerUp;
+        }
+    }
+
+    // Everything else is now what the spectators have. The power-ups that weren't sent stay dead-reckoned
+    SpectatorPowerUp powerUps[PU_MAX_COUNT];
+    memcpy(powerUps, known->powerUps, sizeof(powerUps));
+    *known = *next;
+    memcpy(known->powerUps, powerUps, sizeof(powerUps));
+
+    return EndMessage(&writer);
+}
+
+static bool ReadSnapshot(SpectatorState* state, MessageReader* reader)
+{
+    if (Take8(reader) != SPECTATOR_VERSION)
+    {
+        printf("Spectator: the game streams a different version\n");
+        return false;
+    }
+
+    SpectatorState read = {0};
+
+    read.time = Take32(reader);
+    read.screenWidth = (int16_t)Take16(reader);
+    read.screenHeight = (int16_t)Take16(reader);
+
+    read.state = (uint8_t)Take8(reader);
+    read.flags = (uint8_t)Take8(reader);
+    read.ballX = (uint16_t)Take16(reader);
+    read.ballY = (uint16_t)Take16(reader);
+    read.ballRadius = (uint16_t)Take16(reader);
+    read.ballColor = TakeColor(reader);
+    read.paddleX = (uint16_t)Take16(reader);
+    read.paddleY = (uint16_t)Take16(reader);
+    read.paddleWidth = (uint16_t)Take16(reader);
+    read.paddleHeight = (uint16_t)Take16(reader);
+    read.paddleColor = TakeColor(reader);
+    read.score = (int32_t)Take32(reader);
+    read.lives = (uint8_t)Take8(reader);
+    read.level = (uint16_t)Take16(reader);
+    read.combo = (uint16_t)Take16(reader);
+    read.timeScale = (uint8_t)Take8(reader);
+
+    read.rows = (uint8_t)Take8(reader);
+    read.columns = (uint8_t)Take8(reader);
+
+    if (read.rows > BLOCK_GRID_ROWS || read.columns > BLOCK_GRID_COLUMNS)
+    {
+        return false;
+    }
+
+    for (int row = 0; row < read.rows; row++)
+    {
+        for (int col = 0; col < read.columns; col++)
+        {
+            SpectatorBlock* block = &read.blocks[row][col];
+
+            block->x = (int16_t)Take16(reader);
+            block->y = (int16_t)Take16(reader);
+            block->width = (int16_t)Take16(reader);
+            block->height = (int16_t)Take16(reader);
+            block->lives = (int8_t)Take8(reader);
+            block->type = (uint8_t)Take8(reader);
+            block->tint = TakeColor(reader);
+        }
+    }
+
+    int visible = (int)Take8(reader);
+
+    for (int i = 0; i < visible && !reader->bad; i++)
+    {
+        int slot = (int)Take8(reader);
+
+        if (slot >= PU_MAX_COUNT)
+        {
+            return false;
+        }
+
+        SpectatorPowerUp* powerUp = &read.powerUps[slot];
+        powerUp->visible = true;
+        powerUp->type = (uint8_t)Take8(reader);
+        powerUp->x = (uint16_t)Take16(reader);
+        powerUp->y = (uint16_t)Take16(reader);
+        powerUp->speed = (int16_t)Take16(reader);
+    }
+
+    if (reader->bad)
+    {
+        return false;
+    }
+
+    *state = read;
+    return true;
+}
+
+static bool ReadDelta(SpectatorState* state, MessageReader* reader)
+{
+    uint32_t elapsed = Take16(reader);
+    uint32_t mask = Take16(reader);
+
+    // The same order the game did it in: move the power-ups with the old time scale, then take the changes
+    AdvanceSpectatorPowerUps(state, elapsed);
+    state->time += elapsed;
+
+    if (mask & SPECTATOR_FIELD_STATE)
+    {
+        state->state = (uint8_t)Take8(reader);
+        state->flags = (uint8_t)Take8(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_BALL)
+    {
+        state->ballX = (uint16_t)Take16(reader);
+        state->ballY = (uint16_t)Take16(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_BALL_LOOK)
+    {
+        state->ballRadius = (uint16_t)Take16(reader);
+        state->ballColor = TakeColor(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_PADDLE)
+    {
+        state->paddleX = (uint16_t)Take16(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_PADDLE_LOOK)
+    {
+        state->paddleY = (uint16_t)Take16(reader);
+        state->paddleWidth = (uint16_t)Take16(reader);
+        state->paddleHeight = (uint16_t)Take16(reader);
+        state->paddleColor = TakeColor(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_SCORE)
+    {
+        state->score = (int32_t)Take32(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_COUNTERS)
+    {
+        state->lives = (uint8_t)Take8(reader);
+        state->level = (uint16_t)Take16(reader);
+        state->combo = (uint16_t)Take16(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_TIME_SCALE)
+    {
+        state->timeScale = (uint8_t)Take8(reader);
+    }
+
+    if (mask & SPECTATOR_FIELD_BLOCKS)
+    {
+        int count = (int)Take16(reader);
+
+        for (int i = 0; i < count && !reader->bad; i++)
+        {
+            int index = (int)Take16(reader);
+            int8_t lives = (int8_t)Take8(reader);
+
+            if (state->columns == 0 || index >= state->rows * state->columns)
+            {
+                return false;
+            }
+
+            state->blocks[index / state->columns][index % state->columns].lives = lives;
+        }
+    }
+
+    if (mask & SPECTATOR_FIELD_POWERUPS)
+    {
+        int count = (int)Take8(reader);
+
+        for (int i = 0; i < count && !reader->bad; i++)
+        {
+            int slot = (int)Take8(reader);
+            SpectatorPowerUp* powerUp = &state->powerUps[(slot & 0x7F) % PU_MAX_COUNT];
+
+            if ((slot & 0x7F) >= PU_MAX_COUNT)
+            {
+                return false;
+            }
+
+            powerUp->visible = (slot & 0x80) != 0;
+
+            if (powerUp->visible)
+            {
+                powerUp->type = (uint8_t)Take8(reader);
+                powerUp->x = (uint16_t)Take16(reader);
+                powerUp->y = (uint16_t)Take16(reader);
+                powerUp->speed = (int16_t)Take16(reader);
+            }
+        }
+    }
+
+    return !reader->bad;
+}
+
+bool ApplySpectatorMessage(SpectatorState* state, bool* haveSnapshot, const unsigned char* data, int size)
+{
+    MessageReader reader = { .data = data, .size = size };
+    uint32_t type = Take8(&reader);
+
+    if (type == SPECTATOR_SNAPSHOT)
+    {
+        *haveSnapshot = ReadSnapshot(state, &reader);
+        return *haveSnapshot;
+    }
+
+    if (type == SPECTATOR_DELTA && *haveSnapshot)
+    {
+        return ReadDelta(state, &reader);
+    }
+
+    return false;
+}
+
+typedef struct SpectatorClient
+{
+    TcpSocket socket;           // TCP_INVALID_SOCKET: free slot
+    unsigned char pending[SPECTATOR_CLIENT_BUFFER];
+    int pendingSize;
+} SpectatorClient;
+
+// Only ever one server, like the I/O worker
+static struct
+{
+    bool running;
+    TcpSocket listener;
+    SpectatorClient clients[SPECTATOR_MAX_CLIENTS];
+    SpectatorState known;       // What every spectator has after the last frame
+    bool haveKnown;
+    double startTime;
+    double nextFrameTime;
+    SpectatorStats stats;
+} server;
+
+bool StartSpectatorServer(int port)
+{
+    memset(&server, 0, sizeof(server));
+    server.listener = OpenTcpListener(port);
+
+    if (server.listener == TCP_INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < SPECTATOR_MAX_CLIENTS; i++)
+    {
+        server.clients[i].socket = TCP_INVALID_SOCKET;
+    }
+
+    server.running = true;
+    printf("Spectators can connect on port %d\n", port);
+    return true;
+}
+
+static void DropClient(SpectatorClient* client)
+{
+    CloseTcpSocket(client->socket);
+    client->socket = TCP_INVALID_SOCKET;
+    client->pendingSize = 0;
+    server.stats.clients--;
+}
+
+void StopSpectatorServer(void)
+{
+    if (!server.running)
+    {
+        return;
+    }
+
+    for (int i = 0; i < SPECTATOR_MAX_CLIENTS; i++)
+    {
+        if (server.clients[i].socket != TCP_INVALID_SOCKET)
+        {
+            DropClient(&server.clients[i]);
+        }
+    }
+
+    CloseTcpSocket(server.listener);
+    server.running = false;
+
+    const SpectatorStats* stats = &server.stats;
+
+    if (stats->runSeconds > 0.0)
+    {
+        printf("Spectators: %d frames (%d snapshots), %.2f KB/s to each, %.3f%% of the frame time\n",
+               stats->frames, stats->snapshots, stats->bytesSent / 1024.0 / stats->runSeconds,
+               stats->busySeconds / stats->runSeconds * 100.0);
+    }
+}
+
+static void Queue(SpectatorClient* client, const unsigned char* data, int size)
+{
+    if (client->socket == TCP_INVALID_SOCKET)
+    {
+        return;
+    }
+
+    // It hasn't read anything for seconds. Reconnecting gets it a fresh snapshot
+    if (client->pendingSize + size > SPECTATOR_CLIENT_BUFFER)
+    {
+        printf("Spectator fell too far behind, dropped\n");
+        DropClient(client);
+        return;
+    }
+
+    memcpy(client->pending + client->pendingSize, data, (size_t)size);
+    client->pendingSize += size;
+}
+
+static void Flush(SpectatorClient* client)
+{
+    int sent = 0;
+
+    while (sent < client->pendingSize)
+    {
+        int result = SendTcp(client->socket, client->pending + sent, client->pendingSize - sent);
+
+        if (result < 0)
+        {
+            DropClient(client);
+            return;
+        }
+
+        if (result == 0)
+        {
+            break;
+        }
+
+        sent += result;
+    }
+
+    memmove(client->pending, client->pending + sent, (size_t)(client->pendingSize - sent));
+    client->pendingSize -= sent;
+}
+
+static void Broadcast(const unsigned char* data, int size)
+{
+    for (int i = 0; i < SPECTATOR_MAX_CLIENTS; i++)
+    {
+        Queue(&server.clients[i], data, size);
+    }
+
+    // Counted once: this is what one spectator costs
+    server.stats.bytesSent += size;
+}
+
+static void AcceptClients(void)
+{
+    TcpSocket accepted;
+
+    while ((accepted = AcceptTcp(server.listener)) != TCP_INVALID_SOCKET)
+    {
+        SpectatorClient* client = NULL;
+
+        for (int i = 0; i < SPECTATOR_MAX_CLIENTS && client == NULL; i++)
+        {
+            client = server.clients[i].socket == TCP_INVALID_SOCKET ? &server.clients[i] : NULL;
+        }
+
+        if (client == NULL)
+        {
+            printf("Spectator turned away, already %d watching\n", SPECTATOR_MAX_CLIENTS);
+            CloseTcpSocket(accepted);
+            continue;
+        }
+
+        client->socket = accepted;
+        client->pendingSize = 0;
+        server.stats.clients++;
+
+        // Late: what everyone else has right now, the deltas follow with the next frame
+        if (server.haveKnown)
+        {
+            unsigned char snapshot[SPECTATOR_MAX_MESSAGE];
+            int size = EncodeSpectatorSnapshot(&server.known, snapshot, sizeof(snapshot));
+            Queue(client, snapshot, size);
+        }
+    }
+}
+
+// Spectators don't talk back, anything they send is dropped. Mostly this notices when they hang up
+static void DrainClients(void)
+{
+    unsigned char discard[256];
+
+    for (int i = 0; i < SPECTATOR_MAX_CLIENTS; i++)
+    {
+        SpectatorClient* client = &server.clients[i];
+
+        while (client->socket != TCP_INVALID_SOCKET)
+        {
+            int received = ReceiveTcp(client->socket, discard, sizeof(discard));
+
+            if (received < 0)
+            {
+                DropClient(client);
+            }
+
+            if (received <= 0)
+            {
+                break;
+            }
+        }
+    }
+}
+
+int EncodeSpectatorFrame(SpectatorState* known, bool* haveKnown, const SpectatorState* next, unsigned char* buffer, int capacity)
+{
+    int size = 0;
+
+    // Anything that moves blocks around (a new level, a different grid) is a fresh start for everyone
+    if (*haveKnown && SameBlockLayout(known, next))
+    {
+        size = EncodeSpectatorDelta(known, next, buffer, capacity);
+    }
+
+    if (size == 0)
+    {
+        *known = *next;
+        *haveKnown = true;
+        size = EncodeSpectatorSnapshot(known, buffer, capacity);
+    }
+
+    return size;
+}
+
+static void SendFrame(const Game* game, double now)
+{
+    static SpectatorState next;
+    unsigned char message[SPECTATOR_MAX_MESSAGE];
+
+    CaptureSpectatorState(game, (uint32_t)((now - server.startTime) * 1000.0), &next);
+
+    int size = EncodeSpectatorFrame(&server.known, &server.haveKnown, &next, message, sizeof(message));
+
+    server.stats.snapshots += message[2] == SPECTATOR_SNAPSHOT;
+    server.stats.frames++;
+    Broadcast(message, size);
+}
+
+void UpdateSpectatorServer(const Game* game, double now)
+{
+    if (!server.running)
+    {
+        return;
+    }
+
+    double start = GetPreciseTime();
+
+    if (server.startTime == 0.0)
+    {
+        server.startTime = now;
+        server.nextFrameTime = now;
+    }
+
+    AcceptClients();
+    DrainClients();
+
+    // Nobody watching: nothing to encode. The next one to connect gets a snapshot anyway
+    if (server.stats.clients == 0)
+    {
+        server.haveKnown = false;
+    }
+    else if (now >= server.nextFrameTime)
+    {
+        SendFrame(game, now);
+
+        // After a hitch, carry on from now instead of sending a burst of frames
+        server.nextFrameTime += 1.0 / SPECTATOR_FRAME_RATE;
+        server.nextFrameTime = server.nextFrameTime < now ? now + 1.0 / SPECTATOR_FRAME_RATE : server.nextFrameTime;
+    }
+
+    for (int i = 0; i < SPECTATOR_MAX_CLIENTS; i++)
+    {
+        if (server.clients[i].socket != TCP_INVALID_SOCKET && server.clients[i].pendingSize > 0)
+        {
+            Flush(&server.clients[i]);
+        }
+    }
+
+    double end = GetPreciseTime();
+    server.stats.busySeconds += end - start;
+    server.stats.runSeconds = end - server.startTime;
+}
+
+SpectatorStats GetSpectatorStats(void)
+{
+    return server.stats;
+}
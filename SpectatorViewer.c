@@ -0,0 +1,423 @@
+﻿#include <raylib.h>
+#include <rlgl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Spectator.h"
+#include "Timing.h"
+
+/* Watches a game streaming to spectators (RaylibGame --spectate-port):
+ *   Spectate <host> [port] [--headless seconds]
+ * Frames arrive SPECTATOR_FRAME_RATE times a second, so the picture runs SPECTATOR_VIEW_DELAY_MS behind them
+ * and moves the ball, paddle and power-ups smoothly between the two frames either side of now.
+ * --headless skips the window and just prints what the stream costs, for checking a setup before a match. */
+
+#define SPECTATOR_VIEW_WIDTH 1280
+#define SPECTATOR_VIEW_HEIGHT 720
+#define SPECTATOR_VIEW_HISTORY 16       // Frames kept to interpolate between, half a second
+#define SPECTATOR_VIEW_DELAY_MS 80.0    // Two and a bit frames: one late frame doesn't make it stutter
+#define SPECTATOR_RECONNECT_SECONDS 2.0
+
+_Static_assert(SPECTATOR_CLIENT_BUFFER > SPECTATOR_MAX_MESSAGE + 2, "ReceiveFrames needs room for a whole message and more");
+
+typedef struct SpectatorView
+{
+    TcpSocket socket;
+    unsigned char received[SPECTATOR_CLIENT_BUFFER];
+    int receivedSize;
+
+    SpectatorState current;         // Everything applied so far
+    bool haveSnapshot;
+
+    SpectatorState history[SPECTATOR_VIEW_HISTORY];
+    int historyCount;
+    int historyHead;                // Oldest
+
+    double clockOffset;             // Our milliseconds minus the stream's, for the fastest frame seen
+    bool haveClock;
+
+    long long bytesReceived;
+    int messages;
+    int snapshots;
+} SpectatorView;
+
+static SpectatorView view;
+static RenderCommandBuffer viewCommands;
+
+static double NowMs(void)
+{
+    return GetPreciseTime() * 1000.0;
+}
+
+static void ResetView(void)
+{
+    view.receivedSize = 0;
+    view.haveSnapshot = false;
+    view.historyCount = 0;
+    view.historyHead = 0;
+    view.haveClock = false;
+}
+
+static void RememberFrame(const SpectatorState* state)
+{
+    int slot = (view.historyHead + view.historyCount) % SPECTATOR_VIEW_HISTORY;
+
+    if (view.historyCount == SPECTATOR_VIEW_HISTORY)
+    {
+        view.historyHead = (view.historyHead + 1) % SPECTATOR_VIEW_HISTORY;
+        view.historyCount--;
+    }
+
+    view.history[slot] = *state;
+    view.historyCount++;
+
+    /* Which of our times a stream time belongs to. The quickest frame to arrive is the best guess,
+     * and it creeps up slowly in case the two clocks drift apart */
+    double offset = NowMs() - state->time;
+
+    if (!view.haveClock || offset < view.clockOffset)
+    {
+        view.clockOffset = offset;
+        view.haveClock = true;
+    }
+    else
+    {
+        view.clockOffset += (offset - view.clockOffset) * 0.01;
+    }
+}
+
+// Applies every whole message in the buffer and keeps the rest. False when the stream is broken
+static bool ApplyFrames(void)
+{
+    int offset = 0;
+
+    while (view.receivedSize - offset >= 2)
+    {
+        int length = view.received[offset] | view.received[offset + 1] << 8;
+
+        if (length == 0 || length > SPECTATOR_MAX_MESSAGE)
+        {
+            printf("Spectate: that's not a spectator stream\n");
+            return false;
+        }
+
+        if (view.receivedSize - offset - 2 < length)
+        {
+            break;
+        }
+
+        const unsigned char* message = view.received + offset + 2;
+
+        if (!ApplySpectatorMessage(&view.current, &view.haveSnapshot, message, length))
+        {
+            printf("Spectate: couldn't read a frame\n");
+            return false;
+        }
+
+        view.snapshots += message[0] == SPECTATOR_SNAPSHOT;
+        view.messages++;
+        RememberFrame(&view.current);
+        offset += 2 + length;
+    }
+
+    memmove(view.received, view.received + offset, (size_t)(view.receivedSize - offset));
+    view.receivedSize -= offset;
+
+    return true;
+}
+
+/* Every whole message that's arrived. False when the stream is broken or gone.
+ * Applied as we read: after a stall the kernel can hold more than our buffer, and asking recv
+ * for 0 bytes would look just like the game hanging up */
+static bool ReceiveFrames(void)
+{
+    while (true)
+    {
+        int received = ReceiveTcp(view.socket, view.received + view.receivedSize, SPECTATOR_CLIENT_BUFFER - view.receivedSize);
+
+        if (received < 0)
+        {
+            printf("Spectate: the game went away\n");
+            return false;
+        }
+
+        if (received == 0)
+        {
+            return true;
+        }
+
+        view.receivedSize += received;
+        view.bytesReceived += received;
+
+        // Whatever's left after this is less than one message, so there's always room for more (see the assert up top)
+        if (!ApplyFrames())
+        {
+            return false;
+        }
+    }
+}
+
+static bool Connect(const char* host, int port)
+{
+    view.socket = ConnectTcp(host, port);
+    ResetView();
+
+    return view.socket != TCP_INVALID_SOCKET;
+}
+
+static float Lerp16(uint16_t from, uint16_t to, float t)
+{
+    return (from + (to - from) * t) / SPECTATOR_SUBPIXELS;
+}
+
+// The frame to draw, SPECTATOR_VIEW_DELAY_MS ago: the frame before it for everything but positions, which blend
+static void DrawInterpolated(float scale)
+{
+    const SpectatorState* from = &view.history[view.historyHead];
+    const SpectatorState* to = from;
+    double time = NowMs() - view.clockOffset - SPECTATOR_VIEW_DELAY_MS;
+    float t = 0.0f;
+
+    for (int i = 0; i < view.historyCount; i++)
+    {
+        const SpectatorState* frame = &view.history[(view.historyHead + i) % SPECTATOR_VIEW_HISTORY];
+
+        if (frame->time <= time)
+        {
+            from = frame;
+            to = frame;
+            continue;
+        }
+
+        to = frame;
+        t = from->time < frame->time ? (float)((time - from->time) / (frame->time - from->time)) : 0.0f;
+        t = t < 0.0f ? 0.0f : t;
+        break;
+    }
+
+    ClearRenderCommands(&viewCommands);
+
+    for (int row = 0; row < from->rows; row++)
+    {
+        for (int col = 0; col < from->columns; col++)
+        {
+            const SpectatorBlock* captured = &from->blocks[row][col];
+
+            if (captured->lives < 0)
+            {
+                continue;
+            }
+
+            Block block = {
+                .position = { captured->x, captured->y },
+                .width = captured->width,
+                .height = captured->height,
+                .tint = captured->tint,
+                .type = (BlockType)captured->type,
+                .lives = captured->lives,
+                .active = true
+            };
+
+            block.color = ShadeBlock(&block, from->flags & SPECTATOR_TIMEWARP);
+            RecordBlock(&viewCommands, &block);
+        }
+    }
+
+    // Serving again or a new life puts the ball back on the paddle: jump there instead of sliding across
+    bool ballActive = from->flags & SPECTATOR_BALL_ACTIVE;
+    bool ballBlends = ballActive == ((to->flags & SPECTATOR_BALL_ACTIVE) != 0);
+    Vector2 ball = {
+        ballBlends ? Lerp16(from->ballX, to->ballX, t) : from->ballX / (float)SPECTATOR_SUBPIXELS,
+        ballBlends ? Lerp16(from->ballY, to->ballY, t) : from->ballY / (float)SPECTATOR_SUBPIXELS
+    };
+
+    PushCircle(&viewCommands, RENDER_LAYER_BALL, ball, from->ballRadius / (float)SPECTATOR_SUBPIXELS, from->ballColor);
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        const SpectatorPowerUp* powerUp = &from->powerUps[i];
+
+        if (!powerUp->visible)
+        {
+            continue;
+        }
+
+        // Same one in the next frame, or it went: then it just stays put for the last few milliseconds
+        const SpectatorPowerUp* next = to->powerUps[i].visible && to->powerUps[i].type == powerUp->type ? &to->powerUps[i] : powerUp;
+        Vector2 position = { Lerp16(powerUp->x, next->x, t), Lerp16(powerUp->y, next->y, t) };
+
+        RecordPowerUp(&viewCommands, CreatePowerUp(position, (PowerUpType)powerUp->type, 0.0f));
+    }
+
+    PushRectangle(&viewCommands, RENDER_LAYER_PADDLE, (int)Lerp16(from->paddleX, to->paddleX, t),
+                  from->paddleY / SPECTATOR_SUBPIXELS, from->paddleWidth / SPECTATOR_SUBPIXELS,
+                  from->paddleHeight / SPECTATOR_SUBPIXELS, from->paddleColor);
+
+    rlPushMatrix();
+    {
+        rlScalef(scale, scale, 1.0f);
+        SubmitRenderCommands(&viewCommands);
+    }
+    rlPopMatrix();
+
+    DrawRectangleLines(0, 0, (int)(from->screenWidth * scale), (int)(from->screenHeight * scale), DARKGREEN);
+
+    const char* state = "";
+
+    switch ((GameState)from->state)
+    {
+        case PLAYING:
+            state = "";
+        break;
+
+        case LEVEL_COMPLETE:
+            state = "  LEVEL COMPLETE";
+        break;
+
+        case GAME_OVER:
+            state = "  GAME OVER";
+        break;
+
+        case WIN:
+            state = "  WIN";
+        break;
+
+        default:
+            state = "  In the menus";
+        break;
+    }
+
+    DrawText(TextFormat("Score %d  Lives %d  Level %d  Combo %d%s", from->score, from->lives, from->level, from->combo, state),
+             10, 10, 20, PLAYER_COLOR);
+}
+
+static void PrintStats(double seconds)
+{
+    printf("Spectate: %d frames (%d snapshots) in %.1f s, %.2f KB/s\n", view.messages, view.snapshots, seconds,
+           seconds > 0.0 ? view.bytesReceived / 1024.0 / seconds : 0.0);
+}
+
+static int RunHeadless(double seconds)
+{
+    double start = GetPreciseTime();
+
+    while (GetPreciseTime() - start < seconds)
+    {
+        if (!ReceiveFrames())
+        {
+            PrintStats(GetPreciseTime() - start);
+            return 1;
+        }
+
+        SleepSeconds(0.005);
+    }
+
+    PrintStats(GetPreciseTime() - start);
+
+    if (view.haveSnapshot)
+    {
+        printf("Spectate: score %d, lives %d, level %d\n", view.current.score, view.current.lives, view.current.level);
+    }
+
+    return view.haveSnapshot ? 0 : 1;
+}
+
+static void RunWindowed(const char* host, int port)
+{
+    double start = GetPreciseTime();
+    double retryAt = 0.0;
+
+    InitWindow(SPECTATOR_VIEW_WIDTH, SPECTATOR_VIEW_HEIGHT, TextFormat("Block Kuzushi! Spectating %s", host));
+    SetTargetFPS(60);
+
+    while (!WindowShouldClose())
+    {
+        if (view.socket == TCP_INVALID_SOCKET && GetPreciseTime() >= retryAt)
+        {
+            retryAt = GetPreciseTime() + SPECTATOR_RECONNECT_SECONDS;
+            Connect(host, port);
+        }
+
+        if (view.socket != TCP_INVALID_SOCKET && !ReceiveFrames())
+        {
+            CloseTcpSocket(view.socket);
+            view.socket = TCP_INVALID_SOCKET;
+            retryAt = GetPreciseTime() + SPECTATOR_RECONNECT_SECONDS;
+        }
+
+        BeginDrawing();
+        {
+            ClearBackground(BLACK);
+
+            if (view.historyCount > 0)
+            {
+                const SpectatorState* newest = &view.history[(view.historyHead + view.historyCount - 1) % SPECTATOR_VIEW_HISTORY];
+                float scaleX = (float)SPECTATOR_VIEW_WIDTH / newest->screenWidth;
+                float scaleY = (float)SPECTATOR_VIEW_HEIGHT / newest->screenHeight;
+
+                DrawInterpolated(scaleX < scaleY ? scaleX : scaleY);
+            }
+
+            if (view.socket == TCP_INVALID_SOCKET)
+            {
+                DrawText(TextFormat("Waiting for %s:%d...", host, port), 10, SPECTATOR_VIEW_HEIGHT - 30, 20, YELLOW);
+            }
+            else
+            {
+                double seconds = GetPreciseTime() - start;
+                DrawText(TextFormat("%.2f KB/s", seconds > 0.0 ? view.bytesReceived / 1024.0 / seconds : 0.0),
+                         10, SPECTATOR_VIEW_HEIGHT - 30, 20, GRAY);
+            }
+        }
+        EndDrawing();
+    }
+
+    CloseWindow();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <host> [port] [--headless seconds]\n", argv[0]);
+        return 1;
+    }
+
+    const char* host = argv[1];
+    int port = SPECTATOR_DEFAULT_PORT;
+    double headlessSeconds = 0.0;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+        {
+            headlessSeconds = atof(argv[++i]);
+        }
+        else
+        {
+            port = atoi(argv[i]);
+        }
+    }
+
+    if (!StartNetworking())
+    {
+        return 1;
+    }
+
+    int result = 0;
+    view.socket = TCP_INVALID_SOCKET;
+
+    if (headlessSeconds > 0.0)
+    {
+        result = Connect(host, port) ? RunHeadless(headlessSeconds) : 1;
+    }
+    else
+    {
+        RunWindowed(host, port);
+    }
+
+    CloseTcpSocket(view.socket);
+    StopNetworking();
+
+    return result;
+}
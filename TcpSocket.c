@@ -0,0 +1,216 @@
+﻿#include "TcpSocket.h"
+#include <stdio.h>
+#include <string.h>
+
+// Like UdpSocket.c, no raylib in here: winsock2.h includes windows.h
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <arpa/inet.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+// A closed peer would raise SIGPIPE on send and kill the game, we'd rather get an error back
+#ifdef MSG_NOSIGNAL
+    #define SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define SEND_FLAGS 0
+#endif
+
+static void SetNonBlocking(TcpSocket socket)
+{
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket((SOCKET)socket, FIONBIO, &nonBlocking);
+#else
+    fcntl((int)socket, F_SETFL, fcntl((int)socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// Small messages, several a second: don't let Nagle hold them back waiting for more
+static void SetNoDelay(TcpSocket socket)
+{
+    int noDelay = 1;
+#ifdef _WIN32
+    setsockopt((SOCKET)socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+#else
+    setsockopt((int)socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+#endif
+}
+
+static bool WouldBlock(void)
+{
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+static TcpSocket CreateTcpSocket(void)
+{
+#ifdef _WIN32
+    SOCKET handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    return handle == INVALID_SOCKET ? TCP_INVALID_SOCKET : (TcpSocket)handle;
+#else
+    int handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    return handle < 0 ? TCP_INVALID_SOCKET : (TcpSocket)handle;
+#endif
+}
+
+TcpSocket OpenTcpListener(int port)
+{
+    TcpSocket listener = CreateTcpSocket();
+
+    if (listener == TCP_INVALID_SOCKET)
+    {
+        printf("Couldn't create a TCP socket\n");
+        return TCP_INVALID_SOCKET;
+    }
+
+    // Restarting the game shouldn't have to wait out the old listener's TIME_WAIT
+    int reuse = 1;
+#ifdef _WIN32
+    setsockopt((SOCKET)listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+#else
+    setsockopt((int)listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons((uint16_t)port);
+
+#ifdef _WIN32
+    bool bound = bind((SOCKET)listener, (const struct sockaddr*)&local, sizeof(local)) == 0 && listen((SOCKET)listener, SOMAXCONN) == 0;
+#else
+    bool bound = bind((int)listener, (const struct sockaddr*)&local, sizeof(local)) == 0 && listen((int)listener, SOMAXCONN) == 0;
+#endif
+
+    if (!bound)
+    {
+        printf("Couldn't listen on TCP port %d\n", port);
+        CloseTcpSocket(listener);
+        return TCP_INVALID_SOCKET;
+    }
+
+    SetNonBlocking(listener);
+    return listener;
+}
+
+TcpSocket AcceptTcp(TcpSocket listener)
+{
+#ifdef _WIN32
+    SOCKET handle = accept((SOCKET)listener, NULL, NULL);
+    TcpSocket accepted = handle == INVALID_SOCKET ? TCP_INVALID_SOCKET : (TcpSocket)handle;
+#else
+    int handle = accept((int)listener, NULL, NULL);
+    TcpSocket accepted = handle < 0 ? TCP_INVALID_SOCKET : (TcpSocket)handle;
+#endif
+
+    if (accepted != TCP_INVALID_SOCKET)
+    {
+        SetNonBlocking(accepted);
+        SetNoDelay(accepted);
+    }
+
+    return accepted;
+}
+
+TcpSocket ConnectTcp(const char* host, int port)
+{
+    UdpAddress address;
+
+    if (!ResolveUdpAddress(host, port, &address))
+    {
+        return TCP_INVALID_SOCKET;
+    }
+
+    TcpSocket connection = CreateTcpSocket();
+
+    if (connection == TCP_INVALID_SOCKET)
+    {
+        printf("Couldn't create a TCP socket\n");
+        return TCP_INVALID_SOCKET;
+    }
+
+    struct sockaddr_in remote = {0};
+    remote.sin_family = AF_INET;
+    remote.sin_addr.s_addr = htonl(address.host);
+    remote.sin_port = htons(address.port);
+
+#ifdef _WIN32
+    bool connected = connect((SOCKET)connection, (const struct sockaddr*)&remote, sizeof(remote)) == 0;
+#else
+    bool connected = connect((int)connection, (const struct sockaddr*)&remote, sizeof(remote)) == 0;
+#endif
+
+    if (!connected)
+    {
+        printf("Couldn't connect to %s:%d\n", host, port);
+        CloseTcpSocket(connection);
+        return TCP_INVALID_SOCKET;
+    }
+
+    SetNonBlocking(connection);
+    SetNoDelay(connection);
+    return connection;
+}
+
+void CloseTcpSocket(TcpSocket socket)
+{
+    if (socket == TCP_INVALID_SOCKET)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    closesocket((SOCKET)socket);
+#else
+    close((int)socket);
+#endif
+}
+
+int SendTcp(TcpSocket socket, const void* data, int size)
+{
+#ifdef _WIN32
+    int sent = send((SOCKET)socket, (const char*)data, size, SEND_FLAGS);
+#else
+    int sent = (int)send((int)socket, data, (size_t)size, SEND_FLAGS);
+#endif
+
+    if (sent < 0)
+    {
+        return WouldBlock() ? 0 : -1;
+    }
+
+    return sent;
+}
+
+int ReceiveTcp(TcpSocket socket, void* buffer, int capacity)
+{
+#ifdef _WIN32
+    int received = recv((SOCKET)socket, (char*)buffer, capacity, 0);
+#else
+    int received = (int)recv((int)socket, buffer, (size_t)capacity, 0);
+#endif
+
+    // 0 from recv is the other side hanging up
+    if (received == 0)
+    {
+        return -1;
+    }
+
+    if (received < 0)
+    {
+        return WouldBlock() ? 0 : -1;
+    }
+
+    return received;
+}
@@ -0,0 +1,332 @@
+﻿#include "Telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <windows.h>    // MoveFileExA (no raylib in here either, see RunJournal.c)
+#else
+    #include <unistd.h>
+#endif
+
+// Version 1 had no rewind power-up: one spawned and one collected column fewer
+#define TELEMETRY_V1_POWERUP_TYPES (TELEMETRY_POWERUP_TYPES - 1)
+#define TELEMETRY_V1_COLUMN_COUNT (TELEMETRY_COLUMN_COUNT - 2)
+
+static const char* columnNames[TELEMETRY_COLUMN_COUNT] =
+{
+    "timestamp", "score", "max_combo", "level", "duration_ms", "ticks", "blocks_hit", "lives_lost",
+    "spawned_life", "spawned_speed", "spawned_growth", "spawned_ghost", "spawned_timewarp", "spawned_damage",
+    "spawned_rewind",
+    "collected_life", "collected_speed", "collected_growth", "collected_ghost", "collected_timewarp", "collected_damage",
+    "collected_rewind",
+    "death_tick_1", "death_tick_2", "death_tick_3", "death_tick_4",
+    "death_tick_5", "death_tick_6", "death_tick_7", "death_tick_8"
+};
+
+void ResetRunTelemetry(RunTelemetry* telemetry)
+{
+    *telemetry = (RunTelemetry){0};
+}
+
+void RecordTelemetryDeath(RunTelemetry* telemetry)
+{
+    if (telemetry->livesLost < TELEMETRY_MAX_DEATHS)
+    {
+        telemetry->deathTicks[telemetry->livesLost] = telemetry->ticks;
+    }
+
+    telemetry->livesLost++;
+}
+
+TelemetryRow BuildTelemetryRow(const RunTelemetry* telemetry, int score, int maxCombo, int level)
+{
+    TelemetryRow row = {0};
+
+    row.values[TELEMETRY_TIMESTAMP] = (int)time(NULL);
+    row.values[TELEMETRY_SCORE] = score;
+    row.values[TELEMETRY_MAX_COMBO] = maxCombo;
+    row.values[TELEMETRY_LEVEL] = level;
+    row.values[TELEMETRY_DURATION_MS] = (int)(telemetry->duration * 1000.0f);
+    row.values[TELEMETRY_TICKS] = telemetry->ticks;
+    row.values[TELEMETRY_BLOCKS_HIT] = telemetry->blocksHit;
+    row.values[TELEMETRY_LIVES_LOST] = telemetry->livesLost;
+
+    for (int i = 0; i < TELEMETRY_POWERUP_TYPES; i++)
+    {
+        row.values[TELEMETRY_SPAWNED_FIRST + i] = telemetry->powerUpsSpawned[i];
+        row.values[TELEMETRY_COLLECTED_FIRST + i] = telemetry->powerUpsCollected[i];
+    }
+
+    // Unused death slots stay 0, meaning "didn't die that many times"
+    for (int i = 0; i < TELEMETRY_MAX_DEATHS; i++)
+    {
+        row.values[TELEMETRY_DEATH_TICK_FIRST + i] = telemetry->deathTicks[i];
+    }
+
+    return row;
+}
+
+// Same as in RunJournal.c: all the way to the disk, not just the OS cache
+static bool SyncTelemetryFile(FILE* file)
+{
+    if (fflush(file) != 0)
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+size_t GetTelemetryBlockBytes(void)
+{
+    return (size_t)TELEMETRY_COLUMN_COUNT * TELEMETRY_BLOCK_ROWS * sizeof(int);
+}
+
+// Where a version 1 column lives now: the power-up groups each got one column longer at the end
+static int MapVersion1Column(int column)
+{
+    if (column < TELEMETRY_SPAWNED_FIRST + TELEMETRY_V1_POWERUP_TYPES)
+    {
+        return column;
+    }
+
+    if (column < TELEMETRY_SPAWNED_FIRST + 2 * TELEMETRY_V1_POWERUP_TYPES)
+    {
+        return column + 1;
+    }
+
+    return column + 2;
+}
+
+/* Rewrites a version 1 file in the current layout, with the rewind columns at 0 for the old runs.
+ * Into a temp file first and renamed over the old one, so a crash halfway leaves the old file as it was.
+ * Closes `old` either way */
+static bool MigrateTelemetryFile(FILE* old, const TelemetryFileHeader* oldHeader)
+{
+    const char* tempPath = TELEMETRY_FILE ".tmp";
+    size_t oldColumnBytes = (size_t)TELEMETRY_BLOCK_ROWS * sizeof(int);
+    unsigned int blockCount = (oldHeader->rowCount + TELEMETRY_BLOCK_ROWS - 1) / TELEMETRY_BLOCK_ROWS;
+    unsigned char* block = malloc(GetTelemetryBlockBytes());
+    FILE* file = fopen(tempPath, "wb");
+
+    if (!block || !file)
+    {
+        free(block);
+        fclose(old);
+
+        if (file)
+        {
+            fclose(file);
+            remove(tempPath);
+        }
+
+        return false;
+    }
+
+    TelemetryFileHeader header = *oldHeader;
+    header.version = TELEMETRY_VERSION;
+    header.columnCount = TELEMETRY_COLUMN_COUNT;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fseek(old, (long)sizeof(header), SEEK_SET) == 0;
+
+    for (unsigned int b = 0; written && b < blockCount; b++)
+    {
+        memset(block, 0, GetTelemetryBlockBytes());
+
+        for (int column = 0; written && column < TELEMETRY_V1_COLUMN_COUNT; column++)
+        {
+            written = fread(block + MapVersion1Column(column) * oldColumnBytes, oldColumnBytes, 1, old) == 1;
+        }
+
+        written = written && fwrite(block, GetTelemetryBlockBytes(), 1, file) == 1;
+    }
+
+    free(block);
+    written = SyncTelemetryFile(file) && written;
+    written = (fclose(file) == 0) && written;
+
+    fclose(old); // Windows won't replace a file that's still open
+
+    if (!written)
+    {
+        remove(tempPath);
+        return false;
+    }
+
+#ifdef _WIN32
+    return MoveFileExA(tempPath, TELEMETRY_FILE, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(tempPath, TELEMETRY_FILE) == 0;
+#endif
+}
+
+/* Opens the file for appending. NULL in *file with true means there is none yet, start one.
+ * A version 1 file is migrated once. Anything else we don't understand is moved aside as telemetry.col.old
+ * and a new file starts, instead of refusing every run from now on */
+static bool OpenTelemetryFile(FILE** file, TelemetryFileHeader* header)
+{
+    *file = fopen(TELEMETRY_FILE, "r+b");
+
+    if (!*file)
+    {
+        return true;
+    }
+
+    bool readable = fread(header, sizeof(*header), 1, *file) == 1 && header->magic == TELEMETRY_MAGIC &&
+                    header->blockRows == TELEMETRY_BLOCK_ROWS;
+
+    if (readable && header->version == TELEMETRY_VERSION && header->columnCount == TELEMETRY_COLUMN_COUNT)
+    {
+        return true;
+    }
+
+    if (readable && header->version == 1 && header->columnCount == TELEMETRY_V1_COLUMN_COUNT)
+    {
+        unsigned int rowCount = header->rowCount;
+
+        // If it fails we try again next run, the old file is untouched
+        if (!MigrateTelemetryFile(*file, header))
+        {
+            printf("Failed to migrate the version 1 telemetry file\n");
+            *file = NULL;
+            return false;
+        }
+
+        printf("Telemetry file migrated from version 1 (%u runs), the new columns start at 0 for them\n", rowCount);
+        *file = fopen(TELEMETRY_FILE, "r+b");
+
+        return *file != NULL && fread(header, sizeof(*header), 1, *file) == 1;
+    }
+
+    fclose(*file);
+    *file = NULL;
+
+    if (rename(TELEMETRY_FILE, TELEMETRY_FILE ".old") != 0)
+    {
+        printf("Telemetry file has an unknown layout and can't be moved aside, not touching it\n");
+        return false;
+    }
+
+    printf("Telemetry file has an unknown layout, moved it to %s and starting a new one\n", TELEMETRY_FILE ".old");
+    return true;
+}
+
+/* Appending a row means one int into each column of the last block.
+ * The row only "exists" once the header count is bumped at the very end,
+ * so a crash halfway leaves the file exactly as it was. */
+bool AppendTelemetryRow(const TelemetryRow* row)
+{
+    TelemetryFileHeader header;
+    FILE* file;
+
+    if (!OpenTelemetryFile(&file, &header))
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+
+        return false;
+    }
+
+    if (!file)
+    {
+        file = fopen(TELEMETRY_FILE, "w+b");
+
+        if (!file)
+        {
+            printf("Failed to create telemetry file\n");
+            return false;
+        }
+
+        header = (TelemetryFileHeader)
+        {
+            .magic = TELEMETRY_MAGIC,
+            .version = TELEMETRY_VERSION,
+            .columnCount = TELEMETRY_COLUMN_COUNT,
+            .blockRows = TELEMETRY_BLOCK_ROWS,
+            .rowCount = 0
+        };
+
+        fwrite(&header, sizeof(header), 1, file);
+    }
+
+    size_t blockBytes = GetTelemetryBlockBytes();
+    unsigned int block = header.rowCount / TELEMETRY_BLOCK_ROWS;
+    unsigned int rowInBlock = header.rowCount % TELEMETRY_BLOCK_ROWS;
+    long blockStart = (long)(sizeof(header) + block * blockBytes);
+
+    bool written = true;
+
+    // First row of a new block: grow the file by a whole zeroed block, so every column has its fixed spot
+    if (rowInBlock == 0)
+    {
+        written = fseek(file, blockStart + (long)blockBytes - 1, SEEK_SET) == 0 && fputc(0, file) != EOF;
+    }
+
+    for (int column = 0; written && column < TELEMETRY_COLUMN_COUNT; column++)
+    {
+        long offset = blockStart + (long)((column * TELEMETRY_BLOCK_ROWS + rowInBlock) * sizeof(int));
+
+        written = fseek(file, offset, SEEK_SET) == 0 &&
+                  fwrite(&row->values[column], sizeof(int), 1, file) == 1;
+    }
+
+    // Columns first, then the count: that's our commit point
+    written = written && SyncTelemetryFile(file);
+
+    if (written)
+    {
+        header.rowCount++;
+        written = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+        written = SyncTelemetryFile(file) && written;
+    }
+
+    written = (fclose(file) == 0) && written;
+
+    if (!written)
+    {
+        printf("Failed to write telemetry row\n");
+    }
+
+    return written;
+}
+
+const char* GetTelemetryColumnName(int column)
+{
+    if (column < 0 || column >= TELEMETRY_COLUMN_COUNT)
+    {
+        return "?";
+    }
+
+    return columnNames[column];
+}
+
+int FindTelemetryColumn(const char* name)
+{
+    for (int i = 0; i < TELEMETRY_COLUMN_COUNT; i++)
+    {
+        if (strcmp(columnNames[i], name) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Straight pointer into the mapped file: TELEMETRY_BLOCK_ROWS ints of one column
+const int* GetTelemetryColumnBlock(const unsigned char* fileData, int column, int block)
+{
+    size_t offset = sizeof(TelemetryFileHeader) + (size_t)block * GetTelemetryBlockBytes() +
+                    (size_t)column * TELEMETRY_BLOCK_ROWS * sizeof(int);
+
+    return (const int*)(fileData + offset);
+}
@@ -0,0 +1,546 @@
+﻿#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "MappedFile.h"
+#include "Telemetry.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define TELEMETRY_USE_SSE 1
+#endif
+
+/* Offline query tool for telemetry.col!
+ *   TelemetryQuery <file> columns
+ *   TelemetryQuery <file> summary
+ *   TelemetryQuery <file> percentiles <column> [p ...]
+ *   TelemetryQuery <file> histogram <column> [buckets]
+ *   TelemetryQuery <file> generate <runs>      (fake runs, for benchmarking)
+ * The file is memory-mapped, so every scan reads the column arrays straight out of the page cache. */
+
+#define FINE_BUCKET_BITS 16
+#define FINE_BUCKETS (1 << FINE_BUCKET_BITS)
+
+typedef struct TelemetryTable
+{
+    MappedFile file;
+    const TelemetryFileHeader* header;
+    int rowCount;
+    int blockCount;
+} TelemetryTable;
+
+typedef struct ColumnStats
+{
+    long long count;
+    long long sum;
+    int min;
+    int max;
+} ColumnStats;
+
+// A fine histogram over the column: bucket = (value - min) >> shift
+typedef struct FineHistogram
+{
+    unsigned int* counts;
+    int shift;
+    int min;
+} FineHistogram;
+
+static double NowMilliseconds(void)
+{
+    return (double)clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static bool OpenTelemetryTable(const char* path, TelemetryTable* table)
+{
+    if (!MapFileReadOnly(path, &table->file))
+    {
+        printf("Can't open %s\n", path);
+        return false;
+    }
+
+    table->header = (const TelemetryFileHeader*)table->file.data;
+
+    if (table->file.size < sizeof(TelemetryFileHeader) || table->header->magic != TELEMETRY_MAGIC ||
+        table->header->version != TELEMETRY_VERSION || table->header->columnCount != TELEMETRY_COLUMN_COUNT ||
+        table->header->blockRows != TELEMETRY_BLOCK_ROWS || table->header->rowCount > INT_MAX)
+    {
+        printf("%s is not a telemetry file this tool understands\n", path);
+        UnmapFile(&table->file);
+        return false;
+    }
+
+    table->rowCount = (int)table->header->rowCount;
+    table->blockCount = (table->rowCount + TELEMETRY_BLOCK_ROWS - 1) / TELEMETRY_BLOCK_ROWS;
+
+    // Never trust a header that claims more blocks than the file actually has
+    size_t needed = sizeof(TelemetryFileHeader) + (size_t)table->blockCount * GetTelemetryBlockBytes();
+
+    if (needed > table->file.size)
+    {
+        printf("%s is truncated\n", path);
+        UnmapFile(&table->file);
+        return false;
+    }
+
+    return true;
+}
+
+static int RowsInBlock(const TelemetryTable* table, int block)
+{
+    int remaining = table->rowCount - block * TELEMETRY_BLOCK_ROWS;
+    return remaining < TELEMETRY_BLOCK_ROWS ? remaining : TELEMETRY_BLOCK_ROWS;
+}
+
+// Min, max and sum of one column block, four runs per step
+static void ScanColumnBlock(const int* values, int count, ColumnStats* stats)
+{
+    int i = 0;
+
+#ifdef TELEMETRY_USE_SSE
+    __m128i minimum = _mm_set1_epi32(INT_MAX);
+    __m128i maximum = _mm_set1_epi32(INT_MIN);
+    __m128i sumLow = _mm_setzero_si128();
+    __m128i sumHigh = _mm_setzero_si128();
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_load_si128((const __m128i*)(values + i));
+
+        // SSE2 has no 32-bit min/max, so we select with compare masks
+        __m128i less = _mm_cmplt_epi32(v, minimum);
+        minimum = _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, minimum));
+
+        __m128i greater = _mm_cmpgt_epi32(v, maximum);
+        maximum = _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, maximum));
+
+        // Sign-extend to 64 bits before summing, timestamps alone would overflow 32 bits
+        __m128i sign = _mm_srai_epi32(v, 31);
+        sumLow = _mm_add_epi64(sumLow, _mm_unpacklo_epi32(v, sign));
+        sumHigh = _mm_add_epi64(sumHigh, _mm_unpackhi_epi32(v, sign));
+    }
+
+    int minLanes[4];
+    int maxLanes[4];
+    long long sumLanes[4];
+
+    _mm_storeu_si128((__m128i*)minLanes, minimum);
+    _mm_storeu_si128((__m128i*)maxLanes, maximum);
+    _mm_storeu_si128((__m128i*)sumLanes, sumLow);
+    _mm_storeu_si128((__m128i*)(sumLanes + 2), sumHigh);
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+        stats->min = minLanes[lane] < stats->min ? minLanes[lane] : stats->min;
+        stats->max = maxLanes[lane] > stats->max ? maxLanes[lane] : stats->max;
+        stats->sum += sumLanes[lane];
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        stats->min = values[i] < stats->min ? values[i] : stats->min;
+        stats->max = values[i] > stats->max ? values[i] : stats->max;
+        stats->sum += values[i];
+    }
+
+    stats->count += count;
+}
+
+static ColumnStats ScanColumn(const TelemetryTable* table, int column)
+{
+    ColumnStats stats = { .count = 0, .sum = 0, .min = INT_MAX, .max = INT_MIN };
+
+    for (int block = 0; block < table->blockCount; block++)
+    {
+        ScanColumnBlock(GetTelemetryColumnBlock(table->file.data, column, block), RowsInBlock(table, block), &stats);
+    }
+
+    return stats;
+}
+
+/* One pass that drops every run into one of 65536 buckets.
+ * If the column's range fits in 16 bits, every bucket is a single exact value. */
+static FineHistogram BuildFineHistogram(const TelemetryTable* table, int column, const ColumnStats* stats)
+{
+    FineHistogram histogram = { .counts = calloc(FINE_BUCKETS, sizeof(unsigned int)), .shift = 0, .min = stats->min };
+    unsigned int range = (unsigned int)stats->max - (unsigned int)stats->min;
+
+    while ((range >> histogram.shift) >= FINE_BUCKETS)
+    {
+        histogram.shift++;
+    }
+
+    if (!histogram.counts)
+    {
+        return histogram;
+    }
+
+    for (int block = 0; block < table->blockCount; block++)
+    {
+        const int* values = GetTelemetryColumnBlock(table->file.data, column, block);
+        int count = RowsInBlock(table, block);
+        int i = 0;
+
+#ifdef TELEMETRY_USE_SSE
+        // Bucket indices four at a time; the increments themselves have to be scalar
+        __m128i minimum = _mm_set1_epi32(histogram.min);
+        __m128i shift = _mm_cvtsi32_si128(histogram.shift);
+        unsigned int indices[4];
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_load_si128((const __m128i*)(values + i));
+            _mm_storeu_si128((__m128i*)indices, _mm_srl_epi32(_mm_sub_epi32(v, minimum), shift));
+
+            histogram.counts[indices[0]]++;
+            histogram.counts[indices[1]]++;
+            histogram.counts[indices[2]]++;
+            histogram.counts[indices[3]]++;
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            histogram.counts[((unsigned int)values[i] - (unsigned int)histogram.min) >> histogram.shift]++;
+        }
+    }
+
+    return histogram;
+}
+
+static int CompareInts(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile: find its bucket, and if the bucket spans several values, sort just that bucket
+static int FindPercentile(const TelemetryTable* table, int column, const FineHistogram* histogram, long long count, double percentile)
+{
+    long long rank = (long long)(percentile / 100.0 * count + 0.999999);
+    rank = rank < 1 ? 1 : (rank > count ? count : rank);
+
+    long long seen = 0;
+    int bucket = 0;
+
+    while (bucket < FINE_BUCKETS - 1 && seen + histogram->counts[bucket] < rank)
+    {
+        seen += histogram->counts[bucket++];
+    }
+
+    int bucketMin = (int)((unsigned int)histogram->min + ((unsigned int)bucket << histogram->shift));
+
+    if (histogram->shift == 0)
+    {
+        return bucketMin;
+    }
+
+    // Second pass over just this bucket's runs
+    int* members = malloc(histogram->counts[bucket] * sizeof(int));
+    int memberCount = 0;
+
+    if (!members)
+    {
+        return bucketMin;
+    }
+
+    for (int block = 0; block < table->blockCount; block++)
+    {
+        const int* values = GetTelemetryColumnBlock(table->file.data, column, block);
+        int rows = RowsInBlock(table, block);
+
+        for (int i = 0; i < rows; i++)
+        {
+            if ((int)(((unsigned int)values[i] - (unsigned int)histogram->min) >> histogram->shift) == bucket)
+            {
+                members[memberCount++] = values[i];
+            }
+        }
+    }
+
+    qsort(members, memberCount, sizeof(int), CompareInts);
+    int result = members[rank - seen - 1];
+    free(members);
+
+    return result;
+}
+
+static void PrintColumns(void)
+{
+    for (int i = 0; i < TELEMETRY_COLUMN_COUNT; i++)
+    {
+        printf("%2d  %s\n", i, GetTelemetryColumnName(i));
+    }
+}
+
+static void PrintSummary(const TelemetryTable* table)
+{
+    printf("%-20s %12s %12s %14s %12s %12s\n", "column", "min", "max", "mean", "p50", "p99");
+
+    for (int column = 0; column < TELEMETRY_COLUMN_COUNT; column++)
+    {
+        ColumnStats stats = ScanColumn(table, column);
+
+        if (stats.count == 0)
+        {
+            printf("%-20s no runs\n", GetTelemetryColumnName(column));
+            continue;
+        }
+
+        FineHistogram histogram = BuildFineHistogram(table, column, &stats);
+
+        printf("%-20s %12d %12d %14.2f %12d %12d\n",
+               GetTelemetryColumnName(column), stats.min, stats.max, (double)stats.sum / stats.count,
+               FindPercentile(table, column, &histogram, stats.count, 50.0),
+               FindPercentile(table, column, &histogram, stats.count, 99.0));
+
+        free(histogram.counts);
+    }
+}
+
+static void PrintPercentiles(const TelemetryTable* table, int column, const double* percentiles, int percentileCount)
+{
+    ColumnStats stats = ScanColumn(table, column);
+
+    if (stats.count == 0)
+    {
+        printf("%s: no runs\n", GetTelemetryColumnName(column));
+        return;
+    }
+
+    FineHistogram histogram = BuildFineHistogram(table, column, &stats);
+
+    printf("%s over %lld runs (mean %.2f)\n", GetTelemetryColumnName(column), stats.count, (double)stats.sum / stats.count);
+
+    for (int i = 0; i < percentileCount; i++)
+    {
+        printf("  p%-6g %d\n", percentiles[i], FindPercentile(table, column, &histogram, stats.count, percentiles[i]));
+    }
+
+    free(histogram.counts);
+}
+
+// Equal-width buckets, built by merging the fine histogram, drawn as bars
+static void PrintHistogram(const TelemetryTable* table, int column, int bucketCount)
+{
+    ColumnStats stats = ScanColumn(table, column);
+
+    if (stats.count == 0)
+    {
+        printf("%s: no runs\n", GetTelemetryColumnName(column));
+        return;
+    }
+
+    FineHistogram histogram = BuildFineHistogram(table, column, &stats);
+
+    unsigned int range = (unsigned int)stats.max - (unsigned int)stats.min;
+    int usedFine = (int)(range >> histogram.shift) + 1;
+
+    if (bucketCount > usedFine)
+    {
+        bucketCount = usedFine;
+    }
+
+    long long* buckets = calloc(bucketCount, sizeof(long long));
+    long long largest = 1;
+
+    for (int fine = 0; fine < usedFine; fine++)
+    {
+        buckets[(long long)fine * bucketCount / usedFine] += histogram.counts[fine];
+    }
+
+    for (int i = 0; i < bucketCount; i++)
+    {
+        largest = buckets[i] > largest ? buckets[i] : largest;
+    }
+
+    printf("%s over %lld runs\n", GetTelemetryColumnName(column), stats.count);
+
+    for (int i = 0; i < bucketCount; i++)
+    {
+        int firstFine = (int)(((long long)i * usedFine + bucketCount - 1) / bucketCount);
+        long long from = (long long)stats.min + ((long long)firstFine << histogram.shift);
+        int barLength = (int)(buckets[i] * 50 / largest);
+
+        printf("  %12lld | %-50.*s %lld\n", from, barLength,
+               "##################################################", buckets[i]);
+    }
+
+    free(buckets);
+    free(histogram.counts);
+}
+
+// Writes whole blocks of made-up runs, so we can benchmark without playing 500k games first
+static bool GenerateTelemetry(const char* path, int runs)
+{
+    FILE* file = fopen(path, "wb");
+
+    if (!file)
+    {
+        printf("Can't create %s\n", path);
+        return false;
+    }
+
+    TelemetryFileHeader header =
+    {
+        .magic = TELEMETRY_MAGIC,
+        .version = TELEMETRY_VERSION,
+        .columnCount = TELEMETRY_COLUMN_COUNT,
+        .blockRows = TELEMETRY_BLOCK_ROWS,
+        .rowCount = (unsigned int)runs
+    };
+
+    fwrite(&header, sizeof(header), 1, file);
+
+    int* block = malloc(GetTelemetryBlockBytes());
+    unsigned int seed = 12345;
+    int now = (int)time(NULL);
+
+    for (int first = 0; first < runs; first += TELEMETRY_BLOCK_ROWS)
+    {
+        memset(block, 0, GetTelemetryBlockBytes());
+
+        for (int row = 0; row < TELEMETRY_BLOCK_ROWS && first + row < runs; row++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int level = 1 + (seed >> 28) % 5;
+            int blocksHit = level * 20 + (seed >> 8) % 60;
+
+            block[TELEMETRY_TIMESTAMP * TELEMETRY_BLOCK_ROWS + row] = now - (runs - first - row) * 60;
+            block[TELEMETRY_SCORE * TELEMETRY_BLOCK_ROWS + row] = blocksHit * (100 + (seed >> 20) % 400);
+            block[TELEMETRY_MAX_COMBO * TELEMETRY_BLOCK_ROWS + row] = 1 + (seed >> 12) % 25;
+            block[TELEMETRY_LEVEL * TELEMETRY_BLOCK_ROWS + row] = level;
+            block[TELEMETRY_DURATION_MS * TELEMETRY_BLOCK_ROWS + row] = 30000 + (seed >> 4) % 600000;
+            block[TELEMETRY_TICKS * TELEMETRY_BLOCK_ROWS + row] = 12000 + (seed >> 6) % 200000;
+            block[TELEMETRY_BLOCKS_HIT * TELEMETRY_BLOCK_ROWS + row] = blocksHit;
+            block[TELEMETRY_LIVES_LOST * TELEMETRY_BLOCK_ROWS + row] = 5;
+            block[(TELEMETRY_SPAWNED_FIRST + (seed >> 3) % TELEMETRY_POWERUP_TYPES) * TELEMETRY_BLOCK_ROWS + row] = 1 + (seed >> 9) % 4;
+            block[(TELEMETRY_COLLECTED_FIRST + (seed >> 3) % TELEMETRY_POWERUP_TYPES) * TELEMETRY_BLOCK_ROWS + row] = (seed >> 9) % 3;
+
+            for (int death = 0; death < 5; death++)
+            {
+                block[(TELEMETRY_DEATH_TICK_FIRST + death) * TELEMETRY_BLOCK_ROWS + row] = (death + 1) * 2400 + (seed >> (death + 2)) % 2000;
+            }
+        }
+
+        fwrite(block, GetTelemetryBlockBytes(), 1, file);
+    }
+
+    free(block);
+    fclose(file);
+
+    printf("Generated %d runs into %s\n", runs, path);
+    return true;
+}
+
+static int ParseColumn(const char* argument)
+{
+    int column = FindTelemetryColumn(argument);
+
+    if (column < 0)
+    {
+        char* end;
+        long index = strtol(argument, &end, 10);
+        column = (*end == '\0' && index >= 0 && index < TELEMETRY_COLUMN_COUNT) ? (int)index : -1;
+    }
+
+    if (column < 0)
+    {
+        printf("Unknown column '%s', see 'columns'\n", argument);
+    }
+
+    return column;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s <file> columns|summary|percentiles <column> [p...]|histogram <column> [buckets]|generate <runs>\n", argv[0]);
+        return 1;
+    }
+
+    const char* path = argv[1];
+    const char* command = argv[2];
+
+    if (strcmp(command, "columns") == 0)
+    {
+        PrintColumns();
+        return 0;
+    }
+
+    if (strcmp(command, "generate") == 0)
+    {
+        return (argc > 3 && GenerateTelemetry(path, atoi(argv[3]))) ? 0 : 1;
+    }
+
+    TelemetryTable table = {0};
+
+    if (!OpenTelemetryTable(path, &table))
+    {
+        return 1;
+    }
+
+    if (table.rowCount == 0)
+    {
+        printf("No runs recorded yet\n");
+        UnmapFile(&table.file);
+        return 0;
+    }
+
+    double start = NowMilliseconds();
+    int result = 0;
+
+    if (strcmp(command, "summary") == 0)
+    {
+        PrintSummary(&table);
+    }
+    else if (strcmp(command, "percentiles") == 0 && argc > 3)
+    {
+        int column = ParseColumn(argv[3]);
+        double percentiles[32] = { 50, 90, 99 };
+        int percentileCount = 3;
+
+        if (argc > 4)
+        {
+            percentileCount = 0;
+
+            for (int i = 4; i < argc && percentileCount < 32; i++)
+            {
+                percentiles[percentileCount++] = atof(argv[i]);
+            }
+        }
+
+        if (column >= 0)
+        {
+            PrintPercentiles(&table, column, percentiles, percentileCount);
+        }
+
+        result = column >= 0 ? 0 : 1;
+    }
+    else if (strcmp(command, "histogram") == 0 && argc > 3)
+    {
+        int column = ParseColumn(argv[3]);
+        int buckets = argc > 4 ? atoi(argv[4]) : 20;
+
+        if (column >= 0)
+        {
+            PrintHistogram(&table, column, buckets > 0 ? buckets : 20);
+        }
+
+        result = column >= 0 ? 0 : 1;
+    }
+    else
+    {
+        printf("Unknown command '%s'\n", command);
+        result = 1;
+    }
+
+    printf("Scanned %d runs in %.1f ms\n", table.rowCount, NowMilliseconds() - start);
+
+    UnmapFile(&table.file);
+    return result;
+}
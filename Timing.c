@@ -0,0 +1,108 @@
+﻿#include "Timing.h"
+
+// Like RunJournal.c, this file never includes raylib, so windows.h can't clash with it
+#ifdef _WIN32
+    #include <windows.h>
+    #include <mmsystem.h>
+#else
+    #ifndef _GNU_SOURCE
+        #define _GNU_SOURCE // pthread_setaffinity_np
+    #endif
+    #include <pthread.h>
+    #include <sched.h>
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
+void BeginHighResolutionTimer(void)
+{
+#ifdef _WIN32
+    timeBeginPeriod(1); // Otherwise Sleep(1) can take up to 15.6 ms!
+#endif
+}
+
+void EndHighResolutionTimer(void)
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+double GetPreciseTime(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
+}
+
+void SleepSeconds(double seconds)
+{
+    if (seconds <= 0.0)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    Sleep((DWORD)(seconds * 1000.0));
+#else
+    struct timespec duration =
+    {
+        .tv_sec = (time_t)seconds,
+        .tv_nsec = (long)((seconds - (double)(time_t)seconds) * 1e9)
+    };
+
+    nanosleep(&duration, NULL);
+#endif
+}
+
+void SpinPause(void)
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    _mm_pause();
+#endif
+}
+
+int GetCoreCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+bool PinThreadToCore(int core)
+{
+#if defined(_WIN32)
+    return core < 64 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)core; // macOS only takes affinity hints
+    return false;
+#endif
+}
@@ -0,0 +1,173 @@
+﻿#include "UdpSocket.h"
+#include <stdio.h>
+#include <string.h>
+
+// Like Timing.c, no raylib in here: winsock2.h includes windows.h
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    typedef int socklen_t;
+#else
+    #include <arpa/inet.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+bool StartNetworking(void)
+{
+#ifdef _WIN32
+    WSADATA data;
+
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        printf("Couldn't start winsock\n");
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+void StopNetworking(void)
+{
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool ResolveUdpAddress(const char* host, int port, UdpAddress* address)
+{
+    struct addrinfo hints = {0};
+    struct addrinfo* result = NULL;
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL)
+    {
+        printf("Couldn't resolve %s\n", host);
+        return false;
+    }
+
+    const struct sockaddr_in* found = (const struct sockaddr_in*)result->ai_addr;
+    address->host = ntohl(found->sin_addr.s_addr);
+    address->port = (uint16_t)port;
+
+    freeaddrinfo(result);
+    return true;
+}
+
+bool SameUdpAddress(const UdpAddress* a, const UdpAddress* b)
+{
+    return a->host == b->host && a->port == b->port;
+}
+
+UdpSocket OpenUdpSocket(int port)
+{
+#ifdef _WIN32
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (handle == INVALID_SOCKET)
+    {
+        printf("Couldn't create a UDP socket\n");
+        return UDP_INVALID_SOCKET;
+    }
+#else
+    int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (handle < 0)
+    {
+        printf("Couldn't create a UDP socket\n");
+        return UDP_INVALID_SOCKET;
+    }
+#endif
+
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons((uint16_t)port);
+
+    if (bind(handle, (const struct sockaddr*)&local, sizeof(local)) != 0)
+    {
+        printf("Couldn't bind UDP port %d\n", port);
+        CloseUdpSocket((UdpSocket)handle);
+        return UDP_INVALID_SOCKET;
+    }
+
+    // Never block: the game polls it once a frame
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    return (UdpSocket)handle;
+}
+
+void CloseUdpSocket(UdpSocket socket)
+{
+    if (socket == UDP_INVALID_SOCKET)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    closesocket((SOCKET)socket);
+#else
+    close((int)socket);
+#endif
+}
+
+bool SendUdp(UdpSocket socket, const UdpAddress* to, const void* data, int size)
+{
+    struct sockaddr_in remote = {0};
+    remote.sin_family = AF_INET;
+    remote.sin_addr.s_addr = htonl(to->host);
+    remote.sin_port = htons(to->port);
+
+#ifdef _WIN32
+    int sent = sendto((SOCKET)socket, (const char*)data, size, 0, (const struct sockaddr*)&remote, sizeof(remote));
+#else
+    int sent = (int)sendto((int)socket, data, (size_t)size, 0, (const struct sockaddr*)&remote, sizeof(remote));
+#endif
+
+    return sent == size;
+}
+
+int ReceiveUdp(UdpSocket socket, UdpAddress* from, void* buffer, int capacity)
+{
+    struct sockaddr_in remote = {0};
+    socklen_t remoteSize = sizeof(remote);
+
+#ifdef _WIN32
+    int received = recvfrom((SOCKET)socket, (char*)buffer, capacity, 0, (struct sockaddr*)&remote, &remoteSize);
+
+    if (received == SOCKET_ERROR)
+    {
+        int error = WSAGetLastError();
+
+        // A port unreachable from an earlier send shows up here on Windows, it's not our socket's fault
+        return (error == WSAEWOULDBLOCK || error == WSAECONNRESET) ? 0 : -1;
+    }
+#else
+    int received = (int)recvfrom((int)socket, buffer, (size_t)capacity, 0, (struct sockaddr*)&remote, &remoteSize);
+
+    if (received < 0)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) ? 0 : -1;
+    }
+#endif
+
+    if (from != NULL)
+    {
+        from->host = ntohl(remote.sin_addr.s_addr);
+        from->port = ntohs(remote.sin_port);
+    }
+
+    return received;
+}
@@ -0,0 +1,334 @@
+﻿#include "Versus.h"
+#include <raylib.h>
+#include <rlgl.h>
+#include <string.h>
+#include "Level.h"
+#include "RenderCommands.h"
+
+void InitVersusMatch(VersusMatch* match, int width, int height, uint64_t seed)
+{
+    memset(match, 0, sizeof(*match));
+
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        // Game has a const member, so no plain assignment
+        Game game = InitHeadlessGame(width, height);
+
+        // Rollback re-simulates ticks, so bursts would pile up twice. Versus doesn't draw sparks at all
+        UnloadParticleSystem(&game.particles);
+        memcpy(&match->players[i], &game, sizeof(Game));
+
+        Game* player = &match->players[i];
+        player->endless = true;
+        player->fixedLevelSeed = seed != 0 ? seed : 1;
+        ResetGame(player);
+    }
+
+    match->garbageRandom = SeedSimRandom(seed ^ 0x6A7BA6E6A7BA6E6Aull);
+    match->winner = VERSUS_RUNNING;
+}
+
+void FreeVersusMatch(VersusMatch* match)
+{
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        UnloadParticleSystem(&match->players[i].particles);
+    }
+}
+
+// Somewhere empty in the field, and not right on top of the ball. False when there's no room left
+static bool DropGarbageBlock(Game* game, SimRandom* random)
+{
+    int rows = game->currentBlockRows;
+    int columns = game->currentBlockColumns;
+    int cells = rows * columns;
+
+    float blockWidth, blockHeight;
+    CalculateBlockDimensions(game->screenWidth, game->screenHeight, &blockWidth, &blockHeight, columns);
+
+    float startX = game->screenWidth * BLOCK_SIDE_OFFSET;
+    float startY = game->screenHeight * BLOCK_TOP_OFFSET;
+    int first = SimRandomRange(random, 0, cells - 1);
+
+    for (int i = 0; i < cells; i++)
+    {
+        int cell = (first + i) % cells;
+        int row = cell / columns;
+        int col = cell % columns;
+        Block* block = &game->blocks[row][col];
+
+        if (block->active)
+        {
+            continue;
+        }
+
+        float x = startX + col * (blockWidth + BLOCK_SPACING);
+        float y = startY + row * (blockHeight + BLOCK_SPACING);
+        const Ball* ball = &game->ball;
+
+        // A block appearing around the ball would trap it inside
+        if (ball->position.x + ball->radius > x && ball->position.x - ball->radius < x + blockWidth &&
+            ball->position.y + ball->radius > y && ball->position.y - ball->radius < y + blockHeight)
+        {
+            continue;
+        }
+
+        InitializeBlock(block, x, y, blockWidth, blockHeight, VERSUS_GARBAGE_LIVES, game->isTimewarpActive);
+        block->tint = RED;
+        block->color = ShadeBlock(block, game->isTimewarpActive);
+        return true;
+    }
+
+    return false;
+}
+
+static void SendGarbage(VersusMatch* match, int from)
+{
+    const Game* game = &match->players[from];
+    int earned = game->combo / VERSUS_GARBAGE_COMBO;
+
+    // The combo broke (or a new level reset it)
+    if (earned < match->comboSent[from])
+    {
+        match->comboSent[from] = earned;
+        return;
+    }
+
+    int to = 1 - from;
+    int sent = earned - match->comboSent[from];
+
+    match->pendingGarbage[to] += sent;
+
+    if (match->pendingGarbage[to] > VERSUS_MAX_PENDING_GARBAGE)
+    {
+        match->pendingGarbage[to] = VERSUS_MAX_PENDING_GARBAGE;
+    }
+
+    match->comboSent[from] = earned;
+}
+
+void StepVersusMatch(VersusMatch* match, const SimInput inputs[VERSUS_PLAYERS])
+{
+    match->tick++;
+
+    if (match->winner != VERSUS_RUNNING)
+    {
+        return;
+    }
+
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        Game* game = &match->players[i];
+
+        // Garbage sent last tick lands first, in the order it was sent
+        while (match->pendingGarbage[i] > 0 && DropGarbageBlock(game, &match->garbageRandom))
+        {
+            match->pendingGarbage[i]--;
+        }
+
+        // No room left for the rest, it's lost
+        match->pendingGarbage[i] = 0;
+
+        if (game->state == PLAYING)
+        {
+            StepSimulation(game, &inputs[i], SIM_DT);
+        }
+
+        // No level complete screen in versus, the next one starts straight away
+        if (game->state == LEVEL_COMPLETE)
+        {
+            LoadNextLevel(game);
+        }
+    }
+
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        SendGarbage(match, i);
+    }
+
+    bool lost[VERSUS_PLAYERS];
+
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        lost[i] = match->players[i].state == GAME_OVER;
+    }
+
+    if (lost[0] && lost[1])
+    {
+        match->winner = VERSUS_DRAW;
+    }
+    else if (lost[0] || lost[1])
+    {
+        match->winner = lost[0] ? 1 : 0;
+    }
+}
+
+void SaveVersusState(const VersusMatch* match, VersusState* state)
+{
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        CaptureSnapshot(&match->players[i], &state->players[i]);
+    }
+
+    state->garbageRandom = match->garbageRandom;
+    memcpy(state->pendingGarbage, match->pendingGarbage, sizeof(state->pendingGarbage));
+    memcpy(state->comboSent, match->comboSent, sizeof(state->comboSent));
+    state->tick = match->tick;
+    state->winner = match->winner;
+}
+
+void LoadVersusState(VersusMatch* match, const VersusState* state)
+{
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        ApplySnapshot(&match->players[i], &state->players[i]);
+    }
+
+    match->garbageRandom = state->garbageRandom;
+    memcpy(match->pendingGarbage, state->pendingGarbage, sizeof(match->pendingGarbage));
+    memcpy(match->comboSent, state->comboSent, sizeof(match->comboSent));
+    match->tick = state->tick;
+    match->winner = state->winner;
+}
+
+static uint32_t HashBytes(uint32_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+#define HASH_VALUE(hash, value) HashBytes((hash), &(value), sizeof(value))
+
+static uint32_t HashGame(uint32_t hash, const GameSnapshot* game)
+{
+    hash = HASH_VALUE(hash, game->state);
+    hash = HASH_VALUE(hash, game->currentLevel);
+    hash = HASH_VALUE(hash, game->random.state);
+    hash = HASH_VALUE(hash, game->simTime);
+
+    hash = HASH_VALUE(hash, game->player.position.x);
+    hash = HASH_VALUE(hash, game->player.width);
+    hash = HASH_VALUE(hash, game->player.lives);
+    hash = HASH_VALUE(hash, game->player.score);
+
+    hash = HASH_VALUE(hash, game->ball.active);
+    hash = HASH_VALUE(hash, game->ball.position.x);
+    hash = HASH_VALUE(hash, game->ball.position.y);
+    hash = HASH_VALUE(hash, game->ball.direction.x);
+    hash = HASH_VALUE(hash, game->ball.direction.y);
+    hash = HASH_VALUE(hash, game->ball.speed);
+    hash = HASH_VALUE(hash, game->combo);
+
+    for (int row = 0; row < game->blockRows; row++)
+    {
+        for (int col = 0; col < game->blockColumns; col++)
+        {
+            const Block* block = &game->blocks[row][col];
+            int lives = block->active ? block->lives : -1;
+
+            hash = HASH_VALUE(hash, lives);
+        }
+    }
+
+    for (int i = 0; i < PU_MAX_COUNT; i++)
+    {
+        const PowerUp* powerUp = &game->powerUps[i];
+
+        hash = HASH_VALUE(hash, powerUp->active);
+
+        if (powerUp->active)
+        {
+            hash = HASH_VALUE(hash, powerUp->type);
+            hash = HASH_VALUE(hash, powerUp->position.y);
+            hash = HASH_VALUE(hash, powerUp->remainingDuration);
+        }
+    }
+
+    return hash;
+}
+
+uint32_t HashVersusState(const VersusState* state)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < VERSUS_PLAYERS; i++)
+    {
+        hash = HashGame(hash, &state->players[i]);
+        hash = HASH_VALUE(hash, state->pendingGarbage[i]);
+    }
+
+    hash = HASH_VALUE(hash, state->garbageRandom.state);
+    hash = HASH_VALUE(hash, state->tick);
+
+    return hash;
+}
+
+static RenderCommandBuffer fieldCommands;
+
+// One field through the render command buffer, in its own scaled corner of the screen
+static void DrawVersusField(const Game* game, float x, float y, float scale)
+{
+    ClearRenderCommands(&fieldCommands);
+    RecordPlayerTrail(&fieldCommands, &game->player);
+
+    for (int row = 0; row < game->currentBlockRows; row++)
+    {
+        for (int col = 0; col < game->currentBlockColumns; col++)
+        {
+            if (game->blocks[row][col].active)
+            {
+                RecordBlock(&fieldCommands, &game->blocks[row][col]);
+            }
+        }
+    }
+
+    RecordBall(&fieldCommands, game->ball);
+    RecordPowerUps(&fieldCommands, game);
+    PushRectangle(&fieldCommands, RENDER_LAYER_PADDLE, game->player.position.x, game->player.position.y,
+                  game->player.width, game->player.height, game->player.color);
+
+    rlPushMatrix();
+    {
+        rlTranslatef(x, y, 0.0f);
+        rlScalef(scale, scale, 1.0f);
+        SubmitRenderCommands(&fieldCommands);
+    }
+    rlPopMatrix();
+
+    DrawRectangleLines((int)x, (int)y, (int)(game->screenWidth * scale), (int)(game->screenHeight * scale), DARKGREEN);
+}
+
+void DrawVersusMatch(const VersusMatch* match, int localPlayer, float scale, int gap)
+{
+    const int fontSize = 20;
+
+    // Yours on the left, whichever player you are
+    for (int side = 0; side < VERSUS_PLAYERS; side++)
+    {
+        int index = side == 0 ? localPlayer : 1 - localPlayer;
+        const Game* game = &match->players[index];
+        float x = gap + side * (game->screenWidth * scale + gap);
+        float y = gap + fontSize + 10;
+
+        DrawVersusField(game, x, y, scale);
+
+        DrawText(TextFormat("%s  Score %d  Lives %d  Level %d%s", side == 0 ? "YOU" : "THEM", game->player.score,
+                            game->player.lives, game->currentLevel,
+                            match->pendingGarbage[index] > 0 ? "  Garbage incoming!" : ""),
+                 (int)x, gap, fontSize, side == 0 ? PLAYER_COLOR : GRAY);
+    }
+
+    if (match->winner != VERSUS_RUNNING)
+    {
+        const char* text = match->winner == VERSUS_DRAW ? "DRAW" : (match->winner == localPlayer ? "YOU WIN" : "YOU LOSE");
+        int width = MeasureText(text, TITLE_FONT_SIZE);
+
+        DrawText(text, GetScreenWidth() / 2 - width / 2, GetScreenHeight() / 2 - TITLE_FONT_SIZE / 2, TITLE_FONT_SIZE, BALL_COLOR);
+    }
+}
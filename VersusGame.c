@@ -0,0 +1,291 @@
+﻿#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "InputThread.h"
+#include "Rollback.h"
+#include "Timing.h"
+
+/* Versus over the network, rollback style. Start one on each machine (or both on one, for testing):
+ *   Versus <player 0|1> <local port> <remote host> <remote port> [options]
+ *     --seed n           Both sides need the same one (default 1)
+ *     --delay ms         Hold back every packet we send this long...
+ *     --jitter ms        ...give or take this much...
+ *     --loss percent     ...and drop this many of them, to see how it copes
+ *     --input-delay n    Ticks (default ROLLBACK_DEFAULT_INPUT_DELAY)
+ *     --bot              A bot plays instead of the keyboard
+ *     --headless ticks   No window, the bot plays until this many ticks are confirmed. Prints the state hash
+ *                        at that tick, and exits 1 if the peer's ever differed */
+
+#define VERSUS_WINDOW_WIDTH 1880
+#define VERSUS_WINDOW_HEIGHT 620
+#define VERSUS_FIELD_SCALE 0.48f
+#define VERSUS_FIELD_GAP 10
+#define VERSUS_LINGER_SECONDS 1.0  // Headless: keep answering a little after we're done, the peer may still need us
+
+typedef struct KeyboardSource
+{
+    InputState state;
+    InputQueue* queue;
+} KeyboardSource;
+
+typedef struct BotSource
+{
+    int player;
+    SimRandom random;
+} BotSource;
+
+static SimInput ReadKeyboard(void* context, const VersusMatch* match, double tickStart, double tickEnd)
+{
+    (void)match;
+
+    KeyboardSource* keyboard = context;
+    SimInput input = BuildTickInput(&keyboard->state, keyboard->queue, tickStart, tickEnd);
+
+    // No rewinding in versus, the peer would have to rewind with us
+    input.rewind = false;
+    return input;
+}
+
+// Keeps the paddle under the ball. Good enough to clear levels and send garbage now and then
+static SimInput RunBot(void* context, const VersusMatch* match, double tickStart, double tickEnd)
+{
+    (void)tickStart;
+    (void)tickEnd;
+
+    BotSource* bot = context;
+    const Game* game = &match->players[bot->player];
+    const Player* player = &game->player;
+    SimInput input = {0};
+
+    if (!game->ball.active)
+    {
+        input.launch = SimRandomRange(&bot->random, 0, 30) == 0;
+        input.launchSteer = SimRandomRange(&bot->random, -1, 1);
+        return input;
+    }
+
+    float dx = game->ball.position.x - (player->position.x + player->width / 2.0f);
+
+    if (dx < -player->width / 4.0f || dx > player->width / 4.0f)
+    {
+        input.moving = true;
+        input.left = dx < 0;
+        input.right = dx > 0;
+        input.moveSeconds = dx < 0 ? -SIM_DT : SIM_DT;
+    }
+
+    return input;
+}
+
+static void PrintStats(const RollbackStats* stats)
+{
+    printf("Versus: confirmed %d, rtt %.1f ms, %d rollbacks (%lld ticks, longest %d), %d stalls, "
+           "%d hashes checked, packets %d sent %d received %d dropped\n",
+           stats->confirmedTick, stats->rttMs, stats->rollbacks, stats->rolledBackTicks, stats->longestRollback,
+           stats->stalls, stats->checkedHashes, stats->packetsSent, stats->packetsReceived, stats->packetsDropped);
+}
+
+static int RunHeadless(RollbackSession* session, BotSource* bot, int ticks)
+{
+    const double timeout = ticks * (double)SIM_DT * 4.0 + 30.0;
+    double start = GetPreciseTime();
+    RollbackStats stats = GetRollbackStats(session);
+
+    while (stats.confirmedTick < ticks)
+    {
+        double now = GetPreciseTime();
+
+        if (now - start > timeout)
+        {
+            printf("Versus: gave up waiting, only %d ticks confirmed\n", stats.confirmedTick);
+            PrintStats(&stats);
+            return 1;
+        }
+
+        RunRollbackSession(session, now, RunBot, bot);
+        stats = GetRollbackStats(session);
+        SleepSeconds(0.001);
+    }
+
+    double lingerUntil = GetPreciseTime() + VERSUS_LINGER_SECONDS;
+
+    while (GetPreciseTime() < lingerUntil)
+    {
+        RunRollbackSession(session, GetPreciseTime(), RunBot, bot);
+        SleepSeconds(0.001);
+    }
+
+    stats = GetRollbackStats(session);
+    PrintStats(&stats);
+
+    // The same tick on both sides, whichever finished first
+    int hashTick = ticks - ticks % ROLLBACK_HASH_INTERVAL;
+    uint32_t hash;
+
+    if (GetConfirmedHash(session, hashTick, &hash))
+    {
+        printf("Versus: tick %d hash %08x\n", hashTick, hash);
+    }
+
+    if (stats.desyncTick >= 0)
+    {
+        printf("Versus: DESYNC at tick %d\n", stats.desyncTick);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void RunWindowed(RollbackSession* session, BotSource* bot, bool useBot)
+{
+    static KeyboardSource keyboard;
+    int localPlayer = GetRollbackLocalPlayer(session);
+
+    InitWindow(VERSUS_WINDOW_WIDTH, VERSUS_WINDOW_HEIGHT, TextFormat("Block Kuzushi! Versus, player %d", localPlayer));
+    SetTargetFPS(0);
+    StartInputThread();
+    keyboard.queue = GetInputQueue();
+
+    while (!WindowShouldClose())
+    {
+        if (!IsInputThreadRunning())
+        {
+            PollFrameInput(&keyboard.state, keyboard.queue);
+        }
+
+        double now = GetPreciseTime();
+
+        if (useBot)
+        {
+            RunRollbackSession(session, now, RunBot, bot);
+        }
+        else
+        {
+            RunRollbackSession(session, now, ReadKeyboard, &keyboard);
+        }
+
+        RollbackStats stats = GetRollbackStats(session);
+
+        BeginDrawing();
+        {
+            ClearBackground(BLACK);
+            DrawVersusMatch(GetRollbackMatch(session), localPlayer, VERSUS_FIELD_SCALE, VERSUS_FIELD_GAP);
+
+            if (!stats.connected)
+            {
+                DrawText("Waiting for the other player...", VERSUS_FIELD_GAP, VERSUS_WINDOW_HEIGHT - 30, 20, YELLOW);
+            }
+            else
+            {
+                DrawText(TextFormat("RTT %.0f ms  ahead %.1f  rollbacks %d (longest %d)  stalls %d  hashes ok %d%s",
+                                    stats.rttMs, stats.advantage, stats.rollbacks, stats.longestRollback, stats.stalls,
+                                    stats.checkedHashes, stats.desyncTick >= 0 ? "  DESYNC!" : ""),
+                         VERSUS_FIELD_GAP, VERSUS_WINDOW_HEIGHT - 30, 20, stats.desyncTick >= 0 ? RED : GRAY);
+            }
+        }
+        EndDrawing();
+
+        // Nothing to wait for here, ticks run off the clock, so just don't burn the whole core
+        SleepSeconds(0.001);
+    }
+
+    StopInputThread();
+    CloseWindow();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 5)
+    {
+        printf("Usage: %s <player 0|1> <local port> <remote host> <remote port> [--seed n] [--delay ms] "
+               "[--jitter ms] [--loss percent] [--input-delay ticks] [--bot] [--headless ticks]\n", argv[0]);
+        return 1;
+    }
+
+    RollbackConfig config = {
+        .localPlayer = atoi(argv[1]),
+        .localPort = atoi(argv[2]),
+        .remoteHost = argv[3],
+        .remotePort = atoi(argv[4]),
+        .seed = 1,
+        .screenWidth = 1920,
+        .screenHeight = 1080
+    };
+
+    bool useBot = false;
+    int headlessTicks = 0;
+
+    for (int i = 5; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--seed") == 0 && hasValue)
+        {
+            config.seed = strtoull(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--delay") == 0 && hasValue)
+        {
+            config.conditions.delayMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--jitter") == 0 && hasValue)
+        {
+            config.conditions.jitterMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--loss") == 0 && hasValue)
+        {
+            config.conditions.lossPercent = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--input-delay") == 0 && hasValue)
+        {
+            config.inputDelay = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bot") == 0)
+        {
+            useBot = true;
+        }
+        else if (strcmp(argv[i], "--headless") == 0 && hasValue)
+        {
+            headlessTicks = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("Versus: unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!StartNetworking())
+    {
+        return 1;
+    }
+
+    BeginHighResolutionTimer();
+
+    RollbackSession* session = CreateRollbackSession(&config);
+
+    if (session == NULL)
+    {
+        EndHighResolutionTimer();
+        StopNetworking();
+        return 1;
+    }
+
+    BotSource bot = { .player = config.localPlayer, .random = SeedSimRandom(config.seed + config.localPlayer) };
+    int result = 0;
+
+    if (headlessTicks > 0)
+    {
+        result = RunHeadless(session, &bot, headlessTicks);
+    }
+    else
+    {
+        RunWindowed(session, &bot, useBot);
+    }
+
+    DestroyRollbackSession(session);
+    EndHighResolutionTimer();
+    StopNetworking();
+
+    return result;
+}
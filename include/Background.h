@@ -15,6 +15,7 @@
 
 #define QUAD_SIZE 32
 #define MAX_QUADS (((1920 + QUAD_SIZE - 1)/QUAD_SIZE) * ((1080 + QUAD_SIZE - 1)/QUAD_SIZE))
+#define DISTORTION_JOB_ROWS 4 // Quad rows per job when rebuilding the cache
 #define BACKGROUND_PURPLE (Color){0x80, 0x00, 0xFF, 0xFF}    // Pure purple phosphor
 
 // CRT Quad effect!
@@ -41,6 +42,7 @@ typedef struct Background
 
     RenderTexture2D effectTexture;
     RenderTexture2D finalTexture;
+    RenderTexture2D distortedTexture; // The curved game screen, only redrawn when the game screen changed
 
     DistortedQuad* quadCache;
     bool distortionNeedsUpdate;
@@ -54,7 +56,12 @@ typedef struct Background
 Background InitBackground(int width, int height);
 void UpdateBackground(Background* background, float deltaTime, bool isTimewarpActive);
 void UpdateStaticEffects(Background* background, int width, int height);
-void DrawBackground(Background* background, int width, int height, Texture2D sourceTexture);
+void UpdateDistortionCache(Background* background, int width, int height);
+void DrawBackground(Background* background, int width, int height, Texture2D sourceTexture, bool sourceChanged);
+void BeginBackgroundComposite(Background* background, int width, int height, Texture2D sourceTexture, bool sourceChanged);
+void EndBackgroundComposite(Background* background);
+Vector2 DistortPoint(Vector2 point, Vector2 center, float curveAmount, int width, int height);
+void DrawDistortedRectangle(const Background* background, Rectangle rectangle, Color color);
 void UnloadBackground(Background* background);
 
 #endif //BACKGROUND_H
\ No newline at end of file
@@ -12,6 +12,8 @@
 #define BALL_SPEED_MAX 1400.0f
 #define TRAIL_LENGTH 10
 #define TRAIL_SPACING 3
+#define TRAIL_MAX_GAP_TICKS 4   // Trail points further apart than this many ticks of movement aren't one path
+#define BALL_TRAIL_RIBBON_POINTS (TRAIL_LENGTH + 1)   // The ball, then its history ring
 
 // Ball Collision Properties
 #define MIN_VERTICAL_COMPONENT 0.3f
@@ -48,8 +50,9 @@ typedef struct
 
 Ball InitBall(Vector2 position);
 void UpdateBall(Ball* ball, float deltaTime, int screenWidth, int screenHeight);
-void DrawBall(Ball ball);
-void ShootBall(Ball* ball, Vector2 startPos, Vector2 direction, Player player);
+int GetBallTrailRibbon(const Ball* ball, RibbonPoint points[BALL_TRAIL_RIBBON_POINTS]);   // Shared with the software renderer
+void RecordBall(RenderCommandBuffer* commands, Ball ball);
+void ShootBall(Ball* ball, Vector2 startPos, Vector2 direction, Player player, int steer, SimRandom* random);
 void AdjustBallDirection(Ball* ball);
 
 #endif
\ No newline at end of file
@@ -3,16 +3,27 @@
 
 #include "VectorMath.h"
 
+// Level packs can mix these, the built-in levels only use BLOCK_NORMAL
+typedef enum BlockType
+{
+    BLOCK_NORMAL,
+    BLOCK_SOLID,    // Bounces the ball forever, and doesn't need to be destroyed to clear the level
+    BLOCK_BONUS     // Always drops a power-up
+} BlockType;
+
 typedef struct Block {
     Vector2 position;
     int width;
     int height;
     Color color;
+    Color tint;     // Alpha 0: shade by lives
+    BlockType type;
     int lives;
     bool active;
 } Block;
 
 Block InitBlock(int x, int y, int width, int height, int row);
 Color GetBlockColor(int lives, bool isTimewarpActive);
+Color ShadeBlock(const Block* block, bool isTimewarpActive);
 
 #endif //BLOCK_H
\ No newline at end of file
@@ -3,13 +3,18 @@
 
 #include "Ball.h"
 #include "../include/Block.h"
+#include "LevelPack.h"
 
-// Block dimension constants
+// Block dimension constants (the built-in levels grow from MIN to MAX)
 #define MAX_BLOCK_ROWS 6
 #define MIN_BLOCK_ROWS 3
 #define MIN_BLOCK_COLUMNS 4
 #define MAX_BLOCK_COLUMNS 8
 
+// Block storage, big enough for the largest packed level
+#define BLOCK_GRID_ROWS LEVEL_PACK_MAX_ROWS
+#define BLOCK_GRID_COLUMNS LEVEL_PACK_MAX_COLUMNS
+
 // Block layout constants
 #define BLOCK_SPACING 10
 #define BLOCK_TOP_OFFSET 0.18f
@@ -31,23 +36,31 @@
 #define BLOCK_COLOR_5_PURPLE (Color){0x6B, 0x12, 0xD6, 0xFF}  // Bright purple
 #define BLOCK_COLOR_6_PURPLE (Color){0x80, 0x16, 0xFF, 0xFF}  // Pure phosphor purple (Strongest)
 
+// Solid blocks stay dim, they're scenery more than targets
+#define BLOCK_COLOR_SOLID (Color){0x30, 0x40, 0x30, 0xFF}
+#define BLOCK_COLOR_SOLID_PURPLE (Color){0x38, 0x30, 0x48, 0xFF}
+
 // Block dimension calculation functions
 void CalculateBlockDimensions(int screenWidth, int screenHeight, float* blockWidth, float* blockHeight, int columnCount);
 void ClampBlockDimensions(int* rowCount, int* columnCount);
 
 // Block initialization and drawing functions
 void InitializeBlock(Block* block, float x, float y, float width, float height, int lives, bool isTimewarpActive);
-void InitBlocks(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS],
+void InitBlocks(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS],
                 int screenWidth, int screenHeight, int rowCount, int columnCount, bool isTimewarpActive);
-void DrawBlock(Block* block);
-void DrawBlocks(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS], int rowCount, int columnCount);
+void InitPackedBlocks(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS], int screenWidth, int screenHeight,
+                      const LevelCell* cells, int rowCount, int columnCount, const uint32_t* palette,
+                      bool isTimewarpActive);
+void RecordBlock(RenderCommandBuffer* commands, const Block* block);
+void RecordBlocks(RenderCommandBuffer* commands, Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS], int rowCount, int columnCount);
 
 // Block collision and state functions
-bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive);
-bool AreAllBlocksDestroyed(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS], int rowCount, int columnCount);
+bool CheckBlockCollision(Block* block, Ball* ball, bool isTimewarpActive, SimRandom* random);
+bool IsBallTouchingBlock(const Block* block, Vector2 position, float radius, bool isGhost); // No side effects
+bool AreAllBlocksDestroyed(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS], int rowCount, int columnCount);
 
 // Block update functions
-void UpdateBlockColors(Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS],
+void UpdateBlockColors(Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS],
                       int rowCount, int columnCount, bool isTimewarpActive);
 
 #endif // BLOCKS_MANAGER_H
\ No newline at end of file
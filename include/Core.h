@@ -15,6 +15,7 @@ typedef enum GameState
 typedef enum MenuOption
 {
     MENU_PLAY,
+    MENU_ENDLESS,
     MENU_LEADERBOARD,
     MENU_TUTORIAL,
     MENU_QUIT,
@@ -0,0 +1,27 @@
+﻿#ifndef FAST_FORWARD_H
+#define FAST_FORWARD_H
+
+#include "Game.h"
+
+#define FAST_FORWARD_MARGIN 2.0f    // Px. Blocks the ball passes closer than this get tested every tick on the way
+#define FAST_FORWARD_MIN_TICKS 2    // A single tick isn't worth looking ahead for
+
+/* Headless only: the same result as calling StepSimulation `ticks` times with the same input, much quicker.
+ * Between impacts the ball flies in a straight line, so when it gets to the next wall, the ceiling or the
+ * killzone, and which few blocks it passes on the way, is worked out once. The ticks in between skip the
+ * full collision pass: the ball only gets tested against those blocks, and only while it's near them.
+ * Everything else that changes every tick (timers, the paddle, falling power-ups) still gets its own cheap
+ * update, float sums have to be added up in the same order to come out the same. In the fixed-point build
+ * the ball's position comes straight from where the stretch started. The tick where something actually
+ * happens runs through StepSimulation. */
+typedef struct FastForwardStats
+{
+    long long steppedTicks;     // Through StepSimulation
+    long long skippedTicks;     // Quiet, only the per-tick bookkeeping
+    long long skips;
+} FastForwardStats;
+
+// Stops early when the game leaves PLAYING (level done, game over). Returns how many ticks it ran
+int FastForwardSimulation(Game* game, const SimInput* input, int ticks, FastForwardStats* stats); // stats may be NULL
+
+#endif // FAST_FORWARD_H
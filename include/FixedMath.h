@@ -0,0 +1,42 @@
+﻿#ifndef FIXED_MATH_H
+#define FIXED_MATH_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Fixed-point math for the deterministic physics build (cmake -DFIXED_POINT_PHYSICS=ON).
+ * sinf, cosf and sqrtf don't give the same last bit on every compiler, flag and CPU, and a replay or
+ * a lockstep game drifts apart from the first bit that differs. Integer math gives the same answer everywhere.
+ * The ball keeps its float fields (snapshots, drawing and the rest of the game read them), but in this build
+ * they only ever hold values that go to fixed point and back exactly. All of the physics happens in between. */
+
+typedef int32_t Fixed;          // Lengths: 1/4096 px. Exact as a float below 4096 px, the screen fits
+typedef int32_t FixedUnit;      // Directions, sines: 1/65536. Exact as a float below 256
+
+#define FIXED_SHIFT 12
+#define FIXED_UNIT_SHIFT 16
+#define FIXED_UNIT_ONE (1 << FIXED_UNIT_SHIFT)
+#define FIXED_ANGLE_TURN 65536  // Binary angles: a whole turn is 65536, so they wrap for free
+
+// Conversions only scale by powers of two and truncate, which no FPU rounds differently
+Fixed ToFixed(float value);
+float FromFixed(Fixed value);
+FixedUnit ToFixedUnit(float value);
+float FromFixedUnit(FixedUnit value);
+
+// From a quarter-wave table, no libm involved
+FixedUnit FixedSin(int angle);
+FixedUnit FixedCos(int angle);
+
+// To length FIXED_UNIT_ONE, with an integer square root. A zero vector stays zero
+void FixedNormalize(FixedUnit* x, FixedUnit* y);
+
+// The ball's physics on float vectors, fixed point inside
+Vector2 FixedNormalizeVector2(Vector2 v);
+Vector2 FixedMoveBall(Vector2 position, Vector2 direction, float speed, float seconds);
+Vector2 FixedMoveBallTicks(Vector2 position, Vector2 direction, float speed, float seconds, int ticks); // Exactly `ticks` FixedMoveBalls
+Vector2 FixedPaddleBounce(float ballX, float paddleX, int paddleWidth, int maxAngle);
+bool FixedCheckCollisionCircleRec(Vector2 center, float radius, Rectangle rect);
+
+#endif // FIXED_MATH_H
@@ -0,0 +1,58 @@
+﻿#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <raylib.h>
+#include <stdbool.h>
+
+/* Screenshots and gameplay footage without stalling the frame. A frame that's due for capture copies
+ * finalTexture into one of a ring of pixel pack buffers: glReadPixels into a buffer returns right away and the
+ * GPU does the copy whenever it gets to it. A fence says when it's done, a few frames later, and only then does
+ * the game thread map the buffer. Encoder threads convert straight out of the mapped memory (PNG, or Y4M for
+ * video), and the buffer goes back in the ring once they're finished with it. If every buffer is still busy when
+ * a frame is due, that frame is dropped (and counted), the game never waits for the capture.
+ *
+ * Video is at a fixed rate whatever the game runs at: a capture that stands in for several video frames (slow
+ * frames, drops) is written that many times in a Y4M, so the footage keeps the game's timing. PNG sequences
+ * are much slower to encode than the game runs, expect them to drop frames at the full video rate. */
+
+#define CAPTURE_RING_SIZE 6             // Pack buffers: a couple in flight on the GPU, the rest with the encoders
+#define CAPTURE_ENCODER_THREADS 2
+#define CAPTURE_VIDEO_FPS 60
+#define CAPTURE_STATUS_SECONDS 3.0      // How long the overlay stays up after a screenshot or a recording stops
+
+typedef enum CaptureFormat
+{
+    CAPTURE_Y4M,            // One uncompressed 4:2:0 video file, any player or ffmpeg reads it
+    CAPTURE_PNG_SEQUENCE    // One PNG per video frame, numbered by video frame so drops show up as gaps
+} CaptureFormat;
+
+typedef struct CaptureStats
+{
+    bool available;         // The GL context can do it (pack buffers and fences, GL 3.2)
+    bool recording;
+    CaptureFormat format;
+    double recordingSeconds;
+
+    int framesCaptured;     // Read back and handed to the encoders, this recording
+    int framesDropped;      // Video frames missed because every buffer in the ring was still busy
+    int framesRepeated;     // Video frames missed because the game was slower than the video rate
+    int screenshots;        // This session
+    int framesInFlight;     // Ring buffers not free right now
+
+    double gameThreadMs;    // Average time CaptureFrame takes per frame, what the capture costs the game
+    double encodeMs;        // Average per captured frame, on an encoder thread
+} CaptureStats;
+
+bool InitFrameCapture(int width, int height); // After InitWindow (needs the GL context), the composite's size
+void ShutdownFrameCapture(void);        // Finishes everything in flight first
+void CaptureFrame(RenderTexture2D source); // Once a frame after drawing, with the finished composite
+
+void RequestScreenshot(void);           // Taken at the next CaptureFrame
+bool StartVideoCapture(CaptureFormat format);
+void StopVideoCapture(void);            // The file is finished once the frames in flight are written
+bool IsCapturingVideo(void);
+
+CaptureStats GetCaptureStats(void);
+void DrawCaptureStatus(int x, int y);   // Only while recording, or just after
+
+#endif // FRAME_CAPTURE_H
@@ -0,0 +1,47 @@
+﻿#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdbool.h>
+
+#define PACER_FALLBACK_REFRESH 60   // When the monitor won't tell us its refresh rate
+#define PACER_MENU_TICK_RATE 30     // Menus still animate the CRT and arrows this often
+#define PACER_UNFOCUSED_RATE 10     // Nobody's looking, so barely draw
+#define PACER_MAX_DIVISOR 4         // Worst case we run at refresh / 4
+#define PACER_STATS_WINDOW 240      // Frames kept for the rolling stats
+#define PACER_GOVERNOR_WINDOW 120   // Frames between governor decisions
+#define PACER_SPIN_MIN 0.0005       // Always busy-wait at least the last half millisecond
+#define PACER_SPIN_MAX 0.004
+
+/* How we wait between frames, picked per game state in main.c */
+typedef enum PacingPolicy
+{
+    PACING_UNCAPPED,        // Benchmark: no waiting at all
+    PACING_DISPLAY_LOCKED,  // Gameplay: one frame per refresh, or per 2nd/3rd.. refresh if we can't keep up
+    PACING_EVENT_DRIVEN     // Menus: sleep until input arrives or the next animation tick
+} PacingPolicy;
+
+typedef struct FrameStats
+{
+    int frameCount;         // Frames in the rolling window
+    double meanMs;
+    double deviationMs;     // Standard deviation, our "stability" number
+    double p99Ms;
+    double worstMs;
+    int missedDeadlines;    // In the rolling window
+
+    PacingPolicy policy;
+    double refreshRate;
+    double targetMs;        // 0 = uncapped
+    int divisor;
+    double spinMarginMs;    // How much of each wait we currently busy-wait
+    bool focused;
+} FrameStats;
+
+void InitFramePacer(void); // After InitWindow!
+void SetPacingPolicy(PacingPolicy policy);
+void PaceFrame(void); // After EndDrawing: waits until the next frame should start
+FrameStats GetFrameStats(void);
+void DrawFrameStats(int x, int y);
+void ShutdownFramePacer(void);
+
+#endif // FRAME_PACER_H
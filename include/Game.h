@@ -9,6 +9,13 @@
 #include "PowerUp.h"
 #include "Core.h"
 #include "Leaderboard.h"
+#include "Particles.h"
+#include "Telemetry.h"
+#include "ScreenCache.h"
+#include "Simulation.h"
+
+// Late latching: never draw the paddle further ahead of the simulation than this
+#define LATE_LATCH_MAX_LEAD 0.05f
 
 // UI
 #define PADDING_TOP 40
@@ -35,17 +42,28 @@ typedef struct Game
     int screenHeight;
 
     RenderTexture2D gameTexture; // before background!
+    ScreenCache screenCache;     // Menus and end screens, drawn once instead of every frame
     Background background;
 
     GameState state;
     MenuOption selectedOption;
     bool inMenu;
     bool shouldClose;
+    bool headless;          // No window: no textures, no leaderboard, finished runs aren't saved
+    bool benchmarkMode;     // F2: uncapped frame rate
+    bool showFrameStats;    // F3: frame pacing overlay
+    bool showInputLatency;  // F4: input-to-present measurement
+    bool lateLatchEnabled;  // F5: compare with and without late latching
+    double inputSampleTime; // When the simulation last moved the paddle
+
+    InputState input;       // Timestamped input, applied tick by tick
+    double simTime;         // Simulated seconds this run, power-up timers count in this
+    SimRandom random;       // Everything random in the simulation draws from this
     float menuArrowTimer;
 
     Player player;
     Ball ball;
-    Block blocks[MAX_BLOCK_ROWS][MAX_BLOCK_COLUMNS];
+    Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS];
     int currentBlockRows;
     int currentBlockColumns;
 
@@ -59,6 +77,11 @@ typedef struct Game
     PowerUp powerUps[10];
     PowerUpSpawnSystem spawnSystem;
     bool isTimewarpActive;
+    int rewindCharges;      // From rewind power-ups
+    int rewindTicks;        // How far back the current rewind has scrubbed, 0 when not rewinding
+
+    ParticleSystem particles;
+    RunTelemetry telemetry;
 
     float timeScale;
     float normalTimeScale;
@@ -69,20 +92,26 @@ typedef struct Game
     const float UI_UPDATE_INTERVAL;
 
     int currentLevel;
-    const int maxLevels;
+    int maxLevels;          // From the level pack, or the built-in PROCEDURAL_LEVEL_COUNT
+    bool endless;           // Generated levels, one after another, no WIN screen
+    uint64_t levelSeed;     // Picks this run's generated levels
+    uint64_t fixedLevelSeed; // --seed: every endless run uses the same levels (0 = random)
 } Game;
 
 // Core!
 Game InitGame(int width, int height);
+Game InitHeadlessGame(int width, int height);
 void UpdateGame(Game* game);
+void StepSimulation(Game* game, const SimInput* input, float deltaTime);
 void DrawGame(Game game);
 void HandleCollisions(Game* game);
+bool IsBallTouchingPaddle(Vector2 position, float radius, Rectangle paddle);
 void ResetGame(Game* game);
 
 // Power ups!
 void HandlePowerUpCollisions(Game* game);
-void UpdatePowerUps(Game* game);
-void DrawPowerUps(Game* game);
+void UpdatePowerUps(Game* game, float deltaTime);
+void RecordPowerUps(RenderCommandBuffer* commands, const Game* game);
 void DrawPowerUpTimers(Game game);
 
 // UI!
@@ -0,0 +1,40 @@
+﻿#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "Snapshot.h"
+
+#define HISTORY_BUDGET (1024 * 1024)    // Bytes, keyframes and deltas together. Never grows!
+#define HISTORY_KEYFRAME_INTERVAL 48    // Ticks, 0.2 s. Rebuilding any tick applies at most this many deltas
+#define HISTORY_MAX_TICKS (SIM_TICK_RATE * 20)
+
+/* The last few seconds of the simulation, one entry per tick.
+ * Every HISTORY_KEYFRAME_INTERVAL ticks we keep a whole GameSnapshot, in between only what changed
+ * since the tick before: the ball and paddle move every tick, but blocks, power-ups and the score
+ * only show up in a delta on the tick they actually changed. All of it lives in one fixed ring,
+ * the oldest seconds get dropped when it's full. */
+typedef struct HistoryStats
+{
+    size_t bytesUsed;
+    size_t budget;
+    int ticks;              // Entries we could rewind to
+    int keyframes;
+    float seconds;          // ticks as play time
+    float meanDeltaBytes;
+    double meanRecordUs;    // Per tick, includes capturing the snapshot
+    double worstRecordUs;
+    double lastRebuildUs;   // Last ReconstructHistory
+} HistoryStats;
+
+void ClearHistory(void);
+void RecordHistory(const Game* game); // After every StepSimulation
+int GetHistoryLength(void);           // How many ticks back we can go
+
+// ticksAgo 0 is the newest entry. Rebuilds from the nearest keyframe before it.
+bool ReconstructHistory(int ticksAgo, GameSnapshot* snapshot);
+
+HistoryStats GetHistoryStats(void);
+void DrawHistoryStats(int x, int y);
+
+#endif // HISTORY_H
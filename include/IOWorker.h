@@ -0,0 +1,50 @@
+﻿#ifndef IO_WORKER_H
+#define IO_WORKER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "RunJournal.h"
+#include "Telemetry.h"
+
+#define IO_QUEUE_CAPACITY 256
+
+/* Everything that touches the disk goes through here!
+ * The game thread submits requests, a single I/O thread runs them in order,
+ * and the results come back to the game thread through PollIOCompletions. */
+typedef enum IORequestType
+{
+    IO_LOAD_RUNS,       // Snapshot + journal → a ready-built index
+    IO_APPEND_RUN,      // One run to the end of the journal
+    IO_COMPACT_RUNS,    // Fold the journal into a new snapshot
+    IO_APPEND_TELEMETRY,// One run's columns to telemetry.col
+    IO_SAVE_SNAPSHOT,   // Suspend: the run in progress to suspend.snap
+    IO_LOAD_SNAPSHOT,   // Resume: read suspend.snap and delete it, so it only resumes once
+    IO_SAVE_REPLAY      // A finished run's replay to last.replay
+} IORequestType;
+
+typedef struct IORequest IORequest;
+typedef struct GameSnapshot GameSnapshot; // Snapshot.h pulls in all of Game.h
+
+// Completion callbacks run on the GAME thread, during PollIOCompletions
+typedef void (*IOCallback)(IORequest* request, void* context);
+
+struct IORequest
+{
+    IORequestType type;
+    IOCallback callback;
+    bool success;
+
+    RunRecord record;       // IO_APPEND_RUN
+    RunJournal journal;     // IO_LOAD_RUNS result, handed over to the game thread
+    TelemetryRow telemetry; // IO_APPEND_TELEMETRY
+    GameSnapshot* snapshot; // IO_SAVE_SNAPSHOT (freed by the worker), IO_LOAD_SNAPSHOT (freed by the callback)
+    unsigned char* data;    // IO_SAVE_REPLAY, freed by the worker
+    size_t dataSize;
+};
+
+bool StartIOWorker(void);
+void StopIOWorker(void); // Finishes everything still queued first
+bool SubmitIORequest(IORequest request);
+void PollIOCompletions(void* context);
+
+#endif // IO_WORKER_H
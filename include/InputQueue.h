@@ -0,0 +1,42 @@
+﻿#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define INPUT_QUEUE_CAPACITY 1024 // Must be a power of two
+
+// Only the keys the simulation cares about, so the input thread doesn't need raylib's key codes
+typedef enum InputKey
+{
+    INPUT_KEY_LEFT,
+    INPUT_KEY_RIGHT,
+    INPUT_KEY_DASH,
+    INPUT_KEY_LAUNCH,
+    INPUT_KEY_REWIND,
+    INPUT_KEY_COUNT
+} InputKey;
+
+typedef struct InputEvent
+{
+    double time;    // GetPreciseTime() when the key changed
+    InputKey key;
+    bool down;
+} InputEvent;
+
+/* Single producer, single consumer ring buffer, no locks!
+ * The producer only ever writes tail, the consumer only ever writes head.
+ * They sit on separate cache lines so the two threads don't keep stealing the same line from each other. */
+typedef struct InputQueue
+{
+    InputEvent events[INPUT_QUEUE_CAPACITY];
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) atomic_uint tail;
+} InputQueue;
+
+void ResetInputQueue(InputQueue* queue);
+bool PushInputEvent(InputQueue* queue, InputEvent event);   // Producer only
+bool PeekInputEvent(InputQueue* queue, InputEvent* event);  // Consumer only
+void PopInputEvent(InputQueue* queue);                      // Consumer only
+
+#endif // INPUT_QUEUE_H
@@ -0,0 +1,18 @@
+﻿#ifndef INPUT_THREAD_H
+#define INPUT_THREAD_H
+
+#include <stdbool.h>
+#include "InputQueue.h"
+
+#define INPUT_POLL_INTERVAL 0.001 // ~1000 Hz
+
+/* A thread that does nothing but watch the gameplay keys, and timestamps every change.
+ * On Windows it reads the hardware key state directly (GetAsyncKeyState).
+ * Elsewhere raylib/GLFW input only works on the main thread, so StartInputThread returns false,
+ * and the game feeds the same queue from raylib once per frame instead (see PollFrameInput). */
+bool StartInputThread(void);
+void StopInputThread(void);
+bool IsInputThreadRunning(void);
+InputQueue* GetInputQueue(void);
+
+#endif // INPUT_THREAD_H
@@ -0,0 +1,85 @@
+﻿#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/* Spreading a frame's CPU work over the cores. One worker thread per spare core, each with its own deque of jobs:
+ * a worker takes its newest job first, and when it runs dry it steals the oldest from someone else.
+ * The game thread is worker 0. It doesn't sleep while it waits for jobs, it runs them too.
+ *
+ * Jobs are plain functions over a range of items, no fibers: anything that has to happen afterwards is a
+ * continuation, either by waiting on a JobCounter or as the next node of a JobGraph. Jobs must never touch
+ * raylib's drawing or GL, all of that stays on the game thread, which gathers up the results.
+ * Without StartJobSystem (the headless tools) the game thread just runs everything itself. */
+
+#define JOB_MAX_WORKERS 16          // Including the game thread
+#define JOB_QUEUE_CAPACITY 256      // Per worker. A full queue runs the job right away instead
+#define JOB_SPIN_COUNT 4000         // Empty-handed tries before a worker goes to sleep
+#define JOB_GRAPH_MAX_NODES 32
+#define JOB_NODE_MAX_SUCCESSORS 4
+#define JOB_STATS_INTERVAL 0.5      // Seconds the utilization overlay averages over
+
+typedef void (*JobFunction)(void* data, int first, int last); // Items [first, last)
+
+// Profiler hook: called around every job, on the thread that runs it
+typedef void (*JobProfilerHook)(const char* name, int worker, bool begin);
+
+// How many jobs are still running. Zero it, hand it to RunJob/RunParallelFor, then WaitForJobs
+typedef struct JobCounter
+{
+    atomic_int pending;
+} JobCounter;
+
+// One step of a frame's task graph: `count` items, run `batch` at a time as separate jobs
+typedef struct JobNode
+{
+    const char* name;
+    JobFunction function;
+    void* data;
+    int count;
+    int batch;
+
+    int successors[JOB_NODE_MAX_SUCCESSORS];
+    int successorCount;
+    int dependencies;
+
+    struct JobGraph* graph;
+    atomic_int waitingFor;      // Nodes before this one still running
+    atomic_int unfinished;      // Batches still running
+} JobNode;
+
+// Built fresh every frame: add nodes and dependencies, start it, do other work, wait for it
+typedef struct JobGraph
+{
+    JobNode nodes[JOB_GRAPH_MAX_NODES];
+    int nodeCount;
+    JobCounter nodesLeft;
+} JobGraph;
+
+typedef struct JobWorkerStats
+{
+    float utilization;          // Busy fraction over the last JOB_STATS_INTERVAL
+    long long jobs;             // Since StartJobSystem
+    long long steals;
+} JobWorkerStats;
+
+bool StartJobSystem(int workerCount); // Including the game thread, 0: one per core
+void StopJobSystem(void);
+int GetJobWorkerCount(void);
+
+void RunJob(const char* name, JobFunction function, void* data, int first, int last, JobCounter* counter);
+void RunParallelFor(const char* name, JobFunction function, void* data, int count, int batch, JobCounter* counter);
+void WaitForJobs(JobCounter* counter); // Runs jobs itself until the counter is done
+
+int AddGraphJob(JobGraph* graph, const char* name, JobFunction function, void* data, int count, int batch); // -1: full
+bool AddGraphDependency(JobGraph* graph, int before, int after);
+void StartJobGraph(JobGraph* graph);
+void WaitForJobGraph(JobGraph* graph); // Then it's empty again, ready for the next frame
+
+// Profiling
+void SetJobProfilerHook(JobProfilerHook hook); // Before StartJobSystem, NULL for none
+int GetJobWorkerStats(JobWorkerStats* stats, int maxWorkers); // Returns how many it filled
+void DrawJobStats(int x, int y);
+
+#endif // JOB_SYSTEM_H
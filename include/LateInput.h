@@ -0,0 +1,37 @@
+﻿#ifndef LATE_INPUT_H
+#define LATE_INPUT_H
+
+#include <stdbool.h>
+
+#define LATENCY_WINDOW 120 // Frames averaged in the measurement overlay
+
+/* Late latching! raylib only reads input once per frame (inside EndDrawing), so by the time a frame
+ * is presented the paddle shows input that's a whole frame old. Here we ask the OS for the key state
+ * again right before the final composite, and only move the *drawn* paddle with it.
+ * The simulation keeps using raylib's input, so it stays the one source of truth. */
+typedef struct PaddleKeys
+{
+    bool valid;     // false = this platform can't read keys mid-frame, use raylib's state
+    bool left;
+    bool right;
+    bool dash;
+} PaddleKeys;
+
+typedef struct InputLatencyStats
+{
+    int samples;
+    double simulatedMs;     // Input age at present, for what the simulation saw
+    double latchedMs;       // Input age at present, for the late-latched paddle
+    double worstSimulatedMs;
+    double worstLatchedMs;
+    int corrections;        // Frames where the late sample disagreed with the simulation's
+} InputLatencyStats;
+
+PaddleKeys SamplePaddleKeys(void); // Windows only reads the hardware state, safe from any point in the frame
+
+// Measurement mode
+void MarkLateLatch(bool correction);
+void MarkPresent(void);
+InputLatencyStats GetInputLatencyStats(void);
+
+#endif // LATE_INPUT_H
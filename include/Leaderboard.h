@@ -2,9 +2,11 @@
 #define LEADERBOARD_H
 
 #include <stdbool.h>
+#include "RunJournal.h"
 
 #define MAX_LEADERBOARD_ENTRIES 10
-#define LEADERBOARD_FILE "leaderboard.dat"
+#define MAX_PENDING_RUNS 16 // Runs finished before the journal was loaded
+#define LEADERBOARD_FILE "leaderboard.dat" // Old top-10 format, imported once into the run journal
 
 #define LB_FONT_SIZE 30
 #define LB_PADDING 20
@@ -16,15 +18,31 @@ typedef struct {
 } LeaderboardEntry;
 
 typedef struct {
-    LeaderboardEntry entries[MAX_LEADERBOARD_ENTRIES];
+    LeaderboardEntry entries[MAX_LEADERBOARD_ENTRIES]; // Top 10, refreshed from the journal
     int count;
+
+    RunJournal journal; // Every run ever played
+    int lastRank;       // Rank of the most recent run (0 = none yet)
+    int lastTotal;      // How many runs there were at that point
+
+    bool loading;       // No journal yet: the I/O thread is still reading it, or the read never got queued
+    bool loadQueued;    // False if the I/O queue refused the read, AddLeaderboardEntry tries again
+    LeaderboardEntry pending[MAX_PENDING_RUNS];
+    int pendingCount;
+
+    unsigned int revision; // Bumped whenever what the leaderboard screen shows changes
 } Leaderboard;
 
 // Core functions
 Leaderboard InitLeaderboard(void);
-bool SaveLeaderboard(const Leaderboard* leaderboard);
+bool SaveLeaderboard(Leaderboard* leaderboard);
 bool LoadLeaderboard(Leaderboard* leaderboard);
 void AddLeaderboardEntry(Leaderboard* leaderboard, int score, int maxCombo);
+void RefreshLeaderboardEntries(Leaderboard* leaderboard);
 void DrawLeaderboardScreen(const Leaderboard* leaderboard, int screenWidth, int screenHeight);
+void UnloadLeaderboard(Leaderboard* leaderboard);
+
+// I/O thread only
+void ImportLegacyLeaderboard(RunJournal* journal);
 
 #endif
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #define LEVEL_BONUS_MULTIPLIER 100
 #define SCORE_BONUS_MULTIPLIER 0.25f
+#define PROCEDURAL_LEVEL_COUNT 5    // Without a level pack, we fall back to the original growing grids
 
 void DrawLevelComplete(Game game);
 void LoadNextLevel(Game* game);
@@ -12,4 +13,12 @@ void CalculateLevelProgression(int currentLevel, float* speedIncrease, float* wi
 void InitializeLevel(Game* game, int level);
 int CalculateLevelBonus(int level, int currentScore);
 
+// Level pack, mapped once at startup and kept open
+bool LoadLevelPack(const char* path);
+void UnloadLevelPack(void);
+int GetLevelCount(void);
+const char* GetLevelName(int level);
+uint32_t GetLevelPackChecksum(void); // 0 with the built-in levels, replays remember which pack they were played on
+void BuildLevelBlocks(Game* game, int level);
+
 #endif //LEVEL_H
@@ -0,0 +1,68 @@
+﻿#ifndef LEVEL_GENERATOR_H
+#define LEVEL_GENERATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "LevelPack.h"
+
+#define GENERATOR_MIN_ROWS 3
+#define GENERATOR_MAX_ROWS 10           // Leaves room between the blocks and the paddle
+#define GENERATOR_MIN_COLUMNS 6
+#define GENERATOR_MAX_COLUMNS LEVEL_PACK_MAX_COLUMNS
+#define GENERATOR_MAX_BONUS 4
+
+typedef enum LevelPattern
+{
+    PATTERN_FULL,
+    PATTERN_PYRAMID,
+    PATTERN_DIAMOND,
+    PATTERN_CHECKER,
+    PATTERN_STRIPES,
+    PATTERN_FRAME,
+    PATTERN_SCATTER,
+    PATTERN_COUNT
+} LevelPattern;
+
+typedef enum LevelSymmetry
+{
+    SYMMETRY_NONE,
+    SYMMETRY_MIRROR,    // Left half mirrored onto the right
+    SYMMETRY_QUAD,      // ...and the top half onto the bottom
+    SYMMETRY_COUNT
+} LevelSymmetry;
+
+// How lives are spread over the blocks, the total always comes from the difficulty target
+typedef enum LivesLayout
+{
+    LIVES_TOP_HEAVY,    // Like the built-in levels: the top rows are the toughest
+    LIVES_CORE,         // Toughest in the middle
+    LIVES_RANDOM,
+    LIVES_LAYOUT_COUNT
+} LivesLayout;
+
+/* One generated level, in the same cell format as the level pack,
+ * so the game builds it with the exact same code (InitPackedBlocks). */
+typedef struct GeneratedLevel
+{
+    uint64_t seed;
+    int level;
+    int rows;
+    int columns;
+    int blockCount;     // Destructible blocks
+    int totalLives;
+    LevelCell cells[LEVEL_PACK_MAX_ROWS * LEVEL_PACK_MAX_COLUMNS];
+    char name[LEVEL_PACK_MAX_NAME];
+} GeneratedLevel;
+
+// Same seed and level, same layout. Always! Runs and replays depend on it.
+void GenerateLevel(uint64_t seed, int level, GeneratedLevel* out);
+const uint32_t* GetGeneratorPalette(void);
+
+/* The generator thread works one level ahead: request the next level when the current one starts,
+ * and by the time LoadNextLevel comes around, it's just a copy out of the ready slot. */
+bool StartLevelGenerator(void);
+void StopLevelGenerator(void);
+void RequestGeneratedLevel(uint64_t seed, int level);
+bool TakeGeneratedLevel(uint64_t seed, int level, GeneratedLevel* out);
+
+#endif // LEVEL_GENERATOR_H
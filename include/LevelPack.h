@@ -0,0 +1,82 @@
+﻿#ifndef LEVEL_PACK_H
+#define LEVEL_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "MappedFile.h"
+
+#define LEVEL_PACK_FILE "levels.pack"
+#define LEVEL_PACK_MAGIC 0x4B504C42  // "BLPK"
+#define LEVEL_PACK_VERSION 1
+
+#define LEVEL_PACK_MAX_ROWS 12
+#define LEVEL_PACK_MAX_COLUMNS 12
+#define LEVEL_PACK_MAX_LIVES 9          // DrawBlock only has room for one digit
+#define LEVEL_PACK_PALETTE_SIZE 16      // Colour 0 means "shade by lives", like the built-in levels
+#define LEVEL_PACK_MAX_NAME 48
+
+// Cell types, must match BlockType (checked in Level.c)
+#define LEVEL_CELL_NORMAL 0
+#define LEVEL_CELL_SOLID 1              // Can't be destroyed, doesn't count for clearing the level
+#define LEVEL_CELL_BONUS 2              // Always drops a power-up when destroyed
+#define LEVEL_CELL_TYPE_COUNT 3
+
+/* File layout! Everything is little-endian and 4-byte aligned, so the game reads it in place:
+ *   LevelPackHeader
+ *   palette         LEVEL_PACK_PALETTE_SIZE x uint32 (0xRRGGBBAA)
+ *   table of contents, levelCount x LevelPackEntry
+ *   cell data       rows * columns LevelCells per level, row by row
+ *   names           zero-terminated strings
+ * Loading a level is a TOC lookup plus one pass over its cells, nothing gets parsed. */
+typedef struct LevelPackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t levelCount;
+    uint32_t paletteOffset;
+    uint32_t tocOffset;
+    uint32_t fileSize;      // Catches truncated files before we read past the end
+    uint32_t checksum;      // FNV-1a of everything after the header, checked by the validator
+    uint32_t reserved;
+} LevelPackHeader;
+
+typedef struct LevelPackEntry
+{
+    uint32_t cellOffset;
+    uint8_t rows;
+    uint8_t columns;
+    uint16_t blockCount;    // Destructible blocks, so nobody ships a level that can't be cleared
+    uint32_t nameOffset;
+    uint32_t checksum;      // FNV-1a of this level's cells
+} LevelPackEntry;
+
+typedef struct LevelCell
+{
+    uint8_t lives;          // 0 = no block here
+    uint8_t type;
+    uint8_t color;          // Palette index
+    uint8_t reserved;
+} LevelCell;
+
+typedef struct LevelPack
+{
+    MappedFile file;
+    const LevelPackHeader* header;
+    const uint32_t* palette;
+    const LevelPackEntry* toc;
+    int levelCount;
+} LevelPack;
+
+// Opening only checks what's needed to read safely, ValidateLevelPack checks everything
+bool OpenLevelPack(const char* path, LevelPack* pack);
+void CloseLevelPack(LevelPack* pack);
+bool ValidateLevelPack(const LevelPack* pack, bool verbose);
+
+// Pointers straight into the mapped file, valid until CloseLevelPack
+const LevelCell* GetPackedLevel(const LevelPack* pack, int index, int* rows, int* columns);
+const char* GetPackedLevelName(const LevelPack* pack, int index);
+
+uint32_t HashLevelPackBytes(const void* data, size_t size);
+
+#endif // LEVEL_PACK_H
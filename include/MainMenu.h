@@ -5,9 +5,11 @@
 
 #define FONT_SIZE 35
 #define FONT_TITLE_SIZE 65
+#define MENU_SPACING 50
 
 void UpdateMainMenu(Game* game);
 void DrawMainMenu(Game game);
+void DrawMenuArrows(Game game);
 void DrawTutorial(Game game);
 
 #endif // MAINMENU_H
\ No newline at end of file
@@ -0,0 +1,21 @@
+﻿#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Read-only memory-mapped file. The OS pages the file in on demand,
+ * so we can scan huge files without reading them into our own buffers first. */
+typedef struct MappedFile
+{
+    const unsigned char* data;
+    size_t size;
+
+    void* fileHandle;       // Windows only
+    void* mappingHandle;    // Windows only
+} MappedFile;
+
+bool MapFileReadOnly(const char* path, MappedFile* mapped);
+void UnmapFile(MappedFile* mapped);
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,63 @@
+﻿#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include "JobSystem.h"
+
+/* Memory notes, same idea as the quad cache in Background.h:
+ * Per particle = 6 floats (24 bytes) + 1 Color (4 bytes) = 28 bytes
+ * MAX_PARTICLES = 100,000 → 2,800,000 bytes (~2.7MB), allocated once in InitParticleSystem */
+
+#define MAX_PARTICLES 100000
+#define PARTICLE_HIGH_WATER 0.85f // Above this fill level, new bursts get thinned out
+#define PARTICLE_JOB_BATCH 4096    // Shards per job, a multiple of 4 (the SIMD loop runs in fours)
+
+// Burst sizes
+#define PARTICLE_HIT_COUNT 10
+#define PARTICLE_DESTROY_COUNT 40
+
+// Shard look & feel
+#define PARTICLE_WIDTH 2.0f
+#define PARTICLE_LENGTH 5.0f
+#define PARTICLE_STREAK 0.012f      // Extra shard length per pixel/second of velocity
+#define PARTICLE_MIN_SPEED 150.0f
+#define PARTICLE_MAX_SPEED 650.0f
+#define PARTICLE_MIN_LIFE 0.35f
+#define PARTICLE_MAX_LIFE 0.9f
+#define PARTICLE_GRAVITY 1400.0f
+#define PARTICLE_DRAG 2.5f          // Velocity lost per second (fraction)
+
+/* Structure of arrays! Every field lives in its own tightly packed array,
+ * so the update pass can run straight down them four particles at a time.
+ * Live particles are always packed at [0, count), dead ones get swapped out. */
+typedef struct ParticleSystem
+{
+    float* positionX;
+    float* positionY;
+    float* velocityX;
+    float* velocityY;
+    float* life;            // Remaining seconds
+    float* inverseMaxLife;  // 1 / starting life, so fading is a multiply
+    Color* color;
+
+    void* memory;           // One block for all arrays above
+    int capacity;
+    int count;
+
+    unsigned int seed;      // Own tiny RNG, so shards don't eat from rand()
+    int culledCount;        // How many shards we refused/thinned since init
+
+    float stepTime;         // What AddParticleJobs' jobs step by
+    float stepDamping;
+} ParticleSystem;
+
+ParticleSystem InitParticleSystem(int capacity);
+void SpawnParticleBurst(ParticleSystem* system, Rectangle area, Color color, int count);
+void UpdateParticles(ParticleSystem* system, float deltaTime);
+void AddParticleJobs(JobGraph* graph, ParticleSystem* system, float deltaTime); // UpdateParticles, on the job workers
+void DrawParticles(const ParticleSystem* system);
+void ClearParticles(ParticleSystem* system);
+void UnloadParticleSystem(ParticleSystem* system);
+
+#endif // PARTICLES_H
@@ -3,6 +3,8 @@
 
 #include <raylib.h>
 #include <stdbool.h>
+#include "Simulation.h"
+#include "RenderCommands.h"
 
 #define PLAYER_SPEED_BOOST 1.5f
 #define PLAYER_COLOR (Color){0x40, 0xFF, 0x40, 0xFF}  // Bright phosphor green
@@ -11,6 +13,7 @@
 #define PLAYER_TRAIL_LENGTH 16
 #define PLAYER_TRAIL_SPACING 10
 #define PLAYER_BASE_WIDTH 150
+#define PLAYER_TRAIL_RIBBON_POINTS (PLAYER_TRAIL_LENGTH + 2)   // Head, trail and the faded tail past it
 
 typedef struct
 {
@@ -38,11 +41,12 @@ typedef struct Player
 Player InitPlayer(int width, int height);
 
 // Movement functions
-void UpdatePlayerMovement(Player* player, float deltaTime, float screenWidth);
+void UpdatePlayerMovement(Player* player, const SimInput* input, float timeScale, float screenWidth);
 void UpdatePlayerTrail(Player* player, Vector2 prevPosition);
 
-// Trail render
-void DrawPlayerWithTrail(const Player* player);
+// Trail render. The ribbon is shared with the software renderer, 0 points when not dashing
+int GetPlayerTrailRibbon(const Player* player, RibbonPoint points[PLAYER_TRAIL_RIBBON_POINTS]);
+void RecordPlayerTrail(RenderCommandBuffer* commands, const Player* player);
 
 // Color
 void UpdatePlayerColor(Player* player, bool isTimewarpActive);
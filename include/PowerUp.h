@@ -3,6 +3,8 @@
 
 #include <raylib.h>
 #include <stdbool.h>
+#include "Simulation.h"
+#include "RenderCommands.h"
 
 typedef struct Game Game; // We do this to avoid a circular dependency, when referring to Game.h!
 
@@ -12,6 +14,7 @@ typedef struct Game Game; // We do this to avoid a circular dependency, when ref
 #define PU_SPEED_COLOR (Color){0xFF, 0xFF, 0x40, 0xFF}     // Bright yellow with green tint (#FFFF40)
 #define PU_GHOST_COLOR (Color){0x40, 0xFF, 0xFF, 0xFF}     // Bright cyan (#40FFFF)
 #define PU_TIMEWARP_COLOR (Color){0xFF, 0x40, 0xFF, 0xFF}  // Bright purple with green tint (#FF40FF)
+#define PU_REWIND_COLOR (Color){0xA0, 0xA0, 0xFF, 0xFF}    // Pale phosphor blue (#A0A0FF)
 
 #define PU_SPEED_DURATION 12.0
 #define PU_GROWTH_DURATION 13.0
@@ -27,6 +30,11 @@ typedef struct Game Game; // We do this to avoid a circular dependency, when ref
 #define PU_TIMEWARP_MULTIPLIER 0.75f
 #define PU_DAMAGE_MULTIPLIER 3
 
+// Rewind isn't timed, it's a charge: hold BACKSPACE to scrub back through the last few seconds
+#define PU_REWIND_MAX_CHARGES 3
+#define PU_REWIND_SECONDS 4.0f  // Furthest one charge goes back
+#define PU_REWIND_SPEED 3       // Ticks scrubbed back per tick held, 4 s of play rewinds in ~1.3 s
+
 typedef enum
 {
     POWERUP_LIFE,
@@ -35,6 +43,7 @@ typedef enum
     POWERUP_GHOST,
     POWERUP_TIMEWARP,
     POWERUP_DAMAGE,
+    POWERUP_REWIND,
     POWERUP_COUNT // Active array!
 } PowerUpType;
 
@@ -70,13 +79,13 @@ typedef struct
 // Core
 PowerUp CreatePowerUp(Vector2 position, PowerUpType type, float duration);
 void UpdatePowerUp(PowerUp* powerUp, float deltaTime);
-void DrawPowerUp(PowerUp powerUp);
+void RecordPowerUp(RenderCommandBuffer* commands, PowerUp powerUp);
 bool CheckPowerUpCollision(const PowerUp* powerUp, Rectangle playerRect);
 
 // Spawn
 PowerUpSpawnSystem InitPowerUpSpawnSystem(void);
 float CalculateSpawnChance(PowerUpSpawnSystem* system, int combo, int score);
-bool CheckPowerUpSpawn(PowerUpSpawnSystem* system, int combo, int score, float deltaTime);
+bool CheckPowerUpSpawn(PowerUpSpawnSystem* system, int combo, int score, float deltaTime, SimRandom* random);
 void ResetAllPowerUpEffects(Game* game);
 
 // Effects
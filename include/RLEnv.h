@@ -0,0 +1,101 @@
+﻿#ifndef RL_ENV_H
+#define RL_ENV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "BlocksManager.h"
+#include "PowerUp.h"
+
+/* A batch of headless games for training paddle agents, as a plain C API (PaddleEnv, a shared library).
+ * The caller owns every buffer: actions in, observations, rewards, done flags and frames out, one slot per game.
+ * They can live anywhere, shared memory included, we read and write them in place and never copy them.
+ * Everything gets allocated in CreateRLEnv, ResetRLEnv and StepRLEnv don't allocate at all.
+ * The games are split between pinned worker threads, the calling thread plays its own share too. */
+
+#define RL_ENV_MAX_THREADS 64
+#define RL_ENV_SPIN_COUNT 20000          // ~1 ms of spinning before an idle worker goes to sleep
+#define RL_DEFAULT_TICKS_PER_STEP 4      // 60 decisions a second
+#define RL_DEFAULT_WIDTH 1920
+#define RL_DEFAULT_HEIGHT 1080
+#define RL_LIFE_PENALTY 10.0f            // Reward for losing a life, in blocks' worth (BASE_SCORE)
+
+#define RL_DEFAULT_FRAME_WIDTH 64        // 16:9 like the game
+#define RL_DEFAULT_FRAME_HEIGHT 36
+
+#define RL_BLOCK_WORDS ((BLOCK_GRID_ROWS * BLOCK_GRID_COLUMNS + 31) / 32)
+
+typedef enum RLAction
+{
+    RL_ACTION_STAY,
+    RL_ACTION_LEFT,
+    RL_ACTION_RIGHT,
+    RL_ACTION_DASH_LEFT,
+    RL_ACTION_DASH_RIGHT,
+    RL_ACTION_LAUNCH,       // Straight up. Does nothing while the ball is in play
+    RL_ACTION_COUNT         // Anything from here on is STAY
+} RLAction;
+
+// In the dones buffer
+#define RL_RUNNING 0
+#define RL_TERMINATED 1     // Game over (or won the built-in levels)
+#define RL_TRUNCATED 2      // Ran out of maxEpisodeSteps
+
+// What an agent sees of one game. Plain floats and bitmasks, positions 0 to 1 across the screen
+typedef struct RLObservation
+{
+    float ballX;
+    float ballY;
+    float ballDirectionX;
+    float ballDirectionY;
+    float ballSpeed;                            // Over BALL_SPEED_MAX
+    float ballInPlay;                           // 0 while it sits on the paddle
+    float paddleX;                              // Centre
+    float paddleWidth;
+    float lives;
+    float level;
+    float blockRows;                            // The grid the bitmasks use this level
+    float blockColumns;
+    float fallingPowerUps[PU_MAX_COUNT][3];     // x, y, type + 1. All 0 for an empty slot
+    float effects[POWERUP_COUNT];               // Seconds left on each timed effect. Rewind: charges
+    uint32_t blocks[RL_BLOCK_WORDS];            // Bit row * BLOCK_GRID_COLUMNS + column: still there
+    uint32_t solidBlocks[RL_BLOCK_WORDS];       // The ones that can't be broken
+} RLObservation;
+
+typedef struct RLEnvConfig
+{
+    int envCount;
+    int threadCount;        // Including the caller. 0: one per core
+    int ticksPerStep;       // 0: RL_DEFAULT_TICKS_PER_STEP
+    int maxEpisodeSteps;    // 0: episodes only end with the game
+    int screenWidth;        // 0: RL_DEFAULT_WIDTH, the simulation runs in screen space
+    int screenHeight;
+    int frameWidth;         // 0: RL_DEFAULT_FRAME_WIDTH. Only used with a frames buffer
+    int frameHeight;
+    uint64_t seed;          // Same seed, same episodes, however many threads
+    bool campaign;          // The built-in levels (or the level pack) instead of endless generated ones
+    bool pinThreads;        // Worker n on core n. The calling thread is left alone
+} RLEnvConfig;
+
+// envCount slots each, owned by the caller, and left where they are until DestroyRLEnv
+typedef struct RLEnvBuffers
+{
+    const int32_t* actions;         // RLAction, read by StepRLEnv
+    RLObservation* observations;
+    float* rewards;                 // Score gained in BASE_SCOREs, minus RL_LIFE_PENALTY per life lost
+    uint8_t* dones;                 // RL_RUNNING, RL_TERMINATED or RL_TRUNCATED
+    uint8_t* frames;                // frameWidth * frameHeight RGBA pixels per game (SoftRenderer). NULL: no frames
+} RLEnvBuffers;
+
+typedef struct RLEnv RLEnv;
+
+RLEnv* CreateRLEnv(const RLEnvConfig* config, const RLEnvBuffers* buffers); // NULL on failure
+void DestroyRLEnv(RLEnv* env);
+
+// New episodes everywhere. Writes observations (and frames), zero rewards and dones
+void ResetRLEnv(RLEnv* env);
+
+/* One action per game, ticksPerStep ticks each. A game that finishes gets its done flag and reward,
+ * and is reset straight away: its observation is already the next episode's first one. */
+void StepRLEnv(RLEnv* env);
+
+#endif // RL_ENV_H
@@ -0,0 +1,141 @@
+﻿#ifndef RENDER_COMMANDS_H
+#define RENDER_COMMANDS_H
+
+#include <raylib.h>
+#include <stdbool.h>
+
+/* The game screen used to go straight to raylib in draw order: a block, its lives, the next block, a power-up,
+ * its letter... Every switch between shapes and the font (and every outline, which raylib draws as lines)
+ * ends rlgl's current batch. Instead, DrawGame records typed commands here first, sorts them by layer and
+ * then texture, and replays them as a few long runs of quads with rlSetTexture only when it actually changes.
+ *
+ * Recording never touches GL, so a buffer can be filled on one thread and submitted on the render thread.
+ * Layers are drawn in order. Inside a layer, commands with the same texture keep their order, but different
+ * textures get regrouped, so only put things in one layer if it doesn't matter which is drawn first. */
+
+#define RENDER_MAX_COMMANDS 4096
+#define RENDER_MAX_TEXT 8192            // Bytes of text per buffer, terminators included
+#define RENDER_MAX_RIBBON_POINTS 512    // Per buffer, for all the ribbons together
+#define RENDER_CIRCLE_SEGMENTS 36       // Same as DrawCircleV
+#define RENDER_TEXT_LINE_SPACING 2      // raylib's default, for '\n'
+
+// Back to front
+typedef enum RenderLayer
+{
+    RENDER_LAYER_TRAILS,            // The paddle's trail, under everything like it always was
+    RENDER_LAYER_BLOCKS,            // Blocks and bonus outlines
+    RENDER_LAYER_BLOCK_LABELS,      // Lives, each only on top of its own block
+    RENDER_LAYER_PARTICLES,
+    RENDER_LAYER_BALL_TRAIL,        // Over the blocks, so a ghost ball's trail shows through them
+    RENDER_LAYER_BALL,
+    RENDER_LAYER_POWERUPS,
+    RENDER_LAYER_POWERUP_GLYPHS,
+    RENDER_LAYER_PADDLE,            // Only where it isn't late-latched (versus)
+    RENDER_LAYER_COUNT
+} RenderLayer;
+
+typedef enum RenderCommandType
+{
+    RENDER_RECTANGLE,
+    RENDER_RECTANGLE_LINES,         // 1 pixel outline, as 4 thin quads instead of lines
+    RENDER_CIRCLE,
+    RENDER_TEXT,                    // A glyph run in the default font
+    RENDER_TEXTURE,
+    RENDER_RIBBON,                  // A strip along a path, see PushRibbon
+    RENDER_CUSTOM                   // Anything else (the particles' own rlgl loop). Ends the current batch
+} RenderCommandType;
+
+typedef void (*RenderCallback)(const void* data);
+
+// One point along a ribbon's spine: the ribbon is 2 * halfWidth across here, and blends to the next point's colour
+typedef struct RibbonPoint
+{
+    Vector2 position;
+    float halfWidth;
+    Color color;
+} RibbonPoint;
+
+typedef struct RenderCommand
+{
+    RenderCommandType type;
+    unsigned int texture;           // What it samples, the sort key after its layer
+    Color color;
+
+    union
+    {
+        Rectangle rectangle;        // RENDER_RECTANGLE and RENDER_RECTANGLE_LINES
+
+        struct
+        {
+            Vector2 center;
+            float radius;
+        } circle;
+
+        struct
+        {
+            Vector2 position;
+            int fontSize;
+            int textOffset;         // Into the buffer's text
+        } text;
+
+        struct
+        {
+            Texture2D texture;
+            Rectangle source;
+            Rectangle dest;
+        } blit;
+
+        struct
+        {
+            int pointOffset;        // Into the buffer's ribbon points
+            int pointCount;
+        } ribbon;
+
+        struct
+        {
+            RenderCallback draw;
+            const void* data;
+        } custom;
+    };
+} RenderCommand;
+
+typedef struct RenderCommandBuffer
+{
+    RenderCommand commands[RENDER_MAX_COMMANDS];
+    unsigned long long keys[RENDER_MAX_COMMANDS];   // Layer, texture, then the command's index
+    int count;
+    bool sorted;
+
+    char text[RENDER_MAX_TEXT];
+    int textUsed;
+
+    RibbonPoint ribbonPoints[RENDER_MAX_RIBBON_POINTS];
+    int ribbonPointsUsed;
+
+    // Last submit, for the F3 overlay
+    int droppedCount;               // Didn't fit, since the last clear
+    int submittedCount;
+    int batchCount;                 // Texture changes + custom commands, an upper bound on draw calls
+} RenderCommandBuffer;
+
+// Recording. Same arguments as the raylib call each one stands for
+void ClearRenderCommands(RenderCommandBuffer* buffer);
+void PushRectangle(RenderCommandBuffer* buffer, RenderLayer layer, int x, int y, int width, int height, Color color);
+void PushRectangleLines(RenderCommandBuffer* buffer, RenderLayer layer, int x, int y, int width, int height, Color color);
+void PushCircle(RenderCommandBuffer* buffer, RenderLayer layer, Vector2 center, float radius, Color color);
+void PushText(RenderCommandBuffer* buffer, RenderLayer layer, const char* text, int x, int y, int fontSize, Color color);
+void PushTexture(RenderCommandBuffer* buffer, RenderLayer layer, Texture2D texture, Rectangle source, Rectangle dest, Color tint);
+void PushCustom(RenderCommandBuffer* buffer, RenderLayer layer, RenderCallback draw, const void* data);
+
+/* Trails: one quad per segment, joined edge to edge like a triangle strip (rlgl only batches quads and
+ * triangles), coloured per vertex so the alpha fades smoothly along it. Points are copied, head first */
+void PushRibbon(RenderCommandBuffer* buffer, RenderLayer layer, const RibbonPoint* points, int count);
+
+// Optional on the recording thread, SubmitRenderCommands sorts anything that isn't yet
+void SortRenderCommands(RenderCommandBuffer* buffer);
+
+// The render thread: replays everything, in as few batches as the textures allow. Leaves the buffer as it is
+void SubmitRenderCommands(RenderCommandBuffer* buffer);
+void DrawRenderStats(const RenderCommandBuffer* buffer, int x, int y);
+
+#endif // RENDER_COMMANDS_H
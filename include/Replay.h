@@ -0,0 +1,165 @@
+﻿#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "MappedFile.h"
+#include "Snapshot.h"
+
+#define REPLAY_FILE "last.replay"       // The most recent finished run
+#define REPLAY_MAGIC 0x50524B42         // "BKRP"
+#define REPLAY_FOOTER_MAGIC 0x58524B42  // "BKRX"
+#define REPLAY_VERSION 1
+
+// Any seek replays at most this much from the keyframe before it (~2 ms of simulation)
+#define REPLAY_KEYFRAME_SECONDS 5
+#define REPLAY_KEYFRAME_INTERVAL (SIM_TICK_RATE * REPLAY_KEYFRAME_SECONDS)
+
+/* File layout:
+ *   ReplayHeader
+ *   input stream     one run per stretch of identical ticks: varint tick count, varint flags,
+ *                    and the raw moveSeconds float only when the paddle moved. Runs never cross a keyframe.
+ *   keyframes        plain GameSnapshots
+ *   index            one ReplayKeyframe per keyframe, sorted by tick
+ *   ReplayFooter     where the index is, read first when opening
+ * A 20 minute run is a couple of MB, almost all of it keyframes. */
+typedef struct ReplayHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t tickRate;
+    uint32_t tickCount;
+    uint32_t snapshotSize;      // sizeof(GameSnapshot) in the build that wrote it
+    uint32_t snapshotVersion;
+    int32_t screenWidth;        // The simulation plays in screen space
+    int32_t screenHeight;
+    uint32_t levelPackChecksum; // 0: the built-in levels. Another pack means other blocks, so a different run
+    int32_t finalScore;
+    int32_t finalLevel;
+    uint32_t inputOffset;
+    uint32_t inputSize;
+    int32_t finalMaxCombo;
+    uint32_t physics;           // SIM_PHYSICS of the build that recorded it
+    uint32_t reserved;
+} ReplayHeader;
+
+// What one tick's SimInput turns into in the file (and in versus packets)
+typedef enum ReplayInputFlags
+{
+    REPLAY_INPUT_MOVE = 1,          // moveSeconds follows as a raw float
+    REPLAY_INPUT_MOVING = 2,
+    REPLAY_INPUT_DASHING = 4,
+    REPLAY_INPUT_LAUNCH = 8,
+    REPLAY_INPUT_STEER_LEFT = 16,
+    REPLAY_INPUT_STEER_RIGHT = 32,
+    REPLAY_INPUT_LEFT = 64,
+    REPLAY_INPUT_RIGHT = 128,
+    REPLAY_INPUT_DASH = 256
+} ReplayInputFlags;
+
+// 8 bytes a tick while recording, a 20 minute run is about 2 MB before the run-length pass
+typedef struct ReplayInput
+{
+    float moveSeconds;
+    uint32_t flags;
+} ReplayInput;
+
+typedef enum ReplayKeyframeFlags
+{
+    REPLAY_KEYFRAME_CUT = 1     // The timeline jumps here (a rewind), playback has to load it
+} ReplayKeyframeFlags;
+
+// The state right before tick `tick` runs
+typedef struct ReplayKeyframe
+{
+    uint32_t tick;
+    uint32_t flags;
+    uint32_t snapshotOffset;
+    uint32_t inputOffset;       // The run starting at this tick
+} ReplayKeyframe;
+
+typedef struct ReplayFooter
+{
+    uint32_t indexOffset;
+    uint32_t keyframeCount;
+    uint32_t checksum;          // FNV-1a of everything before the footer
+    uint32_t magic;
+} ReplayFooter;
+
+typedef struct Replay
+{
+    MappedFile file;
+    const ReplayHeader* header;
+    const ReplayKeyframe* index;
+    int keyframeCount;
+    bool mapped;                // False: somebody else's buffer (OpenReplayMemory)
+} Replay;
+
+// Where playback is: the next tick to run, and where its input comes from
+typedef struct ReplayCursor
+{
+    const Replay* replay;
+    int tick;
+    uint32_t inputOffset;
+    int runLeft;                // Ticks left in the current run
+    SimInput runInput;
+    int nextKeyframe;           // Index of the first keyframe after tick
+    bool cut;                   // The last ReplayTick loaded a cut keyframe
+} ReplayCursor;
+
+typedef enum ReplayVerdict
+{
+    REPLAY_VALID,
+    REPLAY_DAMAGED,             // Checksum, or the input stream doesn't decode
+    REPLAY_OTHER_LEVELS,        // Recorded with another level pack
+    REPLAY_NOT_FROM_START,      // Doesn't begin like a new run (resumed, retried, or doctored)
+    REPLAY_BAD_CUT,             // A rewind lands somewhere the run never was
+    REPLAY_DIVERGED,            // The inputs play out differently from what the file says
+    REPLAY_UNFINISHED,          // The run never ended
+    REPLAY_WRONG_CLAIM,         // Played out fine, to another score or combo
+    REPLAY_VERDICT_COUNT
+} ReplayVerdict;
+
+typedef struct ReplayCheck
+{
+    ReplayVerdict verdict;
+    int score;                  // What the simulation came to
+    int maxCombo;
+    int ticks;                  // Simulated
+    int failedTick;             // Where it went wrong, -1 if it didn't
+} ReplayCheck;
+
+// One tick's input, packed. The rewind key isn't kept, it never reaches StepSimulation
+ReplayInput PackReplayInput(const SimInput* input);
+SimInput UnpackReplayInput(uint32_t flags, float moveSeconds);
+
+// Recording, from the game thread. Only the simulation ticks are recorded, menus and end screens take no time
+void BeginReplayRecording(const Game* game);
+void RecordReplayTick(const Game* game, const SimInput* input); // Right BEFORE StepSimulation
+void CutReplayRecording(const Game* game, int droppedTicks);    // After a rewind: forget the scrubbed ticks
+void FinishReplayRecording(const Game* game);                   // Hands the file to the I/O thread
+void FreeReplayRecording(void);
+unsigned char* EncodeReplay(const Game* game, size_t* size);    // The recording so far, as a file (malloc'd)
+
+// Files
+bool WriteReplayFile(const char* path, const unsigned char* data, size_t size); // I/O thread only!
+bool OpenReplay(const char* path, Replay* replay);
+bool OpenReplayMemory(const void* data, size_t size, const char* name, Replay* replay); // data must outlive it, 8-byte aligned
+void CloseReplay(Replay* replay);
+bool CheckReplayChecksum(const Replay* replay); // Reads the whole file, so only the tool does it
+bool LoadReplayKeyframe(const Replay* replay, int keyframe, GameSnapshot* snapshot);
+int FindReplayKeyframe(const Replay* replay, int tick); // Last keyframe at or before tick
+
+/* Playback on a (usually headless) Game. Seeking loads the keyframe before the tick, then simulates
+ * forward. ReplayTick gives the next tick's input; the caller runs StepSimulation with it. */
+bool SeekReplay(const Replay* replay, ReplayCursor* cursor, Game* game, int tick);
+bool ReplayTick(ReplayCursor* cursor, Game* game, SimInput* input);
+
+/* For scores from somewhere we don't trust. Only the inputs are taken at their word: the run has to start
+ * like a new one from the menu, every rewind has to land on a state the run really passed through, and
+ * playing it all out has to end the run with the claimed score and max combo. Thread safe on separate Games. */
+ReplayCheck CheckReplayRun(const Replay* replay, Game* game, int claimedScore, int claimedMaxCombo);
+const char* GetReplayVerdictName(ReplayVerdict verdict);
+
+#endif // REPLAY_H
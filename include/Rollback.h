@@ -0,0 +1,86 @@
+﻿#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "Replay.h"
+#include "UdpSocket.h"
+#include "Versus.h"
+
+/* Rollback netcode for versus, over UDP. Both peers run the whole match (both games) themselves.
+ * Every tick, each side's input is sent to the other. A tick never waits for the remote input:
+ * we guess it (the last one we had, minus any launch) and carry on. When the real one arrives and it's not
+ * what we guessed, we load the state saved before that tick and re-simulate up to now with what we know.
+ * Every ROLLBACK_HASH_INTERVAL ticks both sides hash a state every input before it is confirmed for,
+ * and compare: any difference is a desync, and gets reported with its tick.
+ *
+ * Packets carry every input the peer hasn't acknowledged yet, so a lost one costs nothing but a little
+ * latency. For testing on loopback, outgoing packets can be delayed, jittered and dropped on purpose. */
+
+#define ROLLBACK_WINDOW 64              // Saved states. The furthest back a rollback can go, ~265 ms
+#define ROLLBACK_INPUT_HISTORY 256      // Inputs kept per player, must cover the window plus what's unacknowledged
+#define ROLLBACK_DEFAULT_INPUT_DELAY 2  // Ticks local input waits before it's used, the peer has it sooner
+#define ROLLBACK_MAX_INPUT_DELAY 16
+#define ROLLBACK_MAX_PACKET_INPUTS 64
+#define ROLLBACK_HASH_INTERVAL 60       // Ticks between desync checks
+#define ROLLBACK_HASH_HISTORY 16
+#define ROLLBACK_SYNC_INTERVAL 30       // Ticks between slow-downs, so catching up on the peer is gentle
+#define ROLLBACK_SYNC_THRESHOLD 2.0f    // Ticks ahead of the peer before we slow down
+#define ROLLBACK_DELAY_SLOTS 256        // Packets the delay injector can hold back
+#define ROLLBACK_PACKET_MAGIC 0x5653424B // "KBSV"
+
+typedef struct NetConditions
+{
+    int delayMs;            // One way, added to every packet we send
+    int jitterMs;           // +/- on top of the delay
+    float lossPercent;      // Of packets we send, dropped on purpose
+} NetConditions;
+
+typedef struct RollbackConfig
+{
+    int localPlayer;        // 0 or 1, the peer has to be the other
+    int localPort;
+    const char* remoteHost;
+    int remotePort;
+    uint64_t seed;          // Same on both sides
+    int inputDelay;         // 0: ROLLBACK_DEFAULT_INPUT_DELAY
+    int screenWidth;
+    int screenHeight;
+    NetConditions conditions;
+} RollbackConfig;
+
+typedef struct RollbackStats
+{
+    bool connected;
+    double rttMs;           // Smoothed
+    float advantage;        // Ticks we're ahead of the peer, from its last packet and the RTT
+    int confirmedTick;      // Every input before this one is known
+    int rollbacks;
+    long long rolledBackTicks;
+    int longestRollback;
+    int stalls;             // Ticks we sat out: too far ahead, or nothing confirmed for the whole window
+    int checkedHashes;      // Compared with the peer's and the same
+    int desyncTick;         // -1: none. The first tick the peer's state hash didn't match ours
+    int packetsSent;
+    int packetsReceived;
+    int packetsDropped;     // By the loss injector
+} RollbackStats;
+
+// Where the local player's input for a tick comes from: keys (BuildTickInput) or a bot
+typedef SimInput (*RollbackInputSource)(void* context, const VersusMatch* match, double tickStart, double tickEnd);
+
+typedef struct RollbackSession RollbackSession;
+
+RollbackSession* CreateRollbackSession(const RollbackConfig* config); // NULL on failure
+void DestroyRollbackSession(RollbackSession* session);
+
+/* Once a frame: takes in the peer's packets (rolling back if they change the past), runs the ticks that are due,
+ * and sends our inputs. Nothing runs until the peer has been heard from once. */
+void RunRollbackSession(RollbackSession* session, double now, RollbackInputSource source, void* context);
+
+const VersusMatch* GetRollbackMatch(const RollbackSession* session);
+int GetRollbackLocalPlayer(const RollbackSession* session);
+RollbackStats GetRollbackStats(const RollbackSession* session);
+bool GetConfirmedHash(const RollbackSession* session, int tick, uint32_t* hash); // Only ROLLBACK_HASH_INTERVAL ticks
+
+#endif // ROLLBACK_H
@@ -0,0 +1,82 @@
+﻿#ifndef RUN_JOURNAL_H
+#define RUN_JOURNAL_H
+
+#include <stdbool.h>
+
+#define RUN_JOURNAL_FILE "runs.journal"
+#define RUN_SNAPSHOT_FILE "runs.snapshot"
+#define RUN_JOURNAL_VERSION 1
+#define RUN_JOURNAL_MAGIC 0x4A524B42   // "BKRJ"
+#define RUN_SNAPSHOT_MAGIC 0x53524B42  // "BKRS"
+
+#define RUN_COMPACT_INTERVAL 256       // Appends between compactions
+#define RUN_INDEX_MAX_DEPTH 128        // GetTopRuns' stack. Way deeper than a treap should get, but it copes if not
+
+/* Every run ever played, one fixed-size record each (24 bytes).
+ * 1,000,000 runs = ~23MB on disk, ~38MB in the index. */
+typedef struct RunRecord
+{
+    long long timestamp;
+    int score;
+    int maxCombo;
+    unsigned int sequence;  // Run number, older runs win score ties
+    unsigned int checksum;  // Catches half-written records after a crash
+} RunRecord;
+
+typedef struct RunFileHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int generation;    // Bumped every time the journal gets compacted
+    unsigned int count;         // Snapshot only: records that follow
+    long long journalOffset;    // Snapshot only: journal bytes already folded in
+} RunFileHeader;
+
+/* Order-statistic treap! It's a binary search tree sorted by rank,
+ * where every node also knows the size of its subtree. That lets us answer
+ * "what rank is this run" and "who is #N" in O(log n). */
+typedef struct RunIndexNode
+{
+    RunRecord record;
+    int left;
+    int right;
+    int size;
+    unsigned int priority;
+} RunIndexNode;
+
+typedef struct RunJournal
+{
+    RunIndexNode* nodes;    // Node pool, -1 means "no node"
+    int nodeCount;
+    int nodeCapacity;
+    int root;
+
+    unsigned int generation;
+    long long journalOffset;    // How far into the journal we've loaded
+    unsigned int nextSequence;
+    int appendsSinceCompaction;
+    unsigned int prioritySeed;
+    bool snapshotLoaded;
+} RunJournal;
+
+/* Files: these block on disk, so they're meant for the I/O worker, never the game thread! */
+bool LoadRunJournal(RunJournal* journal);
+bool WriteRunRecords(const RunRecord* records, int count);
+bool CompactRunFiles(void);
+
+// Core
+RunJournal InitRunJournal(void);
+RunRecord CreateRunRecord(RunJournal* journal, int score, int maxCombo);
+void UnloadRunJournal(RunJournal* journal);
+
+// Index
+void InsertRunRecord(RunJournal* journal, RunRecord record);
+int GetRunCount(const RunJournal* journal);
+int GetRunRank(const RunJournal* journal, const RunRecord* record);
+bool GetRunAtRank(const RunJournal* journal, int rank, RunRecord* outRecord);
+int GetTopRuns(const RunJournal* journal, RunRecord* outRecords, int count);
+
+unsigned int CalculateRunChecksum(const RunRecord* record);
+bool ReplaceRunFile(const char* tempPath, const char* path); // Also used for the suspend snapshot
+
+#endif // RUN_JOURNAL_H
@@ -0,0 +1,28 @@
+﻿#ifndef SCREEN_CACHE_H
+#define SCREEN_CACHE_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include "Core.h"
+
+/* The menus, tutorial, leaderboard and end screens are just text that almost never changes.
+ * Instead of measuring and drawing all of it every frame, we draw the screen once into a texture,
+ * and only redraw it when its key changes. The key is a hash of everything the screen shows
+ * (state, selected option, scores...), so any input or data change invalidates it by itself. */
+typedef struct ScreenCache
+{
+    RenderTexture2D texture;
+    unsigned int key;
+    bool valid;
+    bool rebuilt;       // Redrawn this frame, so anything built on top of it is stale too
+    int rebuildCount;   // Debug: should only go up on input, never every frame
+} ScreenCache;
+
+ScreenCache InitScreenCache(int width, int height);
+unsigned int HashScreenKey(unsigned int key, int value);
+bool BeginScreenCache(ScreenCache* cache, unsigned int key); // false = still up to date, draw nothing
+void EndScreenCache(ScreenCache* cache);
+void InvalidateScreenCache(ScreenCache* cache);
+void UnloadScreenCache(ScreenCache* cache);
+
+#endif // SCREEN_CACHE_H
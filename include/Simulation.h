@@ -0,0 +1,62 @@
+﻿#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "InputQueue.h"
+
+/* Fixed timestep! The game logic runs in ticks of exactly SIM_DT, no matter the render frame rate.
+ * Every input event carries a timestamp, and is applied inside the tick it happened in. */
+#define SIM_TICK_RATE 240
+#define SIM_DT (1.0f / SIM_TICK_RATE)
+#define SIM_MAX_TICKS_PER_FRAME 24 // 100 ms. After a longer hitch we drop time instead of trying to catch up
+
+// Which ball physics this build runs (see FixedMath.h). Replays only play back on the kind that recorded them
+#define SIM_PHYSICS_FLOAT 0
+#define SIM_PHYSICS_FIXED 1
+
+#ifdef FIXED_POINT_PHYSICS
+    #define SIM_PHYSICS SIM_PHYSICS_FIXED
+#else
+    #define SIM_PHYSICS SIM_PHYSICS_FLOAT
+#endif
+
+// Everything one tick needs to know about the player's input
+typedef struct SimInput
+{
+    float moveSeconds;  // Seconds held right minus seconds held left (dash time counts PLAYER_SPEED_BOOST times)
+    bool moving;        // Moved at all this tick
+    bool dashing;       // Dashed at any point this tick
+    bool launch;        // Launch went down this tick (even if it went back up before the tick ended)
+    int launchSteer;    // -1 left, 0 none, 1 right: what was held at the moment of the launch
+    bool left;          // Held at the end of the tick
+    bool right;
+    bool dash;
+    bool rewind;        // Held at the end of the tick: scrub back instead of simulating
+} SimInput;
+
+// Consumer side of the input queue, owned by the game thread
+typedef struct InputState
+{
+    bool held[INPUT_KEY_COUNT]; // As of the last event we applied
+    bool polled[INPUT_KEY_COUNT]; // Fallback only: what raylib said last frame
+    double clock;               // Real time the next tick starts at
+    bool clockRunning;
+} InputState;
+
+// The only randomness the simulation may use! Seeded per run, and part of every snapshot.
+typedef struct SimRandom
+{
+    uint64_t state;
+} SimRandom;
+
+void PollFrameInput(InputState* state, InputQueue* queue); // Only when there's no input thread!
+void DiscardInput(InputState* state, InputQueue* queue, double before);
+SimInput BuildTickInput(InputState* state, InputQueue* queue, double tickStart, double tickEnd);
+
+SimRandom SeedSimRandom(uint64_t seed);
+uint32_t NextSimRandom(SimRandom* random);
+int SimRandomRange(SimRandom* random, int min, int max); // Inclusive, like GetRandomValue
+float SimRandomFloat(SimRandom* random);                 // 0 to 1
+
+#endif // SIMULATION_H
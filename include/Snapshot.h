@@ -0,0 +1,67 @@
+﻿#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "Game.h"
+
+#define SUSPEND_FILE "suspend.snap"
+#define SNAPSHOT_MAGIC 0x50534B42   // "BKSP"
+#define SNAPSHOT_VERSION 2   // 2: rewind charges
+
+/* Everything the simulation needs to carry on exactly where it left off, and nothing else:
+ * no textures, no particles, no leaderboard, no input. It's all plain data without pointers,
+ * so capturing or restoring is a handful of struct copies (well under a microsecond). */
+typedef struct GameSnapshot
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;          // sizeof(GameSnapshot) in the build that wrote it
+    uint32_t checksum;      // Only used in files
+
+    GameState state;
+    int currentLevel;
+    bool endless;
+    uint64_t levelSeed;
+    SimRandom random;
+    double simTime;
+
+    Player player;
+    Ball ball;
+    int blockRows;
+    int blockColumns;
+    Block blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS];
+
+    PowerUp powerUps[PU_MAX_COUNT];
+    int powerUpCount;
+    PowerUpSpawnSystem spawnSystem;
+    bool isTimewarpActive;
+    float timeScale;
+    int rewindCharges;
+
+    int combo;
+    int maxCombo;
+    int lastScoreGained;
+    float lastScoreTimer;
+
+    RunTelemetry telemetry;
+} GameSnapshot;
+
+void CaptureSnapshot(const Game* game, GameSnapshot* snapshot);
+bool RestoreSnapshot(Game* game, const GameSnapshot* snapshot);
+void ApplySnapshot(Game* game, const GameSnapshot* snapshot); // Simulation state only, no checks (rewind)
+const char* CompareSnapshots(const GameSnapshot* a, const GameSnapshot* b); // NULL, or the first field that differs
+
+// Retry: the state at the start of the current level, kept in memory
+void MarkLevelStart(const Game* game);
+bool RetryLevel(Game* game);
+
+// Suspend on quit, resume on launch. The file work happens on the I/O thread
+void SuspendGame(const Game* game);
+void ResumeSuspendedGame(void);
+
+// Files (I/O thread only!)
+bool WriteSnapshotFile(const char* path, GameSnapshot* snapshot);
+bool ReadSnapshotFile(const char* path, GameSnapshot* snapshot);
+
+#endif // SNAPSHOT_H
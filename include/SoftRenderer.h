@@ -0,0 +1,34 @@
+﻿#ifndef SOFT_RENDERER_H
+#define SOFT_RENDERER_H
+
+#include <raylib.h>
+
+typedef struct Game Game;
+
+/* The game scene without a GPU or a window: DrawGame's PLAYING layers (dash trail, blocks, ball and its trail,
+ * power-ups, paddle) drawn on the CPU into a small framebuffer, for agents' pixel observations and golden images.
+ * Every shape is filled in spans, with its edges anti-aliased by how much of each pixel it covers, so a
+ * 64x36 render looks like the 1920x1080 GL one scaled down. What it leaves out: block lives and power-up glyphs
+ * (text), particles, and the background's CRT effects. Spans are filled four pixels at a time with SSE2; the
+ * trails' ribbons change colour along their length, so their triangles blend pixel by pixel. */
+
+#define SOFT_CIRCLE_SUBROWS 4   // Coverage samples per pixel row along circle edges
+
+// Same layout as an uncompressed R8G8B8A8 raylib Image, so ExportImage can take it as it is
+typedef struct SoftFramebuffer
+{
+    Color* pixels;      // width * height, top row first. Owned by whoever made it
+    int width;
+    int height;
+} SoftFramebuffer;
+
+// Shapes, in framebuffer pixels. Blending is the usual source-over, and the framebuffer stays opaque
+void SoftClear(SoftFramebuffer* target, Color color);
+void SoftFillRectangle(SoftFramebuffer* target, float x, float y, float width, float height, Color color);
+void SoftFillEllipse(SoftFramebuffer* target, float centerX, float centerY, float radiusX, float radiusY, Color color);
+void SoftFillTriangle(SoftFramebuffer* target, Vector2 a, Vector2 b, Vector2 c, Color colorA, Color colorB, Color colorC);
+
+// The whole game screen, scaled to fit the framebuffer. Thread safe, only reads the game
+void RenderGameSoftware(const Game* game, SoftFramebuffer* target);
+
+#endif // SOFT_RENDERER_H
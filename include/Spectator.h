@@ -0,0 +1,118 @@
+﻿#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "Game.h"
+#include "TcpSocket.h"
+
+/* Spectating over TCP, for casters watching from another machine. The game (--spectate-port) sends what's on
+ * screen SPECTATOR_FRAME_RATE times a second, quantized: positions in 1/8 pixels, 16 bits each. A frame only
+ * carries the fields that changed since the one before, the blocks that lost lives and power-ups that appeared
+ * or went. Falling power-ups aren't sent every frame: both ends move them the same way from where they
+ * appeared, and the game only sends one again if it's drifted. Someone joining late gets a whole snapshot
+ * first, then the same deltas as everyone else. A new level is a new snapshot for everyone.
+ *
+ * Every message is a little-endian uint16 length, then a type byte and the rest. */
+
+#define SPECTATOR_DEFAULT_PORT 7788
+#define SPECTATOR_VERSION 1
+#define SPECTATOR_FRAME_RATE 30
+#define SPECTATOR_MAX_CLIENTS 8
+#define SPECTATOR_CLIENT_BUFFER 65536   // Unsent bytes per spectator. A spectator that falls this far behind is dropped
+#define SPECTATOR_MAX_MESSAGE 4096      // A snapshot of the biggest grid, with room to spare
+#define SPECTATOR_SUBPIXELS 8
+#define SPECTATOR_POWERUP_DRIFT 16      // 2 pixels, in subpixels. Further off than this and the power-up is sent again
+
+typedef enum SpectatorMessageType
+{
+    SPECTATOR_SNAPSHOT = 1,
+    SPECTATOR_DELTA = 2
+} SpectatorMessageType;
+
+// What a delta frame carries, in this order
+typedef enum SpectatorField
+{
+    SPECTATOR_FIELD_STATE = 1,          // Game state and flags
+    SPECTATOR_FIELD_BALL = 2,           // Position
+    SPECTATOR_FIELD_BALL_LOOK = 4,      // Radius and color
+    SPECTATOR_FIELD_PADDLE = 8,         // x
+    SPECTATOR_FIELD_PADDLE_LOOK = 16,   // y, size and color
+    SPECTATOR_FIELD_SCORE = 32,
+    SPECTATOR_FIELD_COUNTERS = 64,      // Lives, level, combo
+    SPECTATOR_FIELD_TIME_SCALE = 128,
+    SPECTATOR_FIELD_BLOCKS = 256,       // Changed lives
+    SPECTATOR_FIELD_POWERUPS = 512      // Appeared (or drifted), and gone
+} SpectatorField;
+
+typedef enum SpectatorFlags
+{
+    SPECTATOR_BALL_ACTIVE = 1,
+    SPECTATOR_TIMEWARP = 2
+} SpectatorFlags;
+
+typedef struct SpectatorBlock
+{
+    int16_t x, y, width, height;    // Whole pixels, blocks don't move
+    int8_t lives;                   // -1: gone
+    uint8_t type;
+    Color tint;
+} SpectatorBlock;
+
+typedef struct SpectatorPowerUp
+{
+    bool visible;                   // Falling, not yet caught or missed
+    uint8_t type;
+    uint16_t x, y;                  // Subpixels
+    int16_t speed;                  // Pixels a second, down
+} SpectatorPowerUp;
+
+// The quantized screen, as both ends know it
+typedef struct SpectatorState
+{
+    uint32_t time;                  // Milliseconds since the stream started
+    int16_t screenWidth, screenHeight;
+
+    uint8_t state;                  // GameState
+    uint8_t flags;
+    uint16_t ballX, ballY, ballRadius;
+    Color ballColor;
+    uint16_t paddleX, paddleY, paddleWidth, paddleHeight;
+    Color paddleColor;
+    int32_t score;
+    uint8_t lives;
+    uint16_t level;
+    uint16_t combo;
+    uint8_t timeScale;              // Percent
+
+    uint8_t rows, columns;
+    SpectatorBlock blocks[BLOCK_GRID_ROWS][BLOCK_GRID_COLUMNS];
+    SpectatorPowerUp powerUps[PU_MAX_COUNT];
+} SpectatorState;
+
+typedef struct SpectatorStats
+{
+    int clients;
+    int frames;
+    int snapshots;
+    long long bytesSent;
+    double busySeconds;             // Spent in UpdateSpectatorServer
+    double runSeconds;
+} SpectatorStats;
+
+// Game side, a static singleton like the I/O worker
+bool StartSpectatorServer(int port);
+void StopSpectatorServer(void);     // Prints what it cost
+void UpdateSpectatorServer(const Game* game, double now); // Once a frame: accepts, sends a frame when one is due
+SpectatorStats GetSpectatorStats(void);
+
+/* Game side, for anything else streaming state (the game server): a frame of `next` for whoever has `known`,
+ * a delta when it can be, a snapshot otherwise (the type byte after the length says which). `known` catches up */
+void CaptureSpectatorState(const Game* game, uint32_t time, SpectatorState* state);
+int EncodeSpectatorFrame(SpectatorState* known, bool* haveKnown, const SpectatorState* next, unsigned char* buffer, int capacity);
+int EncodeSpectatorSnapshot(const SpectatorState* state, unsigned char* buffer, int capacity); // For late joiners
+
+// Viewer side: one message, without its length. False when it doesn't make sense (or it's a delta before any snapshot)
+bool ApplySpectatorMessage(SpectatorState* state, bool* haveSnapshot, const unsigned char* data, int size);
+
+#endif // SPECTATOR_H
@@ -0,0 +1,21 @@
+﻿#ifndef TCP_SOCKET_H
+#define TCP_SOCKET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "UdpSocket.h"
+
+/* The TCP half of UdpSocket.h, for the spectator stream: a non-blocking listener, and non-blocking connections
+ * that send and receive whatever fits right now. StartNetworking/StopNetworking cover both. */
+
+typedef intptr_t TcpSocket;
+#define TCP_INVALID_SOCKET ((TcpSocket)-1)
+
+TcpSocket OpenTcpListener(int port);                    // TCP_INVALID_SOCKET on failure
+TcpSocket AcceptTcp(TcpSocket listener);                // TCP_INVALID_SOCKET: nobody waiting
+TcpSocket ConnectTcp(const char* host, int port);       // Blocks until connected. TCP_INVALID_SOCKET on failure
+void CloseTcpSocket(TcpSocket socket);
+int SendTcp(TcpSocket socket, const void* data, int size);          // Bytes taken, 0: buffer full, -1: gone
+int ReceiveTcp(TcpSocket socket, void* buffer, int capacity);       // Bytes, 0: nothing waiting, -1: closed
+
+#endif // TCP_SOCKET_H
@@ -0,0 +1,78 @@
+﻿#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TELEMETRY_FILE "telemetry.col"
+#define TELEMETRY_MAGIC 0x4D544B42  // "BKTM"
+#define TELEMETRY_VERSION 2   // 2: rewind power-up columns
+
+#define TELEMETRY_POWERUP_TYPES 7   // Must match POWERUP_COUNT (checked in Game.c)
+#define TELEMETRY_MAX_DEATHS 8      // We keep the tick of the first 8 deaths
+#define TELEMETRY_BLOCK_ROWS 4096   // Runs per column block
+
+/* Column layout! Every column is one int per run.
+ * The file is split into blocks of TELEMETRY_BLOCK_ROWS runs, and inside a block each column
+ * is stored back to back. Scanning "score" is then one tight array per block,
+ * instead of hopping over every other field like with a struct per run. */
+typedef enum TelemetryColumn
+{
+    TELEMETRY_TIMESTAMP,
+    TELEMETRY_SCORE,
+    TELEMETRY_MAX_COMBO,
+    TELEMETRY_LEVEL,
+    TELEMETRY_DURATION_MS,
+    TELEMETRY_TICKS,
+    TELEMETRY_BLOCKS_HIT,
+    TELEMETRY_LIVES_LOST,
+    TELEMETRY_SPAWNED_FIRST,    // One column per power-up type
+    TELEMETRY_COLLECTED_FIRST = TELEMETRY_SPAWNED_FIRST + TELEMETRY_POWERUP_TYPES,
+    TELEMETRY_DEATH_TICK_FIRST = TELEMETRY_COLLECTED_FIRST + TELEMETRY_POWERUP_TYPES,
+    TELEMETRY_COLUMN_COUNT = TELEMETRY_DEATH_TICK_FIRST + TELEMETRY_MAX_DEATHS
+} TelemetryColumn;
+
+// 32 bytes, so every column starts 16-byte aligned for SIMD loads
+typedef struct TelemetryFileHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int columnCount;
+    unsigned int blockRows;
+    unsigned int rowCount;      // Only bumped once a run is fully written
+    unsigned int reserved[3];
+} TelemetryFileHeader;
+
+// What we count while a run is being played
+typedef struct RunTelemetry
+{
+    int ticks;
+    float duration;
+    int blocksHit;
+    int livesLost;
+    int powerUpsSpawned[TELEMETRY_POWERUP_TYPES];
+    int powerUpsCollected[TELEMETRY_POWERUP_TYPES];
+    int deathTicks[TELEMETRY_MAX_DEATHS];
+} RunTelemetry;
+
+// One finished run, flattened into column order
+typedef struct TelemetryRow
+{
+    int values[TELEMETRY_COLUMN_COUNT];
+} TelemetryRow;
+
+// Recording
+void ResetRunTelemetry(RunTelemetry* telemetry);
+void RecordTelemetryDeath(RunTelemetry* telemetry);
+TelemetryRow BuildTelemetryRow(const RunTelemetry* telemetry, int score, int maxCombo, int level);
+
+// Files (I/O thread only!)
+bool AppendTelemetryRow(const TelemetryRow* row);
+
+// Column access for readers
+const char* GetTelemetryColumnName(int column);
+int FindTelemetryColumn(const char* name);
+size_t GetTelemetryBlockBytes(void);
+const int* GetTelemetryColumnBlock(const unsigned char* fileData, int column, int block);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,17 @@
+﻿#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+
+/* High resolution clock and sleeping, for frame pacing, and the little bit of thread placement we need.
+ * Lives in its own file because windows.h and raylib.h can't be included together. */
+
+void BeginHighResolutionTimer(void);    // Asks the OS for 1 ms sleep granularity (Windows)
+void EndHighResolutionTimer(void);
+double GetPreciseTime(void);            // Seconds, monotonic
+void SleepSeconds(double seconds);      // Coarse! May oversleep by a scheduler tick
+void SpinPause(void);                   // Be nice to the other hyperthread while busy-waiting
+int GetCoreCount(void);                 // Logical cores
+bool PinThreadToCore(int core);         // The calling thread. False where the OS doesn't let us
+
+#endif // TIMING_H
@@ -0,0 +1,33 @@
+﻿#ifndef UDP_SOCKET_H
+#define UDP_SOCKET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Just enough UDP for versus: one non-blocking socket, send to an address, receive whatever's waiting.
+ * Lives in its own file for the same reason as Timing.c, winsock2.h drags windows.h in with it. */
+
+#define UDP_MAX_PACKET 1200     // Stays under any real MTU, so nothing gets fragmented
+
+typedef intptr_t UdpSocket;
+#define UDP_INVALID_SOCKET ((UdpSocket)-1)
+
+// IPv4, both in host byte order
+typedef struct UdpAddress
+{
+    uint32_t host;
+    uint16_t port;
+} UdpAddress;
+
+bool StartNetworking(void);     // WSAStartup on Windows, nothing elsewhere
+void StopNetworking(void);
+
+bool ResolveUdpAddress(const char* host, int port, UdpAddress* address);
+bool SameUdpAddress(const UdpAddress* a, const UdpAddress* b);
+
+UdpSocket OpenUdpSocket(int port); // 0: any port. UDP_INVALID_SOCKET on failure
+void CloseUdpSocket(UdpSocket socket);
+bool SendUdp(UdpSocket socket, const UdpAddress* to, const void* data, int size);
+int ReceiveUdp(UdpSocket socket, UdpAddress* from, void* buffer, int capacity); // Bytes, 0: nothing waiting, -1: error
+
+#endif // UDP_SOCKET_H
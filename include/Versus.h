@@ -0,0 +1,55 @@
+﻿#ifndef VERSUS_H
+#define VERSUS_H
+
+#include <stdint.h>
+#include "Game.h"
+#include "Snapshot.h"
+
+/* Head-to-head: two headless games side by side, on the same endless levels, stepped together one tick at a time.
+ * Every VERSUS_GARBAGE_COMBO hits in a row sends a garbage block into the other player's field. Last one with
+ * lives left wins. Given the same seed and the same inputs it plays out bit for bit the same on any machine
+ * running the same build, which is all the rollback netcode (Rollback.h) needs from it. */
+
+#define VERSUS_PLAYERS 2
+#define VERSUS_GARBAGE_COMBO 4          // Hits in a row for each garbage block sent
+#define VERSUS_GARBAGE_LIVES 2
+#define VERSUS_MAX_PENDING_GARBAGE 16   // More than this is lost, the field is probably full anyway
+
+#define VERSUS_RUNNING -1
+#define VERSUS_DRAW 2                   // Both ran out of lives on the same tick
+
+typedef struct VersusMatch
+{
+    Game players[VERSUS_PLAYERS];
+    SimRandom garbageRandom;            // Where garbage lands. Its own stream, the games' own stays untouched
+    int pendingGarbage[VERSUS_PLAYERS]; // On its way to this player, lands next tick
+    int comboSent[VERSUS_PLAYERS];      // Garbage already sent for the current combo
+    int tick;
+    int winner;                         // VERSUS_RUNNING, a player, or VERSUS_DRAW
+} VersusMatch;
+
+// Everything StepVersusMatch reads or writes. Saved every tick for rollback, so it stays plain data
+typedef struct VersusState
+{
+    GameSnapshot players[VERSUS_PLAYERS];
+    SimRandom garbageRandom;
+    int pendingGarbage[VERSUS_PLAYERS];
+    int comboSent[VERSUS_PLAYERS];
+    int tick;
+    int winner;
+} VersusState;
+
+void InitVersusMatch(VersusMatch* match, int width, int height, uint64_t seed); // Both sides get the same levels
+void FreeVersusMatch(VersusMatch* match);
+void StepVersusMatch(VersusMatch* match, const SimInput inputs[VERSUS_PLAYERS]);
+
+void SaveVersusState(const VersusMatch* match, VersusState* state);
+void LoadVersusState(VersusMatch* match, const VersusState* state);
+
+// For desync checks: only what the simulation decides, read field by field so padding can't differ
+uint32_t HashVersusState(const VersusState* state);
+
+// Renders both fields into the current target, side by side, each scaled by `scale`
+void DrawVersusMatch(const VersusMatch* match, int localPlayer, float scale, int gap);
+
+#endif // VERSUS_H
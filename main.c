@@ -1,25 +1,125 @@
 ﻿#include <raylib.h>
+#include <stdlib.h>
+#include <string.h>
 #include "Game.h"
+#include "IOWorker.h"
+#include "FramePacer.h"
+#include "InputThread.h"
+#include "Level.h"
+#include "LevelGenerator.h"
+#include "Snapshot.h"
+#include "Replay.h"
+#include "JobSystem.h"
+#include "FrameCapture.h"
+#include "Spectator.h"
+#include "Timing.h"
 
-int main()
+int main(int argc, char** argv)
 {
     const int width = 1920;
     const int height = 1080;
 
     InitWindow(width, height, "Block Kuzushi!");
-    SetTargetFPS(400);
+
+    // No more hard 400 FPS cap: the frame pacer decides how long to wait, per game state
+    InitFramePacer();
+
+    // All file I/O lives on its own thread, so the game never hitches on slow storage
+    StartIOWorker();
+
+    // Worker threads for the parallel bits of a frame (particles, the CRT distortion grid)
+    StartJobSystem(0);
+
+    // Gameplay keys get their own thread, so presses are timestamped to the millisecond, not the frame
+    StartInputThread();
+
+    // Mapped for the whole run, every level loads straight out of it
+    LoadLevelPack(LEVEL_PACK_FILE);
+
+    // Endless levels are generated one level ahead, off the game thread
+    StartLevelGenerator();
 
     Game game = InitGame(width, height);
 
+    // F6/F7/F8 screenshots and recording, read back from the composite without waiting on the GPU
+    InitFrameCapture(game.background.finalTexture.texture.width, game.background.finalTexture.texture.height);
+
+    // If the last session quit in the middle of a run, pick it up again (arrives through PollIOCompletions)
+    ResumeSuspendedGame();
+
+    bool spectating = false;
+
+    // --benchmark: start uncapped, with the frame stats showing
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--benchmark") == 0)
+        {
+            game.benchmarkMode = true;
+            game.showFrameStats = true;
+        }
+
+        // --seed <n>: the same endless levels every run
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            game.fixedLevelSeed = strtoull(argv[++i], NULL, 0);
+        }
+
+        // --spectate-port <n>: stream the game to the Spectate viewer, for casters on another machine
+        if (strcmp(argv[i], "--spectate-port") == 0 && i + 1 < argc)
+        {
+            int port = atoi(argv[++i]);
+            spectating = StartNetworking() && StartSpectatorServer(port);
+        }
+    }
+
     while ((!WindowShouldClose() && !game.shouldClose))
     {
         UpdateGame(&game);
+        UpdateSpectatorServer(&game, GetPreciseTime());
         DrawGame(game);
+        CaptureFrame(game.background.finalTexture);
+
+        /* Gameplay is locked to the display, static screens are cached and only wake up
+         * for input or the next animation tick, and benchmarks don't wait at all. */
+        if (game.benchmarkMode)
+        {
+            SetPacingPolicy(PACING_UNCAPPED);
+        }
+        else
+        {
+            SetPacingPolicy(game.state == PLAYING ? PACING_DISPLAY_LOCKED : PACING_EVENT_DRIVEN);
+        }
+
+        PaceFrame();
+    }
+
+    // Quitting mid-run suspends it instead of losing it
+    SuspendGame(&game);
+
+    // The last frames of a recording still need their GPU copies, so before anything GL goes away
+    ShutdownFrameCapture();
+
+    // Let the I/O thread finish anything still queued (like the last run) before we tear down
+    StopIOWorker();
+    StopInputThread();
+    StopLevelGenerator();
+    StopJobSystem();
+    ShutdownFramePacer();
+
+    if (spectating)
+    {
+        StopSpectatorServer();
+        StopNetworking();
     }
 
     // In my coding rush, I forgot to prevent a memory leak of my render textures.
     UnloadRenderTexture(game.gameTexture);
+    UnloadScreenCache(&game.screenCache);
     UnloadBackground(&game.background);
+    UnloadParticleSystem(&game.particles);
+    UnloadLeaderboard(&game.leaderboard);
+    UnloadLevelPack();
+    FreeReplayRecording();
 
     CloseWindow();
 